@@ -0,0 +1,85 @@
+#include "Benchmark.h"
+#include "AIScheduler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace
+{
+  // stand-in for the NinjaController decision: distance checks against a
+  // handful of targets and a new destination now and then
+  class BenchmarkAgent : public AIAgent
+  {
+  public:
+    BenchmarkAgent() : mThinks(0), mState(0.0f) {}
+
+    void think(float elapsed)
+    {
+      float best = 1e30f;
+      for (int i = 0; i < 64; i++)
+      {
+        const float dx = std::sin(mState + i) * 250.0f;
+        const float dz = std::cos(mState - i) * 250.0f;
+        best = std::min(best, dx * dx + dz * dz);
+      }
+      mState += elapsed + best * 1e-9f;
+      mThinks++;
+    }
+
+    int mThinks;
+    float mState;
+  };
+}
+
+int aiSchedulerBenchmark(int argc, char *argv[])
+{
+  const int agentCount = benchmarkArg(argc, argv, 0, 10000);
+  const int frames = benchmarkArg(argc, argv, 1, 300);
+  const double budget = (argc > 2) ? atof(argv[2]) : 2.0;
+  const float interval = (argc > 3) ? (float)atof(argv[3]) : 0.25f;
+  const float frameTime = 1.0f / 60.0f;
+
+  std::vector<BenchmarkAgent> agents(agentCount);
+
+  // every agent thinks every frame, what the controllers do today
+  BenchmarkTimer timer;
+  for (int f = 0; f < frames; f++)
+  {
+    for (int i = 0; i < agentCount; i++)
+      agents[i].think(frameTime);
+  }
+  const double everyFrameMs = timer.getMilliseconds() / frames;
+
+  AIScheduler scheduler(8, budget);
+  for (int i = 0; i < agentCount; i++)
+  {
+    agents[i].mThinks = 0;
+    scheduler.add(&agents[i], interval);
+  }
+
+  double totalMs = 0.0, worstMs = 0.0;
+  long long updated = 0, deferred = 0;
+  float longestWait = 0.0f;
+
+  for (int f = 0; f < frames; f++)
+  {
+    scheduler.update(frameTime);
+    const AIScheduler::FrameStats& stats = scheduler.getFrameStats();
+
+    totalMs += stats.milliseconds;
+    worstMs = std::max(worstMs, stats.milliseconds);
+    updated += stats.updated;
+    deferred += stats.deferred;
+    longestWait = std::max(longestWait, stats.longestWait);
+  }
+
+  printf("ai: %d agents, %d frames, budget %.2f ms, think interval %.2f s, %d buckets\n",
+    agentCount, frames, budget, interval, scheduler.getBucketCount());
+  printf("  every frame   : %.3f ms/frame\n", everyFrameMs);
+  printf("  scheduled     : %.3f ms/frame avg, %.3f ms worst\n", totalMs / frames, worstMs);
+  printf("  per frame     : %.1f updated, %.1f deferred\n", (double)updated / frames, (double)deferred / frames);
+  printf("  longest wait  : %.3f s\n", longestWait);
+
+  return 0;
+}
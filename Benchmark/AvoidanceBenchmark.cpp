@@ -0,0 +1,126 @@
+#include "Benchmark.h"
+#include "CrowdAvoidance.h"
+
+#include <cmath>
+#include <vector>
+
+// Two square blocks of agents, half of agentCount each, start on opposite
+// sides and swap places, so every agent has to walk through the other
+// block. The rows of one block are half a spacing off the other's, with
+// room for an agent between two rows; closer than that the blocks jam,
+// there is no way through that does not push a whole block aside. Agents
+// that reached their goal can still be pushed off it by the ones passing,
+// so both are counted: reached at some step, and at the goal at the end.
+int avoidanceBenchmark(int argc, char *argv[])
+{
+  const int agentCount = benchmarkArg(argc, argv, 0, 5000);
+  const int steps = benchmarkArg(argc, argv, 1, 2500);
+
+  const float timeStep = 1.0f / 30.0f;
+  const float radius = 15.0f;
+  const float speed = 80.0f;
+  const float spacing = radius * 5.0f;
+  const int side = (int)std::ceil(std::sqrt(agentCount * 0.5f));
+  // the blocks' near edges two spacings apart; every agent walks onto the
+  // place of its counterpart in the other block, 3825 units or about 1430
+  // steps without anyone in the way
+  const float offset = spacing;
+  const float walk = offset * 2.0f + (side - 1) * spacing;
+
+  // the neighbours reach past the next row
+  CrowdAvoidance avoidance(spacing * 1.2f, 2.0f);
+  std::vector<float> goalX(agentCount), goalZ(agentCount);
+  std::vector<char> reached(agentCount, 0);
+
+  for (int i = 0; i < agentCount; i++)
+  {
+    const int group = i & 1;
+    const int cell = i >> 1;
+    const float sign = group ? 1.0f : -1.0f;
+    const float x = sign * (offset + (cell % side) * spacing);
+    const float z = (cell / side - side * 0.5f) * spacing + group * spacing * 0.5f;
+    avoidance.addAgent(x, z, radius, speed);
+    goalX[i] = x - sign * walk;
+    goalZ[i] = z;
+  }
+
+  double totalMs = 0.0, worstMs = 0.0;
+  long long neighbourSum = 0;
+
+  for (int step = 0; step < steps; step++)
+  {
+    for (int i = 0; i < agentCount; i++)
+    {
+      float dx = goalX[i] - avoidance.getPositionX(i);
+      float dz = goalZ[i] - avoidance.getPositionZ(i);
+      const float distance = std::sqrt(dx * dx + dz * dz);
+      if (distance > speed * timeStep)
+      {
+        dx *= speed / distance;
+        dz *= speed / distance;
+      }
+      else
+      {
+        dx /= timeStep;
+        dz /= timeStep;
+      }
+      avoidance.setPreferredVelocity(i, dx, dz);
+    }
+
+    BenchmarkTimer timer;
+    avoidance.computeVelocities(timeStep);
+    const double ms = timer.getMilliseconds();
+
+    totalMs += ms;
+    if (ms > worstMs)
+      worstMs = ms;
+
+    avoidance.integrate(timeStep);
+
+    for (int i = 0; i < agentCount; i++)
+    {
+      const float dx = goalX[i] - avoidance.getPositionX(i);
+      const float dz = goalZ[i] - avoidance.getPositionZ(i);
+      if (dx * dx + dz * dz < radius * radius * 4.0f)
+        reached[i] = 1;
+    }
+  }
+
+  int arrived = 0, reachedCount = 0;
+  double progress = 0.0;
+  for (int i = 0; i < agentCount; i++)
+  {
+    neighbourSum += avoidance.getNeighbourCount(i);
+    reachedCount += reached[i];
+    const float dx = goalX[i] - avoidance.getPositionX(i);
+    const float dz = goalZ[i] - avoidance.getPositionZ(i);
+    if (dx * dx + dz * dz < radius * radius * 4.0f)
+      arrived++;
+    progress += 1.0 - std::sqrt(dx * dx + dz * dz) / walk;
+  }
+
+  // count remaining deep overlaps with a brute force pass over a sample
+  int overlaps = 0;
+  const int sample = agentCount < 1000 ? agentCount : 1000;
+  for (int i = 0; i < sample; i++)
+  {
+    for (int j = 0; j < agentCount; j++)
+    {
+      if (i == j)
+        continue;
+      const float dx = avoidance.getPositionX(i) - avoidance.getPositionX(j);
+      const float dz = avoidance.getPositionZ(i) - avoidance.getPositionZ(j);
+      if (dx * dx + dz * dz < radius * radius)
+        overlaps++;
+    }
+  }
+
+  printf("avoidance: %d agents, %d steps, max %d neighbours\n", agentCount, steps, (int)CrowdAvoidance::MAX_NEIGHBOURS);
+  printf("  avg %.3f ms/step, worst %.3f ms/step, %.3f us/agent\n",
+    totalMs / steps, worstMs, totalMs * 1000.0 / steps / agentCount);
+  printf("  reached goal %d/%d, at goal at end %d/%d, avg progress %.1f%%, avg neighbours at end %.2f, deep overlaps in sample of %d: %d\n",
+    reachedCount, agentCount, arrived, agentCount, progress * 100.0 / agentCount, (double)neighbourSum / agentCount,
+    sample, overlaps);
+
+  return 0;
+}
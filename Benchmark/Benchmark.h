@@ -0,0 +1,45 @@
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+// Headless benchmarks. Every benchmark gets the arguments following its
+// name on the command line and returns the process exit code.
+
+class BenchmarkTimer
+{
+public:
+  BenchmarkTimer() { reset(); }
+
+  void reset(void) { mStart = std::chrono::high_resolution_clock::now(); }
+
+  double getMilliseconds(void) const
+  {
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - mStart).count();
+  }
+
+private:
+  std::chrono::high_resolution_clock::time_point mStart;
+};
+
+inline int benchmarkArg(int argc, char *argv[], int index, int defaultValue)
+{
+  return (index < argc) ? atoi(argv[index]) : defaultValue;
+}
+
+int avoidanceBenchmark(int argc, char *argv[]);
+int aiSchedulerBenchmark(int argc, char *argv[]);
+int scenarioBenchmark(int argc, char *argv[]);
+int collisionBenchmark(int argc, char *argv[]);
+int influenceBenchmark(int argc, char *argv[]);
+int cullingBenchmark(int argc, char *argv[]);
+int occlusionBenchmark(int argc, char *argv[]);
+int lightsBenchmark(int argc, char *argv[]);
+int captureBenchmark(int argc, char *argv[]);
+int transformBenchmark(int argc, char *argv[]);
+int sceneBenchmark(int argc, char *argv[]);
+int sceneCompile(int argc, char *argv[]);
+int streamingBenchmark(int argc, char *argv[]);
+int particleBenchmark(int argc, char *argv[]);
+int impostorBenchmark(int argc, char *argv[]);
@@ -0,0 +1,129 @@
+#include "Benchmark.h"
+#include "FrameEncoder.h"
+
+#include <climits>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+  const double FRAME_MS = 1000.0 / 60.0;
+
+  struct Result
+  {
+    double pushMs;   // copy and push, all frames
+    FrameEncoder::Stats stats;
+  };
+
+  // a moving gradient, stands in for the render texture on the GPU
+  void renderFrame(int frame, int width, int height, std::vector<uint8_t>& rgb)
+  {
+    for (int y = 0; y < height; y++)
+    {
+      uint8_t* row = &rgb[(size_t)y * width * 3];
+      for (int x = 0; x < width; x++)
+      {
+        row[x * 3 + 0] = (uint8_t)(x + frame);
+        row[x * 3 + 1] = (uint8_t)(y + frame * 2);
+        row[x * 3 + 2] = (uint8_t)(x ^ y);
+      }
+    }
+  }
+
+  void removeOutput(FrameEncoder::Format format, const std::string& path, int frames)
+  {
+    if (format == FrameEncoder::FORMAT_RAW)
+    {
+      remove((path + ".rgb").c_str());
+      return;
+    }
+
+    char number[16];
+    for (int i = 0; i < frames; i++)
+    {
+      snprintf(number, sizeof(number), "%06d", i);
+      remove((path + number + ".png").c_str());
+    }
+  }
+
+  // what FrameCapture::_read does on the render thread: the pixels are
+  // copied into a buffer from the encoder, where blitToMemory would put
+  // them, and pushed. Frames are paced at 60 Hz like a running lab, so a
+  // threaded encoder has the rest of the frame to write.
+  Result run(FrameEncoder::Format format, const std::string& path, int frames, int width, int height,
+    int minAsyncPixels)
+  {
+    std::vector<uint8_t> pixels((size_t)width * height * 3);
+    Result result;
+    result.pushMs = 0.0;
+
+    {
+      FrameEncoder encoder(format, path, 8, minAsyncPixels);
+      FrameEncoder::Frame frame;
+      for (int i = 0; i < frames; i++)
+      {
+        BenchmarkTimer pace;
+        renderFrame(i, width, height, pixels);
+
+        BenchmarkTimer timer;
+        encoder.acquire(frame, width, height);
+        frame.number = i;
+        memcpy(&frame.rgb[0], &pixels[0], pixels.size());
+        encoder.push(frame);
+        result.pushMs += timer.getMilliseconds();
+
+        // the rest of the frame the render thread waits for the GPU
+        const double left = FRAME_MS - pace.getMilliseconds();
+        if (left > 0.0)
+          std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(left));
+      }
+      encoder.flush();
+      result.stats = encoder.getStats();
+    }
+
+    removeOutput(format, path, frames);
+    return result;
+  }
+
+  void print(const char* label, const Result& result, int frames)
+  {
+    const double ms = result.pushMs / frames;
+    printf("  %-30s %.3f ms/frame (%.1f%% of the frame), %d written, %d dropped\n", label, ms,
+      ms / FRAME_MS * 100.0, result.stats.framesWritten, result.stats.framesDropped);
+  }
+}
+
+// The render thread's share of capturing once the pixels are in memory,
+// with the encoder on its thread, writing on the render thread, and
+// FrameEncoder's default of threading from MIN_ASYNC_PIXELS up.
+//
+// The second render of the scene into FrameCapture's texture and the wait
+// in blitToMemory are GPU work this benchmark cannot do. The culling
+// benchmark lab logs them per frame (Capture in culling.cfg); until that
+// has been measured against a frame budget, capture costing a few percent
+// of the frame is a goal, not a result.
+int captureBenchmark(int argc, char *argv[])
+{
+  const int frames = benchmarkArg(argc, argv, 0, 120);
+  const int width = benchmarkArg(argc, argv, 1, 640);
+  const int height = benchmarkArg(argc, argv, 2, 480);
+  const std::string formatName = (argc > 3) ? argv[3] : "raw";
+  const FrameEncoder::Format format = (formatName == "png") ? FrameEncoder::FORMAT_PNG : FrameEncoder::FORMAT_RAW;
+
+  const Result async = run(format, "capture_async_", frames, width, height, 0);
+  const Result sync = run(format, "capture_sync_", frames, width, height, INT_MAX);
+  const Result gated = run(format, "capture_gated_", frames, width, height, FrameEncoder::MIN_ASYNC_PIXELS);
+
+  printf("capture: %d frames of %dx%d, %s, paced at %.1f ms\n", frames, width, height, formatName.c_str(), FRAME_MS);
+  printf("  render thread, copy of the read back pixels and push:\n");
+  print("encoder thread:", async, frames);
+  print("writing on the render thread:", sync, frames);
+  print(width * height >= FrameEncoder::MIN_ASYNC_PIXELS ? "default (threaded):" : "default (render thread):",
+    gated, frames);
+  printf("  encoder thread busy: %.3f ms/frame\n", async.stats.encodeMs / frames);
+  printf("  not measured: rendering the scene again and waiting for the GPU in the read back,\n");
+  printf("  so this does not show capture costing a few percent of the frame\n");
+  return 0;
+}
@@ -0,0 +1,94 @@
+#include "Benchmark.h"
+#include "CharacterCollision.h"
+#include "RandomStream.h"
+
+#include <cmath>
+#include <vector>
+
+// Bodies wander around a square area at a fixed density. The first step
+// sorts from scratch, the following ones reuse the order of the previous
+// step and only fix it up with an insertion sort.
+int collisionBenchmark(int argc, char *argv[])
+{
+  const int bodyCount = benchmarkArg(argc, argv, 0, 1000);
+  const int steps = benchmarkArg(argc, argv, 1, 600);
+
+  const float timeStep = 1.0f / 30.0f;
+  const float radius = 15.0f;
+  const float height = 100.0f;
+  const float speed = 60.0f;
+  const float area = std::sqrt((float)bodyCount) * radius * 5.0f;
+
+  RandomStream random(2016);
+
+  CharacterCollision collision;
+  std::vector<float> velX(bodyCount), velZ(bodyCount);
+
+  for (int i = 0; i < bodyCount; i++)
+  {
+    collision.addBody(random.range(-area, area), 0.0f, random.range(-area, area), radius, height);
+    const float angle = random.range(0.0f, 6.2831853f);
+    velX[i] = std::cos(angle) * speed;
+    velZ[i] = std::sin(angle) * speed;
+  }
+
+  BenchmarkTimer timer;
+  collision.step();
+  const double coldMs = timer.getMilliseconds();
+  const int coldSwaps = collision.getStats().swaps;
+
+  double totalMs = 0.0, worstMs = 0.0, broadMs = 0.0, narrowMs = 0.0;
+  long long pairSum = 0, contactSum = 0, swapSum = 0;
+
+  for (int step = 0; step < steps; step++)
+  {
+    for (int i = 0; i < bodyCount; i++)
+    {
+      float x = collision.getX(i) + velX[i] * timeStep;
+      float z = collision.getZ(i) + velZ[i] * timeStep;
+      if (x < -area || x > area)
+        velX[i] = -velX[i];
+      if (z < -area || z > area)
+        velZ[i] = -velZ[i];
+      collision.setPosition(i, x, 0.0f, z);
+    }
+
+    timer.reset();
+    collision.step();
+    const double ms = timer.getMilliseconds();
+
+    totalMs += ms;
+    if (ms > worstMs)
+      worstMs = ms;
+
+    const CharacterCollision::Stats& stats = collision.getStats();
+    broadMs += stats.broadphaseMs;
+    narrowMs += stats.narrowphaseMs;
+    pairSum += stats.pairs;
+    contactSum += stats.contacts;
+    swapSum += stats.swaps;
+  }
+
+  // brute force check that the response left no deep overlap behind
+  int overlaps = 0;
+  const int sample = bodyCount < 1000 ? bodyCount : 1000;
+  for (int i = 0; i < sample; i++)
+  {
+    for (int j = i + 1; j < bodyCount; j++)
+    {
+      const float dx = collision.getX(i) - collision.getX(j);
+      const float dz = collision.getZ(i) - collision.getZ(j);
+      if (dx * dx + dz * dz < radius * radius)
+        overlaps++;
+    }
+  }
+
+  printf("collision: %d bodies, %d steps\n", bodyCount, steps);
+  printf("  first step (full sort) %.3f ms, %d moves\n", coldMs, coldSwaps);
+  printf("  avg %.3f ms/step (broadphase %.3f, narrowphase %.3f), worst %.3f ms, %.2f M bodies/s\n",
+    totalMs / steps, broadMs / steps, narrowMs / steps, worstMs, bodyCount * steps / totalMs / 1000.0);
+  printf("  avg %.1f swaps, %.1f pairs, %.1f contacts per step, deep overlaps in sample of %d: %d\n",
+    (double)swapSum / steps, (double)pairSum / steps, (double)contactSum / steps, sample, overlaps);
+
+  return 0;
+}
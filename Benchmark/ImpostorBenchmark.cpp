@@ -0,0 +1,105 @@
+#include "Benchmark.h"
+#include "ImpostorLod.h"
+#include "RandomStream.h"
+
+#include <cmath>
+#include <vector>
+
+namespace
+{
+  // every view rendered into the atlas has to come back from an eye placed
+  // along its direction, whatever the instance's yaw
+  int checkViews(const ImpostorLod::Settings& settings)
+  {
+    ImpostorLod lod(settings);
+    RandomStream random(7);
+    const float right[3] = { 1.0f, 0.0f, 0.0f }, up[3] = { 0.0f, 1.0f, 0.0f };
+    ImpostorLod::Vertex quad[4];
+    int wrong = 0;
+
+    for (int angle = 0; angle < settings.angles; angle++)
+    {
+      for (int elevation = 0; elevation < settings.elevations; elevation++)
+      {
+        const float yaw = random.range(-3.14159f, 3.14159f);
+        float view[3];
+        lod.clear();
+        lod.add(0.0f, 0.0f, 0.0f, yaw);
+        lod.getViewDirection(angle, elevation, view);
+
+        // from the character's space into the world, turned by its yaw
+        const float distance = 50000.0f;
+        const float eye[3] = { (view[0] * std::cos(yaw) + view[2] * std::sin(yaw)) * distance,
+          settings.centreHeight + view[1] * distance, (-view[0] * std::sin(yaw) + view[2] * std::cos(yaw)) * distance };
+        lod.update(eye, 1000.0f, 1.0f);
+        lod.update(eye, 1000.0f, 1.0f);
+        lod.buildBillboards(right, up, 0.0f, quad, 1);
+
+        float rect[4];
+        lod.getCellRect(lod.getCell(angle, elevation, 0), rect);
+        if (quad[3].uv[0] != rect[0] || quad[3].uv[1] != rect[1])
+          wrong++;
+      }
+    }
+    return wrong;
+  }
+}
+
+// The CloneProfessors field in its random layout, seen from the lab's
+// orbiting camera with a 45 degree field of view on a 720 pixel high
+// viewport: choosing mesh or impostor for every clone and building the
+// billboards, as the lab does every frame.
+int impostorBenchmark(int argc, char *argv[])
+{
+  const int instances = benchmarkArg(argc, argv, 0, 10000);
+  const int frames = benchmarkArg(argc, argv, 1, 300);
+  const float dt = 1.0f / 60.0f, spacing = 130.0f;
+  const float pixelScale = 720.0f / (2.0f * std::tan(3.14159f / 8.0f));
+
+  ImpostorLod::Settings settings;
+  ImpostorLod lod(settings);
+  RandomStream random(2016);
+  const float half = std::sqrt((float)instances) * spacing * 0.5f;
+  for (int i = 0; i < instances; i++)
+    lod.add(random.range(-half, half), 0.0f, random.range(-half, half), random.range(-3.14159f, 3.14159f), random.nextFloat());
+
+  std::vector<ImpostorLod::Vertex> vertices((size_t)instances * 4);
+  double select = 0.0, build = 0.0;
+  long long meshes = 0, impostors = 0, fading = 0, switched = 0;
+  for (int frame = 0; frame < frames; frame++)
+  {
+    // the lab's camera: 800 units out, 400 up, looking at the centre
+    const float angle = frame * 0.5f / 360.0f * 2.0f * 3.14159f;
+    const float eye[3] = { 800.0f * std::cos(angle), 400.0f, -800.0f * std::sin(angle) };
+    float forward[3] = { -eye[0], 100.0f - eye[1], -eye[2] };
+    const float length = std::sqrt(forward[0] * forward[0] + forward[1] * forward[1] + forward[2] * forward[2]);
+    for (int k = 0; k < 3; k++)
+      forward[k] /= length;
+    float right[3] = { -forward[2], 0.0f, forward[0] };
+    const float rightLength = std::sqrt(right[0] * right[0] + right[2] * right[2]);
+    right[0] /= rightLength;
+    right[2] /= rightLength;
+    const float up[3] = { right[1] * forward[2] - right[2] * forward[1], right[2] * forward[0] - right[0] * forward[2],
+      right[0] * forward[1] - right[1] * forward[0] };
+
+    lod.update(eye, pixelScale, dt);
+    lod.buildBillboards(right, up, frame * dt, &vertices[0], instances);
+
+    const ImpostorLod::Stats& stats = lod.getStats();
+    select += stats.selectMs;
+    build += stats.buildMs;
+    meshes += stats.meshes;
+    impostors += stats.impostors;
+    fading += stats.fading;
+    switched += stats.switched;
+  }
+
+  printf("impostors: %d instances, %d frames, %d x %d x %d views in a %d x %d atlas, switching below %.0f pixels\n",
+    instances, frames, settings.angles, settings.elevations, settings.frames, lod.getColumns(), lod.getRows(),
+    settings.switchPixels);
+  printf("  per frame: %.1f meshes, %.1f impostors, %.1f fading, %.1f switched\n",
+    (double)meshes / frames, (double)impostors / frames, (double)fading / frames, (double)switched / frames);
+  printf("  select %.3f ms, billboards %.3f ms per frame\n", select / frames, build / frames);
+  printf("  %d of %d views selected wrongly\n", checkViews(settings), settings.angles * settings.elevations);
+  return 0;
+}
@@ -0,0 +1,113 @@
+#include "Benchmark.h"
+#include "InfluenceMap.h"
+#include "RandomStream.h"
+
+#include <cmath>
+#include <vector>
+
+// Every agent adds itself to the crowd layer, one in a hundred is also a
+// threat. Each frame all agents move, then every agent asks how threatened
+// it is, once from the map and once by scanning the threat agents the way
+// NinjaController used to check the distance to the professor.
+int influenceBenchmark(int argc, char *argv[])
+{
+  const int agentCount = benchmarkArg(argc, argv, 0, 10000);
+  const int frames = benchmarkArg(argc, argv, 1, 300);
+
+  const float timeStep = 1.0f / 30.0f;
+  const float speed = 80.0f;
+  const float threatRadius = 100.0f;
+  const float cellSize = 25.0f;
+  const float area = std::sqrt((float)agentCount) * 40.0f;
+  const int cells = (int)std::ceil(area * 2.0f / cellSize);
+
+  InfluenceMap map(-area, -area, cellSize, cells, cells);
+  const int threat = map.addLayer("threat", threatRadius);
+  const int crowd = map.addLayer("crowd", 50.0f);
+
+  RandomStream random(2016);
+  std::vector<float> posX(agentCount), posZ(agentCount), velX(agentCount), velZ(agentCount);
+  std::vector<int> crowdSource(agentCount), threatSource(agentCount, -1);
+  std::vector<int> threats;
+
+  for (int i = 0; i < agentCount; i++)
+  {
+    posX[i] = random.range(-area, area);
+    posZ[i] = random.range(-area, area);
+    const float angle = random.range(0.0f, 6.2831853f);
+    velX[i] = std::cos(angle) * speed;
+    velZ[i] = std::sin(angle) * speed;
+
+    crowdSource[i] = map.addSource(crowd, posX[i], posZ[i]);
+    if (i % 100 == 0)
+    {
+      threatSource[i] = map.addSource(threat, posX[i], posZ[i]);
+      threats.push_back(i);
+    }
+  }
+  map.takeStampCount();
+
+  double updateMs = 0.0, sampleMs = 0.0, scanMs = 0.0;
+  long long stamps = 0;
+  int mismatches = 0;
+  float checksum = 0.0f;
+
+  for (int frame = 0; frame < frames; frame++)
+  {
+    BenchmarkTimer timer;
+    for (int i = 0; i < agentCount; i++)
+    {
+      posX[i] += velX[i] * timeStep;
+      posZ[i] += velZ[i] * timeStep;
+      if (posX[i] < -area || posX[i] > area)
+        velX[i] = -velX[i];
+      if (posZ[i] < -area || posZ[i] > area)
+        velZ[i] = -velZ[i];
+
+      map.moveSource(crowdSource[i], posX[i], posZ[i]);
+      if (threatSource[i] >= 0)
+        map.moveSource(threatSource[i], posX[i], posZ[i]);
+    }
+    updateMs += timer.getMilliseconds();
+    stamps += map.takeStampCount();
+
+    timer.reset();
+    int threatened = 0;
+    for (int i = 0; i < agentCount; i++)
+    {
+      if (map.sample(threat, posX[i], posZ[i]) > 0.0f)
+        threatened++;
+      checksum += map.sample(crowd, posX[i], posZ[i]);
+    }
+    sampleMs += timer.getMilliseconds();
+
+    timer.reset();
+    int scanned = 0;
+    for (int i = 0; i < agentCount; i++)
+    {
+      for (size_t t = 0; t < threats.size(); t++)
+      {
+        const float dx = posX[threats[t]] - posX[i];
+        const float dz = posZ[threats[t]] - posZ[i];
+        if (dx * dx + dz * dz < threatRadius * threatRadius)
+        {
+          scanned++;
+          break;
+        }
+      }
+    }
+    scanMs += timer.getMilliseconds();
+
+    // the map works on cells, so it only approximates the exact distance test
+    mismatches += std::abs(threatened - scanned);
+  }
+
+  printf("influence: %d agents, %d threats, %dx%d cells of %.0f, %d frames\n",
+    agentCount, (int)threats.size(), cells, cells, cellSize, frames);
+  printf("  update %.3f ms/frame (%.1f stamps), map sampling %.3f ms/frame, scanning threats %.3f ms/frame\n",
+    updateMs / frames, (double)stamps / frames, sampleMs / frames, scanMs / frames);
+  printf("  threatened count differs from exact test by %.1f agents/frame (cell quantisation), checksum %.1f\n",
+    (double)mismatches / frames, checksum);
+
+  return 0;
+}
@@ -0,0 +1,157 @@
+#include "Benchmark.h"
+#include "LightClusters.h"
+#include "RandomStream.h"
+
+#include <cmath>
+#include <vector>
+
+namespace
+{
+  const float tanHalfFovY = 0.41421356f;   // 45 degree field of view
+  const float aspect = 4.0f / 3.0f;
+  const float nearDist = 5.0f, farDist = 5000.0f;
+
+  // rows of the world to view transform, looking along heading
+  void buildView(float x, float y, float z, float heading, float* out)
+  {
+    const float fx = std::cos(heading), fz = std::sin(heading);
+    const float view[12] = {
+      -fz, 0.0f, fx, -(-fz * x + fx * z),
+      0.0f, 1.0f, 0.0f, -y,
+      -fx, 0.0f, -fz, fx * x + fz * z,
+    };
+    for (int i = 0; i < 12; i++)
+      out[i] = view[i];
+  }
+
+  // what a scene manager does before it asks for lights: only objects in
+  // the frustum are rendered
+  bool inFrustum(const float* view, const LightClusters::Sphere& sphere)
+  {
+    const float vx = view[0] * sphere.x + view[1] * sphere.y + view[2] * sphere.z + view[3];
+    const float vy = view[4] * sphere.x + view[5] * sphere.y + view[6] * sphere.z + view[7];
+    const float depth = -(view[8] * sphere.x + view[9] * sphere.y + view[10] * sphere.z + view[11]);
+    const float r = sphere.radius;
+    const float tanX = tanHalfFovY * aspect;
+
+    return depth + r >= nearDist && depth - r <= farDist
+      && std::fabs(vx) <= depth * tanX + r * std::sqrt(1.0f + tanX * tanX)
+      && std::fabs(vy) <= depth * tanHalfFovY + r * std::sqrt(1.0f + tanHalfFovY * tanHalfFovY);
+  }
+
+  bool touches(const LightClusters::Sphere& a, const LightClusters::Sphere& b)
+  {
+    const float dx = a.x - b.x, dy = a.y - b.y, dz = a.z - b.z;
+    const float r = a.radius + b.radius;
+    return dx * dx + dy * dy + dz * dz <= r * r;
+  }
+}
+
+// DustinBody sized objects scattered over the ground and point lights
+// circling over them, a camera at head height circles the scene. Every
+// frame each object in the frustum gets its lights, once by testing every
+// light (Ogre's per object search) and once from the light clusters.
+int lightsBenchmark(int argc, char *argv[])
+{
+  const int lightCount = benchmarkArg(argc, argv, 0, 64);
+  const int objectCount = benchmarkArg(argc, argv, 1, 2000);
+  const int frames = benchmarkArg(argc, argv, 2, 300);
+  const float range = (float)benchmarkArg(argc, argv, 3, 300);
+
+  const float area = 3000.0f;
+  RandomStream random(2016);
+
+  std::vector<LightClusters::Sphere> objects(objectCount);
+  for (int i = 0; i < objectCount; i++)
+  {
+    LightClusters::Sphere object = { random.range(-area, area), 60.0f, random.range(-area, area), 60.0f };
+    objects[i] = object;
+  }
+
+  std::vector<float> orbitX(lightCount), orbitZ(lightCount), orbitRadius(lightCount), orbitSpeed(lightCount);
+  for (int i = 0; i < lightCount; i++)
+  {
+    orbitX[i] = random.range(-area, area);
+    orbitZ[i] = random.range(-area, area);
+    orbitRadius[i] = random.range(50.0f, 400.0f);
+    orbitSpeed[i] = random.range(-3.0f, 3.0f);
+  }
+
+  LightClusters clusters;
+  std::vector<LightClusters::Sphere> lights(lightCount);
+  std::vector<int> result;
+  double bruteMs = 0.0, binMs = 0.0, queryMs = 0.0;
+  long long visible = 0, bruteAssigned = 0, clusteredAssigned = 0, candidates = 0, entries = 0;
+
+  for (int frame = 0; frame < frames; frame++)
+  {
+    const float t = frame / 60.0f;
+    for (int i = 0; i < lightCount; i++)
+    {
+      LightClusters::Sphere light = { orbitX[i] + std::cos(orbitSpeed[i] * t) * orbitRadius[i], 100.0f,
+        orbitZ[i] + std::sin(orbitSpeed[i] * t) * orbitRadius[i], range };
+      lights[i] = light;
+    }
+
+    const float angle = 6.2831853f * frame / frames;
+    float view[12];
+    buildView(std::cos(angle) * area * 0.5f, 100.0f, std::sin(angle) * area * 0.5f, angle, view);
+
+    std::vector<char> inView(objectCount);
+    for (int i = 0; i < objectCount; i++)
+    {
+      inView[i] = inFrustum(view, objects[i]);
+      visible += inView[i];
+    }
+
+    BenchmarkTimer timer;
+    for (int i = 0; i < objectCount; i++)
+    {
+      if (!inView[i])
+        continue;
+      for (int j = 0; j < lightCount; j++)
+      {
+        if (touches(lights[j], objects[i]))
+          bruteAssigned++;
+      }
+    }
+    bruteMs += timer.getMilliseconds();
+
+    timer.reset();
+    clusters.setView(view, tanHalfFovY, aspect, nearDist, farDist);
+    clusters.build(&lights[0], lightCount);
+    binMs += timer.getMilliseconds();
+
+    timer.reset();
+    for (int i = 0; i < objectCount; i++)
+    {
+      if (!inView[i])
+        continue;
+      clusters.query(objects[i], result);
+      clusteredAssigned += result.size();
+    }
+    queryMs += timer.getMilliseconds();
+
+    candidates += clusters.getStats().candidatesTested;
+    entries += clusters.getStats().clusterEntries;
+  }
+
+  printf("lights: %d lights (range %.0f), %d objects, %d frames, %d clusters, %.1f objects in view/frame\n",
+    lightCount, range, objectCount, frames, clusters.getClusterCount(), (double)visible / frames);
+  printf("  per object search: %.3f ms/frame, %.2f lights/object\n",
+    bruteMs / frames, visible ? (double)bruteAssigned / visible : 0.0);
+  printf("  clustered: bin %.3f ms/frame (%.0f entries), query %.3f ms/frame, %.2f lights/object, %.2f tested/object\n",
+    binMs / frames, (double)entries / frames, queryMs / frames,
+    visible ? (double)clusteredAssigned / visible : 0.0, visible ? (double)candidates / visible : 0.0);
+
+  // ClusteredLighting::MIN_LIGHTS is where the clusters start to win here
+  const double clusteredMs = binMs + queryMs;
+  printf("  faster: %s (clustered %.3f ms/frame, per object search %.3f ms/frame)\n",
+    clusteredMs < bruteMs ? "clustered" : "per object search", clusteredMs / frames, bruteMs / frames);
+
+  // a light that only touches an object outside the view is not in any of
+  // its clusters, it cannot light anything visible there
+  if (clusteredAssigned != bruteAssigned)
+    printf("  %lld lights touching objects only outside the view\n", bruteAssigned - clusteredAssigned);
+  return 0;
+}
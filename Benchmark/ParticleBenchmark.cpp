@@ -0,0 +1,111 @@
+#include "Benchmark.h"
+#include "ParticlePool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace
+{
+  // the NightClub effects: a slow fog layer and fast sparkles, both from
+  // an emitter turning like the "Night" node
+  void addEmitters(ParticlePool& pool, int particles)
+  {
+    ParticlePool::Emitter fog;
+    fog.lifeMin = 4.0f;
+    fog.lifeMax = 6.0f;
+    fog.speedMin = 5.0f;
+    fog.speedMax = 20.0f;
+    fog.angle = 1.5f;
+    fog.sizeStart = 20.0f;
+    fog.sizeEnd = 60.0f;
+    fog.box[0] = fog.box[2] = 250.0f;
+    fog.rate = particles * 0.3f / 5.0f;
+    pool.addEmitter(fog);
+
+    ParticlePool::Emitter sparkle;
+    sparkle.lifeMin = 0.5f;
+    sparkle.lifeMax = 1.5f;
+    sparkle.speedMin = 100.0f;
+    sparkle.speedMax = 300.0f;
+    sparkle.angle = 0.3f;
+    sparkle.sizeStart = 2.0f;
+    sparkle.sizeEnd = 0.5f;
+    sparkle.position[1] = 50.0f;
+    sparkle.rate = particles * 0.7f / 1.0f;
+    pool.addEmitter(sparkle);
+
+    pool.setGravity(0.0f, -98.0f, 0.0f);
+    pool.setDrag(0.2f);
+  }
+
+  void turn(ParticlePool& pool, float time)
+  {
+    ParticlePool::Emitter& sparkle = pool.getEmitter(1);
+    sparkle.direction[0] = std::cos(time * 3.14159f) * 0.8f;
+    sparkle.direction[1] = 0.6f;
+    sparkle.direction[2] = std::sin(time * 3.14159f) * 0.8f;
+  }
+}
+
+// The pool kept full at the given number of particles, frames at 60 Hz:
+// integration and building the billboard vertices, scalar against SSE.
+// Both pools run the same seed, so their particles must agree.
+int particleBenchmark(int argc, char *argv[])
+{
+  const int particles = benchmarkArg(argc, argv, 0, 100000);
+  const int frames = benchmarkArg(argc, argv, 1, 300);
+  const float dt = 1.0f / 60.0f;
+
+  ParticlePool scalar(particles, 2016), simd(particles, 2016);
+  scalar.setSimd(false);
+  addEmitters(scalar, particles);
+  addEmitters(simd, particles);
+
+  std::vector<ParticlePool::Vertex> scalarVertices((size_t)particles * 4), simdVertices((size_t)particles * 4);
+  const float right[3] = { 0.8f, 0.0f, -0.6f }, up[3] = { 0.0f, 1.0f, 0.0f };
+
+  double integrate[2] = { 0.0, 0.0 }, emit[2] = { 0.0, 0.0 }, build[2] = { 0.0, 0.0 };
+  long long alive = 0, dropped = 0;
+  for (int frame = 0; frame < frames; frame++)
+  {
+    turn(scalar, frame * dt);
+    turn(simd, frame * dt);
+
+    scalar.update(dt);
+    simd.update(dt);
+    scalar.buildBillboards(right, up, &scalarVertices[0], particles);
+    simd.buildBillboards(right, up, &simdVertices[0], particles);
+
+    ParticlePool* pools[2] = { &scalar, &simd };
+    for (int i = 0; i < 2; i++)
+    {
+      emit[i] += pools[i]->getStats().emitMs;
+      integrate[i] += pools[i]->getStats().integrateMs;
+      build[i] += pools[i]->getStats().buildMs;
+    }
+    alive += simd.getStats().alive;
+    dropped += simd.getStats().dropped;
+  }
+
+  double maxError = 0.0;
+  int colourErrors = 0;
+  const int count = std::min(scalar.size(), simd.size());
+  for (int i = 0; i < count * 4; i++)
+  {
+    for (int k = 0; k < 3; k++)
+      maxError = std::max(maxError, (double)std::fabs(scalarVertices[i].position[k] - simdVertices[i].position[k]));
+    if (scalarVertices[i].colour != simdVertices[i].colour)
+      colourErrors++;
+  }
+
+  printf("particles: %d capacity, %d frames, %.0f alive on average, %lld not emitted on a full pool\n",
+    particles, frames, (double)alive / frames, dropped);
+  printf("  scalar: emit %.3f ms, integrate %.3f ms, billboards %.3f ms per frame\n",
+    emit[0] / frames, integrate[0] / frames, build[0] / frames);
+  printf("  %s: emit %.3f ms, integrate %.3f ms, billboards %.3f ms per frame\n", ParticlePool::hasSimd() ? "SSE" : "no SSE build",
+    emit[1] / frames, integrate[1] / frames, build[1] / frames);
+  printf("  %d and %d alive at the end, largest vertex difference %g, %d colours differ\n",
+    scalar.size(), simd.size(), maxError, colourErrors);
+  return 0;
+}
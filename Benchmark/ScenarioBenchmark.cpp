@@ -0,0 +1,61 @@
+#include "Benchmark.h"
+#include "CrowdScenario.h"
+
+#include <string>
+
+// Runs a crowd scenario file headless and prints timing and the final
+// state checksum. With runs > 1 the scenario is repeated and the checksums
+// must match.
+int scenarioBenchmark(int argc, char *argv[])
+{
+  const std::string fileName = (argc > 0) ? argv[0] : "crowd.cfg";
+
+  CrowdScenarioConfig config;
+  std::string error;
+  if (!config.load(fileName, error))
+  {
+    printf("scenario: %s\n", error.c_str());
+    return 1;
+  }
+
+  const int ticks = benchmarkArg(argc, argv, 1, config.ticks);
+  const int runs = benchmarkArg(argc, argv, 2, 1);
+
+  uint64_t firstChecksum = 0;
+  for (int run = 0; run < runs; run++)
+  {
+    CrowdScenario scenario;
+
+    BenchmarkTimer timer;
+    scenario.setup(config);
+    const double setupMs = timer.getMilliseconds();
+
+    timer.reset();
+    scenario.run(ticks);
+    const double runMs = timer.getMilliseconds();
+
+    int chasing = 0;
+    for (int i = 0; i < scenario.getAgentCount(); i++)
+    {
+      if (scenario.isChasing(i))
+        chasing++;
+    }
+
+    const uint64_t checksum = scenario.getChecksum();
+    printf("scenario %s: %d agents, %d ticks, seed %u\n", fileName.c_str(), scenario.getAgentCount(), ticks, config.seed);
+    printf("  setup %.2f ms, run %.2f ms, %.3f ms/tick, %d chasing at end\n", setupMs, runMs, runMs / ticks, chasing);
+    printf("  checksum %016llx\n", (unsigned long long)checksum);
+
+    if (run == 0)
+    {
+      firstChecksum = checksum;
+    }
+    else if (checksum != firstChecksum)
+    {
+      printf("  checksum mismatch, run %d is not reproducible\n", run);
+      return 1;
+    }
+  }
+
+  return 0;
+}
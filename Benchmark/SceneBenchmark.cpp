@@ -0,0 +1,116 @@
+#include "Benchmark.h"
+#include "SceneFile.h"
+#include "RandomStream.h"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+// Compiles a scene text file to the binary scene format, by default next to
+// the text file with ".bin" appended, like SceneLoader does.
+int sceneCompile(int argc, char *argv[])
+{
+  if (argc < 1)
+  {
+    printf("scenec <text file> [binary file]\n");
+    return 1;
+  }
+
+  const std::string textFile = argv[0];
+  const std::string binaryFile = (argc > 1) ? argv[1] : textFile + ".bin";
+  std::string error;
+  if (!SceneFile::compileFile(textFile, binaryFile, error))
+  {
+    printf("%s\n", error.c_str());
+    return 1;
+  }
+
+  SceneFile file;
+  if (!file.open(binaryFile, error))
+  {
+    printf("%s\n", error.c_str());
+    return 1;
+  }
+  printf("%s: %d nodes, %d entities, %d lights, %u bytes\n", binaryFile.c_str(), file.getNodeCount(),
+    file.getEntityCount(), file.getLightCount(), (unsigned)file.getSize());
+  return 0;
+}
+
+// A generated test scene: rows of DustinBody characters with a camera rig
+// node chain each, and a point light for every 16 of them. Compares
+// compiling the text, which a text loader pays on every start, with mapping
+// and walking the binary file.
+int sceneBenchmark(int argc, char *argv[])
+{
+  const int characters = benchmarkArg(argc, argv, 0, 5000);
+  const int runs = benchmarkArg(argc, argv, 1, 20);
+  const std::string textFile = "scene_benchmark.scn", binaryFile = textFile + ".bin";
+
+  RandomStream random(2016);
+  std::ostringstream text;
+  text << "# generated by Benchmark scene\n";
+  for (int i = 0; i < characters; i++)
+  {
+    text << "node Root" << i << " position=" << (i % 100) * 200 << " 0 " << (i / 100) * 200
+      << " yaw=" << random.range(0, 359) << "\n";
+    text << "node Yaw" << i << " parent=Root" << i << "\n";
+    text << "node Camera" << i << " parent=Root" << i << " position=0 120 0\n";
+    text << "node Holder" << i << " parent=Camera" << i << " position=0 80 500\n";
+    text << "entity Body" << i << " mesh=DustinBody.mesh node=Yaw" << i << " shadows=off\n";
+    if (i % 16 == 0)
+      text << "light Light" << i << " type=point node=Root" << i << " position=0 150 0 diffuse=1 0.8 0.6"
+        << " attenuation=400 1 0.01 0 shadows=off\n";
+  }
+  {
+    std::ofstream output(textFile.c_str(), std::ios::binary);
+    output << text.str();
+  }
+
+  double compileMs = 0.0, openMs = 0.0;
+  std::string error;
+  float checksum = 0.0f;
+  for (int run = 0; run < runs; run++)
+  {
+    BenchmarkTimer timer;
+    if (!SceneFile::compileFile(textFile, binaryFile, error))
+    {
+      printf("%s\n", error.c_str());
+      return 1;
+    }
+    compileMs += timer.getMilliseconds();
+
+    // what SceneLoader reads before it creates the objects
+    timer.reset();
+    SceneFile file;
+    if (!file.open(binaryFile, error))
+    {
+      printf("%s\n", error.c_str());
+      return 1;
+    }
+    for (int i = 0; i < file.getNodeCount(); i++)
+    {
+      float position[3];
+      file.getPosition(file.getNodes()[i], position);
+      checksum += position[0] + file.getString(file.getNodes()[i].name)[0];
+    }
+    for (int i = 0; i < file.getEntityCount(); i++)
+      checksum += file.getString(file.getEntities()[i].mesh)[0];
+    for (int i = 0; i < file.getLightCount(); i++)
+      checksum += file.getLights()[i].attenuation[0];
+    openMs += timer.getMilliseconds();
+  }
+
+  SceneFile file;
+  file.open(binaryFile, error);
+  printf("scene: %d nodes, %d entities, %d lights, text %u bytes, binary %u bytes (checksum %g)\n",
+    file.getNodeCount(), file.getEntityCount(), file.getLightCount(), (unsigned)text.str().size(),
+    (unsigned)file.getSize(), checksum / runs);
+  printf("  compile text: %.3f ms\n", compileMs / runs);
+  printf("  map and read binary: %.3f ms\n", openMs / runs);
+  file.close();
+
+  remove(textFile.c_str());
+  remove(binaryFile.c_str());
+  return 0;
+}
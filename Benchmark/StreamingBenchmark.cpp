@@ -0,0 +1,134 @@
+#include "Benchmark.h"
+#include "TileStreamer.h"
+#include "RandomStream.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+namespace
+{
+  // stands in for StreamedWorld, counts the vertices a scene would hold
+  class CountingListener : public TileStreamer::Listener
+  {
+  public:
+    CountingListener() : vertices(0), peakVertices(0) {}
+
+    void attachTile(const WorldTile& tile)
+    {
+      vertices += tile.getVertexCount();
+      peakVertices = std::max(peakVertices, vertices);
+    }
+
+    void detachTile(const WorldTile& tile)
+    {
+      vertices -= tile.getVertexCount();
+    }
+
+    long long vertices;
+    long long peakVertices;
+  };
+
+  struct RunResult
+  {
+    TileStreamer::Stats stats;
+    double updateMs;
+    double maxUpdateMs;
+    int framesMissing;   // the tile under the character was not there
+    long long peakVertices;
+    float distance;
+  };
+
+  RunResult run(const TileStreamer::Settings& settings, int frames, float speed)
+  {
+    const double frameMs = 1000.0 / 60.0;
+    const float dt = 1.0f / 60.0f;
+    CountingListener listener;
+    RunResult result = { TileStreamer::Stats(), 0.0, 0.0, 0, 0, 0.0f };
+
+    TileStreamer streamer(settings, &listener);
+    // loading screen: the start area is there before the first frame
+    streamer.update(0.0f, 0.0f);
+    streamer.flush();
+
+    // runs straight and turns every few seconds, like a player exploring
+    RandomStream random(7);
+    float x = 0.0f, z = 0.0f, heading = 0.0f, turnIn = 3.0f;
+    for (int frame = 0; frame < frames; frame++)
+    {
+      BenchmarkTimer pace;
+      turnIn -= dt;
+      if (turnIn <= 0.0f)
+      {
+        heading += random.range(-1.5f, 1.5f);
+        turnIn = random.range(1.0f, 5.0f);
+      }
+      x += std::sin(heading) * speed * dt;
+      z += std::cos(heading) * speed * dt;
+
+      BenchmarkTimer timer;
+      streamer.update(x, z);
+      const double ms = timer.getMilliseconds();
+      result.updateMs += ms;
+      result.maxUpdateMs = std::max(result.maxUpdateMs, ms);
+      if (!streamer.isResident(streamer.tileCoordinate(x), streamer.tileCoordinate(z)))
+        result.framesMissing++;
+
+      const double left = frameMs - pace.getMilliseconds();
+      if (left > 0.0)
+        std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(left));
+    }
+
+    result.stats = streamer.getStats();
+    result.updateMs /= frames;
+    result.peakVertices = listener.peakVertices;
+    result.distance = speed * dt * frames;
+    return result;
+  }
+
+  void print(const char* name, const RunResult& result)
+  {
+    const TileStreamer::Stats& stats = result.stats;
+    printf("  %s: %d loaded, %d unloaded (%d evicted), %d cancelled, %d resident at the end\n",
+      name, stats.loaded, stats.unloaded, stats.evicted, stats.cancelled, stats.resident);
+    printf("    resident %.2f MB, peak %.2f MB, %lld ground vertices at most\n",
+      stats.residentBytes / 1048576.0, stats.peakBytes / 1048576.0, result.peakVertices);
+    printf("    load latency %.1f ms average, %.1f ms worst, %.2f ms generating a tile\n",
+      stats.averageLatencyMs, stats.maxLatencyMs, stats.averageLoadMs);
+    printf("    update %.3f ms/frame, worst %.3f ms, %d frames without the tile underfoot\n",
+      result.updateMs, result.maxUpdateMs, result.framesMissing);
+  }
+}
+
+// A character running at speed units/s over an open world, frames paced at
+// 60 Hz. The first run keeps everything within the radii resident, the
+// second caps memory at half of what the first one peaked at.
+int streamingBenchmark(int argc, char *argv[])
+{
+  const int seconds = benchmarkArg(argc, argv, 0, 8);
+  const float speed = (float)benchmarkArg(argc, argv, 1, 400);
+  const int threads = benchmarkArg(argc, argv, 2, 2);
+  const int frames = seconds * 60;
+
+  TileStreamer::Settings settings;
+  settings.tileSize = 500.0f;
+  settings.resolution = 64;
+  settings.propsPerTile = 16;
+  settings.propKinds = 2;
+  settings.loadRadius = 1500.0f;
+  settings.unloadRadius = 2000.0f;
+  settings.threads = threads;
+
+  const RunResult uncapped = run(settings, frames, speed);
+  settings.memoryBudget = uncapped.stats.peakBytes / 2;
+  const RunResult capped = run(settings, frames, speed);
+
+  printf("streaming: %d s at %.0f units/s (%.0f units), %.0f unit tiles of %dx%d quads, %d threads\n",
+    seconds, speed, uncapped.distance, settings.tileSize, settings.resolution, settings.resolution, threads);
+  printf("  radii %.0f/%.0f, one tile %.1f KB\n", settings.loadRadius, settings.unloadRadius,
+    WorldTile::estimateBytes(settings.resolution, settings.propsPerTile) / 1024.0);
+  print("no cap", uncapped);
+  printf("  cap %.2f MB:\n", settings.memoryBudget / 1048576.0);
+  print("capped", capped);
+  return 0;
+}
@@ -0,0 +1,231 @@
+#include "Benchmark.h"
+#include "TransformHierarchy.h"
+#include "RandomStream.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace
+{
+  struct Quat
+  {
+    float w, x, y, z;
+
+    Quat operator*(const Quat& q) const
+    {
+      Quat r = {
+        w * q.w - x * q.x - y * q.y - z * q.z,
+        w * q.x + x * q.w + y * q.z - z * q.y,
+        w * q.y + y * q.w + z * q.x - x * q.z,
+        w * q.z + z * q.w + x * q.y - y * q.x,
+      };
+      return r;
+    }
+
+    void rotate(const float* v, float* out) const
+    {
+      // v + 2w (q x v) + 2 q x (q x v)
+      const float cx = y * v[2] - z * v[1], cy = z * v[0] - x * v[2], cz = x * v[1] - y * v[0];
+      const float dx = y * cz - z * cy, dy = z * cx - x * cz, dz = x * cy - y * cx;
+      out[0] = v[0] + 2.0f * (w * cx + dx);
+      out[1] = v[1] + 2.0f * (w * cy + dy);
+      out[2] = v[2] + 2.0f * (w * cz + dz);
+    }
+  };
+
+  Quat yawQuat(float angle)
+  {
+    Quat q = { std::cos(angle * 0.5f), 0.0f, std::sin(angle * 0.5f), 0.0f };
+    return q;
+  }
+
+  // what Ogre::SceneNode does: one heap object per node, the update walks
+  // the children from the root and derives position, orientation and
+  // scale, then the full matrix when it is asked for
+  struct TreeNode
+  {
+    TreeNode* parent;
+    std::vector<TreeNode*> children;
+    float position[3];
+    Quat orientation;
+    float scale[3];
+
+    float derivedPosition[3];
+    Quat derivedOrientation;
+    float derivedScale[3];
+    float world[12];
+    bool dirty;
+
+    void update(bool parentChanged)
+    {
+      const bool changed = dirty || parentChanged;
+      if (changed)
+      {
+        if (parent)
+        {
+          derivedOrientation = parent->derivedOrientation * orientation;
+          float scaled[3];
+          for (int i = 0; i < 3; i++)
+          {
+            derivedScale[i] = parent->derivedScale[i] * scale[i];
+            scaled[i] = parent->derivedScale[i] * position[i];
+          }
+          parent->derivedOrientation.rotate(scaled, derivedPosition);
+          for (int i = 0; i < 3; i++)
+            derivedPosition[i] += parent->derivedPosition[i];
+        }
+        else
+        {
+          derivedOrientation = orientation;
+          for (int i = 0; i < 3; i++)
+          {
+            derivedScale[i] = scale[i];
+            derivedPosition[i] = position[i];
+          }
+        }
+        makeWorld();
+        dirty = false;
+      }
+
+      for (size_t i = 0; i < children.size(); i++)
+        children[i]->update(changed);
+    }
+
+    void makeWorld(void)
+    {
+      const Quat& q = derivedOrientation;
+      const float axes[3][3] = {
+        { 1.0f - 2.0f * (q.y * q.y + q.z * q.z), 2.0f * (q.x * q.y - q.w * q.z), 2.0f * (q.x * q.z + q.w * q.y) },
+        { 2.0f * (q.x * q.y + q.w * q.z), 1.0f - 2.0f * (q.x * q.x + q.z * q.z), 2.0f * (q.y * q.z - q.w * q.x) },
+        { 2.0f * (q.x * q.z - q.w * q.y), 2.0f * (q.y * q.z + q.w * q.x), 1.0f - 2.0f * (q.x * q.x + q.y * q.y) },
+      };
+      for (int i = 0; i < 3; i++)
+      {
+        for (int j = 0; j < 3; j++)
+          world[i * 4 + j] = axes[i][j] * derivedScale[j];
+        world[i * 4 + 3] = derivedPosition[i];
+      }
+    }
+  };
+}
+
+// Character rigs and pivot chains: trees of the given depth, every node with
+// one to three children, scattered over the heap like scene nodes created
+// at different times. Every frame a quarter of the nodes turn, then the
+// world matrices are brought up to date by the node tree and by the flat
+// TransformHierarchy, with and without SSE.
+int transformBenchmark(int argc, char *argv[])
+{
+  const int nodeCount = benchmarkArg(argc, argv, 0, 10000);
+  const int depth = benchmarkArg(argc, argv, 1, 6);
+  const int frames = benchmarkArg(argc, argv, 2, 300);
+
+  RandomStream random(2016);
+  std::vector<int> parents;
+  std::vector<int> depths;
+  std::vector<int> open;   // nodes that can still take children
+  while ((int)parents.size() < nodeCount)
+  {
+    int parent = -1;
+    if (!open.empty() && random.range(0, 31) != 0)
+      parent = open[random.range(0, (int)open.size() - 1)];
+    parents.push_back(parent);
+    depths.push_back(parent < 0 ? 0 : depths[parent] + 1);
+    if (depths.back() + 1 < depth)
+      open.push_back((int)parents.size() - 1);
+  }
+
+  // allocated in a shuffled order, linked in creation order
+  std::vector<int> allocation(nodeCount);
+  for (int i = 0; i < nodeCount; i++)
+    allocation[i] = i;
+  for (int i = nodeCount - 1; i > 0; i--)
+    std::swap(allocation[i], allocation[random.range(0, i)]);
+  std::vector<TreeNode*> tree(nodeCount);
+  for (int i = 0; i < nodeCount; i++)
+    tree[allocation[i]] = new TreeNode();
+
+  std::vector<TreeNode*> roots;
+  TransformHierarchy scalar, simd;
+  scalar.setSimd(false);
+  for (int i = 0; i < nodeCount; i++)
+  {
+    TreeNode* node = tree[i];
+    node->parent = parents[i] < 0 ? nullptr : tree[parents[i]];
+    if (node->parent)
+      node->parent->children.push_back(node);
+    else
+      roots.push_back(node);
+
+    const float position[3] = { random.range(-50.0f, 50.0f), random.range(0.0f, 50.0f), random.range(-50.0f, 50.0f) };
+    for (int j = 0; j < 3; j++)
+    {
+      node->position[j] = position[j];
+      node->scale[j] = 1.0f;
+    }
+    node->orientation = yawQuat(random.range(0.0f, 6.28f));
+    node->dirty = true;
+
+    scalar.add(parents[i]);
+    simd.add(parents[i]);
+    scalar.setPosition(i, position[0], position[1], position[2]);
+    simd.setPosition(i, position[0], position[1], position[2]);
+  }
+
+  double treeMs = 0.0, scalarMs = 0.0, simdMs = 0.0;
+  long long worldsUpdated = 0;
+  for (int frame = 0; frame < frames; frame++)
+  {
+    for (int i = 0; i < nodeCount; i++)
+    {
+      if ((i + frame) % 4 != 0)
+        continue;
+      TreeNode* node = tree[i];
+      node->orientation = node->orientation * yawQuat(0.01f);
+      node->dirty = true;
+      const Quat& q = node->orientation;
+      scalar.setOrientation(i, q.w, q.x, q.y, q.z);
+      simd.setOrientation(i, q.w, q.x, q.y, q.z);
+    }
+
+    BenchmarkTimer timer;
+    for (size_t i = 0; i < roots.size(); i++)
+      roots[i]->update(false);
+    treeMs += timer.getMilliseconds();
+
+    timer.reset();
+    scalar.update();
+    scalarMs += timer.getMilliseconds();
+
+    timer.reset();
+    simd.update();
+    simdMs += timer.getMilliseconds();
+    worldsUpdated += simd.getStats().worldsUpdated;
+  }
+
+  // all three must agree
+  double maxError = 0.0;
+  for (int i = 0; i < nodeCount; i++)
+  {
+    float flat[12], fast[12];
+    scalar.getWorld(i, flat);
+    simd.getWorld(i, fast);
+    for (int j = 0; j < 12; j++)
+    {
+      maxError = std::max(maxError, (double)std::fabs(flat[j] - tree[i]->world[j]));
+      maxError = std::max(maxError, (double)std::fabs(fast[j] - tree[i]->world[j]));
+    }
+  }
+
+  printf("transforms: %d nodes, %d levels, %d roots, %d frames, %.0f world transforms/frame\n",
+    nodeCount, simd.getStats().levels, (int)roots.size(), frames, (double)worldsUpdated / frames);
+  printf("  node tree: %.3f ms/frame\n", treeMs / frames);
+  printf("  flat, scalar: %.3f ms/frame\n", scalarMs / frames);
+  printf("  flat, %s: %.3f ms/frame\n", TransformHierarchy::hasSimd() ? "SSE" : "no SSE build", simdMs / frames);
+  printf("  largest difference %g\n", maxError);
+
+  for (int i = 0; i < nodeCount; i++)
+    delete tree[i];
+  return 0;
+}
@@ -0,0 +1,57 @@
+#define CLIENT_DESCRIPTION "Benchmark"
+
+#include "Benchmark.h"
+
+#include <cstring>
+
+struct BenchmarkEntry
+{
+  const char* name;
+  int (*run)(int argc, char *argv[]);
+  const char* usage;
+};
+
+static const BenchmarkEntry benchmarks[] = {
+  { "avoidance", avoidanceBenchmark, "avoidance [agents=5000] [steps=2500]" },
+  { "ai", aiSchedulerBenchmark, "ai [agents=10000] [frames=300] [budgetMs=2] [interval=0.25]" },
+  { "scenario", scenarioBenchmark, "scenario [config=crowd.cfg] [ticks] [runs=1]" },
+  { "collision", collisionBenchmark, "collision [bodies=1000] [steps=600]" },
+  { "influence", influenceBenchmark, "influence [agents=10000] [frames=300]" },
+  { "culling", cullingBenchmark, "culling [objects=5000] [frames=600] [cellSize=250]" },
+  { "occlusion", occlusionBenchmark, "occlusion [boxes=5000] [walls=200] [frames=300] [width=256] [height=128]" },
+  { "lights", lightsBenchmark, "lights [lights=64] [objects=2000] [frames=300] [range=300]" },
+  { "capture", captureBenchmark, "capture [frames=120] [width=640] [height=480] [format=raw|png]" },
+  { "transforms", transformBenchmark, "transforms [nodes=10000] [depth=6] [frames=300]" },
+  { "scene", sceneBenchmark, "scene [characters=5000] [runs=20]" },
+  { "scenec", sceneCompile, "scenec <text file> [binary file]" },
+  { "streaming", streamingBenchmark, "streaming [seconds=8] [speed=400] [threads=2]" },
+  { "particles", particleBenchmark, "particles [particles=100000] [frames=300]" },
+  { "impostors", impostorBenchmark, "impostors [instances=10000] [frames=300]" },
+};
+
+static const int benchmarkCount = sizeof(benchmarks) / sizeof(benchmarks[0]);
+
+static void printUsage(void)
+{
+  printf(CLIENT_DESCRIPTION " <name> [args...]\n");
+  for (int i = 0; i < benchmarkCount; i++)
+    printf("  %s\n", benchmarks[i].usage);
+}
+
+int main(int argc, char *argv[])
+{
+  if (argc < 2)
+  {
+    printUsage();
+    return 1;
+  }
+
+  for (int i = 0; i < benchmarkCount; i++)
+  {
+    if (strcmp(argv[1], benchmarks[i].name) == 0)
+      return benchmarks[i].run(argc - 2, argv + 2);
+  }
+
+  printUsage();
+  return 1;
+}
@@ -0,0 +1,208 @@
+#include "AIScheduler.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace
+{
+  typedef std::chrono::high_resolution_clock Clock;
+
+  double millisecondsSince(const Clock::time_point& start)
+  {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+  }
+}
+
+
+AIScheduler::AIScheduler(int bucketCount, double budgetMilliseconds)
+  : mBuckets(bucketCount < 1 ? 1 : bucketCount), mDeferredCount(0), mCurrentBucket(0), mFrame(0), mTime(0.0),
+    mBudget(budgetMilliseconds)
+{
+  mStats.agents = mStats.updated = mStats.deferred = mStats.notDue = 0;
+  mStats.milliseconds = 0.0;
+  mStats.longestWait = 0.0f;
+}
+
+AIScheduler::~AIScheduler()
+{
+}
+
+void AIScheduler::add(AIAgent* agent, float thinkInterval)
+{
+  if (_find(agent) >= 0)
+    return;
+
+  Entry entry;
+  entry.agent = agent;
+  entry.interval = thinkInterval;
+  entry.lastThink = mTime;
+  entry.bucket = (thinkInterval > 0.0f) ? _leastUsedBucket() : -1;
+  entry.slot = (int)_list(entry).size();
+  entry.queued = false;
+  entry.lastFrame = mFrame;
+
+  const int index = (int)mEntries.size();
+  mEntries.push_back(entry);
+  mIndices[agent] = index;
+
+  _list(entry).push_back(index);
+}
+
+void AIScheduler::remove(AIAgent* agent)
+{
+  const int index = _find(agent);
+  if (index < 0)
+    return;
+
+  // the last index of its list takes its slot
+  Entry& entry = mEntries[index];
+  std::vector<int>& list = _list(entry);
+  list[entry.slot] = list.back();
+  mEntries[list.back()].slot = entry.slot;
+  list.pop_back();
+  if (entry.queued)
+    mDeferredCount--;
+
+  // and the last entry takes its place in mEntries
+  const int last = (int)mEntries.size() - 1;
+  if (index != last)
+  {
+    mEntries[index] = mEntries[last];
+    _list(mEntries[index])[mEntries[index].slot] = index;
+    mIndices[mEntries[index].agent] = index;
+  }
+  mEntries.pop_back();
+  mIndices.erase(agent);
+}
+
+void AIScheduler::setThinkInterval(AIAgent* agent, float thinkInterval)
+{
+  const int index = _find(agent);
+  if (index < 0)
+    return;
+
+  const bool everyFrame = thinkInterval <= 0.0f;
+  if (everyFrame == (mEntries[index].bucket < 0))
+  {
+    mEntries[index].interval = thinkInterval;
+    return;
+  }
+
+  remove(agent);
+  add(agent, thinkInterval);
+}
+
+void AIScheduler::clear(void)
+{
+  mEntries.clear();
+  mIndices.clear();
+  for (size_t b = 0; b < mBuckets.size(); b++)
+    mBuckets[b].clear();
+  mEveryFrame.clear();
+  mDeferred.clear();
+  mDeferredCount = 0;
+  mCurrentBucket = 0;
+}
+
+void AIScheduler::update(float timeSinceLastFrame)
+{
+  const Clock::time_point start = Clock::now();
+  mFrame++;
+  mTime += timeSinceLastFrame;
+
+  mStats.agents = (int)mEntries.size();
+  mStats.updated = 0;
+  mStats.notDue = 0;
+  mStats.longestWait = 0.0f;
+
+  // agents deferred by earlier frames go first
+  const size_t deferredCount = mDeferred.size();
+  for (size_t i = 0; i < deferredCount; i++)
+  {
+    if (_overBudget(start))
+      break;
+
+    // removed, or removed and added again, since it was deferred
+    const int index = _find(mDeferred.front());
+    mDeferred.pop_front();
+    if (index < 0 || !mEntries[index].queued)
+      continue;
+
+    mEntries[index].queued = false;
+    mDeferredCount--;
+    _think(mEntries[index]);
+  }
+
+  // then the every frame agents and the due agents of this frame's bucket
+  std::vector<int>& bucket = mBuckets[mCurrentBucket];
+  const int candidateCount = (int)(mEveryFrame.size() + bucket.size());
+
+  for (int c = 0; c < candidateCount; c++)
+  {
+    const int index = (c < (int)mEveryFrame.size()) ? mEveryFrame[c] : bucket[c - mEveryFrame.size()];
+    Entry& entry = mEntries[index];
+
+    if (entry.queued || entry.lastFrame == mFrame)
+      continue;
+    if (mTime - entry.lastThink < entry.interval)
+    {
+      mStats.notDue++;
+      continue;
+    }
+
+    if (_overBudget(start))
+    {
+      entry.queued = true;
+      mDeferred.push_back(entry.agent);
+      mDeferredCount++;
+      continue;
+    }
+
+    _think(entry);
+  }
+
+  mCurrentBucket = (mCurrentBucket + 1) % (int)mBuckets.size();
+
+  mStats.deferred = mDeferredCount;
+  mStats.milliseconds = millisecondsSince(start);
+}
+
+bool AIScheduler::_overBudget(const std::chrono::high_resolution_clock::time_point& start) const
+{
+  // at least one agent thinks every frame so nothing starves
+  return mBudget > 0.0 && mStats.updated > 0 && millisecondsSince(start) >= mBudget;
+}
+
+void AIScheduler::_think(Entry& entry)
+{
+  const float elapsed = (float)(mTime - entry.lastThink);
+  if (elapsed > mStats.longestWait)
+    mStats.longestWait = elapsed;
+
+  entry.lastThink = mTime;
+  entry.agent->think(elapsed);
+  entry.lastFrame = mFrame;
+  mStats.updated++;
+}
+
+int AIScheduler::_find(AIAgent* agent) const
+{
+  std::unordered_map<AIAgent*, int>::const_iterator it = mIndices.find(agent);
+  return (it == mIndices.end()) ? -1 : it->second;
+}
+
+int AIScheduler::_leastUsedBucket(void) const
+{
+  int best = 0;
+  for (int b = 1; b < (int)mBuckets.size(); b++)
+  {
+    if (mBuckets[b].size() < mBuckets[best].size())
+      best = b;
+  }
+  return best;
+}
+
+std::vector<int>& AIScheduler::_list(const Entry& entry)
+{
+  return (entry.bucket < 0) ? mEveryFrame : mBuckets[entry.bucket];
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <chrono>
+#include <unordered_map>
+
+// Anything that makes decisions. think() gets the time since this agent
+// last thought, which is larger than a frame when the agent is scheduled
+// at a lower frequency or was deferred by the frame budget.
+class AIAgent
+{
+public:
+  virtual ~AIAgent() {}
+
+  virtual void think(float elapsed) = 0;
+};
+
+
+// Time-sliced AI update. Agents are spread over a ring of buckets and only
+// one bucket is visited per frame; agents in that bucket think when their
+// declared interval has passed. Agents with an interval of 0 think every
+// frame. Once the per-frame budget is used up the remaining due agents are
+// deferred to the next frame, oldest first. A budget of 0 disables the
+// limit, which keeps headless runs deterministic.
+//
+// Nothing is done per agent beyond the visited bucket, the every frame
+// agents and the deferred queue: an agent's wait is taken from the time it
+// last thought, and add() and remove() are constant time.
+class AIScheduler
+{
+public:
+  struct FrameStats
+  {
+    int agents;       // registered agents
+    int updated;      // agents that thought this frame
+    int deferred;     // due agents waiting for the next frame
+    int notDue;       // visited agents whose interval had not passed yet
+    double milliseconds;
+    float longestWait;  // longest time between two thinks of an updated agent
+  };
+
+  AIScheduler(int bucketCount = 4, double budgetMilliseconds = 2.0);
+  ~AIScheduler();
+
+  // thinkInterval in seconds, 0 means every frame
+  void add(AIAgent* agent, float thinkInterval);
+  void remove(AIAgent* agent);
+  void setThinkInterval(AIAgent* agent, float thinkInterval);
+  void clear(void);
+
+  void setBudget(double milliseconds) { mBudget = milliseconds; }
+  double getBudget(void) const { return mBudget; }
+  int getBucketCount(void) const { return (int)mBuckets.size(); }
+
+  void update(float timeSinceLastFrame);
+
+  const FrameStats& getFrameStats(void) const { return mStats; }
+
+private:
+  struct Entry
+  {
+    AIAgent* agent;
+    float interval;
+    double lastThink;  // scheduler time of the last think
+    int bucket;      // -1 for every frame agents
+    int slot;        // position in its bucket or in mEveryFrame
+    bool queued;     // waiting in the deferred queue
+    unsigned lastFrame;
+  };
+
+  int _find(AIAgent* agent) const;
+  int _leastUsedBucket(void) const;
+  std::vector<int>& _list(const Entry& entry);
+  bool _overBudget(const std::chrono::high_resolution_clock::time_point& start) const;
+  void _think(Entry& entry);
+
+  std::vector<Entry> mEntries;
+  std::unordered_map<AIAgent*, int> mIndices;
+  std::vector<std::vector<int> > mBuckets;  // indices into mEntries
+  std::vector<int> mEveryFrame;
+  std::deque<AIAgent*> mDeferred;   // removed agents are skipped when they come up
+  int mDeferredCount;
+
+  int mCurrentBucket;
+  unsigned mFrame;
+  double mTime;
+  double mBudget;
+  FrameStats mStats;
+};
@@ -0,0 +1,229 @@
+#include "CharacterCollision.h"
+
+#include <cmath>
+#include <chrono>
+#include <algorithm>
+
+namespace
+{
+  typedef std::chrono::high_resolution_clock Clock;
+
+  double millisecondsSince(const Clock::time_point& start)
+  {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+  }
+}
+
+
+CharacterCollision::CharacterCollision()
+  : mOrderValid(true)
+{
+  mStats.bodies = mStats.pairs = mStats.contacts = mStats.swaps = 0;
+  mStats.broadphaseMs = mStats.narrowphaseMs = 0.0;
+}
+
+CharacterCollision::~CharacterCollision()
+{
+}
+
+int CharacterCollision::addBody(float x, float y, float z, float radius, float height, float inverseMass)
+{
+  Body body;
+  body.x = x;
+  body.y = y;
+  body.z = z;
+  body.radius = radius;
+  body.height = std::max(height, radius * 2.0f);
+  body.inverseMass = inverseMass;
+  body.enabled = true;
+
+  mBodies.push_back(body);
+  mOrder.push_back((int)mBodies.size() - 1);
+  mOrderValid = false;
+
+  return (int)mBodies.size() - 1;
+}
+
+void CharacterCollision::clear(void)
+{
+  mBodies.clear();
+  mOrder.clear();
+  mPairs.clear();
+  mContacts.clear();
+}
+
+void CharacterCollision::setPosition(int body, float x, float y, float z)
+{
+  mBodies[body].x = x;
+  mBodies[body].y = y;
+  mBodies[body].z = z;
+}
+
+void CharacterCollision::step(int iterations)
+{
+  Clock::time_point start = Clock::now();
+
+  _sortAxis();
+  _findPairs();
+
+  mStats.bodies = getBodyCount();
+  mStats.pairs = (int)mPairs.size();
+  mStats.broadphaseMs = millisecondsSince(start);
+
+  start = Clock::now();
+  mContacts.clear();
+
+  for (int it = 0; it < iterations; it++)
+  {
+    bool resolved = true;
+
+    for (size_t p = 0; p < mPairs.size(); p++)
+    {
+      Contact contact;
+      if (!_testPair(mPairs[p].first, mPairs[p].second, contact))
+        continue;
+
+      if (it == 0)
+        mContacts.push_back(contact);
+
+      Body& a = mBodies[contact.a];
+      Body& b = mBodies[contact.b];
+      const float totalInverseMass = a.inverseMass + b.inverseMass;
+      if (totalInverseMass <= 0.0f)
+        continue;
+
+      // characters stay on the ground, only separate them horizontally
+      float nx = contact.nx, nz = contact.nz;
+      const float length = std::sqrt(nx * nx + nz * nz);
+      if (length < 0.0001f)
+        continue;
+      nx /= length;
+      nz /= length;
+
+      const float push = contact.depth / totalInverseMass;
+      a.x -= nx * push * a.inverseMass;
+      a.z -= nz * push * a.inverseMass;
+      b.x += nx * push * b.inverseMass;
+      b.z += nz * push * b.inverseMass;
+      resolved = false;
+    }
+
+    if (resolved)
+      break;
+  }
+
+  mStats.contacts = (int)mContacts.size();
+  mStats.narrowphaseMs = millisecondsSince(start);
+}
+
+void CharacterCollision::_sortAxis(void)
+{
+  const int count = getBodyCount();
+  mMinX.resize(count);
+  for (int i = 0; i < count; i++)
+    mMinX[i] = mBodies[i].x - mBodies[i].radius;
+
+  if (!mOrderValid)
+  {
+    // no usable order yet, insertion sort would be quadratic
+    const std::vector<float>& minX = mMinX;
+    std::sort(mOrder.begin(), mOrder.end(), [&minX](int a, int b) { return minX[a] < minX[b]; });
+    mOrderValid = true;
+    mStats.swaps = count;
+    return;
+  }
+
+  // insertion sort on the order of the previous step
+  int swaps = 0;
+  for (int i = 1; i < count; i++)
+  {
+    const int body = mOrder[i];
+    const float key = mMinX[body];
+    int j = i - 1;
+    while (j >= 0 && mMinX[mOrder[j]] > key)
+    {
+      mOrder[j + 1] = mOrder[j];
+      j--;
+      swaps++;
+    }
+    mOrder[j + 1] = body;
+  }
+  mStats.swaps = swaps;
+}
+
+void CharacterCollision::_findPairs(void)
+{
+  const int count = getBodyCount();
+  mPairs.clear();
+
+  for (int i = 0; i < count; i++)
+  {
+    const Body& a = mBodies[mOrder[i]];
+    if (!a.enabled)
+      continue;
+
+    const float maxX = a.x + a.radius;
+    for (int j = i + 1; j < count; j++)
+    {
+      const int other = mOrder[j];
+      if (mMinX[other] > maxX)
+        break;
+
+      const Body& b = mBodies[other];
+      if (!b.enabled)
+        continue;
+
+      // remaining axes of the bounding boxes
+      if (std::fabs(a.z - b.z) > a.radius + b.radius)
+        continue;
+      if (a.y > b.y + b.height || b.y > a.y + a.height)
+        continue;
+
+      mPairs.push_back(std::make_pair(mOrder[i], other));
+    }
+  }
+}
+
+bool CharacterCollision::_testPair(int ia, int ib, Contact& contact) const
+{
+  const Body& a = mBodies[ia];
+  const Body& b = mBodies[ib];
+
+  // the capsule axes are vertical segments, the closest points differ in
+  // y only by the gap between the two segments
+  const float aBottom = a.y + a.radius, aTop = a.y + a.height - a.radius;
+  const float bBottom = b.y + b.radius, bTop = b.y + b.height - b.radius;
+
+  float dy = 0.0f;
+  if (bBottom > aTop)
+    dy = bBottom - aTop;
+  else if (aBottom > bTop)
+    dy = bTop - aBottom;
+
+  const float dx = b.x - a.x;
+  const float dz = b.z - a.z;
+  const float distSq = dx * dx + dy * dy + dz * dz;
+  const float radii = a.radius + b.radius;
+  if (distSq >= radii * radii)
+    return false;
+
+  const float distance = std::sqrt(distSq);
+  contact.a = ia;
+  contact.b = ib;
+  contact.depth = radii - distance;
+
+  if (distance > 0.0001f)
+  {
+    contact.nx = dx / distance;
+    contact.ny = dy / distance;
+    contact.nz = dz / distance;
+  }
+  else
+  {
+    // exactly on top of each other, pick a stable direction
+    contact.nx = (ia < ib) ? 1.0f : -1.0f;
+    contact.ny = contact.nz = 0.0f;
+  }
+
+  return true;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <vector>
+
+// Collision between characters standing upright on the ground. Every body
+// is a vertical capsule (position is the bottom, height includes the caps).
+//
+// Broadphase is sort-and-sweep on x: the body order from the last step is
+// kept and re-sorted with an insertion sort, which is close to linear while
+// characters move a little per frame. Narrowphase is an exact
+// capsule/capsule test and the response pushes overlapping bodies apart,
+// split by inverse mass (0 = immovable).
+class CharacterCollision
+{
+public:
+  struct Contact
+  {
+    int a, b;
+    float nx, ny, nz;  // from a to b
+    float depth;
+  };
+
+  struct Stats
+  {
+    int bodies;
+    int pairs;      // broadphase pairs
+    int contacts;   // narrowphase hits
+    int swaps;      // insertion sort moves, low while the order is coherent
+    double broadphaseMs;
+    double narrowphaseMs;
+  };
+
+  CharacterCollision();
+  ~CharacterCollision();
+
+  int addBody(float x, float y, float z, float radius, float height, float inverseMass = 1.0f);
+  void clear(void);
+  int getBodyCount(void) const { return (int)mBodies.size(); }
+
+  void setPosition(int body, float x, float y, float z);
+  void setInverseMass(int body, float inverseMass) { mBodies[body].inverseMass = inverseMass; }
+  void setEnabled(int body, bool enabled) { mBodies[body].enabled = enabled; }
+
+  float getX(int body) const { return mBodies[body].x; }
+  float getY(int body) const { return mBodies[body].y; }
+  float getZ(int body) const { return mBodies[body].z; }
+
+  // broadphase, narrowphase and iterations of push-out
+  void step(int iterations = 2);
+
+  const std::vector<Contact>& getContacts(void) const { return mContacts; }
+  const Stats& getStats(void) const { return mStats; }
+
+private:
+  struct Body
+  {
+    float x, y, z;
+    float radius, height;
+    float inverseMass;
+    bool enabled;
+  };
+
+  void _sortAxis(void);
+  void _findPairs(void);
+  bool _testPair(int a, int b, Contact& contact) const;
+
+  std::vector<Body> mBodies;
+  std::vector<int> mOrder;     // body indices sorted by min x, kept between steps
+  bool mOrderValid;            // false after bodies were added, needs a full sort
+  std::vector<float> mMinX;    // cached per step
+  std::vector<std::pair<int, int> > mPairs;
+  std::vector<Contact> mContacts;
+  Stats mStats;
+};
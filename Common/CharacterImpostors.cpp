@@ -0,0 +1,221 @@
+#include "CharacterImpostors.h"
+#include "RandomStream.h"
+
+using namespace Ogre;
+
+namespace
+{
+  // the bounding sphere of the mesh, with room for the animation to reach
+  // out of its bind pose
+  ImpostorLod::Settings fitToMesh(const String& meshName, ImpostorLod::Settings settings)
+  {
+    MeshPtr mesh = MeshManager::getSingleton().load(meshName, ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME);
+    const AxisAlignedBox& bounds = mesh->getBounds();
+    settings.radius = bounds.getHalfSize().length() * 1.1f;
+    settings.centreHeight = bounds.getCenter().y;
+    return settings;
+  }
+
+  static_assert(sizeof(ImpostorLod::Vertex) == QuadBatch::VERTEX_SIZE, "ImpostorLod::Vertex is not the QuadBatch layout");
+}
+
+
+CharacterImpostors::CharacterImpostors(SceneManager* sceneMgr, Camera* lodCamera, const String& name,
+  const String& meshName, const String& animationName, const ImpostorLod::Settings& settings, int cellPixels)
+  : QuadBatch(name), mSceneMgr(sceneMgr), mLodCamera(lodCamera), mMeshName(meshName),
+    mAnimationName(animationName), mLod(fitToMesh(meshName, settings)), mMaterialName(name + "/Impostor"),
+    mLength(1.0f), mTime(0.0f), mBakeMs(0)
+{
+  _bake(cellPixels);
+  _createMaterial();
+  setMaterial(mMaterialName);
+
+  mRootNode = mSceneMgr->getRootSceneNode()->createChildSceneNode(mName);
+  mRootNode->attachObject(this);
+  Root::getSingleton().addFrameListener(this);
+}
+
+CharacterImpostors::~CharacterImpostors()
+{
+  Root::getSingleton().removeFrameListener(this);
+  destroy();
+  mRootNode->detachObject(this);
+  mSceneMgr->destroySceneNode(mRootNode);
+
+  MaterialManager::getSingleton().remove(mMaterialName);
+  TextureManager::getSingleton().remove(mAtlas->getName());
+}
+
+void CharacterImpostors::create(const std::vector<Vector3>& positions, unsigned int seed)
+{
+  destroy();
+
+  if ((int)positions.size() > _getCapacity())
+    _setCapacity((int)positions.size());
+
+  RandomStream random(seed);
+  AxisAlignedBox box;
+  for (size_t i = 0; i < positions.size(); i++)
+  {
+    const float yaw = random.range(-Math::PI, Math::PI);
+    const float phase = random.nextFloat();
+
+    SceneNode* node = mRootNode->createChildSceneNode(positions[i], Quaternion(Radian(yaw), Vector3::UNIT_Y));
+    Entity* entity = mSceneMgr->createEntity(mName + "/" + StringConverter::toString(i), mMeshName);
+    node->attachObject(entity);
+
+    AnimationState* animation = entity->getAnimationState(mAnimationName);
+    animation->setEnabled(true);
+    animation->setLoop(true);
+
+    mNodes.push_back(node);
+    mEntities.push_back(entity);
+    mAnimations.push_back(animation);
+    mLod.add(positions[i].x, positions[i].y, positions[i].z, yaw, phase);
+    box.merge(positions[i]);
+  }
+
+  if (!positions.empty())
+  {
+    // the billboards reach a sphere around each copy's centre
+    const ImpostorLod::Settings& settings = mLod.getSettings();
+    box.setExtents(box.getMinimum() - Vector3(settings.radius, 0.0f, settings.radius),
+      box.getMaximum() + Vector3(settings.radius, settings.centreHeight + settings.radius, settings.radius));
+    _setBounds(box);
+  }
+
+  LogManager::getSingleton().stream() << "CharacterImpostors " << mName << ": " << positions.size()
+    << " copies of " << mMeshName << " playing " << mAnimationName << ", atlas " << mAtlas->getWidth() << "x"
+    << mAtlas->getHeight() << " baked in " << mBakeMs << " ms";
+}
+
+void CharacterImpostors::destroy(void)
+{
+  for (size_t i = 0; i < mEntities.size(); i++)
+    mSceneMgr->destroyEntity(mEntities[i]);
+  for (size_t i = 0; i < mNodes.size(); i++)
+    mSceneMgr->destroySceneNode(mNodes[i]);
+
+  mEntities.clear();
+  mNodes.clear();
+  mAnimations.clear();
+  mLod.clear();
+  _setBounds(AxisAlignedBox::BOX_NULL);
+}
+
+void CharacterImpostors::logStats(void) const
+{
+  const ImpostorLod::Stats& stats = mLod.getStats();
+  LogManager::getSingleton().stream() << "CharacterImpostors " << mName << ": " << getCount() << " copies, "
+    << (mLod.isEnabled() ? "impostors on" : "impostors off") << ", " << stats.meshes << " meshes, " << stats.impostors
+    << " billboards, " << stats.fading << " fading, " << stats.switched << " switched; select " << stats.selectMs
+    << " ms, billboards " << stats.buildMs << " ms";
+}
+
+bool CharacterImpostors::frameStarted(const FrameEvent& evt)
+{
+  mTime = std::fmod(mTime + evt.timeSinceLastFrame, mLength);
+
+  // pixels per unit at distance 1 on the LOD camera's viewport
+  const Viewport* viewport = mLodCamera->getViewport();
+  const Real height = viewport ? (Real)viewport->getActualHeight() : 720.0f;
+  const Real pixelScale = height / (2.0f * Math::Tan(mLodCamera->getFOVy() * 0.5f));
+  mLod.update(mLodCamera->getDerivedPosition().ptr(), pixelScale, evt.timeSinceLastFrame);
+
+  const std::vector<int>& changed = mLod.getChanged();
+  for (size_t i = 0; i < changed.size(); i++)
+    mEntities[changed[i]]->setVisible(mLod.isMeshVisible(changed[i]));
+
+  // only the shown meshes are posed, at the frame their billboard would show
+  for (size_t i = 0; i < mAnimations.size(); i++)
+  {
+    if (mLod.isMeshVisible((int)i))
+      mAnimations[i]->setTimePosition(std::fmod(mTime + mLod.getPhase((int)i) * mLength, mLength));
+  }
+  return true;
+}
+
+int CharacterImpostors::_writeQuads(const Vector3& right, const Vector3& up, void* vertices, int maxQuads)
+{
+  // white vertices, they read the same in either colour order
+  return mLod.buildBillboards(right.ptr(), up.ptr(), mTime / mLength, static_cast<ImpostorLod::Vertex*>(vertices), maxQuads);
+}
+
+void CharacterImpostors::_bake(int cellPixels)
+{
+  Timer timer;
+  const ImpostorLod::Settings& settings = mLod.getSettings();
+  const Vector3 centre(0.0f, settings.centreHeight, 0.0f);
+
+  // the mesh alone, nothing of the scene can get into the atlas
+  SceneManager* bakeMgr = Root::getSingleton().createSceneManager(ST_GENERIC, mName + "/Bake");
+  bakeMgr->setAmbientLight(mSceneMgr->getAmbientLight());
+  Entity* entity = bakeMgr->createEntity(mMeshName);
+  bakeMgr->getRootSceneNode()->attachObject(entity);
+  AnimationState* animation = entity->getAnimationState(mAnimationName);
+  animation->setEnabled(true);
+  mLength = std::max(animation->getLength(), 0.001f);
+
+  // a cell frames the bounding sphere
+  Camera* camera = bakeMgr->createCamera(mName + "/Bake");
+  camera->setProjectionType(PT_ORTHOGRAPHIC);
+  camera->setOrthoWindow(settings.radius * 2.0f, settings.radius * 2.0f);
+  camera->setAspectRatio(1.0f);
+  camera->setNearClipDistance(settings.radius);
+  camera->setFarClipDistance(settings.radius * 4.0f);
+
+  mAtlas = TextureManager::getSingleton().createManual(mName + "/Atlas", ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME,
+    TEX_TYPE_2D, mLod.getColumns() * cellPixels, mLod.getRows() * cellPixels, 0, PF_A8R8G8B8, TU_RENDERTARGET);
+  RenderTarget* target = mAtlas->getBuffer()->getRenderTarget();
+  target->setAutoUpdated(false);
+
+  Viewport* viewport = target->addViewport(camera);
+  viewport->setClearEveryFrame(true);
+  viewport->setBackgroundColour(ColourValue(0.0f, 0.0f, 0.0f, 0.0f));
+  viewport->setOverlaysEnabled(false);
+  viewport->setSkiesEnabled(false);
+  viewport->setShadowsEnabled(false);
+
+  // one update per cell, the viewport only clears and draws its own
+  for (int frame = 0; frame < settings.frames; frame++)
+  {
+    animation->setTimePosition(mLength * frame / settings.frames);
+    for (int elevation = 0; elevation < settings.elevations; elevation++)
+    {
+      for (int angle = 0; angle < settings.angles; angle++)
+      {
+        Vector3 direction;
+        mLod.getViewDirection(angle, elevation, direction.ptr());
+        camera->setPosition(centre + direction * settings.radius * 2.0f);
+        camera->lookAt(centre);
+
+        float rect[4];
+        mLod.getCellRect(mLod.getCell(angle, elevation, frame), rect);
+        viewport->setDimensions(rect[0], rect[1], rect[2] - rect[0], rect[3] - rect[1]);
+        target->update();
+      }
+    }
+  }
+
+  target->removeAllViewports();
+  Root::getSingleton().destroySceneManager(bakeMgr);
+  mBakeMs = timer.getMilliseconds();
+}
+
+void CharacterImpostors::_createMaterial(void)
+{
+  MaterialPtr material = MaterialManager::getSingleton().create(mMaterialName, ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME);
+  material->setReceiveShadows(false);
+
+  Pass* pass = material->getTechnique(0)->getPass(0);
+  pass->setLightingEnabled(false);
+  pass->setDepthWriteEnabled(false);
+  pass->setSceneBlending(SBT_TRANSPARENT_ALPHA);
+  // the empty parts of a cell cost no blending
+  pass->setAlphaRejectSettings(CMPF_GREATER, 0);
+
+  // no mipmaps, they would bleed neighbouring cells into each other
+  TextureUnitState* unit = pass->createTextureUnitState(mAtlas->getName());
+  unit->setTextureAddressingMode(TextureUnitState::TAM_CLAMP);
+  unit->setTextureFiltering(TFO_BILINEAR);
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <Ogre.h>
+
+#include <vector>
+
+#include "ImpostorLod.h"
+#include "QuadBatch.h"
+
+// A field of animated copies of one character. Copies that are small on
+// the LOD camera's screen are drawn as billboards from an atlas instead of
+// a skinned mesh; an ImpostorLod decides which and cross-fades the switch.
+//
+// The atlas is rendered once when the set is constructed: the mesh in a
+// scene manager of its own, through an orthographic camera, at every
+// view angle, elevation and animation frame ImpostorLod lays out. The
+// bounding sphere of the mesh sets the size of a cell, so the settings'
+// radius and centreHeight are taken from the mesh. It is lit only by the
+// ambient light the scene has at that time.
+//
+// All billboards are one QuadBatch, written for every camera that sees the
+// field, the farthest first. Hidden meshes are not skinned at all; the
+// visible ones play the animation at the instance's phase, the same frame
+// its billboard shows.
+class CharacterImpostors : public QuadBatch,
+  public Ogre::FrameListener
+{
+public:
+  CharacterImpostors(Ogre::SceneManager* sceneMgr, Ogre::Camera* lodCamera, const Ogre::String& name,
+    const Ogre::String& meshName, const Ogre::String& animationName,
+    const ImpostorLod::Settings& settings = ImpostorLod::Settings(), int cellPixels = 128);
+  ~CharacterImpostors();
+
+  // random yaws and animation phases
+  void create(const std::vector<Ogre::Vector3>& positions, unsigned int seed = 2016);
+  void destroy(void);
+  int getCount(void) const { return (int)mEntities.size(); }
+
+  // off draws every copy as a mesh
+  void setEnabled(bool enabled) { mLod.setEnabled(enabled); }
+  bool isEnabled(void) const { return mLod.isEnabled(); }
+
+  const ImpostorLod::Stats& getStats(void) const { return mLod.getStats(); }
+  unsigned long getBakeMilliseconds(void) const { return mBakeMs; }
+  void logStats(void) const;
+
+  // FrameListener
+  bool frameStarted(const Ogre::FrameEvent& evt);
+
+protected:
+  // QuadBatch
+  int _getQuadCount(void) const { return mLod.getStats().impostors; }
+  int _writeQuads(const Ogre::Vector3& right, const Ogre::Vector3& up, void* vertices, int maxQuads);
+
+private:
+  void _bake(int cellPixels);
+  void _createMaterial(void);
+
+  Ogre::SceneManager* mSceneMgr;
+  Ogre::Camera* mLodCamera;
+  Ogre::String mMeshName;
+  Ogre::String mAnimationName;
+  ImpostorLod mLod;
+
+  Ogre::TexturePtr mAtlas;
+  Ogre::String mMaterialName;
+  Ogre::Real mLength;   // of the animation, seconds
+  Ogre::Real mTime;
+  unsigned long mBakeMs;
+
+  Ogre::SceneNode* mRootNode;   // holds the billboards and the copies' nodes
+  std::vector<Ogre::SceneNode*> mNodes;
+  std::vector<Ogre::Entity*> mEntities;
+  std::vector<Ogre::AnimationState*> mAnimations;
+};
@@ -0,0 +1,422 @@
+#include "CloneSet.h"
+#include "RandomStream.h"
+
+#include <OgreInstanceManager.h>
+#include <OgreInstancedEntity.h>
+#include <OgreHighLevelGpuProgramManager.h>
+
+using namespace Ogre;
+
+namespace
+{
+  const char* INSTANCING_PROGRAM = "CloneSet/ShaderBasedVP";
+  // D3D9 does not pair shader model 3 vertex programs with the fixed
+  // function pixel pipeline, so the pixel side is a program as well: the
+  // texture times the colour, as the fixed function passes do
+  const char* TEXTURED_FRAGMENT_PROGRAM = "CloneSet/TexturedFP";
+  const char* COLOUR_FRAGMENT_PROGRAM = "CloneSet/ColourFP";
+
+  // world_matrix_array_3x4 holds one 3x4 matrix per instance, the per vertex
+  // blend index written by the instance batch selects it. 80 matrices fill
+  // the 240 constant registers vs_3_0 leaves after the view-projection.
+  const char* INSTANCING_HLSL =
+    "uniform float3x4 worldMatrix3x4Array[80];\n"
+    "uniform float4x4 viewProjMatrix;\n"
+    "uniform float4 ambient;\n"
+    "void main_vs(float4 position : POSITION, float2 uv0 : TEXCOORD0, float4 blendIdx : BLENDINDICES,\n"
+    "  out float4 oPosition : POSITION, out float2 oUv0 : TEXCOORD0, out float4 oColour : COLOR)\n"
+    "{\n"
+    "  float4 worldPos = float4(mul(worldMatrix3x4Array[blendIdx.x], position).xyz, 1.0);\n"
+    "  oPosition = mul(viewProjMatrix, worldPos);\n"
+    "  oUv0 = uv0;\n"
+    "  oColour = ambient;\n"
+    "}\n";
+
+  const char* INSTANCING_GLSL =
+    "#version 120\n"
+    "uniform vec4 worldMatrix3x4Array[240];\n"
+    "uniform mat4 viewProjMatrix;\n"
+    "uniform vec4 ambient;\n"
+    "attribute vec4 vertex;\n"
+    "attribute vec4 uv0;\n"
+    "attribute vec4 blendIndices;\n"
+    "void main()\n"
+    "{\n"
+    "  int idx = int(blendIndices.x) * 3;\n"
+    "  vec4 worldPos = vec4(dot(worldMatrix3x4Array[idx], vertex),\n"
+    "    dot(worldMatrix3x4Array[idx + 1], vertex),\n"
+    "    dot(worldMatrix3x4Array[idx + 2], vertex), 1.0);\n"
+    "  gl_Position = viewProjMatrix * worldPos;\n"
+    "  gl_TexCoord[0] = uv0;\n"
+    "  gl_FrontColor = ambient;\n"
+    "}\n";
+
+  const char* TEXTURED_HLSL =
+    "sampler2D diffuseMap : register(s0);\n"
+    "float4 main_ps(float2 uv0 : TEXCOORD0, float4 colour : COLOR) : COLOR\n"
+    "{\n"
+    "  return tex2D(diffuseMap, uv0) * colour;\n"
+    "}\n";
+
+  const char* COLOUR_HLSL =
+    "float4 main_ps(float4 colour : COLOR) : COLOR\n"
+    "{\n"
+    "  return colour;\n"
+    "}\n";
+
+  const char* TEXTURED_GLSL =
+    "#version 120\n"
+    "uniform sampler2D diffuseMap;\n"
+    "void main()\n"
+    "{\n"
+    "  gl_FragColor = texture2D(diffuseMap, gl_TexCoord[0].xy) * gl_Color;\n"
+    "}\n";
+
+  const char* COLOUR_GLSL =
+    "#version 120\n"
+    "void main()\n"
+    "{\n"
+    "  gl_FragColor = gl_Color;\n"
+    "}\n";
+}
+
+
+CloneSet::CloneSet(SceneManager* sceneMgr, const String& name, const String& meshName)
+  : mSceneMgr(sceneMgr), mName(name), mMeshName(meshName), mTechnique(TECHNIQUE_NONE),
+    mInstancingPrepared(false), mInstancingSupported(false), mRootNode(nullptr)
+{
+}
+
+CloneSet::~CloneSet()
+{
+  destroy();
+
+  for (size_t i = 0; i < mManagerNames.size(); i++)
+    mSceneMgr->destroyInstanceManager(mManagerNames[i]);
+}
+
+const char* CloneSet::getTechniqueName(void) const
+{
+  switch (mTechnique)
+  {
+  case TECHNIQUE_SHADER_BASED: return "shader based instancing";
+  case TECHNIQUE_ENTITIES: return "entities";
+  default: return "none";
+  }
+}
+
+const char* CloneSet::getLayoutName(Layout layout)
+{
+  switch (layout)
+  {
+  case LAYOUT_GRID: return "grid";
+  case LAYOUT_RANDOM: return "random";
+  default: return "ring";
+  }
+}
+
+size_t CloneSet::getBatchCount(void) const
+{
+  if (mTechnique == TECHNIQUE_ENTITIES)
+  {
+    size_t batches = 0;
+    for (size_t i = 0; i < mEntities.size(); i++)
+      batches += mEntities[i]->getNumSubEntities();
+    return batches;
+  }
+
+  if (mTechnique != TECHNIQUE_SHADER_BASED)
+    return 0;
+
+  // batches are filled one after another
+  size_t batches = 0;
+  for (size_t i = 0; i < mManagerNames.size(); i++)
+  {
+    const size_t perBatch = mSceneMgr->getInstanceManager(mManagerNames[i])->getNumInstancesPerBatch();
+    batches += (mNodes.size() + perBatch - 1) / perBatch;
+  }
+  return batches;
+}
+
+void CloneSet::create(int count, Layout layout, float spacing, bool useInstancing, unsigned int seed)
+{
+  destroy();
+
+  std::vector<Vector3> positions;
+  computePositions(count, layout, spacing, seed, positions);
+
+  mTechnique = (useInstancing && _prepareInstancing()) ? TECHNIQUE_SHADER_BASED : TECHNIQUE_ENTITIES;
+  mRootNode = mSceneMgr->getRootSceneNode()->createChildSceneNode(mName);
+
+  for (int i = 0; i < count; i++)
+  {
+    SceneNode* node = mRootNode->createChildSceneNode(positions[i]);
+    mNodes.push_back(node);
+
+    if (mTechnique == TECHNIQUE_SHADER_BASED)
+    {
+      // one instanced entity per submesh, all following the same node
+      for (size_t sub = 0; sub < mManagerNames.size(); sub++)
+      {
+        InstancedEntity* entity = mSceneMgr->createInstancedEntity(mMaterialNames[sub], mManagerNames[sub]);
+        node->attachObject(entity);
+        mInstancedEntities.push_back(entity);
+      }
+    }
+    else
+    {
+      Entity* entity = mSceneMgr->createEntity(mName + StringConverter::toString(i), mMeshName);
+      node->attachObject(entity);
+      mEntities.push_back(entity);
+    }
+  }
+
+  LogManager::getSingleton().stream() << "CloneSet " << mName << ": " << count << " clones of "
+    << mMeshName << " (" << getLayoutName(layout) << "), " << getTechniqueName()
+    << ", " << getBatchCount() << " batches";
+}
+
+void CloneSet::destroy(void)
+{
+  for (size_t i = 0; i < mInstancedEntities.size(); i++)
+    mSceneMgr->destroyInstancedEntity(mInstancedEntities[i]);
+  for (size_t i = 0; i < mEntities.size(); i++)
+    mSceneMgr->destroyEntity(mEntities[i]);
+  for (size_t i = 0; i < mNodes.size(); i++)
+    mSceneMgr->destroySceneNode(mNodes[i]);
+  if (mRootNode)
+    mSceneMgr->destroySceneNode(mRootNode);
+
+  // release the buffers of batches that no longer hold any instance
+  for (size_t i = 0; i < mManagerNames.size(); i++)
+    mSceneMgr->getInstanceManager(mManagerNames[i])->cleanupEmptyBatches();
+
+  mInstancedEntities.clear();
+  mEntities.clear();
+  mNodes.clear();
+  mRootNode = nullptr;
+  mTechnique = TECHNIQUE_NONE;
+}
+
+void CloneSet::computePositions(int count, Layout layout, float spacing, unsigned int seed, std::vector<Vector3>& positions)
+{
+  positions.resize(count);
+
+  if (layout == LAYOUT_RING)
+  {
+    int placed = 0;
+    for (float radius = 250.0f; placed < count; radius += spacing)
+    {
+      const int capacity = std::max(1, (int)(Math::TWO_PI * radius / spacing));
+      const int ringCount = std::min(capacity, count - placed);
+      for (int i = 0; i < ringCount; i++)
+      {
+        const float angle = (float)i / ringCount * Math::TWO_PI;
+        positions[placed++] = Vector3(radius * Math::Cos(angle), 0.0f, -radius * Math::Sin(angle));
+      }
+    }
+  }
+  else if (layout == LAYOUT_GRID)
+  {
+    const int side = (int)std::ceil(std::sqrt((float)count));
+    const float offset = (side - 1) * spacing * 0.5f;
+    for (int i = 0; i < count; i++)
+      positions[i] = Vector3((i % side) * spacing - offset, 0.0f, (i / side) * spacing - offset);
+  }
+  else
+  {
+    RandomStream random(seed);
+    const float half = std::sqrt((float)count) * spacing * 0.5f;
+    for (int i = 0; i < count; i++)
+      positions[i] = Vector3(random.range(-half, half), 0.0f, random.range(-half, half));
+  }
+}
+
+bool CloneSet::_prepareInstancing(void)
+{
+  if (mInstancingPrepared)
+    return mInstancingSupported;
+  mInstancingPrepared = true;
+
+  const RenderSystemCapabilities* caps = Root::getSingleton().getRenderSystem()->getCapabilities();
+  if (!caps->hasCapability(RSC_VERTEX_PROGRAM))
+  {
+    LogManager::getSingleton().logMessage("CloneSet: no vertex programs, using entities");
+    return false;
+  }
+
+  const String program = _createVertexProgram();
+  const String texturedProgram = _createFragmentProgram(TEXTURED_FRAGMENT_PROGRAM, TEXTURED_HLSL, TEXTURED_GLSL);
+  const String colourProgram = _createFragmentProgram(COLOUR_FRAGMENT_PROGRAM, COLOUR_HLSL, COLOUR_GLSL);
+  if (program.empty() || texturedProgram.empty() || colourProgram.empty())
+    return false;
+
+  MeshPtr mesh = _createStaticMesh();
+
+  for (unsigned short i = 0; i < mesh->getNumSubMeshes(); i++)
+  {
+    MaterialPtr base = MaterialManager::getSingleton().getByName(mesh->getSubMesh(i)->getMaterialName());
+    if (base.isNull())
+      base = MaterialManager::getSingleton().getByName("BaseWhite");
+
+    // same textures and states, positions come from the instancing program
+    const String materialName = mName + "/Instanced/" + StringConverter::toString(i);
+    MaterialPtr material = base->clone(materialName);
+    mMaterialNames.push_back(materialName);
+    while (material->getNumTechniques() > 1)
+      material->removeTechnique(1);
+
+    Ogre::Technique* technique = material->getTechnique(0);
+    for (unsigned short p = 0; p < technique->getNumPasses(); p++)
+    {
+      Pass* pass = technique->getPass(p);
+      pass->setVertexProgram(program);
+      GpuProgramParametersSharedPtr params = pass->getVertexProgramParameters();
+      params->setNamedAutoConstant("worldMatrix3x4Array", GpuProgramParameters::ACT_WORLD_MATRIX_ARRAY_3x4);
+      params->setNamedAutoConstant("viewProjMatrix", GpuProgramParameters::ACT_VIEWPROJ_MATRIX);
+      params->setNamedAutoConstant("ambient", GpuProgramParameters::ACT_AMBIENT_LIGHT_COLOUR);
+
+      // the first texture unit, if any, is what the pixel program samples
+      pass->setFragmentProgram(pass->getNumTextureUnitStates() > 0 ? texturedProgram : colourProgram);
+      while (pass->getNumTextureUnitStates() > 1)
+        pass->removeTextureUnitState(1);
+    }
+
+    material->load();
+    if (material->getNumSupportedTechniques() == 0)
+    {
+      LogManager::getSingleton().logMessage("CloneSet: instancing material unsupported, using entities");
+      _releaseInstancing();
+      return false;
+    }
+
+    const size_t perBatch = mSceneMgr->getNumInstancesPerBatch(mesh->getName(), mesh->getGroup(),
+      materialName, InstanceManager::ShaderBased, 80, 0, i);
+    if (perBatch == 0)
+    {
+      LogManager::getSingleton().logMessage("CloneSet: mesh cannot be instanced, using entities");
+      _releaseInstancing();
+      return false;
+    }
+
+    const String managerName = mName + "/Manager/" + StringConverter::toString(i);
+    mSceneMgr->createInstanceManager(managerName, mesh->getName(), mesh->getGroup(),
+      InstanceManager::ShaderBased, perBatch, 0, i);
+
+    mManagerNames.push_back(managerName);
+  }
+
+  mInstancingSupported = true;
+  return true;
+}
+
+void CloneSet::_releaseInstancing(void)
+{
+  // what an instancing attempt that failed half way had created
+  for (size_t i = 0; i < mManagerNames.size(); i++)
+    mSceneMgr->destroyInstanceManager(mManagerNames[i]);
+  for (size_t i = 0; i < mMaterialNames.size(); i++)
+    MaterialManager::getSingleton().remove(mMaterialNames[i]);
+  mManagerNames.clear();
+  mMaterialNames.clear();
+}
+
+MeshPtr CloneSet::_createStaticMesh(void)
+{
+  const String staticName = mMeshName + "/Static";
+  MeshPtr existing = MeshManager::getSingleton().getByName(staticName);
+  if (!existing.isNull())
+    return existing;
+
+  MeshPtr mesh = MeshManager::getSingleton().load(mMeshName, ResourceGroupManager::AUTODETECT_RESOURCE_GROUP_NAME);
+  MeshPtr copy = mesh->clone(staticName);
+
+  // drop the skeleton and the compiled blend data, the instance batch adds
+  // its own blend indices to address the per instance matrices
+  copy->setSkeletonName(StringUtil::BLANK);
+  copy->clearBoneAssignments();
+  if (copy->sharedVertexData)
+  {
+    copy->sharedVertexData->vertexDeclaration->removeElement(VES_BLEND_INDICES);
+    copy->sharedVertexData->vertexDeclaration->removeElement(VES_BLEND_WEIGHTS);
+  }
+  for (unsigned short i = 0; i < copy->getNumSubMeshes(); i++)
+  {
+    SubMesh* sub = copy->getSubMesh(i);
+    sub->clearBoneAssignments();
+    if (!sub->useSharedVertices && sub->vertexData)
+    {
+      sub->vertexData->vertexDeclaration->removeElement(VES_BLEND_INDICES);
+      sub->vertexData->vertexDeclaration->removeElement(VES_BLEND_WEIGHTS);
+    }
+  }
+
+  return copy;
+}
+
+String CloneSet::_createVertexProgram(void)
+{
+  HighLevelGpuProgramManager& manager = HighLevelGpuProgramManager::getSingleton();
+  if (manager.resourceExists(INSTANCING_PROGRAM))
+    return INSTANCING_PROGRAM;
+
+  HighLevelGpuProgramPtr program;
+  if (manager.isLanguageSupported("hlsl"))
+  {
+    program = manager.createProgram(INSTANCING_PROGRAM, ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME, "hlsl", GPT_VERTEX_PROGRAM);
+    program->setSource(INSTANCING_HLSL);
+    program->setParameter("entry_point", "main_vs");
+    program->setParameter("target", "vs_3_0");
+  }
+  else if (manager.isLanguageSupported("glsl"))
+  {
+    program = manager.createProgram(INSTANCING_PROGRAM, ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME, "glsl", GPT_VERTEX_PROGRAM);
+    program->setSource(INSTANCING_GLSL);
+  }
+  else
+  {
+    LogManager::getSingleton().logMessage("CloneSet: neither hlsl nor glsl available, using entities");
+    return StringUtil::BLANK;
+  }
+
+  program->load();
+  if (program->hasCompileError())
+  {
+    LogManager::getSingleton().logMessage("CloneSet: instancing program failed to compile, using entities");
+    return StringUtil::BLANK;
+  }
+
+  return INSTANCING_PROGRAM;
+}
+
+String CloneSet::_createFragmentProgram(const char* name, const char* hlsl, const char* glsl)
+{
+  HighLevelGpuProgramManager& manager = HighLevelGpuProgramManager::getSingleton();
+  if (manager.resourceExists(name))
+    return name;
+
+  HighLevelGpuProgramPtr program;
+  if (manager.isLanguageSupported("hlsl"))
+  {
+    program = manager.createProgram(name, ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME, "hlsl", GPT_FRAGMENT_PROGRAM);
+    program->setSource(hlsl);
+    program->setParameter("entry_point", "main_ps");
+    program->setParameter("target", "ps_3_0");
+  }
+  else if (manager.isLanguageSupported("glsl"))
+  {
+    program = manager.createProgram(name, ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME, "glsl", GPT_FRAGMENT_PROGRAM);
+    program->setSource(glsl);
+  }
+  else
+    return StringUtil::BLANK;
+
+  program->load();
+  if (program->hasCompileError())
+  {
+    LogManager::getSingleton().logMessage(String("CloneSet: ") + name + " failed to compile, using entities");
+    return StringUtil::BLANK;
+  }
+
+  return name;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <vector>
+#include <Ogre.h>
+
+// Many copies of one mesh. Clones are drawn through Ogre's InstanceManager
+// with the shader based technique, a few batches per submesh instead of one
+// per entity. When the render system cannot run the instancing vertex
+// program (or instancing is turned off) every clone becomes an ordinary
+// Entity, like the original CloneProfessors loop.
+//
+// Clones do not animate, so the instanced path uses a copy of the mesh
+// without its skeleton: each instance then needs one world matrix instead
+// of one per bone and many more of them fit into a batch.
+class CloneSet
+{
+public:
+  enum Layout
+  {
+    LAYOUT_RING,    // concentric rings around the origin, the first at 250 units
+    LAYOUT_GRID,
+    LAYOUT_RANDOM
+  };
+
+  enum Technique
+  {
+    TECHNIQUE_NONE,
+    TECHNIQUE_SHADER_BASED,
+    TECHNIQUE_ENTITIES
+  };
+
+  CloneSet(Ogre::SceneManager* sceneMgr, const Ogre::String& name, const Ogre::String& meshName);
+  ~CloneSet();
+
+  // spacing is the distance between neighbouring clones
+  void create(int count, Layout layout, float spacing, bool useInstancing = true, unsigned int seed = 2016);
+  void destroy(void);
+
+  int getCount(void) const { return (int)mNodes.size(); }
+  Technique getTechnique(void) const { return mTechnique; }
+  const char* getTechniqueName(void) const;
+
+  // batches the clones are drawn with (instance batches or entities)
+  size_t getBatchCount(void) const;
+
+  static const char* getLayoutName(Layout layout);
+  // where create() puts the clones, for other sets laid out the same way
+  static void computePositions(int count, Layout layout, float spacing, unsigned int seed, std::vector<Ogre::Vector3>& positions);
+
+private:
+  bool _prepareInstancing(void);
+  Ogre::MeshPtr _createStaticMesh(void);
+  Ogre::String _createVertexProgram(void);
+  Ogre::String _createFragmentProgram(const char* name, const char* hlsl, const char* glsl);
+  void _releaseInstancing(void);
+
+  Ogre::SceneManager* mSceneMgr;
+  Ogre::String mName;
+  Ogre::String mMeshName;
+
+  Technique mTechnique;
+  bool mInstancingPrepared;
+  bool mInstancingSupported;
+
+  Ogre::SceneNode* mRootNode;
+  std::vector<Ogre::SceneNode*> mNodes;
+  std::vector<Ogre::Entity*> mEntities;
+  std::vector<Ogre::InstancedEntity*> mInstancedEntities;
+  std::vector<Ogre::String> mManagerNames;   // one instance manager per submesh
+  std::vector<Ogre::String> mMaterialNames;
+};
@@ -0,0 +1,229 @@
+#include "ClusteredLighting.h"
+#include "ObjectListeners.h"
+
+#include <algorithm>
+
+using namespace Ogre;
+
+const int ClusteredLighting::MIN_LIGHTS;
+
+
+ClusteredLighting::ClusteredLighting(SceneManager* sceneMgr, Camera* camera, int tilesX, int tilesY, int slices)
+  : mSceneMgr(sceneMgr), mCamera(camera), mClusters(tilesX, tilesY, slices), mEnabled(true),
+  mMinLights(MIN_LIGHTS), mMainPass(false), mBin(0)
+{
+  memset(&mStats, 0, sizeof(mStats));
+  mSceneMgr->addListener(this);
+}
+
+ClusteredLighting::~ClusteredLighting()
+{
+  mSceneMgr->removeListener(this);
+
+  while (!mReceivers.empty())
+    removeObject(const_cast<MovableObject*>(mReceivers.begin()->first));
+}
+
+void ClusteredLighting::addObject(MovableObject* object)
+{
+  if (mReceivers.count(object))
+    return;
+
+  mReceivers[object].bin = 0;
+  ObjectListeners::add(object, this);
+}
+
+void ClusteredLighting::addAllEntities(void)
+{
+  SceneManager::MovableObjectIterator it = mSceneMgr->getMovableObjectIterator(EntityFactory::FACTORY_TYPE_NAME);
+  while (it.hasMoreElements())
+    addObject(it.getNext());
+}
+
+void ClusteredLighting::removeObject(MovableObject* object)
+{
+  std::unordered_map<const MovableObject*, Receiver>::iterator it = mReceivers.find(object);
+  if (it == mReceivers.end())
+    return;
+
+  ObjectListeners::remove(object, this);
+  mReceivers.erase(it);
+}
+
+void ClusteredLighting::logStats(void) const
+{
+  if (mStats.fallback)
+  {
+    LogManager::getSingleton().stream() << "ClusteredLighting: Ogre's light search, " << mStats.fallback;
+    return;
+  }
+
+  const LightClusters::Stats& clusters = mStats.clusters;
+  LogManager::getSingleton().stream() << "ClusteredLighting: " << clusters.lightsBinned << " of " << clusters.lights
+    << " lights binned in " << mStats.binMs << " ms, " << clusters.clusterEntries << " entries in "
+    << clusters.clustersUsed << " of " << mClusters.getClusterCount() << " clusters, " << clusters.objectsQueried
+    << " objects queried in " << mStats.queryMs << " ms, " << clusters.lightsAssigned << " lights assigned ("
+    << clusters.candidatesTested << " tested), " << mDirectional.size() << " directional";
+}
+
+void ClusteredLighting::postUpdateSceneGraph(SceneManager* source, Camera* camera)
+{
+  if (source->_getCurrentRenderStage() == SceneManager::IRS_RENDER_TO_TEXTURE)
+    return;
+
+  mMainPass = false;
+  if (camera != mCamera)
+    return;
+
+  // additive shadows render one pass per light with a list of its own and
+  // never ask the objects, the clusters would be built for nothing
+  if (!mEnabled)
+    mStats.fallback = "clusters off";
+  else if (source->isShadowTechniqueAdditive())
+    mStats.fallback = "additive shadows light every object in a pass per light";
+  else
+    mMainPass = _bin();
+}
+
+void ClusteredLighting::objectDestroyed(MovableObject* object)
+{
+  mReceivers.erase(object);
+}
+
+const LightList* ClusteredLighting::objectQueryLights(const MovableObject* object)
+{
+  std::unordered_map<const MovableObject*, Receiver>::iterator it = mReceivers.find(object);
+  if (it == mReceivers.end())
+    return nullptr;
+
+  Receiver& receiver = it->second;
+
+  // Ogre asks for every renderable and pass, the list is built once per bin
+  if (!mEnabled || !mMainPass)
+    return nullptr;
+  if (receiver.bin == mBin)
+    return &receiver.lights;
+
+  mTimer.reset();
+
+  const Sphere& bounds = object->getWorldBoundingSphere(true);
+  const LightClusters::Sphere sphere = { bounds.getCenter().x, bounds.getCenter().y, bounds.getCenter().z, bounds.getRadius() };
+  mClusters.query(sphere, mQuery);
+
+  // directional lights are at distance 0, they stay in front
+  receiver.lights.clear();
+  for (size_t i = 0; i < mDirectional.size(); i++)
+  {
+    if (mDirectional[i]->getLightMask() & object->getLightMask())
+    {
+      mDirectional[i]->_calcTempSquareDist(bounds.getCenter());
+      receiver.lights.push_back(mDirectional[i]);
+    }
+  }
+
+  // passes take the closest lights first; the lists are a few lights long,
+  // each goes straight to its place
+  for (size_t i = 0; i < mQuery.size(); i++)
+  {
+    Light* light = mLights[mQuery[i]];
+    if (!(light->getLightMask() & object->getLightMask()))
+      continue;
+
+    light->_calcTempSquareDist(bounds.getCenter());
+    size_t slot = receiver.lights.size();
+    receiver.lights.push_back(light);
+    for (; slot > 0 && receiver.lights[slot - 1]->tempSquareDist > light->tempSquareDist; slot--)
+      receiver.lights[slot] = receiver.lights[slot - 1];
+    receiver.lights[slot] = light;
+  }
+  receiver.bin = mBin;
+
+  mStats.queryMs += mTimer.getMicroseconds() / 1000.0f;
+  mStats.clusters = mClusters.getStats();
+  return &receiver.lights;
+}
+
+bool ClusteredLighting::_bin(void)
+{
+  mTimer.reset();
+
+  mLights.clear();
+  mDirectional.clear();
+  mSpheres.clear();
+
+  SceneManager::MovableObjectIterator it = mSceneMgr->getMovableObjectIterator(LightFactory::FACTORY_TYPE_NAME);
+  while (it.hasMoreElements())
+  {
+    Light* light = static_cast<Light*>(it.getNext());
+    if (!light->isVisible())
+      continue;
+
+    if (light->getType() == Light::LT_DIRECTIONAL)
+    {
+      mDirectional.push_back(light);
+    }
+    else
+    {
+      mLights.push_back(light);
+      mSpheres.push_back(_getBounds(light));
+    }
+  }
+
+  if ((int)mLights.size() < mMinLights)
+  {
+    mStats.fallback = "too few lights for the clusters to pay off";
+    return false;
+  }
+
+  const Matrix4& view = mCamera->getViewMatrix(true);
+  float rows[12];
+  for (int row = 0; row < 3; row++)
+  {
+    for (int col = 0; col < 4; col++)
+      rows[row * 4 + col] = (float)view[row][col];
+  }
+
+  // an infinite far plane still needs an end for the depth slices
+  const Real farDist = mCamera->getFarClipDistance() > 0.0f ? mCamera->getFarClipDistance() : Real(100000.0f);
+  mClusters.setView(rows, Math::Tan(mCamera->getFOVy() * 0.5f), mCamera->getAspectRatio(),
+    mCamera->getNearClipDistance(), farDist);
+  mClusters.build(mSpheres.empty() ? nullptr : &mSpheres[0], (int)mSpheres.size());
+
+  mBin++;
+  mStats.fallback = nullptr;
+  mStats.binMs = mTimer.getMicroseconds() / 1000.0f;
+  mStats.queryMs = 0.0f;
+  mStats.clusters = mClusters.getStats();
+  return true;
+}
+
+LightClusters::Sphere ClusteredLighting::_getBounds(const Light* light)
+{
+  const Vector3 position = light->getDerivedPosition();
+  const Real range = light->getAttenuationRange();
+  LightClusters::Sphere sphere = { position.x, position.y, position.z, range };
+
+  if (light->getType() != Light::LT_SPOTLIGHT)
+    return sphere;
+
+  // tightest sphere around the cone: wide cones are bound by their cap,
+  // narrow ones by a sphere through the apex
+  const Real halfAngle = light->getSpotlightOuterAngle().valueRadians() * 0.5f;
+  const Vector3 direction = light->getDerivedDirection();
+  Vector3 centre;
+  if (halfAngle > Math::QUARTER_PI)
+  {
+    centre = position + direction * (range * Math::Cos(halfAngle));
+    sphere.radius = range * Math::Sin(halfAngle);
+  }
+  else
+  {
+    sphere.radius = range / (2.0f * Math::Cos(halfAngle));
+    centre = position + direction * sphere.radius;
+  }
+
+  sphere.x = centre.x;
+  sphere.y = centre.y;
+  sphere.z = centre.z;
+  return sphere;
+}
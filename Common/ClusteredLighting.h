@@ -0,0 +1,100 @@
+#pragma once
+
+#include <Ogre.h>
+
+#include <unordered_map>
+#include <vector>
+
+#include "LightClusters.h"
+
+// Replaces Ogre's per object light search with a LightClusters lookup.
+// After the main camera updates the scene graph, the visible point and spot
+// lights are binned into the camera's clusters once; objects handed to
+// addObject() then get their light list from the clusters they touch,
+// closest first, with directional lights always in front. Other cameras
+// and shadow passes fall back to Ogre's own search.
+//
+// Ogre only asks objects for their lights when it draws all of them in one
+// pass: without shadows, or with modulative or integrated shadows. With an
+// additive shadow technique every light gets a pass of its own over every
+// object, so nothing is binned then and each extra light costs a pass.
+//
+// Binning and the cluster lookups only pay off against Ogre's search with
+// many lights: below MIN_LIGHTS visible point and spot lights nothing is
+// binned and Ogre's search is used (see Benchmark lights).
+//
+// The lights are handed out through the MovableObject listener of each
+// object, shared with other modules by way of ObjectListeners; a list some
+// listener added before returns wins over the clusters.
+class ClusteredLighting : public Ogre::SceneManager::Listener,
+  public Ogre::MovableObject::Listener
+{
+public:
+  // the lights benchmark breaks even at about 256 lights with 1200 objects
+  // in view, and later with fewer objects
+  static const int MIN_LIGHTS = 256;
+
+  struct Stats
+  {
+    const char* fallback;   // why Ogre's search was used, null when the clusters were
+    float binMs;
+    float queryMs;
+    LightClusters::Stats clusters;
+  };
+
+  ClusteredLighting(Ogre::SceneManager* sceneMgr, Ogre::Camera* camera, int tilesX = 16, int tilesY = 8, int slices = 24);
+  ~ClusteredLighting();
+
+  void addObject(Ogre::MovableObject* object);
+  // every entity in the scene
+  void addAllEntities(void);
+  void removeObject(Ogre::MovableObject* object);
+
+  // off hands the lights back to Ogre's search
+  void setEnabled(bool enabled) { mEnabled = enabled; }
+  bool isEnabled(void) const { return mEnabled; }
+  // 0 uses the clusters at any light count
+  void setMinLights(int lights) { mMinLights = lights; }
+  int getMinLights(void) const { return mMinLights; }
+
+  // stats of the last frame of the main camera
+  const Stats& getStats(void) const { return mStats; }
+  void logStats(void) const;
+
+  // SceneManager::Listener
+  void postUpdateSceneGraph(Ogre::SceneManager* source, Ogre::Camera* camera);
+
+  // MovableObject::Listener
+  void objectDestroyed(Ogre::MovableObject* object);
+  const Ogre::LightList* objectQueryLights(const Ogre::MovableObject* object);
+
+private:
+  struct Receiver
+  {
+    Ogre::LightList lights;
+    unsigned long bin;   // the lights were built for
+  };
+
+  // false when there are too few lights to bin
+  bool _bin(void);
+  static LightClusters::Sphere _getBounds(const Ogre::Light* light);
+
+  Ogre::SceneManager* mSceneMgr;
+  Ogre::Camera* mCamera;
+  LightClusters mClusters;
+  bool mEnabled;
+  int mMinLights;
+
+  std::unordered_map<const Ogre::MovableObject*, Receiver> mReceivers;
+
+  // binned this frame
+  bool mMainPass;
+  unsigned long mBin;
+  std::vector<Ogre::Light*> mLights;
+  std::vector<Ogre::Light*> mDirectional;
+  std::vector<LightClusters::Sphere> mSpheres;
+  std::vector<int> mQuery;
+  Ogre::Timer mTimer;
+
+  Stats mStats;
+};
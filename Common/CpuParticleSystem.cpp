@@ -0,0 +1,129 @@
+#include "CpuParticleSystem.h"
+
+using namespace Ogre;
+
+namespace
+{
+  const char* SPRITE_TEXTURE = "CpuParticles/Sprite";
+  const int SPRITE_SIZE = 32;
+
+  static_assert(sizeof(ParticlePool::Vertex) == QuadBatch::VERTEX_SIZE, "ParticlePool::Vertex is not the QuadBatch layout");
+}
+
+const char* CpuParticleSystem::FOG_MATERIAL = "CpuParticles/Fog";
+const char* CpuParticleSystem::SPARKLE_MATERIAL = "CpuParticles/Sparkle";
+
+
+CpuParticleSystem::CpuParticleSystem(const String& name, int capacity, const String& material)
+  : QuadBatch(name), mPool(capacity, FastHash(name.c_str(), (int)name.size()))
+{
+  _createMaterials();
+  _setCapacity(mPool.capacity());
+  setMaterial(material);
+
+  Root::getSingleton().addFrameListener(this);
+}
+
+CpuParticleSystem::~CpuParticleSystem()
+{
+  Root::getSingleton().removeFrameListener(this);
+}
+
+int CpuParticleSystem::addEmitter(SceneNode* node, const ParticlePool::Emitter& emitter)
+{
+  NodeEmitter link;
+  link.node = node;
+  link.id = mPool.addEmitter(emitter);
+  link.local = emitter;
+  mEmitters.push_back(link);
+  return (int)mEmitters.size() - 1;
+}
+
+void CpuParticleSystem::logStats(void) const
+{
+  const ParticlePool::Stats& stats = mPool.getStats();
+  LogManager::getSingleton().stream() << "CpuParticleSystem " << mName << ": " << stats.alive << " of "
+    << mPool.capacity() << " alive, " << stats.emitted << " emitted, " << stats.died << " died, " << stats.dropped
+    << " dropped; " << (mPool.isSimd() ? "SSE" : "scalar") << " emit " << stats.emitMs << " ms, integrate "
+    << stats.integrateMs << " ms, billboards " << stats.buildMs << " ms";
+}
+
+bool CpuParticleSystem::frameStarted(const FrameEvent& evt)
+{
+  for (size_t i = 0; i < mEmitters.size(); i++)
+  {
+    const NodeEmitter& link = mEmitters[i];
+    const Quaternion orientation = link.node->_getDerivedOrientation();
+    const Vector3 position = link.node->_getDerivedPosition() + orientation * Vector3(link.local.position);
+    const Vector3 direction = (orientation * Vector3(link.local.direction)).normalisedCopy();
+
+    ParticlePool::Emitter& emitter = mPool.getEmitter(link.id);
+    emitter = link.local;
+    memcpy(emitter.position, position.ptr(), sizeof(emitter.position));
+    memcpy(emitter.direction, direction.ptr(), sizeof(emitter.direction));
+  }
+
+  // a long stall would otherwise emit a second's worth of particles at once
+  mPool.update(std::min(evt.timeSinceLastFrame, 0.1f));
+  _updateBounds();
+  return true;
+}
+
+int CpuParticleSystem::_writeQuads(const Vector3& right, const Vector3& up, void* vertices, int maxQuads)
+{
+  return mPool.buildBillboards(right.ptr(), up.ptr(), static_cast<ParticlePool::Vertex*>(vertices), maxQuads, _isArgb());
+}
+
+void CpuParticleSystem::_updateBounds(void)
+{
+  if (mPool.size() == 0)
+  {
+    _setBounds(AxisAlignedBox::BOX_NULL);
+    return;
+  }
+
+  float min[3], max[3];
+  mPool.getBounds(min, max);
+  // the corners of a quad are up to size * sqrt(2) from its centre
+  const Vector3 pad(mPool.getMaxSize() * Math::Sqrt(2.0f));
+  _setBounds(AxisAlignedBox(Vector3(min) - pad, Vector3(max) + pad));
+}
+
+void CpuParticleSystem::_createMaterials(void)
+{
+  if (!MaterialManager::getSingleton().getByName(FOG_MATERIAL).isNull())
+    return;
+
+  // a white disc fading out towards its edge
+  Image sprite;
+  uchar* pixels = OGRE_ALLOC_T(uchar, SPRITE_SIZE * SPRITE_SIZE * 4, MEMCATEGORY_GENERAL);
+  for (int y = 0; y < SPRITE_SIZE; y++)
+  {
+    for (int x = 0; x < SPRITE_SIZE; x++)
+    {
+      const float dx = (x + 0.5f) / SPRITE_SIZE * 2.0f - 1.0f, dy = (y + 0.5f) / SPRITE_SIZE * 2.0f - 1.0f;
+      const float alpha = std::max(1.0f - Math::Sqrt(dx * dx + dy * dy), 0.0f);
+      ColourValue colour(1.0f, 1.0f, 1.0f, alpha * alpha);
+      PixelUtil::packColour(colour, PF_A8R8G8B8, pixels + (y * SPRITE_SIZE + x) * 4);
+    }
+  }
+  // the image frees the pixels
+  sprite.loadDynamicImage(pixels, SPRITE_SIZE, SPRITE_SIZE, 1, PF_A8R8G8B8, true);
+  TextureManager::getSingleton().loadImage(SPRITE_TEXTURE, ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME, sprite);
+
+  const char* names[2] = { FOG_MATERIAL, SPARKLE_MATERIAL };
+  for (int i = 0; i < 2; i++)
+  {
+    MaterialPtr material = MaterialManager::getSingleton().create(names[i], ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME);
+    material->setReceiveShadows(false);
+
+    Pass* pass = material->getTechnique(0)->getPass(0);
+    pass->setLightingEnabled(false);
+    pass->setDepthWriteEnabled(false);
+    if (i == 0)
+      pass->setSceneBlending(SBT_TRANSPARENT_ALPHA);
+    else
+      pass->setSceneBlending(SBF_SOURCE_ALPHA, SBF_ONE);
+    pass->createTextureUnitState(SPRITE_TEXTURE)->setTextureAddressingMode(TextureUnitState::TAM_CLAMP);
+  }
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <Ogre.h>
+
+#include <vector>
+
+#include "ParticlePool.h"
+#include "QuadBatch.h"
+
+// Particles simulated on the CPU by a ParticlePool and drawn as one
+// QuadBatch. Every frame the emitters are moved to the scene nodes they are
+// attached to and the pool is updated; for every camera that sees the
+// system the billboards facing it are written into the batch.
+//
+// Particles are in world space, attach the system to the root node (or
+// any node without a transform). Emitter positions and directions are
+// relative to their node, so an emitter on the "Night" node turns with it.
+//
+// Two materials come with it, both unlit, coloured by the vertices and
+// drawn without depth writes:
+//
+//   CpuParticles/Fog       alpha blended
+//   CpuParticles/Sparkle   additive
+class CpuParticleSystem : public QuadBatch,
+  public Ogre::FrameListener
+{
+public:
+  static const char* FOG_MATERIAL;
+  static const char* SPARKLE_MATERIAL;
+
+  CpuParticleSystem(const Ogre::String& name, int capacity, const Ogre::String& material = FOG_MATERIAL);
+  ~CpuParticleSystem();
+
+  // the emitter's position and direction in the node's space
+  int addEmitter(Ogre::SceneNode* node, const ParticlePool::Emitter& emitter);
+  ParticlePool::Emitter& getEmitter(int id) { return mEmitters[id].local; }
+
+  ParticlePool& getPool(void) { return mPool; }
+  void setSimd(bool simd) { mPool.setSimd(simd); }
+  bool isSimd(void) const { return mPool.isSimd(); }
+  void logStats(void) const;
+
+  // FrameListener
+  bool frameStarted(const Ogre::FrameEvent& evt);
+
+protected:
+  // QuadBatch
+  int _getQuadCount(void) const { return mPool.size(); }
+  int _writeQuads(const Ogre::Vector3& right, const Ogre::Vector3& up, void* vertices, int maxQuads);
+
+private:
+  struct NodeEmitter
+  {
+    Ogre::SceneNode* node;
+    int id;
+    ParticlePool::Emitter local;
+  };
+
+  void _updateBounds(void);
+  static void _createMaterials(void);
+
+  ParticlePool mPool;
+  std::vector<NodeEmitter> mEmitters;
+};
@@ -0,0 +1,537 @@
+#include "CrowdAvoidance.h"
+
+#include <cmath>
+#include <algorithm>
+
+#if defined(_M_X64) || defined(_M_AMD64) || defined(__SSE2__)
+#define CROWD_AVOIDANCE_SSE
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+  const float EPSILON = 0.00001f;
+
+  inline float det(float ax, float az, float bx, float bz) { return ax * bz - az * bx; }
+
+  // neighbour data gathered for one agent, laid out for 4-wide processing
+  struct NeighbourBatch
+  {
+    float rpx[CrowdAvoidance::MAX_NEIGHBOURS];
+    float rpz[CrowdAvoidance::MAX_NEIGHBOURS];
+    float rvx[CrowdAvoidance::MAX_NEIGHBOURS];
+    float rvz[CrowdAvoidance::MAX_NEIGHBOURS];
+    float cr[CrowdAvoidance::MAX_NEIGHBOURS];
+
+    float ux[CrowdAvoidance::MAX_NEIGHBOURS];
+    float uz[CrowdAvoidance::MAX_NEIGHBOURS];
+    float dx[CrowdAvoidance::MAX_NEIGHBOURS];
+    float dz[CrowdAvoidance::MAX_NEIGHBOURS];
+  };
+
+  // ORCA half-plane of one neighbour. u is the smallest change of relative
+  // velocity that resolves the collision, d the direction of the line.
+  inline void orcaLane(float rpx, float rpz, float rvx, float rvz, float cr,
+    float invTimeHorizon, float invTimeStep, float& ux, float& uz, float& dx, float& dz)
+  {
+    const float distSq = rpx * rpx + rpz * rpz;
+    const float crSq = cr * cr;
+    const bool collision = !(distSq > crSq);
+    const float s = collision ? invTimeStep : invTimeHorizon;
+
+    const float wx = rvx - s * rpx;
+    const float wz = rvz - s * rpz;
+    const float wLengthSq = wx * wx + wz * wz;
+    const float dot1 = wx * rpx + wz * rpz;
+
+    if (collision || (dot1 < 0.0f && dot1 * dot1 > crSq * wLengthSq))
+    {
+      // project on the cut-off circle
+      const float wLength = std::max(std::sqrt(wLengthSq), EPSILON);
+      const float uwx = wx / wLength;
+      const float uwz = wz / wLength;
+      dx = uwz;
+      dz = -uwx;
+      ux = (cr * s - wLength) * uwx;
+      uz = (cr * s - wLength) * uwz;
+    }
+    else
+    {
+      // project on the legs of the velocity obstacle cone
+      const float leg = std::sqrt(std::max(distSq - crSq, 0.0f));
+      if (det(rpx, rpz, wx, wz) > 0.0f)
+      {
+        dx = (rpx * leg - rpz * cr) / distSq;
+        dz = (rpx * cr + rpz * leg) / distSq;
+      }
+      else
+      {
+        dx = -(rpx * leg + rpz * cr) / distSq;
+        dz = -(-rpx * cr + rpz * leg) / distSq;
+      }
+      const float dot2 = rvx * dx + rvz * dz;
+      ux = dot2 * dx - rvx;
+      uz = dot2 * dz - rvz;
+    }
+  }
+
+#ifdef CROWD_AVOIDANCE_SSE
+  inline __m128 select(__m128 mask, __m128 a, __m128 b)
+  {
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+  }
+
+  // same as orcaLane for four neighbours at once, every branch is evaluated
+  // and the results are blended with the lane masks
+  void orcaBatch4(NeighbourBatch& b, int offset, float invTimeHorizon, float invTimeStep)
+  {
+    const __m128 rpx = _mm_loadu_ps(b.rpx + offset);
+    const __m128 rpz = _mm_loadu_ps(b.rpz + offset);
+    const __m128 rvx = _mm_loadu_ps(b.rvx + offset);
+    const __m128 rvz = _mm_loadu_ps(b.rvz + offset);
+    const __m128 cr = _mm_loadu_ps(b.cr + offset);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 eps = _mm_set1_ps(EPSILON);
+
+    const __m128 distSq = _mm_add_ps(_mm_mul_ps(rpx, rpx), _mm_mul_ps(rpz, rpz));
+    const __m128 crSq = _mm_mul_ps(cr, cr);
+    const __m128 collision = _mm_cmple_ps(distSq, crSq);
+    const __m128 s = select(collision, _mm_set1_ps(invTimeStep), _mm_set1_ps(invTimeHorizon));
+
+    const __m128 wx = _mm_sub_ps(rvx, _mm_mul_ps(s, rpx));
+    const __m128 wz = _mm_sub_ps(rvz, _mm_mul_ps(s, rpz));
+    const __m128 wLengthSq = _mm_add_ps(_mm_mul_ps(wx, wx), _mm_mul_ps(wz, wz));
+    const __m128 dot1 = _mm_add_ps(_mm_mul_ps(wx, rpx), _mm_mul_ps(wz, rpz));
+
+    const __m128 cutoff = _mm_or_ps(collision,
+      _mm_and_ps(_mm_cmplt_ps(dot1, zero),
+                 _mm_cmpgt_ps(_mm_mul_ps(dot1, dot1), _mm_mul_ps(crSq, wLengthSq))));
+
+    // cut-off circle
+    const __m128 wLength = _mm_max_ps(_mm_sqrt_ps(wLengthSq), eps);
+    const __m128 uwx = _mm_div_ps(wx, wLength);
+    const __m128 uwz = _mm_div_ps(wz, wLength);
+    const __m128 scale = _mm_sub_ps(_mm_mul_ps(cr, s), wLength);
+    const __m128 circleUx = _mm_mul_ps(scale, uwx);
+    const __m128 circleUz = _mm_mul_ps(scale, uwz);
+    const __m128 circleDx = uwz;
+    const __m128 circleDz = _mm_sub_ps(zero, uwx);
+
+    // legs, distSq is only used where it is larger than crSq
+    const __m128 invDistSq = _mm_div_ps(_mm_set1_ps(1.0f), _mm_max_ps(distSq, eps));
+    const __m128 leg = _mm_sqrt_ps(_mm_max_ps(_mm_sub_ps(distSq, crSq), zero));
+    const __m128 left = _mm_cmpgt_ps(_mm_sub_ps(_mm_mul_ps(rpx, wz), _mm_mul_ps(rpz, wx)), zero);
+
+    const __m128 leftDx = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(rpx, leg), _mm_mul_ps(rpz, cr)), invDistSq);
+    const __m128 leftDz = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(rpx, cr), _mm_mul_ps(rpz, leg)), invDistSq);
+    const __m128 rightDx = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(rpx, leg), _mm_mul_ps(rpz, cr)), invDistSq);
+    const __m128 rightDz = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(rpz, leg), _mm_mul_ps(rpx, cr)), invDistSq);
+
+    const __m128 legDx = select(left, leftDx, _mm_sub_ps(zero, rightDx));
+    const __m128 legDz = select(left, leftDz, _mm_sub_ps(zero, rightDz));
+    const __m128 dot2 = _mm_add_ps(_mm_mul_ps(rvx, legDx), _mm_mul_ps(rvz, legDz));
+    const __m128 legUx = _mm_sub_ps(_mm_mul_ps(dot2, legDx), rvx);
+    const __m128 legUz = _mm_sub_ps(_mm_mul_ps(dot2, legDz), rvz);
+
+    _mm_storeu_ps(b.ux + offset, select(cutoff, circleUx, legUx));
+    _mm_storeu_ps(b.uz + offset, select(cutoff, circleUz, legUz));
+    _mm_storeu_ps(b.dx + offset, select(cutoff, circleDx, legDx));
+    _mm_storeu_ps(b.dz + offset, select(cutoff, circleDz, legDz));
+  }
+#endif
+}
+
+
+CrowdAvoidance::CrowdAvoidance(float neighbourDistance, float timeHorizon)
+  : mNeighbourDistance(neighbourDistance), mTimeHorizon(timeHorizon),
+  mCellSize(neighbourDistance), mHashMask(0)
+{
+}
+
+CrowdAvoidance::~CrowdAvoidance()
+{
+}
+
+int CrowdAvoidance::addAgent(float x, float z, float radius, float maxSpeed)
+{
+  mPosX.push_back(x);
+  mPosZ.push_back(z);
+  mVelX.push_back(0.0f);
+  mVelZ.push_back(0.0f);
+  mPrefX.push_back(0.0f);
+  mPrefZ.push_back(0.0f);
+  mNewX.push_back(0.0f);
+  mNewZ.push_back(0.0f);
+  mRadius.push_back(radius);
+  mMaxSpeed.push_back(maxSpeed);
+  mAgentCell.push_back(0);
+  mNeighbourCount.push_back(0);
+  mNeighbours.resize(mPosX.size() * MAX_NEIGHBOURS, -1);
+
+  return (int)mPosX.size() - 1;
+}
+
+void CrowdAvoidance::clear(void)
+{
+  mPosX.clear(); mPosZ.clear();
+  mVelX.clear(); mVelZ.clear();
+  mPrefX.clear(); mPrefZ.clear();
+  mNewX.clear(); mNewZ.clear();
+  mRadius.clear();
+  mMaxSpeed.clear();
+  mAgentCell.clear();
+  mCellAgents.clear();
+  mCellStart.clear();
+  mNeighbours.clear();
+  mNeighbourCount.clear();
+}
+
+void CrowdAvoidance::setPosition(int agent, float x, float z)
+{
+  mPosX[agent] = x;
+  mPosZ[agent] = z;
+}
+
+void CrowdAvoidance::setVelocity(int agent, float vx, float vz)
+{
+  mVelX[agent] = vx;
+  mVelZ[agent] = vz;
+}
+
+void CrowdAvoidance::setPreferredVelocity(int agent, float vx, float vz)
+{
+  mPrefX[agent] = vx;
+  mPrefZ[agent] = vz;
+}
+
+void CrowdAvoidance::computeVelocities(float timeStep)
+{
+  const int count = getAgentCount();
+  if (count == 0 || timeStep <= 0.0f)
+    return;
+
+  _buildHash();
+
+  Line lines[MAX_NEIGHBOURS];
+  for (int i = 0; i < count; i++)
+  {
+    _findNeighbours(i);
+    const int lineCount = _buildConstraints(i, timeStep, lines);
+
+    float resultX = 0.0f, resultZ = 0.0f;
+    const int failLine = _linearProgram2(lines, lineCount, mMaxSpeed[i],
+      mPrefX[i], mPrefZ[i], false, resultX, resultZ);
+    if (failLine < lineCount)
+      _linearProgram3(lines, lineCount, failLine, mMaxSpeed[i], resultX, resultZ);
+
+    mNewX[i] = resultX;
+    mNewZ[i] = resultZ;
+  }
+
+  mVelX.swap(mNewX);
+  mVelZ.swap(mNewZ);
+}
+
+void CrowdAvoidance::integrate(float timeStep)
+{
+  const int count = getAgentCount();
+  for (int i = 0; i < count; i++)
+  {
+    mPosX[i] += mVelX[i] * timeStep;
+    mPosZ[i] += mVelZ[i] * timeStep;
+  }
+}
+
+int CrowdAvoidance::_hashCell(int cx, int cz) const
+{
+  return (int)(((unsigned)cx * 73856093u) ^ ((unsigned)cz * 19349663u)) & mHashMask;
+}
+
+void CrowdAvoidance::_buildHash(void)
+{
+  const int count = getAgentCount();
+
+  int tableSize = 64;
+  while (tableSize < count * 2)
+    tableSize <<= 1;
+  mHashMask = tableSize - 1;
+
+  mCellStart.assign(tableSize + 1, 0);
+  mCellAgents.resize(count);
+
+  const float invCell = 1.0f / mCellSize;
+  for (int i = 0; i < count; i++)
+  {
+    const int cx = (int)std::floor(mPosX[i] * invCell);
+    const int cz = (int)std::floor(mPosZ[i] * invCell);
+    mAgentCell[i] = _hashCell(cx, cz);
+    mCellStart[mAgentCell[i] + 1]++;
+  }
+
+  for (int c = 0; c < tableSize; c++)
+    mCellStart[c + 1] += mCellStart[c];
+
+  // counting sort, mCellStart[c] is used as write cursor and restored below
+  for (int i = 0; i < count; i++)
+    mCellAgents[mCellStart[mAgentCell[i]]++] = i;
+  for (int c = tableSize; c > 0; c--)
+    mCellStart[c] = mCellStart[c - 1];
+  mCellStart[0] = 0;
+}
+
+void CrowdAvoidance::_findNeighbours(int agent)
+{
+  const float x = mPosX[agent];
+  const float z = mPosZ[agent];
+  const float rangeSq = mNeighbourDistance * mNeighbourDistance;
+  const float invCell = 1.0f / mCellSize;
+  const int cx = (int)std::floor(x * invCell);
+  const int cz = (int)std::floor(z * invCell);
+
+  // the 3x3 cells may share hash buckets, visit every bucket once
+  int buckets[9];
+  int bucketCount = 0;
+  for (int oz = -1; oz <= 1; oz++)
+  {
+    for (int ox = -1; ox <= 1; ox++)
+    {
+      const int h = _hashCell(cx + ox, cz + oz);
+      if (std::find(buckets, buckets + bucketCount, h) == buckets + bucketCount)
+        buckets[bucketCount++] = h;
+    }
+  }
+
+  int* neighbours = &mNeighbours[agent * MAX_NEIGHBOURS];
+  float distances[MAX_NEIGHBOURS];
+  int found = 0;
+
+  for (int b = 0; b < bucketCount; b++)
+  {
+    for (int k = mCellStart[buckets[b]]; k < mCellStart[buckets[b] + 1]; k++)
+    {
+      const int other = mCellAgents[k];
+      if (other == agent)
+        continue;
+
+      const float ddx = mPosX[other] - x;
+      const float ddz = mPosZ[other] - z;
+      const float distSq = ddx * ddx + ddz * ddz;
+      if (distSq >= rangeSq)
+        continue;
+      if (found == MAX_NEIGHBOURS && distSq >= distances[found - 1])
+        continue;
+
+      // keep the closest MAX_NEIGHBOURS, sorted by distance
+      int slot = (found < MAX_NEIGHBOURS) ? found++ : found - 1;
+      while (slot > 0 && distances[slot - 1] > distSq)
+      {
+        distances[slot] = distances[slot - 1];
+        neighbours[slot] = neighbours[slot - 1];
+        slot--;
+      }
+      distances[slot] = distSq;
+      neighbours[slot] = other;
+    }
+  }
+
+  mNeighbourCount[agent] = found;
+}
+
+int CrowdAvoidance::_buildConstraints(int agent, float timeStep, Line* lines)
+{
+  const int count = mNeighbourCount[agent];
+  const int* neighbours = &mNeighbours[agent * MAX_NEIGHBOURS];
+  const float invTimeHorizon = 1.0f / mTimeHorizon;
+  const float invTimeStep = 1.0f / timeStep;
+
+  NeighbourBatch batch;
+  for (int n = 0; n < MAX_NEIGHBOURS; n++)
+  {
+    if (n < count)
+    {
+      const int other = neighbours[n];
+      batch.rpx[n] = mPosX[other] - mPosX[agent];
+      batch.rpz[n] = mPosZ[other] - mPosZ[agent];
+      batch.rvx[n] = mVelX[agent] - mVelX[other];
+      batch.rvz[n] = mVelZ[agent] - mVelZ[other];
+      batch.cr[n] = mRadius[agent] + mRadius[other];
+    }
+    else
+    {
+      // padding lanes, far away and never read back
+      batch.rpx[n] = mNeighbourDistance * 4.0f;
+      batch.rpz[n] = 0.0f;
+      batch.rvx[n] = batch.rvz[n] = 0.0f;
+      batch.cr[n] = 1.0f;
+    }
+  }
+
+#ifdef CROWD_AVOIDANCE_SSE
+  for (int n = 0; n < count; n += 4)
+    orcaBatch4(batch, n, invTimeHorizon, invTimeStep);
+#else
+  for (int n = 0; n < count; n++)
+    orcaLane(batch.rpx[n], batch.rpz[n], batch.rvx[n], batch.rvz[n], batch.cr[n],
+      invTimeHorizon, invTimeStep, batch.ux[n], batch.uz[n], batch.dx[n], batch.dz[n]);
+#endif
+
+  // each agent takes half of the responsibility for avoiding the collision
+  for (int n = 0; n < count; n++)
+  {
+    lines[n].px = mVelX[agent] + 0.5f * batch.ux[n];
+    lines[n].pz = mVelZ[agent] + 0.5f * batch.uz[n];
+    lines[n].dx = batch.dx[n];
+    lines[n].dz = batch.dz[n];
+  }
+
+  return count;
+}
+
+bool CrowdAvoidance::_linearProgram1(const Line* lines, int lineNo, float radius,
+  float optX, float optZ, bool directionOpt, float& resultX, float& resultZ)
+{
+  const Line& line = lines[lineNo];
+  const float dotProduct = line.px * line.dx + line.pz * line.dz;
+  const float discriminant = dotProduct * dotProduct + radius * radius - (line.px * line.px + line.pz * line.pz);
+
+  if (discriminant < 0.0f)
+    return false;  // max speed circle fully invalidates this line
+
+  const float sqrtDiscriminant = std::sqrt(discriminant);
+  float tLeft = -dotProduct - sqrtDiscriminant;
+  float tRight = -dotProduct + sqrtDiscriminant;
+
+  for (int i = 0; i < lineNo; i++)
+  {
+    const float denominator = det(line.dx, line.dz, lines[i].dx, lines[i].dz);
+    const float numerator = det(lines[i].dx, lines[i].dz, line.px - lines[i].px, line.pz - lines[i].pz);
+
+    if (std::fabs(denominator) <= EPSILON)
+    {
+      // lines are (almost) parallel
+      if (numerator < 0.0f)
+        return false;
+      continue;
+    }
+
+    const float t = numerator / denominator;
+    if (denominator >= 0.0f)
+      tRight = std::min(tRight, t);
+    else
+      tLeft = std::max(tLeft, t);
+
+    if (tLeft > tRight)
+      return false;
+  }
+
+  float t;
+  if (directionOpt)
+  {
+    t = (optX * line.dx + optZ * line.dz > 0.0f) ? tRight : tLeft;
+  }
+  else
+  {
+    t = line.dx * (optX - line.px) + line.dz * (optZ - line.pz);
+    t = std::min(std::max(t, tLeft), tRight);
+  }
+
+  resultX = line.px + t * line.dx;
+  resultZ = line.pz + t * line.dz;
+  return true;
+}
+
+int CrowdAvoidance::_linearProgram2(const Line* lines, int lineCount, float radius,
+  float optX, float optZ, bool directionOpt, float& resultX, float& resultZ)
+{
+  const float optLengthSq = optX * optX + optZ * optZ;
+
+  if (directionOpt)
+  {
+    resultX = optX * radius;
+    resultZ = optZ * radius;
+  }
+  else if (optLengthSq > radius * radius)
+  {
+    const float scale = radius / std::sqrt(optLengthSq);
+    resultX = optX * scale;
+    resultZ = optZ * scale;
+  }
+  else
+  {
+    resultX = optX;
+    resultZ = optZ;
+  }
+
+  for (int i = 0; i < lineCount; i++)
+  {
+    if (det(lines[i].dx, lines[i].dz, lines[i].px - resultX, lines[i].pz - resultZ) > 0.0f)
+    {
+      // result does not satisfy constraint i
+      const float tempX = resultX, tempZ = resultZ;
+      if (!_linearProgram1(lines, i, radius, optX, optZ, directionOpt, resultX, resultZ))
+      {
+        resultX = tempX;
+        resultZ = tempZ;
+        return i;
+      }
+    }
+  }
+
+  return lineCount;
+}
+
+void CrowdAvoidance::_linearProgram3(const Line* lines, int lineCount, int beginLine,
+  float radius, float& resultX, float& resultZ)
+{
+  float distance = 0.0f;
+  Line projLines[MAX_NEIGHBOURS];
+
+  for (int i = beginLine; i < lineCount; i++)
+  {
+    if (det(lines[i].dx, lines[i].dz, lines[i].px - resultX, lines[i].pz - resultZ) <= distance)
+      continue;
+
+    // result does not satisfy constraint of line i, minimise the penetration instead
+    int projCount = 0;
+    for (int j = 0; j < i; j++)
+    {
+      Line line;
+      const float determinant = det(lines[i].dx, lines[i].dz, lines[j].dx, lines[j].dz);
+
+      if (std::fabs(determinant) <= EPSILON)
+      {
+        if (lines[i].dx * lines[j].dx + lines[i].dz * lines[j].dz > 0.0f)
+          continue;  // same direction
+
+        line.px = 0.5f * (lines[i].px + lines[j].px);
+        line.pz = 0.5f * (lines[i].pz + lines[j].pz);
+      }
+      else
+      {
+        const float t = det(lines[j].dx, lines[j].dz, lines[i].px - lines[j].px, lines[i].pz - lines[j].pz) / determinant;
+        line.px = lines[i].px + t * lines[i].dx;
+        line.pz = lines[i].pz + t * lines[i].dz;
+      }
+
+      line.dx = lines[j].dx - lines[i].dx;
+      line.dz = lines[j].dz - lines[i].dz;
+      const float length = std::sqrt(line.dx * line.dx + line.dz * line.dz);
+      if (length > EPSILON)
+      {
+        line.dx /= length;
+        line.dz /= length;
+      }
+      projLines[projCount++] = line;
+    }
+
+    const float tempX = resultX, tempZ = resultZ;
+    if (_linearProgram2(projLines, projCount, radius, -lines[i].dz, lines[i].dx, true, resultX, resultZ) < projCount)
+    {
+      // should not happen in principle, keep the previous result
+      resultX = tempX;
+      resultZ = tempZ;
+    }
+
+    distance = det(lines[i].dx, lines[i].dz, lines[i].px - resultX, lines[i].pz - resultZ);
+  }
+}
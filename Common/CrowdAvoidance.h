@@ -0,0 +1,82 @@
+#pragma once
+
+#include <vector>
+
+// ORCA (optimal reciprocal collision avoidance) for agents walking on the
+// ground plane. Agent data is kept in SoA arrays, neighbours are gathered
+// from a spatial hash and capped at MAX_NEIGHBOURS so that the cost per
+// agent stays constant regardless of crowd density.
+//
+// Positions and velocities are given in the x/z plane of the scene.
+class CrowdAvoidance
+{
+public:
+  enum { MAX_NEIGHBOURS = 8 };
+
+  CrowdAvoidance(float neighbourDistance = 60.0f, float timeHorizon = 2.0f);
+  ~CrowdAvoidance();
+
+  int addAgent(float x, float z, float radius, float maxSpeed);
+  void clear(void);
+  int getAgentCount(void) const { return (int)mPosX.size(); }
+
+  void setPosition(int agent, float x, float z);
+  void setVelocity(int agent, float vx, float vz);
+  void setPreferredVelocity(int agent, float vx, float vz);
+  void setMaxSpeed(int agent, float maxSpeed) { mMaxSpeed[agent] = maxSpeed; }
+
+  float getPositionX(int agent) const { return mPosX[agent]; }
+  float getPositionZ(int agent) const { return mPosZ[agent]; }
+  float getVelocityX(int agent) const { return mVelX[agent]; }
+  float getVelocityZ(int agent) const { return mVelZ[agent]; }
+  int getNeighbourCount(int agent) const { return mNeighbourCount[agent]; }
+
+  // computes a collision free velocity for every agent from its preferred velocity
+  void computeVelocities(float timeStep);
+
+  // advances positions by the computed velocities (headless simulation only,
+  // scene controllers move their own nodes)
+  void integrate(float timeStep);
+
+private:
+  struct Line
+  {
+    float px, pz;
+    float dx, dz;
+  };
+
+  void _buildHash(void);
+  void _findNeighbours(int agent);
+  int _buildConstraints(int agent, float timeStep, Line* lines);
+
+  static bool _linearProgram1(const Line* lines, int lineNo, float radius,
+    float optX, float optZ, bool directionOpt, float& resultX, float& resultZ);
+  static int _linearProgram2(const Line* lines, int lineCount, float radius,
+    float optX, float optZ, bool directionOpt, float& resultX, float& resultZ);
+  static void _linearProgram3(const Line* lines, int lineCount, int beginLine,
+    float radius, float& resultX, float& resultZ);
+
+  int _hashCell(int cx, int cz) const;
+
+  float mNeighbourDistance;
+  float mTimeHorizon;
+
+  // agent state (SoA)
+  std::vector<float> mPosX, mPosZ;
+  std::vector<float> mVelX, mVelZ;
+  std::vector<float> mPrefX, mPrefZ;
+  std::vector<float> mNewX, mNewZ;
+  std::vector<float> mRadius;
+  std::vector<float> mMaxSpeed;
+
+  // spatial hash, rebuilt every step with a counting sort
+  float mCellSize;
+  int mHashMask;
+  std::vector<int> mCellStart;
+  std::vector<int> mCellAgents;
+  std::vector<int> mAgentCell;
+
+  // fixed size neighbour lists, MAX_NEIGHBOURS slots per agent
+  std::vector<int> mNeighbours;
+  std::vector<int> mNeighbourCount;
+};
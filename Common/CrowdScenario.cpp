@@ -0,0 +1,453 @@
+#include "CrowdScenario.h"
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+
+namespace
+{
+  std::string trim(const std::string& str)
+  {
+    const size_t begin = str.find_first_not_of(" \t\r");
+    if (begin == std::string::npos)
+      return std::string();
+    const size_t end = str.find_last_not_of(" \t\r");
+    return str.substr(begin, end - begin + 1);
+  }
+
+  void hashBytes(uint64_t& hash, const void* data, size_t size)
+  {
+    const unsigned char* bytes = (const unsigned char*)data;
+    for (size_t i = 0; i < size; i++)
+    {
+      hash ^= bytes[i];
+      hash *= 1099511628211ULL;
+    }
+  }
+
+  template <typename T> void hashValue(uint64_t& hash, const T& value)
+  {
+    hashBytes(hash, &value, sizeof(T));
+  }
+}
+
+
+CrowdScenarioConfig::CrowdScenarioConfig()
+{
+  seed = 1;
+  agentCount[PROFESSOR] = 10;
+  agentCount[NINJA] = 10;
+  speed[PROFESSOR] = 100.0f;
+  speed[NINJA] = 80.0f;
+  radius = 15.0f;
+  areaSize = 500.0f;
+  randomWaypoints = 4;
+  waypointJitter = 30.0f;
+  arriveDistance = 10.0f;
+  thinkInterval = 0.2f;
+  ticks = 1800;
+  timeStep = 1.0f / 30.0f;
+}
+
+bool CrowdScenarioConfig::parseKind(const std::string& name, AgentKind& kind)
+{
+  for (int k = 0; k < KIND_COUNT; k++)
+  {
+    if (name == getKindName((AgentKind)k))
+    {
+      kind = (AgentKind)k;
+      return true;
+    }
+  }
+  return false;
+}
+
+const char* CrowdScenarioConfig::getKindName(AgentKind kind)
+{
+  static const char* names[KIND_COUNT] = { "professor", "ninja" };
+  return names[kind];
+}
+
+bool CrowdScenarioConfig::load(const std::string& fileName, std::string& error)
+{
+  std::ifstream file(fileName.c_str());
+  if (!file)
+  {
+    error = "cannot open " + fileName;
+    return false;
+  }
+
+  std::stringstream text;
+  text << file.rdbuf();
+  if (!parse(text.str(), error))
+  {
+    error = fileName + ": " + error;
+    return false;
+  }
+  return true;
+}
+
+bool CrowdScenarioConfig::parse(const std::string& text, std::string& error)
+{
+  std::istringstream lines(text);
+  std::string line;
+  int lineNo = 0;
+
+  while (std::getline(lines, line))
+  {
+    lineNo++;
+    line = trim(line.substr(0, line.find('#')));
+    if (line.empty())
+      continue;
+
+    const size_t equal = line.find('=');
+    if (equal == std::string::npos)
+    {
+      std::ostringstream msg;
+      msg << "line " << lineNo << ": expected key=value";
+      error = msg.str();
+      return false;
+    }
+
+    const std::string key = trim(line.substr(0, equal));
+    const std::string value = trim(line.substr(equal + 1));
+    std::istringstream in(value);
+    bool ok = true;
+
+    if (key == "Seed") ok = !!(in >> seed);
+    else if (key == "Professors") ok = !!(in >> agentCount[PROFESSOR]);
+    else if (key == "Ninjas") ok = !!(in >> agentCount[NINJA]);
+    else if (key == "ProfessorSpeed") ok = !!(in >> speed[PROFESSOR]);
+    else if (key == "NinjaSpeed") ok = !!(in >> speed[NINJA]);
+    else if (key == "Radius") ok = !!(in >> radius);
+    else if (key == "AreaSize") ok = !!(in >> areaSize);
+    else if (key == "RandomWaypoints") ok = !!(in >> randomWaypoints);
+    else if (key == "WaypointJitter") ok = !!(in >> waypointJitter);
+    else if (key == "ArriveDistance") ok = !!(in >> arriveDistance);
+    else if (key == "ThinkInterval") ok = !!(in >> thinkInterval);
+    else if (key == "Ticks") ok = !!(in >> ticks);
+    else if (key == "TimeStep") ok = !!(in >> timeStep);
+    else if (key == "Waypoints")
+    {
+      // Waypoints=<kind> x,z x,z ...
+      WaypointSet set;
+      std::string kindName, point;
+      ok = (in >> kindName) && parseKind(kindName, set.kind);
+      while (ok && (in >> point))
+      {
+        float x, z;
+        ok = sscanf(point.c_str(), "%f,%f", &x, &z) == 2;
+        set.x.push_back(x);
+        set.z.push_back(z);
+      }
+      ok = ok && !set.x.empty();
+      if (ok)
+        waypointSets.push_back(set);
+    }
+    else if (key == "Chase")
+    {
+      // Chase=<chaser> <target> <radius> [speedScale]
+      ChaseRule rule;
+      std::string chaser, target;
+      rule.speedScale = 1.0f;
+      ok = (in >> chaser >> target >> rule.radius) && parseKind(chaser, rule.chaser) && parseKind(target, rule.target);
+      if (ok && !(in >> rule.speedScale))
+        rule.speedScale = 1.0f;
+      if (ok)
+        chaseRules.push_back(rule);
+    }
+    else
+    {
+      std::ostringstream msg;
+      msg << "line " << lineNo << ": unknown key " << key;
+      error = msg.str();
+      return false;
+    }
+
+    if (!ok)
+    {
+      std::ostringstream msg;
+      msg << "line " << lineNo << ": bad value for " << key;
+      error = msg.str();
+      return false;
+    }
+  }
+
+  return true;
+}
+
+
+CrowdScenario::CrowdScenario()
+  : mScheduler(4, 0.0), mTick(0), mGridCellSize(100.0f), mGridSize(1)
+{
+}
+
+CrowdScenario::~CrowdScenario()
+{
+}
+
+void CrowdScenario::setup(const CrowdScenarioConfig& config)
+{
+  mConfig = config;
+  mAvoidance.clear();
+  mScheduler.clear();
+  mTick = 0;
+
+  int total = 0;
+  for (int k = 0; k < CrowdScenarioConfig::KIND_COUNT; k++)
+    total += config.agentCount[k];
+
+  mAgents.clear();
+  mAgents.resize(total);
+  mThinkers.clear();
+  mThinkers.resize(total);
+
+  const float half = config.areaSize * 0.5f;
+
+  int index = 0;
+  for (int k = 0; k < CrowdScenarioConfig::KIND_COUNT; k++)
+  {
+    const CrowdScenarioConfig::AgentKind kind = (CrowdScenarioConfig::AgentKind)k;
+
+    const CrowdScenarioConfig::WaypointSet* set = 0;
+    for (size_t w = 0; w < config.waypointSets.size(); w++)
+    {
+      if (config.waypointSets[w].kind == kind)
+        set = &config.waypointSets[w];
+    }
+
+    float maxSpeedScale = 1.0f;
+    for (size_t r = 0; r < config.chaseRules.size(); r++)
+    {
+      if (config.chaseRules[r].chaser == kind)
+        maxSpeedScale = std::max(maxSpeedScale, config.chaseRules[r].speedScale);
+    }
+
+    for (int n = 0; n < config.agentCount[k]; n++, index++)
+    {
+      Agent& agent = mAgents[index];
+      agent.kind = kind;
+      agent.random.setSeed(config.seed, (uint64_t)index);
+      agent.chaseTarget = -1;
+      agent.speedScale = 1.0f;
+
+      const float x = agent.random.range(-half, half);
+      const float z = agent.random.range(-half, half);
+
+      if (set)
+      {
+        const float offsetX = agent.random.range(-config.waypointJitter, config.waypointJitter);
+        const float offsetZ = agent.random.range(-config.waypointJitter, config.waypointJitter);
+        for (size_t p = 0; p < set->x.size(); p++)
+        {
+          agent.waypointX.push_back(set->x[p] + offsetX);
+          agent.waypointZ.push_back(set->z[p] + offsetZ);
+        }
+      }
+      else
+      {
+        for (int p = 0; p < config.randomWaypoints; p++)
+        {
+          agent.waypointX.push_back(agent.random.range(-half, half));
+          agent.waypointZ.push_back(agent.random.range(-half, half));
+        }
+      }
+      agent.waypoint = agent.waypointX.empty() ? 0 : agent.random.range(0, (int)agent.waypointX.size() - 1);
+
+      mAvoidance.addAgent(x, z, config.radius, config.speed[k] * maxSpeedScale);
+
+      mThinkers[index].owner = this;
+      mThinkers[index].index = index;
+      mScheduler.add(&mThinkers[index], config.thinkInterval);
+    }
+  }
+
+  // the chase grid covers the area plus a margin, agents outside are clamped
+  mGridCellSize = 100.0f;
+  for (size_t r = 0; r < config.chaseRules.size(); r++)
+    mGridCellSize = std::max(mGridCellSize, config.chaseRules[r].radius);
+  mGridSize = std::max(1, (int)std::ceil(config.areaSize * 1.5f / mGridCellSize));
+}
+
+void CrowdScenario::run(int ticks)
+{
+  for (int t = 0; t < ticks; t++)
+    tick();
+}
+
+void CrowdScenario::tick(void)
+{
+  const float timeStep = mConfig.timeStep;
+
+  _buildTargetGrid();
+  mScheduler.update(timeStep);
+
+  for (int i = 0; i < getAgentCount(); i++)
+  {
+    const Agent& agent = mAgents[i];
+
+    float goalX, goalZ;
+    if (agent.chaseTarget >= 0)
+    {
+      goalX = getPositionX(agent.chaseTarget);
+      goalZ = getPositionZ(agent.chaseTarget);
+    }
+    else if (!agent.waypointX.empty())
+    {
+      goalX = agent.waypointX[agent.waypoint];
+      goalZ = agent.waypointZ[agent.waypoint];
+    }
+    else
+    {
+      mAvoidance.setPreferredVelocity(i, 0.0f, 0.0f);
+      continue;
+    }
+
+    float dx = goalX - getPositionX(i);
+    float dz = goalZ - getPositionZ(i);
+    const float distance = std::sqrt(dx * dx + dz * dz);
+    const float speed = std::min(mConfig.speed[agent.kind] * agent.speedScale, distance / timeStep);
+
+    if (distance > 0.0f)
+      mAvoidance.setPreferredVelocity(i, dx / distance * speed, dz / distance * speed);
+    else
+      mAvoidance.setPreferredVelocity(i, 0.0f, 0.0f);
+  }
+
+  mAvoidance.computeVelocities(timeStep);
+  mAvoidance.integrate(timeStep);
+  mTick++;
+}
+
+void CrowdScenario::_think(int index)
+{
+  Agent& agent = mAgents[index];
+
+  agent.chaseTarget = -1;
+  agent.speedScale = 1.0f;
+
+  for (size_t r = 0; r < mConfig.chaseRules.size(); r++)
+  {
+    const CrowdScenarioConfig::ChaseRule& rule = mConfig.chaseRules[r];
+    if (rule.chaser != agent.kind)
+      continue;
+
+    const int target = _findTarget(index, rule);
+    if (target >= 0)
+    {
+      agent.chaseTarget = target;
+      agent.speedScale = rule.speedScale;
+      return;
+    }
+  }
+
+  if (agent.waypointX.empty())
+    return;
+
+  const float dx = agent.waypointX[agent.waypoint] - getPositionX(index);
+  const float dz = agent.waypointZ[agent.waypoint] - getPositionZ(index);
+  if (dx * dx + dz * dz > mConfig.arriveDistance * mConfig.arriveDistance)
+    return;
+
+  // like the ninja walk list, a reached random waypoint is replaced by a new one
+  bool randomSet = true;
+  for (size_t w = 0; w < mConfig.waypointSets.size(); w++)
+  {
+    if (mConfig.waypointSets[w].kind == agent.kind)
+      randomSet = false;
+  }
+  if (randomSet)
+  {
+    const float half = mConfig.areaSize * 0.5f;
+    agent.waypointX[agent.waypoint] = agent.random.range(-half, half);
+    agent.waypointZ[agent.waypoint] = agent.random.range(-half, half);
+  }
+
+  agent.waypoint = (agent.waypoint + 1) % (int)agent.waypointX.size();
+}
+
+void CrowdScenario::_buildTargetGrid(void)
+{
+  const int count = getAgentCount();
+  const int cells = mGridSize * mGridSize;
+  const float origin = -mGridSize * mGridCellSize * 0.5f;
+
+  mGridStart.assign(cells + 1, 0);
+  mGridAgents.resize(count);
+
+  std::vector<int> agentCell(count);
+  for (int i = 0; i < count; i++)
+  {
+    const int cx = std::min(std::max((int)((getPositionX(i) - origin) / mGridCellSize), 0), mGridSize - 1);
+    const int cz = std::min(std::max((int)((getPositionZ(i) - origin) / mGridCellSize), 0), mGridSize - 1);
+    agentCell[i] = cz * mGridSize + cx;
+    mGridStart[agentCell[i] + 1]++;
+  }
+
+  for (int c = 0; c < cells; c++)
+    mGridStart[c + 1] += mGridStart[c];
+
+  std::vector<int> cursor(mGridStart.begin(), mGridStart.end() - 1);
+  for (int i = 0; i < count; i++)
+    mGridAgents[cursor[agentCell[i]]++] = i;
+}
+
+int CrowdScenario::_findTarget(int index, const CrowdScenarioConfig::ChaseRule& rule) const
+{
+  const float x = getPositionX(index);
+  const float z = getPositionZ(index);
+  const float origin = -mGridSize * mGridCellSize * 0.5f;
+
+  const int minX = std::max((int)((x - rule.radius - origin) / mGridCellSize), 0);
+  const int maxX = std::min((int)((x + rule.radius - origin) / mGridCellSize), mGridSize - 1);
+  const int minZ = std::max((int)((z - rule.radius - origin) / mGridCellSize), 0);
+  const int maxZ = std::min((int)((z + rule.radius - origin) / mGridCellSize), mGridSize - 1);
+
+  int best = -1;
+  float bestDistSq = rule.radius * rule.radius;
+
+  for (int cz = minZ; cz <= maxZ; cz++)
+  {
+    for (int cx = minX; cx <= maxX; cx++)
+    {
+      const int cell = cz * mGridSize + cx;
+      for (int k = mGridStart[cell]; k < mGridStart[cell + 1]; k++)
+      {
+        const int other = mGridAgents[k];
+        if (other == index || mAgents[other].kind != rule.target)
+          continue;
+
+        const float dx = getPositionX(other) - x;
+        const float dz = getPositionZ(other) - z;
+        const float distSq = dx * dx + dz * dz;
+        if (distSq < bestDistSq || (distSq == bestDistSq && other < best))
+        {
+          best = other;
+          bestDistSq = distSq;
+        }
+      }
+    }
+  }
+
+  return best;
+}
+
+uint64_t CrowdScenario::getChecksum(void) const
+{
+  uint64_t hash = 14695981039346656037ULL;
+
+  hashValue(hash, mTick);
+  for (int i = 0; i < getAgentCount(); i++)
+  {
+    hashValue(hash, getPositionX(i));
+    hashValue(hash, getPositionZ(i));
+    hashValue(hash, getVelocityX(i));
+    hashValue(hash, getVelocityZ(i));
+    hashValue(hash, mAgents[i].waypoint);
+    hashValue(hash, mAgents[i].chaseTarget);
+  }
+
+  return hash;
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "CrowdAvoidance.h"
+#include "AIScheduler.h"
+#include "RandomStream.h"
+
+// Reproducible crowd scene description, read from a plugins.cfg style
+// key=value file. Keys that may repeat (Waypoints, Chase) add one entry
+// per line.
+//
+//   Seed=1234
+//   Professors=500
+//   Ninjas=2000
+//   Ticks=1800
+//   Waypoints=professor 150,200 -150,200 0,-200 0,0
+//   Chase=ninja professor 100 1.5
+struct CrowdScenarioConfig
+{
+  enum AgentKind { PROFESSOR = 0, NINJA, KIND_COUNT };
+
+  struct WaypointSet
+  {
+    AgentKind kind;
+    std::vector<float> x, z;
+  };
+
+  struct ChaseRule
+  {
+    AgentKind chaser;
+    AgentKind target;
+    float radius;
+    float speedScale;
+  };
+
+  CrowdScenarioConfig();
+
+  // returns false and fills error when the file cannot be read or parsed
+  bool load(const std::string& fileName, std::string& error);
+  bool parse(const std::string& text, std::string& error);
+
+  static bool parseKind(const std::string& name, AgentKind& kind);
+  static const char* getKindName(AgentKind kind);
+
+  unsigned int seed;
+  int agentCount[KIND_COUNT];
+  float speed[KIND_COUNT];
+  float radius;
+  float areaSize;            // agents and random waypoints stay in [-areaSize/2, areaSize/2]
+  int randomWaypoints;       // per agent, used when no set is given for its kind
+  float waypointJitter;      // per agent offset applied to shared waypoint sets
+  float arriveDistance;
+  float thinkInterval;
+  int ticks;
+  float timeStep;
+
+  std::vector<WaypointSet> waypointSets;
+  std::vector<ChaseRule> chaseRules;
+};
+
+
+// Ogre independent crowd simulation driven by a CrowdScenarioConfig. The
+// same config and seed always give the same final state, which is what
+// getChecksum() reports.
+class CrowdScenario
+{
+public:
+  CrowdScenario();
+  ~CrowdScenario();
+
+  void setup(const CrowdScenarioConfig& config);
+
+  // one fixed step: AI decisions, avoidance and integration
+  void tick(void);
+  void run(int ticks);
+
+  int getAgentCount(void) const { return (int)mAgents.size(); }
+  int getTickCount(void) const { return mTick; }
+  CrowdScenarioConfig::AgentKind getKind(int agent) const { return mAgents[agent].kind; }
+  float getPositionX(int agent) const { return mAvoidance.getPositionX(agent); }
+  float getPositionZ(int agent) const { return mAvoidance.getPositionZ(agent); }
+  float getVelocityX(int agent) const { return mAvoidance.getVelocityX(agent); }
+  float getVelocityZ(int agent) const { return mAvoidance.getVelocityZ(agent); }
+  bool isChasing(int agent) const { return mAgents[agent].chaseTarget >= 0; }
+
+  const CrowdScenarioConfig& getConfig(void) const { return mConfig; }
+  const AIScheduler& getScheduler(void) const { return mScheduler; }
+
+  // FNV-1a over the bit patterns of the simulation state
+  uint64_t getChecksum(void) const;
+
+private:
+  class ScenarioAgent : public AIAgent
+  {
+  public:
+    void think(float) { owner->_think(index); }
+
+    CrowdScenario* owner;
+    int index;
+  };
+
+  struct Agent
+  {
+    CrowdScenarioConfig::AgentKind kind;
+    RandomStream random;
+    std::vector<float> waypointX, waypointZ;
+    int waypoint;
+    int chaseTarget;
+    float speedScale;
+  };
+
+  void _think(int agent);
+  int _findTarget(int agent, const CrowdScenarioConfig::ChaseRule& rule) const;
+  void _buildTargetGrid(void);
+
+  CrowdScenarioConfig mConfig;
+  CrowdAvoidance mAvoidance;
+  AIScheduler mScheduler;
+
+  std::vector<Agent> mAgents;
+  std::vector<ScenarioAgent> mThinkers;
+  int mTick;
+
+  // uniform grid over the agents, rebuilt every tick for the chase queries
+  float mGridCellSize;
+  int mGridSize;
+  std::vector<int> mGridStart;
+  std::vector<int> mGridAgents;
+};
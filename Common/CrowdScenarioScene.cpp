@@ -0,0 +1,92 @@
+#include "CrowdScenarioScene.h"
+
+using namespace Ogre;
+
+CrowdScenarioScene::CrowdScenarioScene(SceneManager* sceneMgr, CrowdScenario* scenario)
+  : mSceneMgr(sceneMgr), mScenario(scenario), mAccumulator(0.0f), mStopAtEnd(true)
+{
+}
+
+CrowdScenarioScene::~CrowdScenarioScene()
+{
+  destroy();
+}
+
+const char* CrowdScenarioScene::_getMeshName(CrowdScenarioConfig::AgentKind kind)
+{
+  return (kind == CrowdScenarioConfig::NINJA) ? "ninja.mesh" : "DustinBody.mesh";
+}
+
+void CrowdScenarioScene::create(void)
+{
+  destroy();
+
+  const int count = mScenario->getAgentCount();
+  mNodes.resize(count);
+  mAnimations.resize(count);
+
+  SceneNode* root = mSceneMgr->getRootSceneNode()->createChildSceneNode("CrowdRoot");
+
+  for (int i = 0; i < count; i++)
+  {
+    const String name = "CrowdAgent" + StringConverter::toString(i);
+    const CrowdScenarioConfig::AgentKind kind = mScenario->getKind(i);
+
+    Entity* entity = mSceneMgr->createEntity(name, _getMeshName(kind));
+    SceneNode* node = root->createChildSceneNode(name,
+      Vector3(mScenario->getPositionX(i), 0.0f, mScenario->getPositionZ(i)));
+    node->attachObject(entity);
+
+    mAnimations[i] = entity->getAnimationState("Walk");
+    mAnimations[i]->setLoop(true);
+    mAnimations[i]->setEnabled(true);
+    // stagger the walk cycles so the crowd does not march in step
+    mAnimations[i]->setTimePosition(mAnimations[i]->getLength() * (i % 16) / 16.0f);
+
+    mNodes[i] = node;
+  }
+}
+
+void CrowdScenarioScene::destroy(void)
+{
+  if (mNodes.empty())
+    return;
+
+  for (size_t i = 0; i < mNodes.size(); i++)
+  {
+    const String name = "CrowdAgent" + StringConverter::toString(i);
+    mSceneMgr->destroyEntity(name);
+    mSceneMgr->destroySceneNode(name);
+  }
+  mSceneMgr->destroySceneNode("CrowdRoot");
+
+  mNodes.clear();
+  mAnimations.clear();
+}
+
+void CrowdScenarioScene::update(float timeSinceLastFrame)
+{
+  const CrowdScenarioConfig& config = mScenario->getConfig();
+
+  mAccumulator += timeSinceLastFrame;
+  while (mAccumulator >= config.timeStep)
+  {
+    mAccumulator -= config.timeStep;
+    if (!mStopAtEnd || mScenario->getTickCount() < config.ticks)
+      mScenario->tick();
+  }
+
+  for (size_t i = 0; i < mNodes.size(); i++)
+  {
+    const Vector3 velocity(mScenario->getVelocityX(i), 0.0f, mScenario->getVelocityZ(i));
+
+    mNodes[i]->setPosition(mScenario->getPositionX(i), 0.0f, mScenario->getPositionZ(i));
+    if (velocity.squaredLength() > 1.0f)
+    {
+      // DustinBody faces +z, ninja.mesh faces -z
+      const Vector3 forward = (mScenario->getKind(i) == CrowdScenarioConfig::NINJA) ? -velocity : velocity;
+      mNodes[i]->setOrientation(Vector3::UNIT_Z.getRotationTo(forward.normalisedCopy(), Vector3::UNIT_Y));
+      mAnimations[i]->addTime(timeSinceLastFrame);
+    }
+  }
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <vector>
+#include <Ogre.h>
+
+#include "CrowdScenario.h"
+
+// Puts a CrowdScenario on screen: one DustinBody or ninja entity per agent,
+// nodes follow the simulation and face their velocity. The simulation runs
+// at its own fixed time step so the rendered run matches the headless one.
+class CrowdScenarioScene
+{
+public:
+  CrowdScenarioScene(Ogre::SceneManager* sceneMgr, CrowdScenario* scenario);
+  ~CrowdScenarioScene();
+
+  void create(void);
+  void destroy(void);
+
+  // advances the simulation by whole ticks and syncs the nodes
+  void update(float timeSinceLastFrame);
+
+  // stops ticking once the config's Ticks are done (keeps animating)
+  void setStopAtEnd(bool stop) { mStopAtEnd = stop; }
+
+private:
+  static const char* _getMeshName(CrowdScenarioConfig::AgentKind kind);
+
+  Ogre::SceneManager* mSceneMgr;
+  CrowdScenario* mScenario;
+
+  std::vector<Ogre::SceneNode*> mNodes;
+  std::vector<Ogre::AnimationState*> mAnimations;
+
+  float mAccumulator;
+  bool mStopAtEnd;
+};
@@ -0,0 +1,178 @@
+#include "DebugGeometry.h"
+
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <OgreFileSystemLayer.h>
+
+using namespace Ogre;
+
+namespace
+{
+  const char* GRID_MATERIAL = "GridPlaneMaterial";
+
+  // bump when the generated geometry changes so stale cache files are ignored
+  const int GRID_CACHE_VERSION = 1;
+
+  String cacheDirectory = "cache";
+
+  // nine significant digits give back the same float, so grids whose
+  // spacings differ only in the fraction get meshes of their own
+  String spacingKey(float spacing)
+  {
+    std::ostringstream key;
+    key.imbue(std::locale::classic());
+    key.precision(9);
+    key << spacing;
+    return key.str();
+  }
+
+  // reads cached grids again whenever Ogre reloads them, after a lost
+  // device or a resource group reload
+  class CacheLoader : public ManualResourceLoader
+  {
+  public:
+    void setFile(const String& meshName, const String& path) { mFiles[meshName] = path; }
+
+    void loadResource(Resource* resource)
+    {
+      const String& path = mFiles[resource->getName()];
+
+      std::ifstream* file = OGRE_NEW_T(std::ifstream, MEMCATEGORY_GENERAL)(path.c_str(), std::ios::in | std::ios::binary);
+      if (!file->is_open())
+      {
+        OGRE_DELETE_T(file, basic_ifstream, MEMCATEGORY_GENERAL);
+        OGRE_EXCEPT(Exception::ERR_FILE_NOT_FOUND, "Cannot open " + path, "DebugGeometry::CacheLoader::loadResource");
+      }
+
+      // the data stream owns the file stream
+      DataStreamPtr stream(OGRE_NEW FileStreamDataStream(path, file, true));
+      MeshSerializer().importMesh(stream, static_cast<Mesh*>(resource));
+    }
+
+  private:
+    std::map<String, String> mFiles;   // mesh name -> cache file
+  };
+
+  CacheLoader cacheLoader;
+}
+
+
+Entity* DebugGeometry::createGrid(SceneManager* sceneMgr, int lineCount, float spacing)
+{
+  MeshPtr mesh = getGridMesh(lineCount, spacing);
+
+  Entity* grid = sceneMgr->createEntity("GridPlane", mesh->getName());
+  grid->setCastShadows(false);
+  sceneMgr->getRootSceneNode()->createChildSceneNode("GridPlaneNode")->attachObject(grid);
+  return grid;
+}
+
+Entity* DebugGeometry::createAxes(SceneManager* sceneMgr, float scale)
+{
+  Entity* axes = sceneMgr->createEntity("Axes", "axes.mesh");
+  SceneNode* node = sceneMgr->getRootSceneNode()->createChildSceneNode("AxesNode", Vector3::ZERO);
+  node->attachObject(axes);
+  node->setScale(scale, scale, scale);
+  return axes;
+}
+
+MeshPtr DebugGeometry::getGridMesh(int lineCount, float spacing)
+{
+  const String name = "DebugGrid_" + StringConverter::toString(lineCount) + "x"
+    + spacingKey(spacing) + "_v" + StringConverter::toString(GRID_CACHE_VERSION) + ".mesh";
+
+  // already loaded by an earlier scene
+  MeshPtr mesh = MeshManager::getSingleton().getByName(name);
+  if (!mesh.isNull())
+    return mesh;
+
+  _createMaterial();
+
+  const String path = cacheDirectory + "/" + name;
+  mesh = _loadCachedMesh(name, path);
+  if (!mesh.isNull())
+    return mesh;
+
+  mesh = _buildGridMesh(name, lineCount, spacing);
+  _saveCachedMesh(mesh, path);
+  return mesh;
+}
+
+void DebugGeometry::setCacheDirectory(const String& directory)
+{
+  cacheDirectory = directory;
+}
+
+void DebugGeometry::_createMaterial(void)
+{
+  // the labs created "GridPlanMaterial" but drew with "GridPlaneMaterial",
+  // so the grid silently used the default material
+  MaterialPtr material = MaterialManager::getSingleton().getByName(GRID_MATERIAL);
+  if (!material.isNull())
+    return;
+
+  material = MaterialManager::getSingleton().create(GRID_MATERIAL, ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME);
+  material->setReceiveShadows(false);
+  material->getTechnique(0)->setLightingEnabled(true);
+  material->getTechnique(0)->getPass(0)->setDiffuse(1, 1, 1, 0);
+  material->getTechnique(0)->getPass(0)->setAmbient(1, 1, 1);
+  material->getTechnique(0)->getPass(0)->setSelfIllumination(1, 1, 1);
+}
+
+MeshPtr DebugGeometry::_buildGridMesh(const String& name, int lineCount, float spacing)
+{
+  const float half = (lineCount - 1) * spacing * 0.5f;
+
+  ManualObject grid(name);
+  grid.begin(GRID_MATERIAL, RenderOperation::OT_LINE_LIST);
+  for (int i = 0; i < lineCount; i++)
+  {
+    grid.position(-half, 0.0f, half - i * spacing);
+    grid.position(half, 0.0f, half - i * spacing);
+
+    grid.position(-half + i * spacing, 0.0f, half);
+    grid.position(-half + i * spacing, 0.0f, -half);
+  }
+  grid.end();
+
+  return grid.convertToMesh(name);
+}
+
+MeshPtr DebugGeometry::_loadCachedMesh(const String& name, const String& path)
+{
+  if (!std::ifstream(path.c_str(), std::ios::in | std::ios::binary))
+    return MeshPtr();
+
+  cacheLoader.setFile(name, path);
+  MeshPtr mesh = MeshManager::getSingleton().createManual(name, ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME, &cacheLoader);
+
+  try
+  {
+    mesh->load();
+  }
+  catch (Exception& e)
+  {
+    // unreadable cache, rebuild it
+    LogManager::getSingleton().logMessage("DebugGeometry: ignoring " + path + ": " + e.getDescription());
+    MeshManager::getSingleton().remove(name);
+    return MeshPtr();
+  }
+
+  return mesh;
+}
+
+void DebugGeometry::_saveCachedMesh(const MeshPtr& mesh, const String& path)
+{
+  try
+  {
+    FileSystemLayer::createDirectory(cacheDirectory);
+    MeshSerializer serializer;
+    serializer.exportMesh(mesh.getPointer(), path);
+  }
+  catch (Exception& e)
+  {
+    // the mesh is usable without the cache
+    LogManager::getSingleton().logMessage("DebugGeometry: cannot write " + path + ": " + e.getDescription());
+  }
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <Ogre.h>
+
+// Grid and axes shown by every lab. The grid used to be a ManualObject
+// rebuilt by each scene at startup; here it is turned into a mesh once,
+// written to the cache directory and loaded from there on later runs, so
+// scenes only create an entity.
+class DebugGeometry
+{
+public:
+  // entity "GridPlane" on node "GridPlaneNode": lineCount lines in each
+  // direction, spacing apart, centred on the origin
+  static Ogre::Entity* createGrid(Ogre::SceneManager* sceneMgr, int lineCount = 21, float spacing = 50.0f);
+
+  // entity "Axes" (axes.mesh) on node "AxesNode"
+  static Ogre::Entity* createAxes(Ogre::SceneManager* sceneMgr, float scale = 5.0f);
+
+  // builds, or loads from the cache, the grid mesh
+  static Ogre::MeshPtr getGridMesh(int lineCount, float spacing);
+
+  // where grid meshes are cached, relative to the working directory
+  static void setCacheDirectory(const Ogre::String& directory);
+
+private:
+  static void _createMaterial(void);
+  static Ogre::MeshPtr _buildGridMesh(const Ogre::String& name, int lineCount, float spacing);
+  static Ogre::MeshPtr _loadCachedMesh(const Ogre::String& name, const Ogre::String& path);
+  static void _saveCachedMesh(const Ogre::MeshPtr& mesh, const Ogre::String& path);
+};
@@ -0,0 +1,131 @@
+#include "FlatSceneTransforms.h"
+
+using namespace Ogre;
+
+FlatSceneTransforms::FlatSceneTransforms(SceneManager* sceneMgr)
+  : mSceneMgr(sceneMgr), mNodesSynced(0), mUpdateMs(0.0f)
+{
+  mSceneMgr->addListener(this);
+}
+
+FlatSceneTransforms::~FlatSceneTransforms()
+{
+  mSceneMgr->removeListener(this);
+}
+
+int FlatSceneTransforms::add(SceneNode* node, int parent)
+{
+  const int id = mHierarchy.add(parent, node->getInheritOrientation());
+  mNodes.push_back(node);
+
+  // a root keeps its place in the world
+  const Vector3 position = (parent < 0) ? node->_getDerivedPosition() : node->getPosition();
+  const Quaternion orientation = (parent < 0) ? node->_getDerivedOrientation() : node->getOrientation();
+  const Vector3 scale = (parent < 0) ? node->_getDerivedScale() : node->getScale();
+  setPosition(id, position);
+  setOrientation(id, orientation);
+  setScale(id, scale);
+
+  if (node->getParent() != mSceneMgr->getRootSceneNode())
+  {
+    if (node->getParent())
+      node->getParent()->removeChild(node);
+    mSceneMgr->getRootSceneNode()->addChild(node);
+  }
+  node->setInheritOrientation(true);
+  return id;
+}
+
+int FlatSceneTransforms::addTree(SceneNode* node, int parent)
+{
+  // children first collected, add() takes them away from node
+  std::vector<SceneNode*> children;
+  Node::ChildNodeIterator it = node->getChildIterator();
+  while (it.hasMoreElements())
+    children.push_back(static_cast<SceneNode*>(it.getNext()));
+
+  const int id = add(node, parent);
+  for (size_t i = 0; i < children.size(); i++)
+    addTree(children[i], id);
+  return id;
+}
+
+void FlatSceneTransforms::setPosition(int id, const Vector3& position)
+{
+  mHierarchy.setPosition(id, position.x, position.y, position.z);
+}
+
+Vector3 FlatSceneTransforms::getPosition(int id) const
+{
+  Vector3 position;
+  mHierarchy.getPosition(id, position.ptr());
+  return position;
+}
+
+void FlatSceneTransforms::translate(int id, const Vector3& delta)
+{
+  setPosition(id, getPosition(id) + delta);
+}
+
+void FlatSceneTransforms::setOrientation(int id, const Quaternion& orientation)
+{
+  mHierarchy.setOrientation(id, orientation.w, orientation.x, orientation.y, orientation.z);
+}
+
+Quaternion FlatSceneTransforms::getOrientation(int id) const
+{
+  Quaternion orientation;
+  mHierarchy.getOrientation(id, orientation.ptr());
+  return orientation;
+}
+
+void FlatSceneTransforms::setScale(int id, const Vector3& scale)
+{
+  mHierarchy.setScale(id, scale.x, scale.y, scale.z);
+}
+
+void FlatSceneTransforms::rotate(int id, const Quaternion& rotation)
+{
+  Quaternion orientation = getOrientation(id) * rotation;
+  orientation.normalise();
+  setOrientation(id, orientation);
+}
+
+Matrix4 FlatSceneTransforms::getWorld(int id) const
+{
+  float world[12];
+  mHierarchy.getWorld(id, world);
+  return Matrix4(world[0], world[1], world[2], world[3], world[4], world[5], world[6], world[7],
+    world[8], world[9], world[10], world[11], 0.0f, 0.0f, 0.0f, 1.0f);
+}
+
+void FlatSceneTransforms::logStats(void) const
+{
+  const TransformHierarchy::Stats& stats = mHierarchy.getStats();
+  LogManager::getSingleton().stream() << "FlatSceneTransforms: " << stats.nodes << " nodes in " << stats.levels
+    << " levels, " << stats.localsUpdated << " local and " << stats.worldsUpdated << " world transforms, "
+    << mNodesSynced << " nodes synced in " << mUpdateMs << " ms" << (mHierarchy.isSimd() ? " (SSE)" : "");
+}
+
+void FlatSceneTransforms::preUpdateSceneGraph(SceneManager* source, Camera* camera)
+{
+  Timer timer;
+  mHierarchy.update();
+
+  // the nodes hang off the root node, their local transform is the world one
+  mNodesSynced = 0;
+  for (int id = 0; id < mHierarchy.size(); id++)
+  {
+    if (!mHierarchy.isWorldChanged(id))
+      continue;
+
+    Vector3 position, scale;
+    Quaternion orientation;
+    getWorld(id).decomposition(position, scale, orientation);
+    mNodes[id]->setPosition(position);
+    mNodes[id]->setOrientation(orientation);
+    mNodes[id]->setScale(scale);
+    mNodesSynced++;
+  }
+  mUpdateMs = timer.getMicroseconds() / 1000.0f;
+}
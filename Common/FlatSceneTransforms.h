@@ -0,0 +1,61 @@
+#pragma once
+
+#include <Ogre.h>
+
+#include <vector>
+
+#include "TransformHierarchy.h"
+
+// Moves a scene node hierarchy into a TransformHierarchy. add() records a
+// node's local transform and hangs the node directly under the root scene
+// node; before every scene graph update the changed world matrices are
+// written back into those nodes, so Ogre only updates one level of them
+// and no longer walks the original parent chains.
+//
+// Once added, a node has to be moved through this class, the transforms
+// set on the scene node itself are overwritten. Its attached objects and
+// children that were not added keep working, they follow the node.
+class FlatSceneTransforms : public Ogre::SceneManager::Listener
+{
+public:
+  FlatSceneTransforms(Ogre::SceneManager* sceneMgr);
+  ~FlatSceneTransforms();
+
+  // parent is the id of an added node, -1 for the node's own parent
+  // position (which then must not move)
+  int add(Ogre::SceneNode* node, int parent = -1);
+  // node and every node below it, returns the id of node
+  int addTree(Ogre::SceneNode* node, int parent = -1);
+
+  Ogre::SceneNode* getNode(int id) const { return mNodes[id]; }
+
+  // parent space, like the Ogre::Node functions of the same names
+  void setPosition(int id, const Ogre::Vector3& position);
+  Ogre::Vector3 getPosition(int id) const;
+  void translate(int id, const Ogre::Vector3& delta);
+  void setOrientation(int id, const Ogre::Quaternion& orientation);
+  Ogre::Quaternion getOrientation(int id) const;
+  void setScale(int id, const Ogre::Vector3& scale);
+  // local space
+  void rotate(int id, const Ogre::Quaternion& rotation);
+  void yaw(int id, const Ogre::Radian& angle) { rotate(id, Ogre::Quaternion(angle, Ogre::Vector3::UNIT_Y)); }
+  void pitch(int id, const Ogre::Radian& angle) { rotate(id, Ogre::Quaternion(angle, Ogre::Vector3::UNIT_X)); }
+  void roll(int id, const Ogre::Radian& angle) { rotate(id, Ogre::Quaternion(angle, Ogre::Vector3::UNIT_Z)); }
+
+  // world transform as of the last update
+  Ogre::Matrix4 getWorld(int id) const;
+
+  const TransformHierarchy& getHierarchy(void) const { return mHierarchy; }
+  void setSimd(bool simd) { mHierarchy.setSimd(simd); }
+  void logStats(void) const;
+
+  // SceneManager::Listener
+  void preUpdateSceneGraph(Ogre::SceneManager* source, Ogre::Camera* camera);
+
+private:
+  Ogre::SceneManager* mSceneMgr;
+  TransformHierarchy mHierarchy;
+  std::vector<Ogre::SceneNode*> mNodes;   // by id
+  int mNodesSynced;
+  float mUpdateMs;
+};
@@ -0,0 +1,107 @@
+#include "FrameCapture.h"
+
+using namespace Ogre;
+
+FrameCapture::Settings::Settings()
+  : format(FrameEncoder::FORMAT_PNG), path("capture_"), width(640), height(480), latency(3), maxQueued(8),
+  minAsyncPixels(FrameEncoder::MIN_ASYNC_PIXELS)
+{
+}
+
+
+FrameCapture::FrameCapture(Camera* camera, const Settings& settings)
+  : mCamera(camera), mSettings(settings), mEncoder(settings.format, settings.path, settings.maxQueued,
+  settings.minAsyncPixels), mEnabled(true), mFrame(0)
+{
+  memset(&mStats, 0, sizeof(mStats));
+  mSettings.latency = std::max(mSettings.latency, 2);
+
+  const ColourValue background = mCamera->getViewport() ? mCamera->getViewport()->getBackgroundColour()
+    : ColourValue::Black;
+
+  mRing.resize(mSettings.latency);
+  for (size_t i = 0; i < mRing.size(); i++)
+  {
+    Slot& slot = mRing[i];
+    slot.frame = -1;
+    slot.texture = TextureManager::getSingleton().createManual(
+      "FrameCapture/" + mCamera->getName() + "/" + StringConverter::toString(i),
+      ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME, TEX_TYPE_2D, mSettings.width, mSettings.height, 0,
+      PF_R8G8B8, TU_RENDERTARGET);
+
+    RenderTarget* target = slot.texture->getBuffer()->getRenderTarget();
+    target->setAutoUpdated(false);
+    target->addViewport(mCamera)->setBackgroundColour(background);
+  }
+
+  LogManager::getSingleton().stream() << "FrameCapture: " << mCamera->getName() << " at " << mSettings.width << "x"
+    << mSettings.height << " to " << mSettings.path << (mSettings.format == FrameEncoder::FORMAT_RAW ? ".rgb" : "*.png")
+    << ", " << mSettings.latency - 1 << " frames late, written on "
+    << (mEncoder.isAsync(mSettings.width, mSettings.height) ? "the encoder thread" : "the render thread");
+
+  Root::getSingleton().addFrameListener(this);
+}
+
+FrameCapture::~FrameCapture()
+{
+  Root::getSingleton().removeFrameListener(this);
+
+  // the frames still in the ring, oldest first
+  for (int i = 1; i < mSettings.latency; i++)
+    _read(mRing[(mFrame + i) % mSettings.latency]);
+  mEncoder.flush();
+  logStats();
+
+  for (size_t i = 0; i < mRing.size(); i++)
+  {
+    mRing[i].texture->getBuffer()->getRenderTarget()->removeAllViewports();
+    TextureManager::getSingleton().remove(mRing[i].texture->getHandle());
+  }
+}
+
+void FrameCapture::logStats(void) const
+{
+  const FrameEncoder::Stats encoder = mEncoder.getStats();
+  LogManager::getSingleton().stream() << "FrameCapture: " << mStats.framesRendered << " frames rendered, "
+    << mStats.framesRead << " read back, " << (mStats.framesRendered ? mStats.totalMs / mStats.framesRendered : 0.0f)
+    << " ms per frame on the render thread; encoder wrote " << encoder.framesWritten << " frames ("
+    << encoder.bytesWritten / (1024 * 1024) << " MB) in " << encoder.encodeMs << " ms, dropped " << encoder.framesDropped;
+}
+
+bool FrameCapture::frameRenderingQueued(const FrameEvent& evt)
+{
+  if (!mEnabled)
+    return true;
+
+  Timer timer;
+  Slot& slot = mRing[mFrame % mSettings.latency];
+  slot.texture->getBuffer()->getRenderTarget()->update();
+  slot.frame = mFrame;
+  mStats.renderMs = timer.getMicroseconds() / 1000.0f;
+  mStats.framesRendered++;
+
+  // rendered latency - 1 frames ago
+  timer.reset();
+  _read(mRing[(mFrame + 1) % mSettings.latency]);
+  mStats.readMs = timer.getMicroseconds() / 1000.0f;
+
+  mStats.totalMs += mStats.renderMs + mStats.readMs;
+  mFrame++;
+  return true;
+}
+
+void FrameCapture::_read(Slot& slot)
+{
+  if (slot.frame < 0)
+    return;
+
+  mEncoder.acquire(mPixels, mSettings.width, mSettings.height);
+  mPixels.number = slot.frame;
+
+  const PixelBox box(mSettings.width, mSettings.height, 1, PF_BYTE_RGB, &mPixels.rgb[0]);
+  slot.texture->getBuffer()->blitToMemory(box);
+  mEncoder.push(mPixels);
+
+  slot.frame = -1;
+  mStats.framesRead++;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <Ogre.h>
+
+#include <vector>
+
+#include "FrameEncoder.h"
+
+// Records what a camera sees without stalling the render loop. Every frame
+// the camera is rendered into the next of a ring of offscreen render
+// textures, and the texture rendered latency - 1 frames earlier is read
+// back and handed to a FrameEncoder thread. By then the GPU has long
+// finished that texture, so the read back does not wait for the frame in
+// flight.
+//
+// The textures use the camera as it is, so keep their aspect ratio that of
+// the camera's viewport.
+class FrameCapture : public Ogre::FrameListener
+{
+public:
+  struct Settings
+  {
+    FrameEncoder::Format format;
+    Ogre::String path;   // file name prefix
+    int width, height;
+    int latency;         // textures in the ring, 2 or more
+    int maxQueued;       // frames waiting for the encoder
+    int minAsyncPixels;  // smaller frames are written on the render thread
+
+    Settings();
+  };
+
+  struct Stats
+  {
+    int framesRendered;
+    int framesRead;
+    float renderMs;      // offscreen render, last frame
+    float readMs;        // read back and queueing, last frame
+    float totalMs;       // both, all frames
+  };
+
+  FrameCapture(Ogre::Camera* camera, const Settings& settings = Settings());
+  // waits for the encoder to write the frames it has
+  ~FrameCapture();
+
+  void setEnabled(bool enabled) { mEnabled = enabled; }
+  bool isEnabled(void) const { return mEnabled; }
+
+  const Stats& getStats(void) const { return mStats; }
+  FrameEncoder::Stats getEncoderStats(void) const { return mEncoder.getStats(); }
+  void logStats(void) const;
+
+  // FrameListener, runs after the frame's own targets are queued
+  bool frameRenderingQueued(const Ogre::FrameEvent& evt);
+
+private:
+  struct Slot
+  {
+    Ogre::TexturePtr texture;
+    int frame;   // -1 while empty
+  };
+
+  void _read(Slot& slot);
+
+  Ogre::Camera* mCamera;
+  Settings mSettings;
+  FrameEncoder mEncoder;
+  bool mEnabled;
+
+  std::vector<Slot> mRing;
+  int mFrame;
+  FrameEncoder::Frame mPixels;
+
+  Stats mStats;
+};
@@ -0,0 +1,274 @@
+#include "FrameEncoder.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+  uint32_t crcTable[256];
+
+  void buildCrcTable(void)
+  {
+    for (uint32_t n = 0; n < 256; n++)
+    {
+      uint32_t c = n;
+      for (int k = 0; k < 8; k++)
+        c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+      crcTable[n] = c;
+    }
+  }
+
+  uint32_t crc32(uint32_t crc, const uint8_t* data, size_t size)
+  {
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++)
+      crc = crcTable[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    return ~crc;
+  }
+
+  void putUint32(std::vector<uint8_t>& out, uint32_t value)
+  {
+    out.push_back((uint8_t)(value >> 24));
+    out.push_back((uint8_t)(value >> 16));
+    out.push_back((uint8_t)(value >> 8));
+    out.push_back((uint8_t)value);
+  }
+
+  void writeChunk(FILE* file, const char* type, const std::vector<uint8_t>& data)
+  {
+    std::vector<uint8_t> chunk;
+    putUint32(chunk, (uint32_t)data.size());
+    chunk.insert(chunk.end(), type, type + 4);
+    chunk.insert(chunk.end(), data.begin(), data.end());
+    putUint32(chunk, crc32(0, &chunk[4], chunk.size() - 4));
+    fwrite(&chunk[0], 1, chunk.size(), file);
+  }
+}
+
+
+const int FrameEncoder::MIN_ASYNC_PIXELS = 64 * 48;
+
+
+FrameEncoder::FrameEncoder(Format format, const std::string& path, int maxQueued, int minAsyncPixels)
+  : mFormat(format), mPath(path), mMaxQueued(maxQueued > 0 ? maxQueued : 1), mMinAsyncPixels(minAsyncPixels),
+  mBusy(false), mStopping(false)
+{
+  memset(&mStats, 0, sizeof(mStats));
+
+  if (mFormat == FORMAT_RAW)
+    mRaw.open((mPath + ".rgb").c_str(), std::ios::binary);
+
+  mThread = std::thread(&FrameEncoder::_run, this);
+}
+
+FrameEncoder::~FrameEncoder()
+{
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mStopping = true;
+  }
+  mWake.notify_one();
+  mThread.join();
+}
+
+void FrameEncoder::acquire(Frame& frame, int width, int height)
+{
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (!mFree.empty())
+    {
+      frame.rgb.swap(mFree.back());
+      mFree.pop_back();
+    }
+  }
+
+  frame.width = width;
+  frame.height = height;
+  frame.rgb.resize((size_t)width * height * 3);
+}
+
+bool FrameEncoder::push(Frame& frame)
+{
+  if (!isAsync(frame.width, frame.height))
+    return _writeNow(frame);
+
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mQueue.size() >= mMaxQueued)
+    {
+      mStats.framesDropped++;
+      return false;
+    }
+
+    mQueue.push_back(Frame());
+    Frame& queued = mQueue.back();
+    queued.number = frame.number;
+    queued.width = frame.width;
+    queued.height = frame.height;
+    queued.rgb.swap(frame.rgb);
+    mStats.framesQueued++;
+  }
+  mWake.notify_one();
+  return true;
+}
+
+void FrameEncoder::flush(void)
+{
+  std::unique_lock<std::mutex> lock(mMutex);
+  mIdle.wait(lock, [this] { return mQueue.empty() && !mBusy; });
+
+  if (mRaw.is_open())
+    mRaw.flush();
+}
+
+FrameEncoder::Stats FrameEncoder::getStats(void) const
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  return mStats;
+}
+
+bool FrameEncoder::writePng(const std::string& fileName, int width, int height, const uint8_t* rgb)
+{
+  static std::once_flag tableBuilt;
+  std::call_once(tableBuilt, buildCrcTable);
+
+  FILE* file = fopen(fileName.c_str(), "wb");
+  if (!file)
+    return false;
+
+  static const uint8_t signature[8] = { 137, 'P', 'N', 'G', '\r', '\n', 26, '\n' };
+  fwrite(signature, 1, sizeof(signature), file);
+
+  std::vector<uint8_t> header;
+  putUint32(header, (uint32_t)width);
+  putUint32(header, (uint32_t)height);
+  const uint8_t format[5] = { 8, 2, 0, 0, 0 };   // 8 bit RGB, deflate, adaptive filters, no interlace
+  header.insert(header.end(), format, format + 5);
+  writeChunk(file, "IHDR", header);
+
+  // zlib stream of stored deflate blocks, every row starts with filter 0
+  const size_t rowSize = (size_t)width * 3 + 1;
+  std::vector<uint8_t> raw(rowSize * height);
+  for (int y = 0; y < height; y++)
+  {
+    raw[y * rowSize] = 0;
+    memcpy(&raw[y * rowSize + 1], rgb + (size_t)y * width * 3, rowSize - 1);
+  }
+
+  std::vector<uint8_t> data;
+  data.reserve(raw.size() + raw.size() / 65535 * 5 + 16);
+  data.push_back(0x78);
+  data.push_back(0x01);
+  for (size_t offset = 0; offset < raw.size(); offset += 65535)
+  {
+    const size_t block = std::min<size_t>(raw.size() - offset, 65535);
+    data.push_back(offset + block == raw.size() ? 1 : 0);
+    data.push_back((uint8_t)block);
+    data.push_back((uint8_t)(block >> 8));
+    data.push_back((uint8_t)~block);
+    data.push_back((uint8_t)(~block >> 8));
+    data.insert(data.end(), raw.begin() + offset, raw.begin() + offset + block);
+  }
+
+  // 5552 bytes is the most that can be summed before the modulo overflows
+  uint32_t adlerA = 1, adlerB = 0;
+  for (size_t offset = 0; offset < raw.size(); offset += 5552)
+  {
+    const size_t end = std::min<size_t>(raw.size(), offset + 5552);
+    for (size_t i = offset; i < end; i++)
+    {
+      adlerA += raw[i];
+      adlerB += adlerA;
+    }
+    adlerA %= 65521;
+    adlerB %= 65521;
+  }
+  putUint32(data, (adlerB << 16) | adlerA);
+  writeChunk(file, "IDAT", data);
+  writeChunk(file, "IEND", std::vector<uint8_t>());
+
+  const bool written = ferror(file) == 0;
+  fclose(file);
+  return written;
+}
+
+void FrameEncoder::_run(void)
+{
+  std::unique_lock<std::mutex> lock(mMutex);
+  for (;;)
+  {
+    mWake.wait(lock, [this] { return mStopping || !mQueue.empty(); });
+    if (mQueue.empty())
+      break;
+
+    Frame frame;
+    frame.number = mQueue.front().number;
+    frame.width = mQueue.front().width;
+    frame.height = mQueue.front().height;
+    frame.rgb.swap(mQueue.front().rgb);
+    mQueue.pop_front();
+    mBusy = true;
+    lock.unlock();
+
+    const std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+    const bool written = _write(frame);
+    const double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+    lock.lock();
+    mBusy = false;
+    mStats.encodeMs += ms;
+    if (written)
+    {
+      mStats.framesWritten++;
+      mStats.bytesWritten += (long long)frame.rgb.size();
+    }
+    mFree.push_back(std::vector<uint8_t>());
+    mFree.back().swap(frame.rgb);
+
+    if (mQueue.empty())
+      mIdle.notify_all();
+  }
+}
+
+bool FrameEncoder::_writeNow(Frame& frame)
+{
+  {
+    // frames queued earlier go first, the raw stream keeps their order
+    std::unique_lock<std::mutex> lock(mMutex);
+    mIdle.wait(lock, [this] { return mQueue.empty() && !mBusy; });
+    mStats.framesQueued++;
+  }
+
+  // the thread is idle and only the caller queues frames
+  const std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+  const bool written = _write(frame);
+  const double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+  std::lock_guard<std::mutex> lock(mMutex);
+  mStats.encodeMs += ms;
+  if (written)
+  {
+    mStats.framesWritten++;
+    mStats.bytesWritten += (long long)frame.rgb.size();
+  }
+  mFree.push_back(std::vector<uint8_t>());
+  mFree.back().swap(frame.rgb);
+  return written;
+}
+
+bool FrameEncoder::_write(const Frame& frame)
+{
+  if (mFormat == FORMAT_RAW)
+  {
+    if (!mRaw.is_open())
+      return false;
+    mRaw.write(reinterpret_cast<const char*>(&frame.rgb[0]), frame.rgb.size());
+    return !mRaw.fail();
+  }
+
+  char number[16];
+  snprintf(number, sizeof(number), "%06d", frame.number);
+  return writePng(mPath + number + ".png", frame.width, frame.height, &frame.rgb[0]);
+}
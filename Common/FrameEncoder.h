@@ -0,0 +1,94 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Writes captured frames on a background thread, so the render loop only
+// pays for copying the pixels. Frames are 24 bit RGB, top row first.
+//
+//   FORMAT_PNG  one <path>NNNNNN.png per frame (stored, not compressed:
+//               the thread keeps up with the frame rate and the files
+//               diff byte for byte in screenshot tests)
+//   FORMAT_RAW  every frame appended to <path>.rgb, for example
+//               ffmpeg -f rawvideo -pix_fmt rgb24 -s WxH -r 60 -i <path>.rgb out.mp4
+//
+// Pixel buffers are recycled: acquire() hands out a buffer of the right
+// size, push() queues it and the thread gives it back once written. When
+// maxQueued frames are waiting the new frame is dropped instead of
+// blocking the caller.
+//
+// Frames smaller than minAsyncPixels are written by push() itself. Waking
+// the thread has a cost of its own, and for thumbnail sized frames it has
+// been measured above that of writing them; "Benchmark capture" compares
+// both on a machine.
+class FrameEncoder
+{
+public:
+  enum Format
+  {
+    FORMAT_PNG,
+    FORMAT_RAW
+  };
+
+  struct Frame
+  {
+    int number;
+    int width, height;
+    std::vector<uint8_t> rgb;
+  };
+
+  struct Stats
+  {
+    int framesQueued;
+    int framesWritten;
+    int framesDropped;
+    double encodeMs;   // writing, all frames
+    long long bytesWritten;
+  };
+
+  static const int MIN_ASYNC_PIXELS;
+
+  FrameEncoder(Format format, const std::string& path, int maxQueued = 8, int minAsyncPixels = MIN_ASYNC_PIXELS);
+  // writes what is still queued
+  ~FrameEncoder();
+
+  void acquire(Frame& frame, int width, int height);
+  // takes the frame's pixels; false if it was dropped or not written
+  bool push(Frame& frame);
+  // blocks until the queue is empty
+  void flush(void);
+
+  Stats getStats(void) const;
+  Format getFormat(void) const { return mFormat; }
+  bool isAsync(int width, int height) const { return width * height >= mMinAsyncPixels; }
+
+  static bool writePng(const std::string& fileName, int width, int height, const uint8_t* rgb);
+
+private:
+  void _run(void);
+  bool _writeNow(Frame& frame);
+  bool _write(const Frame& frame);
+
+  Format mFormat;
+  std::string mPath;
+  size_t mMaxQueued;
+  int mMinAsyncPixels;
+  std::ofstream mRaw;
+
+  mutable std::mutex mMutex;
+  std::condition_variable mWake;   // frames queued or stopping
+  std::condition_variable mIdle;   // queue drained
+  std::deque<Frame> mQueue;
+  std::vector<std::vector<uint8_t> > mFree;
+  bool mBusy;
+  bool mStopping;
+  Stats mStats;
+
+  std::thread mThread;
+};
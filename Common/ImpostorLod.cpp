@@ -0,0 +1,275 @@
+#include "ImpostorLod.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <functional>
+
+namespace
+{
+  typedef std::chrono::high_resolution_clock Clock;
+
+  const float PI = 3.14159265f;
+
+  // ImpostorLod::mImpostor
+  enum { MESH, IMPOSTOR, UNDECIDED };
+
+  double millisecondsSince(const Clock::time_point& start)
+  {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+  }
+}
+
+
+ImpostorLod::Settings::Settings()
+  : angles(8), elevations(3), frames(8), maxElevation(PI / 3.0f), radius(100.0f), centreHeight(90.0f),
+    switchPixels(60.0f), hysteresis(0.2f), fadeTime(0.5f)
+{
+}
+
+
+ImpostorLod::ImpostorLod(const Settings& settings)
+  : mSettings(settings), mEnabled(true)
+{
+  mSettings.angles = std::max(mSettings.angles, 1);
+  mSettings.elevations = std::max(mSettings.elevations, 1);
+  mSettings.frames = std::max(mSettings.frames, 1);
+  mColumns = (int)std::ceil(std::sqrt((float)getCellCount()));
+  mRows = (getCellCount() + mColumns - 1) / mColumns;
+  mCellWidth = 1.0f / mColumns;
+  mCellHeight = 1.0f / mRows;
+  mEye[0] = mEye[1] = mEye[2] = 0.0f;
+  memset(&mStats, 0, sizeof(mStats));
+}
+
+int ImpostorLod::add(float x, float y, float z, float yaw, float phase)
+{
+  mX.push_back(x);
+  mY.push_back(y);
+  mZ.push_back(z);
+  mYawCos.push_back(std::cos(yaw));
+  mYawSin.push_back(std::sin(yaw));
+  mPhase.push_back(phase - std::floor(phase));
+  mFade.push_back(0.0f);
+  mImpostor.push_back(UNDECIDED);
+  mListed.push_back(0);
+  mDistance.push_back(0.0f);
+  return size() - 1;
+}
+
+void ImpostorLod::setTransform(int id, float x, float y, float z, float yaw)
+{
+  mX[id] = x;
+  mY[id] = y;
+  mZ[id] = z;
+  mYawCos[id] = std::cos(yaw);
+  mYawSin[id] = std::sin(yaw);
+}
+
+void ImpostorLod::clear(void)
+{
+  mX.clear();
+  mY.clear();
+  mZ.clear();
+  mYawCos.clear();
+  mYawSin.clear();
+  mPhase.clear();
+  mFade.clear();
+  mImpostor.clear();
+  mDistance.clear();
+  mListed.clear();
+  mChanged.clear();
+  mOrder.clear();
+}
+
+void ImpostorLod::setEnabled(bool enabled)
+{
+  mEnabled = enabled;
+}
+
+void ImpostorLod::update(const float* eye, float pixelScale, float dt)
+{
+  const Clock::time_point start = Clock::now();
+  for (int k = 0; k < 3; k++)
+    mEye[k] = eye[k];
+
+  // the sphere's diameter in pixels is diameter * pixelScale / distance,
+  // compared as distances so the loop has no division
+  const float diameter = 2.0f * mSettings.radius * pixelScale;
+  const float switchDistance = diameter / std::max(mSettings.switchPixels, 1.0f);
+  const float returnDistance = diameter / std::max(mSettings.switchPixels * (1.0f + mSettings.hysteresis), 1.0f);
+  const float step = mSettings.fadeTime > 0.0f ? dt / mSettings.fadeTime : 1.0f;
+
+  mChanged.clear();
+  int meshes = 0, impostors = 0, fading = 0;
+  for (int i = 0; i < size(); i++)
+  {
+    const float dx = mX[i] - eye[0], dy = mY[i] + mSettings.centreHeight - eye[1], dz = mZ[i] - eye[2];
+    const float distance = std::sqrt(dx * dx + dy * dy + dz * dz);
+    mDistance[i] = distance;
+
+    const bool wanted = mEnabled && distance > (mImpostor[i] == IMPOSTOR ? returnDistance : switchDistance);
+    const bool undecided = mImpostor[i] == UNDECIDED;
+    mImpostor[i] = wanted ? IMPOSTOR : MESH;
+
+    // new instances start as what they should be, without a fade
+    const bool meshVisible = mFade[i] < 1.0f;
+    if (!mEnabled || undecided)
+      mFade[i] = wanted ? 1.0f : 0.0f;
+    else
+      mFade[i] = std::min(std::max(mFade[i] + (wanted ? step : -step), 0.0f), 1.0f);
+    if ((mFade[i] < 1.0f) != meshVisible)
+      mChanged.push_back(i);
+
+    if (mFade[i] < 1.0f)
+      meshes++;
+    if (mFade[i] > 0.0f)
+      impostors++;
+    if (mFade[i] > 0.0f && mFade[i] < 1.0f)
+      fading++;
+  }
+
+  mStats.meshes = meshes;
+  mStats.impostors = impostors;
+  mStats.fading = fading;
+  mStats.switched = (int)mChanged.size();
+  mStats.selectMs = millisecondsSince(start);
+}
+
+int ImpostorLod::buildBillboards(const float* right, const float* up, float cycle, Vertex* vertices, int maxQuads)
+{
+  const Clock::time_point start = Clock::now();
+
+  _sortBillboards();
+
+  const float radius = mSettings.radius;
+  const int count = std::min((int)mOrder.size(), maxQuads);
+  for (int n = 0; n < count; n++)
+  {
+    const int i = mOrder[n].second;
+    const float distance = std::max(mDistance[i], 2.0f * radius);
+
+    int elevation;
+    const int angle = _selectView(i, elevation);
+    float loop = cycle + mPhase[i];
+    loop -= std::floor(loop);
+    const int frame = std::min((int)(loop * mSettings.frames), mSettings.frames - 1);
+    float rect[4];
+    getCellRect(getCell(angle, elevation, frame), rect);
+
+    // moved a radius towards the eye so the instance's own mesh does not
+    // cut it while they fade, and shrunk so it still covers the same pixels
+    const float push = radius / distance;
+    const float half = radius * (1.0f - push);
+    const float centre[3] = { mX[i] + (mEye[0] - mX[i]) * push,
+      mY[i] + mSettings.centreHeight + (mEye[1] - mY[i] - mSettings.centreHeight) * push,
+      mZ[i] + (mEye[2] - mZ[i]) * push };
+
+    const uint32_t colour = 0x00ffffff | (uint32_t)(mFade[i] * 255.0f + 0.5f) << 24;
+    const float corner[4][2] = { { -1.0f, -1.0f }, { 1.0f, -1.0f }, { 1.0f, 1.0f }, { -1.0f, 1.0f } };
+    const float uv[4][2] = { { rect[0], rect[3] }, { rect[2], rect[3] }, { rect[2], rect[1] }, { rect[0], rect[1] } };
+
+    Vertex* quad = vertices + n * 4;
+    for (int c = 0; c < 4; c++)
+    {
+      for (int k = 0; k < 3; k++)
+        quad[c].position[k] = centre[k] + (right[k] * corner[c][0] + up[k] * corner[c][1]) * half;
+      quad[c].colour = colour;
+      quad[c].uv[0] = uv[c][0];
+      quad[c].uv[1] = uv[c][1];
+    }
+  }
+
+  mStats.buildMs = millisecondsSince(start);
+  return count;
+}
+
+void ImpostorLod::_sortBillboards(void)
+{
+  // blended without depth writes, so the farthest go first. Last frame's
+  // order is nearly right, keep it with the new distances and append the
+  // billboards that appeared since.
+  size_t kept = 0;
+  for (size_t n = 0; n < mOrder.size(); n++)
+  {
+    const int i = mOrder[n].second;
+    if (mFade[i] > 0.0f)
+      mOrder[kept++] = std::make_pair(mDistance[i], i);
+    else
+      mListed[i] = 0;
+  }
+  mOrder.resize(kept);
+  for (int i = 0; i < size(); i++)
+  {
+    if (mFade[i] > 0.0f && !mListed[i])
+    {
+      mOrder.push_back(std::make_pair(mDistance[i], i));
+      mListed[i] = 1;
+    }
+  }
+
+  // insertion sort runs in about linear time on it; a jump of the camera
+  // scrambles the order, past a budget of moves it is sorted from scratch
+  const std::greater<std::pair<float, int> > farther;
+  size_t budget = mOrder.size() * 8;
+  for (size_t n = 1; n < mOrder.size(); n++)
+  {
+    const std::pair<float, int> entry = mOrder[n];
+    size_t m = n;
+    for (; m > 0 && farther(entry, mOrder[m - 1]) && budget > 0; m--, budget--)
+      mOrder[m] = mOrder[m - 1];
+    mOrder[m] = entry;
+    if (budget == 0)
+    {
+      std::sort(mOrder.begin(), mOrder.end(), farther);
+      break;
+    }
+  }
+}
+
+int ImpostorLod::getCell(int angle, int elevation, int frame) const
+{
+  return (frame * mSettings.elevations + elevation) * mSettings.angles + angle;
+}
+
+void ImpostorLod::getCellRect(int cell, float* rect) const
+{
+  const int column = cell % mColumns, row = cell / mColumns;
+  rect[0] = column * mCellWidth;
+  rect[1] = row * mCellHeight;
+  rect[2] = (column + 1) * mCellWidth;
+  rect[3] = (row + 1) * mCellHeight;
+}
+
+void ImpostorLod::getViewDirection(int angle, int elevation, float* direction) const
+{
+  const float azimuth = angle * 2.0f * PI / mSettings.angles;
+  const float height = mSettings.elevations > 1 ? elevation * mSettings.maxElevation / (mSettings.elevations - 1) : 0.0f;
+  direction[0] = std::sin(azimuth) * std::cos(height);
+  direction[1] = std::sin(height);
+  direction[2] = std::cos(azimuth) * std::cos(height);
+}
+
+int ImpostorLod::_selectView(int id, int& elevation) const
+{
+  const float dx = mEye[0] - mX[id], dy = mEye[1] - mY[id] - mSettings.centreHeight, dz = mEye[2] - mZ[id];
+
+  // into the character's space, turned back by its yaw about Y
+  const float c = mYawCos[id], s = mYawSin[id];
+  const float x = dx * c - dz * s, z = dx * s + dz * c;
+
+  const int angles = mSettings.angles;
+  int angle = (int)std::floor(std::atan2(x, z) * angles / (2.0f * PI) + 0.5f) % angles;
+  if (angle < 0)
+    angle += angles;
+
+  elevation = 0;
+  if (mSettings.elevations > 1)
+  {
+    const float height = std::atan2(dy, std::sqrt(x * x + z * z));
+    elevation = (int)std::floor(height / mSettings.maxElevation * (mSettings.elevations - 1) + 0.5f);
+    elevation = std::min(std::max(elevation, 0), mSettings.elevations - 1);
+  }
+  return angle;
+}
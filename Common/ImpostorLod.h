@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Chooses between the full mesh and a pre-rendered billboard for many
+// copies of one animated character. Each instance is measured by the
+// screen height of its bounding sphere; below switchPixels it turns into
+// an impostor, and it turns back once it has grown hysteresis above that.
+//
+// The switch is a cross-fade in one direction only, so the mesh material
+// never has to become transparent: going away, the billboard fades in over
+// the mesh and the mesh is hidden when it is opaque; coming closer, the
+// mesh is shown at once and the billboard fades out in front of it.
+//
+// The atlas holds angles x elevations x frames cells. A view is the
+// direction from the character to the camera in the character's own space,
+// azimuth 0 along its +Z and elevation from the horizon up to maxElevation:
+//
+//   cell = (frame * elevations + elevation) * angles + angle
+//
+// cells fill the atlas row by row, getColumns() x getRows() of them.
+//
+// buildBillboards() writes camera facing quads back to front in the
+// ParticlePool vertex layout (position, colour, uv; 24 bytes), counter
+// clockwise from the bottom left. The colour is white, its alpha the fade,
+// so it reads the same as ARGB and ABGR.
+class ImpostorLod
+{
+public:
+  struct Settings
+  {
+    int angles;
+    int elevations;
+    int frames;            // animation frames over one loop
+    float maxElevation;    // radians
+    float radius;          // bounding sphere of the character
+    float centreHeight;    // of the sphere above the character's origin
+    float switchPixels;    // screen height below which an instance becomes an impostor
+    float hysteresis;      // share above switchPixels it has to grow back to
+    float fadeTime;        // seconds
+
+    Settings();
+  };
+
+  struct Vertex
+  {
+    float position[3];
+    uint32_t colour;
+    float uv[2];
+  };
+
+  struct Stats
+  {
+    int meshes;       // mesh drawn, fading or not
+    int impostors;    // billboard drawn, fading or not
+    int fading;       // both
+    int switched;     // mesh shown or hidden by the last update()
+    double selectMs;
+    double buildMs;   // last buildBillboards()
+  };
+
+  ImpostorLod(const Settings& settings = Settings());
+
+  // phase offsets the instance's animation, a share of the loop
+  int add(float x, float y, float z, float yaw, float phase = 0.0f);
+  void setTransform(int id, float x, float y, float z, float yaw);
+  void clear(void);
+  int size(void) const { return (int)mX.size(); }
+
+  // off shows every mesh at once
+  void setEnabled(bool enabled);
+  bool isEnabled(void) const { return mEnabled; }
+
+  // pixelScale is the viewport height / (2 tan(fovY / 2)): pixels per unit at distance 1
+  void update(const float* eye, float pixelScale, float dt);
+  bool isMeshVisible(int id) const { return mFade[id] < 1.0f; }
+  float getPhase(int id) const { return mPhase[id]; }
+  // instances whose mesh was shown or hidden by the last update()
+  const std::vector<int>& getChanged(void) const { return mChanged; }
+
+  // cycle is the animation time in loops; up to maxQuads, returns how many were written
+  int buildBillboards(const float* right, const float* up, float cycle, Vertex* vertices, int maxQuads);
+
+  const Settings& getSettings(void) const { return mSettings; }
+  int getCellCount(void) const { return mSettings.angles * mSettings.elevations * mSettings.frames; }
+  int getColumns(void) const { return mColumns; }
+  int getRows(void) const { return mRows; }
+  int getCell(int angle, int elevation, int frame) const;
+  // u0, v0, u1, v1 with v down the atlas
+  void getCellRect(int cell, float* rect) const;
+  // unit vector from the character to the camera the view is rendered from, in the character's space
+  void getViewDirection(int angle, int elevation, float* direction) const;
+
+  const Stats& getStats(void) const { return mStats; }
+
+private:
+  int _selectView(int id, int& elevation) const;
+  void _sortBillboards(void);
+
+  Settings mSettings;
+  int mColumns, mRows;
+  float mCellWidth, mCellHeight;   // in texture coordinates
+  bool mEnabled;
+  float mEye[3];
+
+  // by instance
+  std::vector<float> mX, mY, mZ;
+  std::vector<float> mYawCos, mYawSin;
+  std::vector<float> mPhase;
+  std::vector<float> mFade;        // billboard opacity, the mesh is hidden at 1
+  std::vector<uint8_t> mImpostor;  // wanted as an impostor, or not decided yet
+  std::vector<float> mDistance;    // to the eye at the last update()
+  std::vector<uint8_t> mListed;    // in mOrder
+
+  std::vector<int> mChanged;
+  std::vector<std::pair<float, int> > mOrder;   // billboards, farthest first
+  Stats mStats;
+};
@@ -0,0 +1,214 @@
+#include "InfluenceMap.h"
+
+#include <cmath>
+#include <algorithm>
+
+namespace
+{
+  const float FIXED_SCALE = 1024.0f;
+
+  int toFixed(float value)
+  {
+    return (int)std::floor(value * FIXED_SCALE + 0.5f);
+  }
+}
+
+
+InfluenceMap::InfluenceMap(float originX, float originZ, float cellSize, int width, int depth)
+  : mOriginX(originX), mOriginZ(originZ), mCellSize(cellSize),
+    mWidth(width), mDepth(depth), mStampCount(0)
+{
+}
+
+InfluenceMap::~InfluenceMap()
+{
+}
+
+int InfluenceMap::addLayer(const std::string& name, float radius)
+{
+  Layer layer;
+  layer.name = name;
+  layer.radius = std::max(0, (int)std::ceil(radius / mCellSize));
+  layer.cells.assign(mWidth * mDepth, 0);
+
+  const int size = layer.radius * 2 + 1;
+  layer.kernel.resize(size * size);
+  for (int z = 0; z < size; z++)
+  {
+    for (int x = 0; x < size; x++)
+    {
+      const float dx = (float)(x - layer.radius) * mCellSize;
+      const float dz = (float)(z - layer.radius) * mCellSize;
+      const float distance = std::sqrt(dx * dx + dz * dz);
+      layer.kernel[z * size + x] = (radius > 0.0f) ? std::max(0.0f, 1.0f - distance / radius) : 1.0f;
+    }
+  }
+
+  mLayers.push_back(layer);
+  return (int)mLayers.size() - 1;
+}
+
+int InfluenceMap::getLayer(const std::string& name) const
+{
+  for (size_t i = 0; i < mLayers.size(); i++)
+  {
+    if (mLayers[i].name == name)
+      return (int)i;
+  }
+  return -1;
+}
+
+int InfluenceMap::addSource(int layer, float x, float z, float strength)
+{
+  Source source;
+  source.layer = layer;
+  source.cx = _cellX(x);
+  source.cz = _cellZ(z);
+  source.strength = toFixed(strength);
+  source.active = true;
+  _stamp(source, 1);
+
+  if (!mFreeSources.empty())
+  {
+    const int index = mFreeSources.back();
+    mFreeSources.pop_back();
+    mSources[index] = source;
+    return index;
+  }
+
+  mSources.push_back(source);
+  return (int)mSources.size() - 1;
+}
+
+void InfluenceMap::moveSource(int index, float x, float z)
+{
+  Source& source = mSources[index];
+  // a removed source has no stamp left to take back
+  if (!source.active)
+    return;
+
+  const int cx = _cellX(x);
+  const int cz = _cellZ(z);
+  if (cx == source.cx && cz == source.cz)
+    return;
+
+  _stamp(source, -1);
+  source.cx = cx;
+  source.cz = cz;
+  _stamp(source, 1);
+}
+
+void InfluenceMap::setStrength(int index, float strength)
+{
+  Source& source = mSources[index];
+  if (!source.active)
+    return;
+
+  const int value = toFixed(strength);
+  if (value == source.strength)
+    return;
+
+  _stamp(source, -1);
+  source.strength = value;
+  _stamp(source, 1);
+}
+
+void InfluenceMap::removeSource(int index)
+{
+  Source& source = mSources[index];
+  if (!source.active)
+    return;
+
+  _stamp(source, -1);
+  source.active = false;
+  mFreeSources.push_back(index);
+}
+
+float InfluenceMap::sample(int layer, float x, float z) const
+{
+  return getCell(layer, _cellX(x), _cellZ(z));
+}
+
+float InfluenceMap::getCell(int layer, int cx, int cz) const
+{
+  if (cx < 0 || cz < 0 || cx >= mWidth || cz >= mDepth)
+    return 0.0f;
+  return mLayers[layer].cells[cz * mWidth + cx] / FIXED_SCALE;
+}
+
+float InfluenceMap::getMaximum(int layer) const
+{
+  const std::vector<int>& cells = mLayers[layer].cells;
+  int maximum = 0;
+  for (size_t i = 0; i < cells.size(); i++)
+    maximum = std::max(maximum, cells[i]);
+  return maximum / FIXED_SCALE;
+}
+
+bool InfluenceMap::climb(int layer, float x, float z, float& targetX, float& targetZ) const
+{
+  const int cx = _cellX(x);
+  const int cz = _cellZ(z);
+
+  float best = getCell(layer, cx, cz);
+  int bestX = cx, bestZ = cz;
+  for (int dz = -1; dz <= 1; dz++)
+  {
+    for (int dx = -1; dx <= 1; dx++)
+    {
+      const float value = getCell(layer, cx + dx, cz + dz);
+      if (value > best)
+      {
+        best = value;
+        bestX = cx + dx;
+        bestZ = cz + dz;
+      }
+    }
+  }
+
+  if (bestX == cx && bestZ == cz)
+    return false;
+
+  targetX = mOriginX + (bestX + 0.5f) * mCellSize;
+  targetZ = mOriginZ + (bestZ + 0.5f) * mCellSize;
+  return true;
+}
+
+int InfluenceMap::takeStampCount(void)
+{
+  const int count = mStampCount;
+  mStampCount = 0;
+  return count;
+}
+
+void InfluenceMap::_stamp(const Source& source, int sign)
+{
+  Layer& layer = mLayers[source.layer];
+  const int radius = layer.radius;
+  const int size = radius * 2 + 1;
+
+  // clip the kernel to the map
+  const int x0 = std::max(0, source.cx - radius), x1 = std::min(mWidth - 1, source.cx + radius);
+  const int z0 = std::max(0, source.cz - radius), z1 = std::min(mDepth - 1, source.cz + radius);
+
+  for (int z = z0; z <= z1; z++)
+  {
+    // both rows start at the first column inside the map
+    const float* kernel = &layer.kernel[(z - source.cz + radius) * size + x0 - source.cx + radius];
+    int* cells = &layer.cells[z * mWidth + x0];
+    for (int i = 0; i <= x1 - x0; i++)
+      cells[i] += sign * (int)(kernel[i] * source.strength + 0.5f);
+  }
+
+  mStampCount++;
+}
+
+int InfluenceMap::_cellX(float x) const
+{
+  return std::min(mWidth - 1, std::max(0, (int)std::floor((x - mOriginX) / mCellSize)));
+}
+
+int InfluenceMap::_cellZ(float z) const
+{
+  return std::min(mDepth - 1, std::max(0, (int)std::floor((z - mOriginZ) / mCellSize)));
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Influence map over the ground grid. Each layer (threat, crowd density,
+// ...) is a grid of cells, sources stamp a kernel into their layer that
+// decays linearly with distance and reaches 0 at the layer's radius.
+//
+// Values are kept in fixed point so that a moving source can subtract its
+// old stamp and add the new one without drifting; only sources that change
+// cell or strength touch the grid. Reading a cell is a single array access.
+class InfluenceMap
+{
+public:
+  InfluenceMap(float originX, float originZ, float cellSize, int width, int depth);
+  ~InfluenceMap();
+
+  // radius in world units, strength of a source is the value in its own cell
+  int addLayer(const std::string& name, float radius);
+  int getLayer(const std::string& name) const;
+  int getLayerCount(void) const { return (int)mLayers.size(); }
+  const std::string& getLayerName(int layer) const { return mLayers[layer].name; }
+
+  int addSource(int layer, float x, float z, float strength = 1.0f);
+  // no effect on a removed source
+  void moveSource(int source, float x, float z);
+  void setStrength(int source, float strength);
+  void removeSource(int source);
+
+  float sample(int layer, float x, float z) const;
+  float getCell(int layer, int cx, int cz) const;
+  float getMaximum(int layer) const;
+
+  // neighbouring cell (3x3) with the highest value, false when no neighbour
+  // is higher than the cell at (x, z)
+  bool climb(int layer, float x, float z, float& targetX, float& targetZ) const;
+
+  float getOriginX(void) const { return mOriginX; }
+  float getOriginZ(void) const { return mOriginZ; }
+  float getCellSize(void) const { return mCellSize; }
+  int getWidth(void) const { return mWidth; }
+  int getDepth(void) const { return mDepth; }
+
+  // number of kernel stamps since the last call, for profiling
+  int takeStampCount(void);
+
+private:
+  struct Layer
+  {
+    std::string name;
+    int radius;                 // in cells
+    std::vector<float> kernel;  // (2 * radius + 1)^2 falloff weights
+    std::vector<int> cells;
+  };
+
+  struct Source
+  {
+    int layer;
+    int cx, cz;
+    int strength;   // fixed point
+    bool active;
+  };
+
+  void _stamp(const Source& source, int sign);
+  int _cellX(float x) const;
+  int _cellZ(float z) const;
+
+  float mOriginX, mOriginZ;
+  float mCellSize;
+  int mWidth, mDepth;
+
+  std::vector<Layer> mLayers;
+  std::vector<Source> mSources;
+  std::vector<int> mFreeSources;
+  int mStampCount;
+};
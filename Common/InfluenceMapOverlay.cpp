@@ -0,0 +1,115 @@
+#include "InfluenceMapOverlay.h"
+
+using namespace Ogre;
+
+namespace
+{
+  const ColourValue LAYER_COLOURS[] = {
+    ColourValue(1.0f, 0.2f, 0.1f),
+    ColourValue(0.1f, 0.8f, 1.0f),
+    ColourValue(0.3f, 1.0f, 0.2f),
+    ColourValue(1.0f, 0.9f, 0.1f),
+  };
+  const int LAYER_COLOUR_COUNT = sizeof(LAYER_COLOURS) / sizeof(LAYER_COLOURS[0]);
+}
+
+
+InfluenceMapOverlay::InfluenceMapOverlay(SceneManager* sceneMgr, const InfluenceMap* map, float refreshInterval)
+  : mSceneMgr(sceneMgr), mMap(map), mLayer(-1), mRefreshInterval(refreshInterval), mRefreshTime(0.0f)
+{
+  MaterialPtr material = MaterialManager::getSingleton().createOrRetrieve("InfluenceMapOverlayMaterial", "General").first.staticCast<Material>();
+  Pass* pass = material->getTechnique(0)->getPass(0);
+  pass->setLightingEnabled(false);
+  pass->setSceneBlending(SBT_TRANSPARENT_ALPHA);
+  pass->setDepthWriteEnabled(false);
+  pass->setCullingMode(CULL_NONE);
+  pass->setVertexColourTracking(TVC_DIFFUSE);
+
+  mObject = mSceneMgr->createManualObject("InfluenceMapOverlay");
+  mObject->setDynamic(true);
+  mNode = mSceneMgr->getRootSceneNode()->createChildSceneNode("InfluenceMapOverlayNode", Vector3(0.0f, 1.0f, 0.0f));
+  mNode->attachObject(mObject);
+  mNode->setVisible(false);
+}
+
+InfluenceMapOverlay::~InfluenceMapOverlay()
+{
+}
+
+void InfluenceMapOverlay::setLayer(int layer)
+{
+  mLayer = (layer < mMap->getLayerCount()) ? layer : -1;
+  mNode->setVisible(mLayer >= 0);
+  mRefreshTime = mRefreshInterval;
+
+  if (mLayer >= 0)
+    LogManager::getSingleton().logMessage("Influence overlay: " + mMap->getLayerName(mLayer));
+}
+
+void InfluenceMapOverlay::nextLayer(void)
+{
+  setLayer(mLayer + 1);
+}
+
+void InfluenceMapOverlay::update(float timeSinceLastFrame)
+{
+  if (mLayer < 0)
+    return;
+
+  mRefreshTime += timeSinceLastFrame;
+  if (mRefreshTime < mRefreshInterval)
+    return;
+
+  mRefreshTime = 0.0f;
+  _rebuild();
+}
+
+void InfluenceMapOverlay::_rebuild(void)
+{
+  const float maximum = mMap->getMaximum(mLayer);
+  const float cellSize = mMap->getCellSize();
+  const ColourValue colour = LAYER_COLOURS[mLayer % LAYER_COLOUR_COUNT];
+
+  if (mObject->getNumSections() == 0)
+    mObject->begin("InfluenceMapOverlayMaterial", RenderOperation::OT_TRIANGLE_LIST);
+  else
+    mObject->beginUpdate(0);
+
+  int quads = 0;
+  for (int cz = 0; cz < mMap->getDepth(); cz++)
+  {
+    for (int cx = 0; cx < mMap->getWidth(); cx++)
+    {
+      const float value = mMap->getCell(mLayer, cx, cz);
+      if (value <= 0.0f)
+        continue;
+
+      const float x = mMap->getOriginX() + cx * cellSize;
+      const float z = mMap->getOriginZ() + cz * cellSize;
+      const ColourValue cellColour(colour.r, colour.g, colour.b, 0.15f + 0.6f * value / maximum);
+
+      mObject->position(x, 0.0f, z);                       mObject->colour(cellColour);
+      mObject->position(x, 0.0f, z + cellSize);            mObject->colour(cellColour);
+      mObject->position(x + cellSize, 0.0f, z + cellSize); mObject->colour(cellColour);
+      mObject->position(x + cellSize, 0.0f, z);            mObject->colour(cellColour);
+
+      const uint32 base = quads * 4;
+      mObject->quad(base, base + 1, base + 2, base + 3);
+      quads++;
+    }
+  }
+
+  // empty sections are not allowed, keep a degenerate triangle instead
+  // (same vertex format so later updates can grow it again)
+  if (quads == 0)
+  {
+    for (int i = 0; i < 3; i++)
+    {
+      mObject->position(0.0f, 0.0f, 0.0f);
+      mObject->colour(colour);
+    }
+    mObject->triangle(0, 1, 2);
+  }
+
+  mObject->end();
+}
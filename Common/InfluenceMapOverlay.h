@@ -0,0 +1,35 @@
+#pragma once
+
+#include <Ogre.h>
+
+#include "InfluenceMap.h"
+
+// Debug view of an InfluenceMap: one layer at a time is drawn as coloured
+// quads just above the ground, brighter where the value is higher. The
+// geometry is rebuilt a few times per second, not every frame.
+class InfluenceMapOverlay
+{
+public:
+  InfluenceMapOverlay(Ogre::SceneManager* sceneMgr, const InfluenceMap* map, float refreshInterval = 0.2f);
+  ~InfluenceMapOverlay();
+
+  // -1 hides the overlay
+  void setLayer(int layer);
+  int getLayer(void) const { return mLayer; }
+  // hidden -> layer 0 -> layer 1 ... -> hidden
+  void nextLayer(void);
+
+  void update(float timeSinceLastFrame);
+
+private:
+  void _rebuild(void);
+
+  Ogre::SceneManager* mSceneMgr;
+  const InfluenceMap* mMap;
+  Ogre::ManualObject* mObject;
+  Ogre::SceneNode* mNode;
+
+  int mLayer;
+  float mRefreshInterval;
+  float mRefreshTime;
+};
@@ -0,0 +1,182 @@
+#include "LightClusters.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+  int clampTile(float u, int tiles)
+  {
+    // u in [-1, 1] across the screen
+    const int tile = (int)std::floor((u + 1.0f) * 0.5f * tiles);
+    return std::min(std::max(tile, 0), tiles - 1);
+  }
+
+  bool touches(const LightClusters::Sphere& a, const LightClusters::Sphere& b)
+  {
+    const float dx = a.x - b.x, dy = a.y - b.y, dz = a.z - b.z;
+    const float r = a.radius + b.radius;
+    return dx * dx + dy * dy + dz * dz <= r * r;
+  }
+}
+
+
+LightClusters::LightClusters(int tilesX, int tilesY, int slices)
+  : mTilesX(std::max(tilesX, 1)), mTilesY(std::max(tilesY, 1)), mSlices(std::max(slices, 1)),
+  mTanX(1.0f), mTanY(1.0f), mNear(1.0f), mFar(10000.0f), mSliceScale(1.0f), mStamp(0)
+{
+  const float identity[12] = { 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f };
+  memcpy(mView, identity, sizeof(mView));
+  memset(&mStats, 0, sizeof(mStats));
+
+  mOffsets.assign(getClusterCount() + 1, 0);
+}
+
+void LightClusters::setView(const float* view, float tanHalfFovY, float aspect, float nearDist, float farDist)
+{
+  memcpy(mView, view, sizeof(mView));
+  mTanY = tanHalfFovY;
+  mTanX = tanHalfFovY * aspect;
+  mNear = std::max(nearDist, 0.001f);
+  mFar = std::max(farDist, mNear * 2.0f);
+  mSliceScale = mSlices / std::log(mFar / mNear);
+}
+
+void LightClusters::build(const Sphere* lights, int lightCount)
+{
+  memset(&mStats, 0, sizeof(mStats));
+  mStats.lights = lightCount;
+
+  mLights.assign(lights, lights + lightCount);
+  mRanges.resize(lightCount);
+  mStamps.assign(lightCount, 0);
+  mStamp = 0;
+
+  // count per cluster, offsets by prefix sum, then fill
+  const int clusterCount = getClusterCount();
+  mOffsets.assign(clusterCount + 1, 0);
+
+  std::vector<bool> binned(lightCount);
+  for (int i = 0; i < lightCount; i++)
+  {
+    Range& range = mRanges[i];
+    binned[i] = _getRange(mLights[i], range);
+    if (!binned[i])
+      continue;
+
+    mStats.lightsBinned++;
+    for (int z = range.z0; z <= range.z1; z++)
+      for (int y = range.y0; y <= range.y1; y++)
+        for (int x = range.x0; x <= range.x1; x++)
+          mOffsets[_getCluster(x, y, z) + 1]++;
+  }
+
+  for (int i = 0; i < clusterCount; i++)
+  {
+    if (mOffsets[i + 1])
+      mStats.clustersUsed++;
+    mOffsets[i + 1] += mOffsets[i];
+  }
+
+  mIndices.resize(mOffsets[clusterCount]);
+  mStats.clusterEntries = (int)mIndices.size();
+
+  std::vector<int> fill(mOffsets.begin(), mOffsets.end() - 1);
+  for (int i = 0; i < lightCount; i++)
+  {
+    if (!binned[i])
+      continue;
+
+    const Range& range = mRanges[i];
+    for (int z = range.z0; z <= range.z1; z++)
+      for (int y = range.y0; y <= range.y1; y++)
+        for (int x = range.x0; x <= range.x1; x++)
+          mIndices[fill[_getCluster(x, y, z)]++] = i;
+  }
+}
+
+void LightClusters::query(const Sphere& object, std::vector<int>& result)
+{
+  result.clear();
+  mStats.objectsQueried++;
+
+  Range range;
+  if (!_getRange(object, range))
+    return;
+
+  // a light spanning several of the object's clusters is tested once
+  if (++mStamp == 0)
+  {
+    std::fill(mStamps.begin(), mStamps.end(), 0);
+    mStamp = 1;
+  }
+
+  for (int z = range.z0; z <= range.z1; z++)
+  {
+    for (int y = range.y0; y <= range.y1; y++)
+    {
+      for (int x = range.x0; x <= range.x1; x++)
+      {
+        const int cluster = _getCluster(x, y, z);
+        for (int i = mOffsets[cluster]; i < mOffsets[cluster + 1]; i++)
+        {
+          const int light = mIndices[i];
+          if (mStamps[light] == mStamp)
+            continue;
+
+          mStamps[light] = mStamp;
+          mStats.candidatesTested++;
+          if (touches(mLights[light], object))
+            result.push_back(light);
+        }
+      }
+    }
+  }
+
+  std::sort(result.begin(), result.end());
+  mStats.lightsAssigned += (int)result.size();
+}
+
+int LightClusters::getClusterLightCount(int x, int y, int slice) const
+{
+  const int cluster = _getCluster(x, y, slice);
+  return mOffsets[cluster + 1] - mOffsets[cluster];
+}
+
+bool LightClusters::_getRange(const Sphere& sphere, Range& range) const
+{
+  const float* m = mView;
+  const float vx = m[0] * sphere.x + m[1] * sphere.y + m[2] * sphere.z + m[3];
+  const float vy = m[4] * sphere.x + m[5] * sphere.y + m[6] * sphere.z + m[7];
+  const float depth = -(m[8] * sphere.x + m[9] * sphere.y + m[10] * sphere.z + m[11]);
+  const float r = sphere.radius;
+
+  const float nearDepth = std::max(depth - r, mNear);
+  const float farDepth = std::min(depth + r, mFar);
+  if (nearDepth > farDepth)
+    return false;
+
+  // x / depth over the box around the sphere, both ends of the depth range
+  // cover either sign of x
+  const float minU = std::min((vx - r) / nearDepth, (vx - r) / farDepth) / mTanX;
+  const float maxU = std::max((vx + r) / nearDepth, (vx + r) / farDepth) / mTanX;
+  const float minV = std::min((vy - r) / nearDepth, (vy - r) / farDepth) / mTanY;
+  const float maxV = std::max((vy + r) / nearDepth, (vy + r) / farDepth) / mTanY;
+  if (maxU < -1.0f || minU > 1.0f || maxV < -1.0f || minV > 1.0f)
+    return false;
+
+  range.x0 = clampTile(minU, mTilesX);
+  range.x1 = clampTile(maxU, mTilesX);
+  range.y0 = clampTile(minV, mTilesY);
+  range.y1 = clampTile(maxV, mTilesY);
+  range.z0 = _getSlice(nearDepth);
+  range.z1 = _getSlice(farDepth);
+  return true;
+}
+
+int LightClusters::_getSlice(float depth) const
+{
+  const int slice = (int)(std::log(depth / mNear) * mSliceScale);
+  return std::min(std::max(slice, 0), mSlices - 1);
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <vector>
+
+// Clustered (froxel) light assignment. The view frustum is split into
+// tilesX x tilesY screen tiles and exponential depth slices; once per frame
+// build() files every light's bounding sphere in the clusters it touches,
+// as one flat index list with an offset per cluster. query() then collects
+// the lights of an object from the few clusters its bounding sphere
+// touches instead of testing it against every light in the scene.
+//
+// Spheres are in world space; setView() takes the camera's world to view
+// transform (row major, looking down -z like Ogre's cameras).
+class LightClusters
+{
+public:
+  struct Sphere
+  {
+    float x, y, z;
+    float radius;
+  };
+
+  struct Stats
+  {
+    int lights;             // passed to build()
+    int lightsBinned;       // inside the frustum
+    int clusterEntries;     // length of the index list
+    int clustersUsed;       // clusters with at least one light
+    int objectsQueried;
+    int candidatesTested;   // lights read from clusters by queries
+    int lightsAssigned;     // lights returned by queries
+  };
+
+  LightClusters(int tilesX = 16, int tilesY = 8, int slices = 24);
+
+  void setView(const float* view, float tanHalfFovY, float aspect, float nearDist, float farDist);
+
+  // indices returned by query() refer to this array
+  void build(const Sphere* lights, int lightCount);
+
+  // lights whose sphere touches the object's sphere, ascending; an object
+  // outside the frustum gets none
+  void query(const Sphere& object, std::vector<int>& result);
+
+  int getClusterCount(void) const { return mTilesX * mTilesY * mSlices; }
+  // lights filed in one cluster
+  int getClusterLightCount(int x, int y, int slice) const;
+
+  // build() resets them
+  const Stats& getStats(void) const { return mStats; }
+
+private:
+  struct Range
+  {
+    int x0, x1, y0, y1, z0, z1;
+  };
+
+  bool _getRange(const Sphere& sphere, Range& range) const;
+  int _getSlice(float depth) const;
+  int _getCluster(int x, int y, int z) const { return (z * mTilesY + y) * mTilesX + x; }
+
+  int mTilesX, mTilesY, mSlices;
+
+  float mView[12];   // the rows that matter
+  float mTanX, mTanY;
+  float mNear, mFar;
+  float mSliceScale;
+
+  std::vector<Sphere> mLights;
+  std::vector<int> mOffsets;   // per cluster, plus one for the end
+  std::vector<int> mIndices;
+
+  std::vector<Range> mRanges;   // scratch for build()
+  std::vector<unsigned int> mStamps;
+  unsigned int mStamp;
+
+  Stats mStats;
+};
@@ -0,0 +1,225 @@
+#include "LooseGrid.h"
+
+#include <cmath>
+#include <algorithm>
+
+LooseGrid::LooseGrid(float originX, float originZ, float cellSize, int cellsPerSide)
+  : mOriginX(originX), mOriginZ(originZ), mCellSize(cellSize), mCellsPerSide(cellsPerSide)
+{
+  clear();
+}
+
+LooseGrid::~LooseGrid()
+{
+}
+
+int LooseGrid::add(const Bounds& bounds, void* userData)
+{
+  int object;
+  if (!mFreeObjects.empty())
+  {
+    object = mFreeObjects.back();
+    mFreeObjects.pop_back();
+  }
+  else
+  {
+    object = (int)mObjects.size();
+    mObjects.push_back(Object());
+  }
+
+  mObjects[object].bounds = bounds;
+  mObjects[object].userData = userData;
+  _insert(object, _findCell(bounds));
+  return object;
+}
+
+void LooseGrid::update(int object, const Bounds& bounds)
+{
+  Object& entry = mObjects[object];
+  entry.bounds = bounds;
+
+  const int cell = _findCell(bounds);
+  if (cell != entry.cell)
+  {
+    _unlink(object);
+    _insert(object, cell);
+  }
+  else if (cell != OVERFLOW_CELL)
+  {
+    Cell& target = mCells[cell];
+    target.minY = std::min(target.minY, bounds.minY);
+    target.maxY = std::max(target.maxY, bounds.maxY);
+  }
+}
+
+void LooseGrid::remove(int object)
+{
+  if (!contains(object))
+    return;
+
+  _unlink(object);
+  mObjects[object].cell = NO_CELL;
+  mObjects[object].userData = nullptr;
+  mFreeObjects.push_back(object);
+}
+
+void LooseGrid::clear(void)
+{
+  mCells.assign(mCellsPerSide * mCellsPerSide, Cell());
+  for (size_t i = 0; i < mCells.size(); i++)
+  {
+    mCells[i].minY = 0.0f;
+    mCells[i].maxY = 0.0f;
+  }
+  mOverflow.clear();
+  mObjects.clear();
+  mFreeObjects.clear();
+  mStats.cellsTested = mStats.cellsInside = mStats.objectsTested = mStats.objectsAccepted = 0;
+}
+
+bool LooseGrid::contains(int object) const
+{
+  return object >= 0 && object < (int)mObjects.size() && mObjects[object].cell != NO_CELL;
+}
+
+void LooseGrid::query(const Plane* planes, int planeCount, const Bounds& area, std::vector<int>& result)
+{
+  mStats.cellsTested = mStats.cellsInside = mStats.objectsTested = mStats.objectsAccepted = 0;
+
+  // loose bounds reach half a cell further, so widen the visited range by one cell
+  const int x0 = std::max(0, (int)std::floor((area.minX - mOriginX) / mCellSize) - 1);
+  const int z0 = std::max(0, (int)std::floor((area.minZ - mOriginZ) / mCellSize) - 1);
+  const int x1 = std::min(mCellsPerSide - 1, (int)std::floor((area.maxX - mOriginX) / mCellSize) + 1);
+  const int z1 = std::min(mCellsPerSide - 1, (int)std::floor((area.maxZ - mOriginZ) / mCellSize) + 1);
+
+  const float half = mCellSize * 0.5f;
+
+  for (int cz = z0; cz <= z1; cz++)
+  {
+    for (int cx = x0; cx <= x1; cx++)
+    {
+      const Cell& cell = mCells[cz * mCellsPerSide + cx];
+      if (cell.objects.empty())
+        continue;
+
+      Bounds loose;
+      loose.minX = mOriginX + cx * mCellSize - half;
+      loose.maxX = mOriginX + (cx + 1) * mCellSize + half;
+      loose.minZ = mOriginZ + cz * mCellSize - half;
+      loose.maxZ = mOriginZ + (cz + 1) * mCellSize + half;
+      loose.minY = cell.minY;
+      loose.maxY = cell.maxY;
+
+      mStats.cellsTested++;
+      const Side side = _classify(planes, planeCount, loose);
+      if (side == OUTSIDE)
+        continue;
+
+      if (side == INSIDE)
+      {
+        mStats.cellsInside++;
+        result.insert(result.end(), cell.objects.begin(), cell.objects.end());
+        mStats.objectsAccepted += (int)cell.objects.size();
+        continue;
+      }
+
+      for (size_t i = 0; i < cell.objects.size(); i++)
+      {
+        const int object = cell.objects[i];
+        mStats.objectsTested++;
+        if (_classify(planes, planeCount, mObjects[object].bounds) != OUTSIDE)
+        {
+          result.push_back(object);
+          mStats.objectsAccepted++;
+        }
+      }
+    }
+  }
+
+  for (size_t i = 0; i < mOverflow.size(); i++)
+  {
+    const int object = mOverflow[i];
+    mStats.objectsTested++;
+    if (_classify(planes, planeCount, mObjects[object].bounds) != OUTSIDE)
+    {
+      result.push_back(object);
+      mStats.objectsAccepted++;
+    }
+  }
+}
+
+int LooseGrid::_findCell(const Bounds& bounds) const
+{
+  // only objects that fit the loose bounds of one cell
+  if (bounds.maxX - bounds.minX > mCellSize || bounds.maxZ - bounds.minZ > mCellSize)
+    return OVERFLOW_CELL;
+
+  const float centreX = (bounds.minX + bounds.maxX) * 0.5f;
+  const float centreZ = (bounds.minZ + bounds.maxZ) * 0.5f;
+  const int cx = (int)std::floor((centreX - mOriginX) / mCellSize);
+  const int cz = (int)std::floor((centreZ - mOriginZ) / mCellSize);
+  if (cx < 0 || cz < 0 || cx >= mCellsPerSide || cz >= mCellsPerSide)
+    return OVERFLOW_CELL;
+
+  return cz * mCellsPerSide + cx;
+}
+
+void LooseGrid::_insert(int object, int cell)
+{
+  std::vector<int>& list = _list(cell);
+  mObjects[object].cell = cell;
+  mObjects[object].slot = (int)list.size();
+  list.push_back(object);
+
+  if (cell != OVERFLOW_CELL)
+  {
+    Cell& target = mCells[cell];
+    const Bounds& bounds = mObjects[object].bounds;
+    if (list.size() == 1)
+    {
+      target.minY = bounds.minY;
+      target.maxY = bounds.maxY;
+    }
+    else
+    {
+      target.minY = std::min(target.minY, bounds.minY);
+      target.maxY = std::max(target.maxY, bounds.maxY);
+    }
+  }
+}
+
+void LooseGrid::_unlink(int object)
+{
+  std::vector<int>& list = _list(mObjects[object].cell);
+  const int slot = mObjects[object].slot;
+
+  // swap with the last entry
+  const int last = list.back();
+  list[slot] = last;
+  mObjects[last].slot = slot;
+  list.pop_back();
+}
+
+LooseGrid::Side LooseGrid::_classify(const Plane* planes, int planeCount, const Bounds& bounds)
+{
+  const float centreX = (bounds.minX + bounds.maxX) * 0.5f;
+  const float centreY = (bounds.minY + bounds.maxY) * 0.5f;
+  const float centreZ = (bounds.minZ + bounds.maxZ) * 0.5f;
+  const float halfX = (bounds.maxX - bounds.minX) * 0.5f;
+  const float halfY = (bounds.maxY - bounds.minY) * 0.5f;
+  const float halfZ = (bounds.maxZ - bounds.minZ) * 0.5f;
+
+  Side side = INSIDE;
+  for (int i = 0; i < planeCount; i++)
+  {
+    const Plane& plane = planes[i];
+    const float distance = plane.nx * centreX + plane.ny * centreY + plane.nz * centreZ + plane.d;
+    const float radius = std::fabs(plane.nx) * halfX + std::fabs(plane.ny) * halfY + std::fabs(plane.nz) * halfZ;
+
+    if (distance < -radius)
+      return OUTSIDE;
+    if (distance < radius)
+      side = INTERSECTS;
+  }
+  return side;
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <vector>
+
+// Loose grid over the ground plane for view frustum culling. Objects are
+// filed in the cell that holds the centre of their bounds; a cell's bounds
+// are grown by half a cell on every side, so anything up to one cell in
+// size fits entirely in the loose bounds of its cell. Larger objects go to
+// an overflow list that is tested one by one.
+//
+// A query tests the loose cells under the frustum first: cells fully
+// inside accept all their objects without further tests, cells crossing a
+// plane test their objects, cells outside are skipped.
+class LooseGrid
+{
+public:
+  struct Bounds
+  {
+    float minX, minY, minZ;
+    float maxX, maxY, maxZ;
+  };
+
+  // a point p is inside when nx * p.x + ny * p.y + nz * p.z + d >= 0
+  struct Plane
+  {
+    float nx, ny, nz, d;
+  };
+
+  struct QueryStats
+  {
+    int cellsTested;
+    int cellsInside;
+    int objectsTested;
+    int objectsAccepted;
+  };
+
+  LooseGrid(float originX = -8000.0f, float originZ = -8000.0f, float cellSize = 250.0f, int cellsPerSide = 64);
+  ~LooseGrid();
+
+  int add(const Bounds& bounds, void* userData = nullptr);
+  void update(int object, const Bounds& bounds);
+  void remove(int object);
+  void clear(void);
+
+  bool contains(int object) const;
+  void* getUserData(int object) const { return mObjects[object].userData; }
+  int getObjectCount(void) const { return (int)mObjects.size() - (int)mFreeObjects.size(); }
+
+  // appends the objects intersecting the convex volume; area limits the
+  // cells that are visited (usually the bounds of the frustum corners)
+  void query(const Plane* planes, int planeCount, const Bounds& area, std::vector<int>& result);
+
+  const QueryStats& getQueryStats(void) const { return mStats; }
+
+  float getCellSize(void) const { return mCellSize; }
+  int getCellsPerSide(void) const { return mCellsPerSide; }
+
+private:
+  enum { OVERFLOW_CELL = -1, NO_CELL = -2 };
+
+  struct Object
+  {
+    Bounds bounds;
+    void* userData;
+    int cell;
+    int slot;   // position in the cell's list
+  };
+
+  struct Cell
+  {
+    std::vector<int> objects;
+    float minY, maxY;   // height of the content, only grows until the cell is empty
+  };
+
+  enum Side { OUTSIDE, INSIDE, INTERSECTS };
+
+  int _findCell(const Bounds& bounds) const;
+  void _insert(int object, int cell);
+  void _unlink(int object);
+  std::vector<int>& _list(int cell) { return (cell == OVERFLOW_CELL) ? mOverflow : mCells[cell].objects; }
+
+  static Side _classify(const Plane* planes, int planeCount, const Bounds& bounds);
+
+  float mOriginX, mOriginZ;
+  float mCellSize;
+  int mCellsPerSide;
+
+  std::vector<Cell> mCells;
+  std::vector<int> mOverflow;
+  std::vector<Object> mObjects;
+  std::vector<int> mFreeObjects;
+
+  QueryStats mStats;
+};
@@ -0,0 +1,231 @@
+#include "LooseGridSceneManager.h"
+
+using namespace Ogre;
+
+namespace
+{
+  const Real DEFAULT_CELL_SIZE = 250.0f;
+  const int DEFAULT_CELLS_PER_SIDE = 64;
+
+  LooseGrid::Bounds toBounds(const AxisAlignedBox& box)
+  {
+    const Vector3& minimum = box.getMinimum();
+    const Vector3& maximum = box.getMaximum();
+    LooseGrid::Bounds bounds = { minimum.x, minimum.y, minimum.z, maximum.x, maximum.y, maximum.z };
+    return bounds;
+  }
+}
+
+
+LooseGridNode::LooseGridNode(LooseGridSceneManager* creator)
+  : SceneNode(creator), mGridObject(-1)
+{
+}
+
+LooseGridNode::LooseGridNode(LooseGridSceneManager* creator, const String& name)
+  : SceneNode(creator, name), mGridObject(-1)
+{
+}
+
+void LooseGridNode::_updateBounds(void)
+{
+  mWorldAABB.setNull();
+
+  ObjectMap::iterator it = mObjectsByName.begin();
+  for (; it != mObjectsByName.end(); ++it)
+    mWorldAABB.merge(it->second->getWorldBoundingBox(true));
+
+  LooseGridSceneManager* creator = static_cast<LooseGridSceneManager*>(mCreator);
+  if (mWorldAABB.isNull() || !mIsInSceneGraph)
+    creator->_removeGridNode(this);
+  else
+    creator->_updateGridNode(this);
+}
+
+
+const String LooseGridSceneManager::TYPE_NAME = "LooseGridSceneManager";
+
+LooseGridSceneManager::LooseGridSceneManager(const String& instanceName)
+  : SceneManager(instanceName),
+  mGrid(-DEFAULT_CELL_SIZE * DEFAULT_CELLS_PER_SIDE * 0.5f, -DEFAULT_CELL_SIZE * DEFAULT_CELLS_PER_SIDE * 0.5f,
+    DEFAULT_CELL_SIZE, DEFAULT_CELLS_PER_SIDE)
+{
+}
+
+LooseGridSceneManager::~LooseGridSceneManager()
+{
+}
+
+SceneNode* LooseGridSceneManager::createSceneNodeImpl(void)
+{
+  return OGRE_NEW LooseGridNode(this);
+}
+
+SceneNode* LooseGridSceneManager::createSceneNodeImpl(const String& name)
+{
+  return OGRE_NEW LooseGridNode(this, name);
+}
+
+void LooseGridSceneManager::destroySceneNode(const String& name)
+{
+  LooseGridNode* node = static_cast<LooseGridNode*>(getSceneNode(name));
+  _removeGridNode(node);
+
+  SceneManager::destroySceneNode(name);
+}
+
+void LooseGridSceneManager::clearScene(void)
+{
+  SceneManager::clearScene();
+
+  // the root node survives, everything filed before is gone
+  mGrid.clear();
+  static_cast<LooseGridNode*>(getRootSceneNode())->setGridObject(-1);
+}
+
+void LooseGridSceneManager::_updateGridNode(LooseGridNode* node)
+{
+  const LooseGrid::Bounds bounds = toBounds(node->_getWorldAABB());
+  if (node->getGridObject() < 0)
+    node->setGridObject(mGrid.add(bounds, node));
+  else
+    mGrid.update(node->getGridObject(), bounds);
+}
+
+void LooseGridSceneManager::_removeGridNode(LooseGridNode* node)
+{
+  if (node->getGridObject() < 0)
+    return;
+
+  mGrid.remove(node->getGridObject());
+  node->setGridObject(-1);
+}
+
+void LooseGridSceneManager::_findVisibleObjects(Camera* cam, VisibleObjectsBoundsInfo* visibleBounds, bool onlyShadowCasters)
+{
+  const Frustum* frustum = cam->getCullingFrustum() ? cam->getCullingFrustum() : cam;
+
+  LooseGrid::Plane planes[6];
+  const Plane* frustumPlanes = frustum->getFrustumPlanes();
+  for (int i = 0; i < 6; i++)
+  {
+    planes[i].nx = frustumPlanes[i].normal.x;
+    planes[i].ny = frustumPlanes[i].normal.y;
+    planes[i].nz = frustumPlanes[i].normal.z;
+    planes[i].d = frustumPlanes[i].d;
+  }
+
+  AxisAlignedBox area;
+  const Vector3* corners = frustum->getWorldSpaceCorners();
+  for (int i = 0; i < 8; i++)
+    area.merge(corners[i]);
+
+  mVisible.clear();
+  mGrid.query(planes, 6, toBounds(area), mVisible);
+
+  RenderQueue* queue = getRenderQueue();
+  for (size_t i = 0; i < mVisible.size(); i++)
+  {
+    LooseGridNode* node = static_cast<LooseGridNode*>(mGrid.getUserData(mVisible[i]));
+    if (!node->isInSceneGraph())
+      continue;
+
+    SceneNode::ObjectIterator it = node->getAttachedObjectIterator();
+    while (it.hasMoreElements())
+      queue->processVisibleObject(it.getNext(), cam, onlyShadowCasters, visibleBounds);
+
+    // what SceneNode::_findVisibleObjects adds for the base class; debug
+    // shadow volumes need nothing here, the shadow pass finds its casters
+    // with a scene query of its own
+    if (getDisplaySceneNodes())
+      queue->addRenderable(node->getDebugRenderable());
+    if (node->getShowBoundingBox() || getShowBoundingBoxes())
+      node->_addBoundingBoxToQueue(queue);
+  }
+}
+
+void LooseGridSceneManager::_resize(Real cellSize, int cellsPerSide)
+{
+  const Real origin = -cellSize * cellsPerSide * 0.5f;
+  mGrid = LooseGrid(origin, origin, cellSize, cellsPerSide);
+
+  // refile every node that was in the old grid
+  SceneNodeList::iterator it = mSceneNodes.begin();
+  for (; it != mSceneNodes.end(); ++it)
+  {
+    LooseGridNode* node = static_cast<LooseGridNode*>(it->second);
+    if (node->getGridObject() < 0)
+      continue;
+
+    node->setGridObject(-1);
+    _updateGridNode(node);
+  }
+}
+
+bool LooseGridSceneManager::setOption(const String& key, const void* value)
+{
+  if (key == "CellSize")
+  {
+    const Real cellSize = *static_cast<const Real*>(value);
+    if (cellSize <= 0.0f)
+      return false;
+    _resize(cellSize, mGrid.getCellsPerSide());
+    return true;
+  }
+  if (key == "CellsPerSide")
+  {
+    const int cellsPerSide = *static_cast<const int*>(value);
+    if (cellsPerSide <= 0)
+      return false;
+    _resize(mGrid.getCellSize(), cellsPerSide);
+    return true;
+  }
+  return SceneManager::setOption(key, value);
+}
+
+bool LooseGridSceneManager::getOption(const String& key, void* destValue)
+{
+  if (key == "CellSize")
+  {
+    *static_cast<Real*>(destValue) = mGrid.getCellSize();
+    return true;
+  }
+  if (key == "CellsPerSide")
+  {
+    *static_cast<int*>(destValue) = mGrid.getCellsPerSide();
+    return true;
+  }
+  return SceneManager::getOption(key, destValue);
+}
+
+bool LooseGridSceneManager::hasOption(const String& key) const
+{
+  return key == "CellSize" || key == "CellsPerSide" || SceneManager::hasOption(key);
+}
+
+bool LooseGridSceneManager::getOptionKeys(StringVector& keys)
+{
+  SceneManager::getOptionKeys(keys);
+  keys.push_back("CellSize");
+  keys.push_back("CellsPerSide");
+  return true;
+}
+
+
+SceneManager* LooseGridSceneManagerFactory::createInstance(const String& instanceName)
+{
+  return OGRE_NEW LooseGridSceneManager(instanceName);
+}
+
+void LooseGridSceneManagerFactory::destroyInstance(SceneManager* instance)
+{
+  OGRE_DELETE instance;
+}
+
+void LooseGridSceneManagerFactory::initMetaData(void) const
+{
+  mMetaData.typeName = LooseGridSceneManager::TYPE_NAME;
+  mMetaData.description = "Scene manager culling through a loose grid on the ground plane";
+  mMetaData.sceneTypeMask = ST_GENERIC;
+  mMetaData.worldGeometrySupported = false;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <Ogre.h>
+
+#include "LooseGrid.h"
+
+class LooseGridSceneManager;
+
+// Scene node that files itself in the loose grid of its scene manager
+// whenever its bounds change. Like the octree plugin's nodes, the bounds
+// only cover the node's own objects, children are filed on their own.
+class LooseGridNode : public Ogre::SceneNode
+{
+public:
+  LooseGridNode(LooseGridSceneManager* creator);
+  LooseGridNode(LooseGridSceneManager* creator, const Ogre::String& name);
+
+  int getGridObject(void) const { return mGridObject; }
+  void setGridObject(int object) { mGridObject = object; }
+
+protected:
+  void _updateBounds(void);
+
+private:
+  int mGridObject;
+};
+
+
+// Scene manager that culls through a LooseGrid instead of walking the whole
+// scene graph. Options (setOption/getOption):
+//   "CellSize"      Real, edge of a grid cell in world units
+//   "CellsPerSide"  int, the grid is centred on the origin
+class LooseGridSceneManager : public Ogre::SceneManager
+{
+public:
+  static const Ogre::String TYPE_NAME;
+
+  LooseGridSceneManager(const Ogre::String& instanceName);
+  ~LooseGridSceneManager();
+
+  const Ogre::String& getTypeName(void) const { return TYPE_NAME; }
+
+  using Ogre::SceneManager::destroySceneNode;
+  void destroySceneNode(const Ogre::String& name);
+  void clearScene(void);
+
+  void _findVisibleObjects(Ogre::Camera* cam, Ogre::VisibleObjectsBoundsInfo* visibleBounds, bool onlyShadowCasters);
+
+  bool setOption(const Ogre::String& key, const void* value);
+  bool getOption(const Ogre::String& key, void* destValue);
+  bool hasOption(const Ogre::String& key) const;
+  bool getOptionKeys(Ogre::StringVector& keys);
+
+  void _updateGridNode(LooseGridNode* node);
+  void _removeGridNode(LooseGridNode* node);
+
+  const LooseGrid& getGrid(void) const { return mGrid; }
+
+protected:
+  Ogre::SceneNode* createSceneNodeImpl(void);
+  Ogre::SceneNode* createSceneNodeImpl(const Ogre::String& name);
+
+private:
+  void _resize(Ogre::Real cellSize, int cellsPerSide);
+
+  LooseGrid mGrid;
+  std::vector<int> mVisible;
+};
+
+
+class LooseGridSceneManagerFactory : public Ogre::SceneManagerFactory
+{
+public:
+  Ogre::SceneManager* createInstance(const Ogre::String& instanceName);
+  void destroyInstance(Ogre::SceneManager* instance);
+
+protected:
+  void initMetaData(void) const;
+};
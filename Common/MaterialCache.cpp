@@ -0,0 +1,292 @@
+#include "MaterialCache.h"
+
+#include <OgreFileSystemLayer.h>
+
+#include <algorithm>
+#include <fstream>
+
+using namespace Ogre;
+
+namespace
+{
+  // bump when the raw texture layout changes so stale files are ignored
+  const uint32 TEXTURE_CACHE_VERSION = 1;
+
+  struct TextureHeader
+  {
+    char magic[4];   // "TEXC"
+    uint32 version;
+    uint32 width, height, depth;
+    uint32 format;
+    uint32 faces;
+    uint32 mipmaps;
+    uint32 size;
+  };
+
+  // program sources; a changed .program script may point at other files
+  const char* PROGRAM_PATTERNS[] = { "*.program", "*.cg", "*.hlsl", "*.glsl", "*.vert", "*.frag", "*.fx" };
+
+  String toHex(uint32 value)
+  {
+    std::ostringstream hex;
+    hex << std::hex << value;
+    return hex.str();
+  }
+}
+
+
+MaterialCache::MaterialCache(const String& cacheDir)
+  : mCacheDir(cacheDir)
+{
+  memset(&mStats, 0, sizeof(mStats));
+}
+
+MaterialCache::~MaterialCache()
+{
+}
+
+void MaterialCache::loadPrograms(void)
+{
+  Timer timer;
+  GpuProgramManager& programs = GpuProgramManager::getSingleton();
+  if (!programs.canGetCompiledShaderBuffer())
+  {
+    LogManager::getSingleton().logMessage("MaterialCache: " + Root::getSingleton().getRenderSystem()->getName()
+      + " cannot hand out compiled programs, programs are not cached");
+    return;
+  }
+
+  mProgramFile = _getProgramCacheFile();
+  programs.setSaveMicrocodesToCache(true);
+
+  std::ifstream* file = OGRE_NEW_T(std::ifstream, MEMCATEGORY_GENERAL)(mProgramFile.c_str(), std::ios::binary);
+  if (!*file)
+  {
+    OGRE_DELETE_T(file, basic_ifstream, MEMCATEGORY_GENERAL);
+    mStats.programMs = timer.getMilliseconds();
+    return;
+  }
+
+  // the data stream owns the file stream
+  DataStreamPtr stream(OGRE_NEW FileStreamDataStream(mProgramFile, file, true));
+  try
+  {
+    programs.loadMicrocodeCache(stream);
+    mStats.programsCached = true;
+  }
+  catch (Exception& e)
+  {
+    // unreadable cache, the programs are compiled and it is written again
+    LogManager::getSingleton().logMessage("MaterialCache: ignoring " + mProgramFile + ": " + e.getDescription());
+  }
+  mStats.programMs = timer.getMilliseconds();
+}
+
+void MaterialCache::savePrograms(void)
+{
+  GpuProgramManager& programs = GpuProgramManager::getSingleton();
+  if (mProgramFile.empty() || !programs.isCacheDirty())
+    return;
+
+  try
+  {
+    FileSystemLayer::createDirectory(mCacheDir);
+    std::fstream* file = OGRE_NEW_T(std::fstream, MEMCATEGORY_GENERAL)(mProgramFile.c_str(),
+      std::ios::out | std::ios::binary | std::ios::trunc);
+    DataStreamPtr stream(OGRE_NEW FileStreamDataStream(mProgramFile, file, true));
+    programs.saveMicrocodeCache(stream);
+    mStats.programsSaved = true;
+  }
+  catch (Exception& e)
+  {
+    // the programs still work, they are compiled again next time
+    LogManager::getSingleton().logMessage("MaterialCache: cannot write " + mProgramFile + ": " + e.getDescription());
+  }
+}
+
+void MaterialCache::prepareTextures(void)
+{
+  ResourceManager::ResourceMapIterator it = MaterialManager::getSingleton().getResourceIterator();
+  while (it.hasMoreElements())
+  {
+    Material* material = static_cast<Material*>(it.getNext().getPointer());
+
+    Material::TechniqueIterator techniques = material->getTechniqueIterator();
+    while (techniques.hasMoreElements())
+    {
+      Technique::PassIterator passes = techniques.getNext()->getPassIterator();
+      while (passes.hasMoreElements())
+      {
+        Pass::TextureUnitStateIterator units = passes.getNext()->getTextureUnitStateIterator();
+        while (units.hasMoreElements())
+        {
+          // a texture created here ignores what the unit asks for, so
+          // only plain 2D textures with the default settings
+          const TextureUnitState* unit = units.getNext();
+          if (unit->getContentType() != TextureUnitState::CONTENT_NAMED || unit->getTextureType() != TEX_TYPE_2D
+            || unit->getNumMipmaps() != MIP_DEFAULT || unit->getDesiredFormat() != PF_UNKNOWN
+            || unit->getIsAlpha() || unit->isHardwareGammaEnabled())
+            continue;
+
+          for (unsigned int frame = 0; frame < unit->getNumFrames(); frame++)
+          {
+            const String& name = unit->getFrameTextureName(frame);
+            if (name.empty() || mTextures.count(name) || !TextureManager::getSingleton().getByName(name).isNull()
+              || !ResourceGroupManager::getSingleton().resourceExists(material->getGroup(), name))
+              continue;
+
+            // under the name the unit asks for, it picks the texture up as usual
+            TextureManager::getSingleton().create(name, material->getGroup(), true, this);
+            mTextures.insert(name);
+            mStats.texturesPrepared++;
+          }
+        }
+      }
+    }
+  }
+}
+
+void MaterialCache::loadMaterials(const StringVector& groups)
+{
+  Timer timer;
+  ResourceManager::ResourceMapIterator it = MaterialManager::getSingleton().getResourceIterator();
+  while (it.hasMoreElements())
+  {
+    Resource* material = it.getNext().getPointer();
+    if (groups.empty() || std::find(groups.begin(), groups.end(), material->getGroup()) != groups.end())
+      material->load();
+  }
+  mStats.materialMs = timer.getMilliseconds();
+}
+
+void MaterialCache::logStats(void) const
+{
+  LogManager::getSingleton().stream() << "MaterialCache: " << mStats.programFiles << " program sources, microcode "
+    << (mStats.programsCached ? "read from the cache" : "compiled") << (mStats.programsSaved ? " and saved" : "")
+    << " (" << mStats.programMs << " ms); " << mStats.texturesPrepared << " textures, " << mStats.texturesCached
+    << " from the cache, " << mStats.texturesDecoded << " decoded (" << mStats.textureMs << " ms); materials loaded in "
+    << mStats.materialMs << " ms";
+}
+
+void MaterialCache::loadResource(Resource* resource)
+{
+  Timer timer;
+  Texture* texture = static_cast<Texture*>(resource);
+
+  DataStreamPtr source = ResourceGroupManager::getSingleton().openResource(texture->getName(), texture->getGroup(), true, resource);
+  MemoryDataStreamPtr memory(OGRE_NEW MemoryDataStream(source));
+  const String file = _getTextureCacheFile(texture->getName(), memory);
+
+  Image image;
+  if (_readTexture(file, image))
+    mStats.texturesCached++;
+  else
+  {
+    String baseName, extension;
+    StringUtil::splitBaseFilename(texture->getName(), baseName, extension);
+    DataStreamPtr data(memory);
+    image.load(data, extension);
+    _writeTexture(file, image);
+    mStats.texturesDecoded++;
+  }
+
+  ConstImagePtrList images;
+  images.push_back(&image);
+  texture->_loadImages(images);
+  mStats.textureMs += timer.getMilliseconds();
+}
+
+String MaterialCache::_getProgramCacheFile(void)
+{
+  // compiled programs only fit the render system, device and driver that
+  // compiled them
+  const RenderSystem* renderSystem = Root::getSingleton().getRenderSystem();
+  const RenderSystemCapabilities* caps = renderSystem->getCapabilities();
+  String key = renderSystem->getName() + "|" + caps->getDeviceName() + "|" + caps->getDriverVersion().toString()
+    + "|" + RenderSystemCapabilities::vendorToString(caps->getVendor());
+
+  uint32 hash = FastHash(key.c_str(), (int)key.size());
+  const StringVector groups = ResourceGroupManager::getSingleton().getResourceGroups();
+  for (size_t i = 0; i < groups.size(); i++)
+  {
+    for (size_t j = 0; j < sizeof(PROGRAM_PATTERNS) / sizeof(PROGRAM_PATTERNS[0]); j++)
+    {
+      FileInfoListPtr files = ResourceGroupManager::getSingleton().findResourceFileInfo(groups[i], PROGRAM_PATTERNS[j]);
+      for (FileInfoList::const_iterator file = files->begin(); file != files->end(); ++file)
+      {
+        const String source = ResourceGroupManager::getSingleton().openResource(file->filename, groups[i])->getAsString();
+        hash = FastHash(file->filename.c_str(), (int)file->filename.size(), hash);
+        hash = FastHash(source.c_str(), (int)source.size(), hash);
+        mStats.programFiles++;
+      }
+    }
+  }
+
+  return mCacheDir + "/programs_" + toHex(hash) + ".cache";
+}
+
+String MaterialCache::_getTextureCacheFile(const String& name, const MemoryDataStreamPtr& source) const
+{
+  // decoded pixels do not depend on the render system, the content is the
+  // whole key
+  uint32 hash = FastHash((const char*)&TEXTURE_CACHE_VERSION, sizeof(TEXTURE_CACHE_VERSION));
+  hash = FastHash((const char*)source->getPtr(), (int)source->size(), hash);
+
+  String baseName, extension;
+  StringUtil::splitBaseFilename(name, baseName, extension);
+  return mCacheDir + "/" + baseName + "_" + toHex(hash) + ".tex";
+}
+
+bool MaterialCache::_readTexture(const String& fileName, Image& image) const
+{
+  std::ifstream file(fileName.c_str(), std::ios::binary);
+  if (!file)
+    return false;
+
+  TextureHeader header;
+  file.read((char*)&header, sizeof(header));
+  if (!file || memcmp(header.magic, "TEXC", 4) != 0 || header.version != TEXTURE_CACHE_VERSION
+    || header.format >= PF_COUNT || header.faces == 0
+    || header.size != Image::calculateSize(header.mipmaps, header.faces, header.width, header.height,
+      header.depth, (PixelFormat)header.format))
+    return false;
+
+  uchar* pixels = OGRE_ALLOC_T(uchar, header.size, MEMCATEGORY_GENERAL);
+  file.read((char*)pixels, header.size);
+  if (!file)
+  {
+    OGRE_FREE(pixels, MEMCATEGORY_GENERAL);
+    return false;
+  }
+
+  // the image frees the pixels
+  image.loadDynamicImage(pixels, header.width, header.height, header.depth, (PixelFormat)header.format, true,
+    header.faces, (uint8)header.mipmaps);
+  return true;
+}
+
+void MaterialCache::_writeTexture(const String& fileName, const Image& image) const
+{
+  TextureHeader header;
+  memcpy(header.magic, "TEXC", 4);
+  header.version = TEXTURE_CACHE_VERSION;
+  header.width = (uint32)image.getWidth();
+  header.height = (uint32)image.getHeight();
+  header.depth = (uint32)image.getDepth();
+  header.format = (uint32)image.getFormat();
+  header.faces = (uint32)image.getNumFaces();
+  header.mipmaps = (uint32)image.getNumMipmaps();
+  header.size = (uint32)image.getSize();
+
+  FileSystemLayer::createDirectory(mCacheDir);
+  std::ofstream file(fileName.c_str(), std::ios::binary | std::ios::trunc);
+  file.write((const char*)&header, sizeof(header));
+  file.write((const char*)image.getData(), image.getSize());
+  if (!file)
+  {
+    // the texture is usable without the cache
+    file.close();
+    remove(fileName.c_str());
+    LogManager::getSingleton().logMessage("MaterialCache: cannot write " + fileName);
+  }
+}
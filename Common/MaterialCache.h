@@ -0,0 +1,76 @@
+#pragma once
+
+#include <Ogre.h>
+
+#include <set>
+
+// Disk cache for the work materials cost at startup. Two parts:
+//
+//   GPU programs  compiled microcode through Ogre's GpuProgramManager
+//                 cache, one file per render system, device, driver and
+//                 set of program sources. Ogre keys the microcode by
+//                 program name only, so the file name carries a hash of
+//                 every program source and editing one starts a new file.
+//   Textures      the images the materials' texture units name, decoded
+//                 once and stored as raw pixels keyed by a hash of the
+//                 source file; later runs read them back instead of
+//                 decoding PNG and GIF files again.
+//
+// The material scripts themselves are parsed as before: Ogre 1.9 has no
+// binary material format, MaterialSerializer writes scripts again.
+//
+// Order of calls:
+//
+//   root->initialise(...);
+//   ...addResourceLocation(...);
+//   cache.loadPrograms();          // hashes the sources it finds there
+//   ...initialiseAllResourceGroups();
+//   cache.prepareTextures();       // before the materials are loaded
+//   cache.loadMaterials();         // optional, puts the cost at startup
+//   ...
+//   cache.savePrograms();          // before the root is deleted
+//
+// Cached textures are loaded through the cache, so it has to live as long
+// as they do (delete it after the root).
+class MaterialCache : public Ogre::ManualResourceLoader
+{
+public:
+  struct Stats
+  {
+    int programFiles;       // program sources found
+    bool programsCached;    // microcode read from the cache
+    bool programsSaved;
+    int texturesPrepared;   // loaded through the cache
+    int texturesCached;     // read back raw
+    int texturesDecoded;    // decoded and written to the cache
+    unsigned long programMs;
+    unsigned long textureMs;
+    unsigned long materialMs;
+  };
+
+  MaterialCache(const Ogre::String& cacheDir = "materialcache");
+  ~MaterialCache();
+
+  void loadPrograms(void);
+  void savePrograms(void);
+  void prepareTextures(void);
+  // loads every parsed material of the groups, all if empty
+  void loadMaterials(const Ogre::StringVector& groups = Ogre::StringVector());
+
+  const Stats& getStats(void) const { return mStats; }
+  void logStats(void) const;
+
+  // ManualResourceLoader, reads a cached texture or decodes and caches it
+  void loadResource(Ogre::Resource* resource);
+
+private:
+  Ogre::String _getProgramCacheFile(void);
+  Ogre::String _getTextureCacheFile(const Ogre::String& name, const Ogre::MemoryDataStreamPtr& source) const;
+  bool _readTexture(const Ogre::String& file, Ogre::Image& image) const;
+  void _writeTexture(const Ogre::String& file, const Ogre::Image& image) const;
+
+  Ogre::String mCacheDir;
+  Ogre::String mProgramFile;
+  std::set<Ogre::String> mTextures;   // created through the cache
+  Stats mStats;
+};
@@ -0,0 +1,225 @@
+#include "MeshLodBuilder.h"
+
+#include <OgreLodConfig.h>
+#include <OgreProgressiveMeshGenerator.h>
+
+#include <fstream>
+
+#if OGRE_PLATFORM == OGRE_PLATFORM_WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+using namespace Ogre;
+
+namespace
+{
+  void makeDirectory(const String& path)
+  {
+#if OGRE_PLATFORM == OGRE_PLATFORM_WIN32
+    _mkdir(path.c_str());
+#else
+    mkdir(path.c_str(), 0755);
+#endif
+  }
+}
+
+
+MeshLodBuilder::Settings::Settings()
+  : strategy("distance"), cacheDir("lodcache")
+{
+  levels.push_back(std::make_pair(Real(300.0f), Real(0.5f)));
+  levels.push_back(std::make_pair(Real(600.0f), Real(0.75f)));
+  levels.push_back(std::make_pair(Real(1000.0f), Real(0.9f)));
+}
+
+MeshLodBuilder::Settings MeshLodBuilder::load(const String& fileName)
+{
+  Settings settings;
+
+  std::ifstream file(fileName.c_str());
+  if (!file)
+    return settings;
+
+  ConfigFile config;
+  config.load(fileName, "\t:=", true);
+
+  settings.strategy = config.getSetting("LodStrategy", BLANKSTRING, settings.strategy);
+  settings.cacheDir = config.getSetting("LodCache", BLANKSTRING, settings.cacheDir);
+
+  const StringVector levels = config.getMultiSetting("LodLevel");
+  if (!levels.empty())
+  {
+    settings.levels.clear();
+    for (size_t i = 0; i < levels.size(); i++)
+    {
+      const StringVector values = StringUtil::split(levels[i]);
+      if (values.size() == 2)
+        settings.levels.push_back(std::make_pair(StringConverter::parseReal(values[0]), StringConverter::parseReal(values[1])));
+    }
+  }
+  return settings;
+}
+
+MeshLodBuilder::MeshLodBuilder(const Settings& settings)
+  : mSettings(settings)
+{
+}
+
+MeshLodBuilder::~MeshLodBuilder()
+{
+}
+
+MeshPtr MeshLodBuilder::prepare(const String& meshName, const String& group,
+  HardwareBuffer::Usage vertexBufferUsage, HardwareBuffer::Usage indexBufferUsage,
+  bool vertexBufferShadowed, bool indexBufferShadowed)
+{
+  const String meshGroup = (group == ResourceGroupManager::AUTODETECT_RESOURCE_GROUP_NAME)
+    ? ResourceGroupManager::getSingleton().findGroupContainingResource(meshName) : group;
+
+  MeshPtr mesh = MeshManager::getSingleton().getByName(meshName);
+  if (!mesh.isNull())
+  {
+    LogManager::getSingleton().logMessage("MeshLodBuilder: " + meshName + " is already loaded, left as it is");
+    return mesh;
+  }
+
+  Timer timer;
+  const String cacheFile = _getCacheFile(meshName, meshGroup);
+
+  if (std::ifstream(cacheFile.c_str(), std::ios::binary))
+  {
+    // a manual mesh under the original name, entities pick it up as usual
+    mCacheFiles[meshName] = cacheFile;
+    mesh = MeshManager::getSingleton().createManual(meshName, meshGroup, this);
+    mesh->setVertexBufferPolicy(vertexBufferUsage, vertexBufferShadowed);
+    mesh->setIndexBufferPolicy(indexBufferUsage, indexBufferShadowed);
+    mesh->load();
+    _logLevels(mesh, "loaded from cache", timer.getMilliseconds());
+    return mesh;
+  }
+
+  mesh = MeshManager::getSingleton().load(meshName, meshGroup, vertexBufferUsage, indexBufferUsage,
+    vertexBufferShadowed, indexBufferShadowed);
+  if (mesh->getNumLodLevels() > 1)
+  {
+    _logLevels(mesh, "has its own levels", timer.getMilliseconds());
+    return mesh;
+  }
+
+  LodConfig config(mesh, _getStrategy());
+  for (size_t i = 0; i < mSettings.levels.size(); i++)
+    config.createGeneratedLodLevel(mSettings.levels[i].first, mSettings.levels[i].second);
+
+  ProgressiveMeshGenerator generator;
+  generator.generateLodLevels(config);
+  _logLevels(mesh, "generated", timer.getMilliseconds());
+
+  makeDirectory(mSettings.cacheDir);
+  try
+  {
+    MeshSerializer().exportMesh(mesh.getPointer(), cacheFile);
+  }
+  catch (Exception& e)
+  {
+    LogManager::getSingleton().logMessage("MeshLodBuilder: cannot write " + cacheFile + ": " + e.getDescription());
+  }
+  return mesh;
+}
+
+size_t MeshLodBuilder::getTriangleCount(const MeshPtr& mesh, unsigned short lod)
+{
+  size_t triangles = 0;
+  for (unsigned short i = 0; i < mesh->getNumSubMeshes(); i++)
+  {
+    const SubMesh* subMesh = mesh->getSubMesh(i);
+    const IndexData* indexData = (lod == 0 || subMesh->mLodFaceList.size() < lod)
+      ? subMesh->indexData : subMesh->mLodFaceList[lod - 1];
+    triangles += indexData->indexCount / 3;
+  }
+  return triangles;
+}
+
+void MeshLodBuilder::countTriangles(SceneManager* sceneMgr, size_t& fullDetail, size_t& current)
+{
+  fullDetail = current = 0;
+
+  SceneManager::MovableObjectIterator it = sceneMgr->getMovableObjectIterator(EntityFactory::FACTORY_TYPE_NAME);
+  while (it.hasMoreElements())
+  {
+    Entity* entity = static_cast<Entity*>(it.getNext());
+    if (!entity->isInScene() || !entity->getVisible())
+      continue;
+
+    fullDetail += getTriangleCount(entity->getMesh(), 0);
+    current += getTriangleCount(entity->getMesh(), entity->getCurrentLodIndex());
+  }
+}
+
+void MeshLodBuilder::logSavings(SceneManager* sceneMgr)
+{
+  size_t fullDetail, current;
+  countTriangles(sceneMgr, fullDetail, current);
+
+  LogManager::getSingleton().stream() << "MeshLodBuilder: entity triangles " << current << " at current LOD, "
+    << fullDetail << " at full detail, saved " << (fullDetail ? 100.0f * (fullDetail - current) / fullDetail : 0.0f) << "%";
+}
+
+void MeshLodBuilder::loadResource(Resource* resource)
+{
+  const String& file = mCacheFiles[resource->getName()];
+
+  std::ifstream* stream = OGRE_NEW_T(std::ifstream, MEMCATEGORY_GENERAL)(file.c_str(), std::ios::binary);
+  if (!*stream)
+  {
+    OGRE_DELETE_T(stream, basic_ifstream, MEMCATEGORY_GENERAL);
+    OGRE_EXCEPT(Exception::ERR_FILE_NOT_FOUND, "Cannot open " + file, "MeshLodBuilder::loadResource");
+  }
+
+  // the data stream owns the file stream
+  DataStreamPtr data(OGRE_NEW FileStreamDataStream(file, stream, true));
+  MeshSerializer().importMesh(data, static_cast<Mesh*>(resource));
+}
+
+String MeshLodBuilder::_getCacheFile(const String& meshName, const String& group) const
+{
+  // the key covers the settings and the size of the source mesh, so editing
+  // either one builds a new cache entry
+  String key = mSettings.strategy;
+  for (size_t i = 0; i < mSettings.levels.size(); i++)
+  {
+    key += " " + StringConverter::toString(mSettings.levels[i].first) + "/"
+      + StringConverter::toString(mSettings.levels[i].second);
+  }
+  key += " " + StringConverter::toString(ResourceGroupManager::getSingleton().openResource(meshName, group)->size());
+
+  String baseName, extension;
+  StringUtil::splitBaseFilename(meshName, baseName, extension);
+
+  std::ostringstream name;
+  name << mSettings.cacheDir << "/" << baseName << "_" << std::hex << FastHash(key.c_str(), (int)key.size()) << ".mesh";
+  return name.str();
+}
+
+LodStrategy* MeshLodBuilder::_getStrategy(void) const
+{
+  if (mSettings.strategy == "distance")
+    return LodStrategyManager::getSingleton().getDefaultStrategy();
+
+  LodStrategy* strategy = LodStrategyManager::getSingleton().getStrategy(mSettings.strategy);
+  if (!strategy)
+  {
+    LogManager::getSingleton().logMessage("MeshLodBuilder: unknown LOD strategy " + mSettings.strategy + ", using distance");
+    return LodStrategyManager::getSingleton().getDefaultStrategy();
+  }
+  return strategy;
+}
+
+void MeshLodBuilder::_logLevels(const MeshPtr& mesh, const char* source, unsigned long ms) const
+{
+  Log::Stream log = LogManager::getSingleton().stream();
+  log << "MeshLodBuilder: " << mesh->getName() << " " << source << " in " << ms << " ms, triangles per level:";
+  for (unsigned short lod = 0; lod < mesh->getNumLodLevels(); lod++)
+    log << " " << getTriangleCount(mesh, lod);
+}
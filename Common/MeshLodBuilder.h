@@ -0,0 +1,70 @@
+#pragma once
+
+#include <Ogre.h>
+
+#include <map>
+#include <vector>
+
+// Build step for meshes that ship without LOD levels (DustinBody.mesh,
+// ninja.mesh). prepare() generates reduced levels with Ogre's
+// ProgressiveMeshGenerator the first time a mesh is used and writes the
+// result to a cache directory; later runs load the cached mesh instead of
+// regenerating it. Settings come from an optional lod.cfg:
+//
+//   # distance, or any Ogre LOD strategy name (pixel_count, ...)
+//   LodStrategy=distance
+//   # one line per level: distance (pixels on screen for pixel_count) and
+//   # the share of vertices to remove
+//   LodLevel=300 0.5
+//   LodLevel=600 0.75
+//   LodLevel=1000 0.9
+//   LodCache=lodcache
+//
+// Cached meshes are reloaded through the builder, so it has to live as long
+// as the meshes do (delete it after the root).
+class MeshLodBuilder : public Ogre::ManualResourceLoader
+{
+public:
+  struct Settings
+  {
+    Ogre::String strategy;
+    std::vector<std::pair<Ogre::Real, Ogre::Real> > levels;   // value, reduction
+    Ogre::String cacheDir;
+
+    Settings();
+  };
+
+  static Settings load(const Ogre::String& fileName = "lod.cfg");
+
+  MeshLodBuilder(const Settings& settings = load());
+  ~MeshLodBuilder();
+
+  // call after the resource groups are initialised and before any entity
+  // uses the mesh; meshes that already have LOD levels are left alone. The
+  // buffer usages and shadow buffers are those of MeshManager::load(), a
+  // later load() only returns the mesh prepared here.
+  Ogre::MeshPtr prepare(const Ogre::String& meshName,
+    const Ogre::String& group = Ogre::ResourceGroupManager::AUTODETECT_RESOURCE_GROUP_NAME,
+    Ogre::HardwareBuffer::Usage vertexBufferUsage = Ogre::HardwareBuffer::HBU_STATIC_WRITE_ONLY,
+    Ogre::HardwareBuffer::Usage indexBufferUsage = Ogre::HardwareBuffer::HBU_STATIC_WRITE_ONLY,
+    bool vertexBufferShadowed = false, bool indexBufferShadowed = false);
+
+  // triangles of one LOD level of a mesh, 0 is full detail
+  static size_t getTriangleCount(const Ogre::MeshPtr& mesh, unsigned short lod);
+
+  // triangles of the entities in the scene at full detail and at the LOD
+  // they were last drawn with
+  static void countTriangles(Ogre::SceneManager* sceneMgr, size_t& fullDetail, size_t& current);
+  static void logSavings(Ogre::SceneManager* sceneMgr);
+
+  // ManualResourceLoader, reads a cached mesh
+  void loadResource(Ogre::Resource* resource);
+
+private:
+  Ogre::String _getCacheFile(const Ogre::String& meshName, const Ogre::String& group) const;
+  Ogre::LodStrategy* _getStrategy(void) const;
+  void _logLevels(const Ogre::MeshPtr& mesh, const char* source, unsigned long ms) const;
+
+  Settings mSettings;
+  std::map<Ogre::String, Ogre::String> mCacheFiles;   // mesh name -> file
+};
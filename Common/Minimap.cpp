@@ -0,0 +1,172 @@
+#include "Minimap.h"
+
+#include <OgreRectangle2D.h>
+
+using namespace Ogre;
+
+namespace
+{
+  const char* const SCHEME = "Minimap";
+}
+
+
+Minimap::Minimap(SceneManager* sceneMgr, Camera* camera, int resolution, Real interval, int maxResolution)
+  : mSceneMgr(sceneMgr), mCamera(camera), mName("Minimap/" + camera->getName()),
+  mResolution(resolution), mMaxResolution(std::max(maxResolution, 16)), mInterval(interval), mElapsed(0.0f)
+{
+  memset(&mStats, 0, sizeof(mStats));
+
+  mCamera->setAspectRatio(1.0f);
+
+  mDisplayMaterial = MaterialManager::getSingleton().create(mName + "/Display",
+    ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME);
+  Pass* pass = mDisplayMaterial->getTechnique(0)->getPass(0);
+  pass->setLightingEnabled(false);
+  pass->setDepthCheckEnabled(false);
+  pass->setDepthWriteEnabled(false);
+
+  mTexture = TextureManager::getSingleton().createManual(mName + "/Texture",
+    ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME, TEX_TYPE_2D, mMaxResolution, mMaxResolution, 0,
+    PF_R8G8B8, TU_RENDERTARGET);
+  pass->createTextureUnitState(mTexture->getName())->setTextureAddressingMode(TextureUnitState::TAM_CLAMP);
+
+  mTarget = mTexture->getBuffer()->getRenderTarget();
+  mTarget->setAutoUpdated(false);
+
+  mViewport = mTarget->addViewport(mCamera);
+  mViewport->setClearEveryFrame(true);
+  mViewport->setBackgroundColour(ColourValue(0.0f, 0.0f, 0.3f));
+  mViewport->setOverlaysEnabled(false);
+  mViewport->setSkiesEnabled(false);
+  mViewport->setShadowsEnabled(false);
+  mViewport->setMaterialScheme(SCHEME);
+  mViewport->setVisibilityMask(MAP_FLAG);
+
+  // drawn over the main view, never into the map itself
+  mDisplay = new Rectangle2D(true);
+  mDisplay->setCorners(0.58f, 0.98f, 0.98f, 0.58f);
+  mDisplay->setBoundingBox(AxisAlignedBox::BOX_INFINITE);
+  mDisplay->setRenderQueueGroup(RENDER_QUEUE_OVERLAY);
+  mDisplay->setMaterial(mDisplayMaterial->getName());
+  mDisplay->setCastShadows(false);
+  mDisplay->removeVisibilityFlags(MAP_FLAG);
+  mDisplayNode = mSceneMgr->getRootSceneNode()->createChildSceneNode(mName + "/Display");
+  mDisplayNode->attachObject(mDisplay);
+
+  mResolution = std::min(std::max(mResolution, 16), mMaxResolution);
+  _applyResolution();
+
+  MaterialManager::getSingleton().addListener(this, SCHEME);
+  Root::getSingleton().addFrameListener(this);
+}
+
+Minimap::~Minimap()
+{
+  Root::getSingleton().removeFrameListener(this);
+  MaterialManager::getSingleton().removeListener(this, SCHEME);
+
+  mDisplayNode->detachObject(mDisplay);
+  mSceneMgr->destroySceneNode(mDisplayNode);
+  delete mDisplay;
+
+  mTarget->removeAllViewports();
+  TextureManager::getSingleton().remove(mTexture->getHandle());
+
+  MaterialManager::getSingleton().remove(mDisplayMaterial->getHandle());
+  for (std::map<String, MaterialPtr>::iterator it = mFlatMaterials.begin(); it != mFlatMaterials.end(); ++it)
+    MaterialManager::getSingleton().remove(it->second->getHandle());
+}
+
+void Minimap::setResolution(int resolution)
+{
+  resolution = std::min(std::max(resolution, 16), mMaxResolution);
+  if (resolution == mResolution)
+    return;
+
+  mResolution = resolution;
+  _applyResolution();
+}
+
+void Minimap::setCorners(Real left, Real top, Real right, Real bottom)
+{
+  mDisplay->setCorners(left, top, right, bottom);
+}
+
+void Minimap::setVisible(bool visible)
+{
+  mDisplay->setVisible(visible);
+}
+
+void Minimap::logStats(void) const
+{
+  LogManager::getSingleton().stream() << "Minimap " << mCamera->getName() << ": " << mResolution << "x" << mResolution
+    << ", every " << mInterval << " s, " << mStats.updates << " updates, " << mStats.framesSkipped
+    << " frames reused the map, last update " << mStats.updateMs << " ms";
+}
+
+bool Minimap::frameStarted(const FrameEvent& evt)
+{
+  mElapsed += evt.timeSinceLastFrame;
+  if (mElapsed < mInterval || !mDisplay->getVisible())
+  {
+    mStats.framesSkipped++;
+    return true;
+  }
+
+  // a late frame does not make the next update come sooner
+  mElapsed = (mInterval > 0.0f) ? std::fmod(mElapsed, mInterval) : 0.0f;
+
+  Timer timer;
+  mTarget->update();
+  mStats.updateMs = timer.getMicroseconds() / 1000.0f;
+  mStats.updates++;
+  return true;
+}
+
+Technique* Minimap::handleSchemeNotFound(unsigned short schemeIndex, const String& schemeName,
+  Material* originalMaterial, unsigned short lodIndex, const Renderable* rend)
+{
+  if (schemeName != SCHEME)
+    return nullptr;
+
+  MaterialPtr& flat = mFlatMaterials[originalMaterial->getName()];
+  if (flat.isNull())
+  {
+    // the first pass's diffuse colour, unlit and untextured
+    ColourValue colour = ColourValue::White;
+    TrackVertexColourType tracking = TVC_NONE;
+    Technique* original = originalMaterial->getBestTechnique();
+    if (original && original->getNumPasses())
+    {
+      colour = original->getPass(0)->getDiffuse();
+      tracking = original->getPass(0)->getVertexColourTracking();
+    }
+
+    flat = MaterialManager::getSingleton().create(mName + "/" + originalMaterial->getName(),
+      ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME);
+    Technique* technique = flat->getTechnique(0);
+    technique->setSchemeName(SCHEME);
+
+    // an unlit pass ignores its surface colours and draws the vertex
+    // colour or white; the colour comes from a texture unit instead, unless
+    // the original takes it from the vertices as well
+    Pass* pass = technique->getPass(0);
+    pass->setLightingEnabled(false);
+    pass->setFog(true, FOG_NONE);
+    if (!(tracking & TVC_DIFFUSE))
+      pass->createTextureUnitState()->setColourOperationEx(LBX_SOURCE1, LBS_MANUAL, LBS_CURRENT, colour);
+    flat->load();
+  }
+  return flat->getTechnique(0);
+}
+
+void Minimap::_applyResolution(void)
+{
+  // draw into the top left corner and show only that part
+  const Real used = Real(mResolution) / mMaxResolution;
+  mViewport->setDimensions(0.0f, 0.0f, used, used);
+  mDisplay->setUVs(Vector2(0.0f, 0.0f), Vector2(0.0f, used), Vector2(used, 0.0f), Vector2(used, used));
+
+  // drawn on the next frame whatever the interval
+  mElapsed = mInterval;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <Ogre.h>
+
+#include <algorithm>
+#include <map>
+
+// Top down map drawn into a small render texture instead of a second window
+// viewport. The texture is only redrawn every interval seconds, with the
+// "Minimap" material scheme (every material replaced by a flat, unlit
+// colour), without shadows, skies or overlays, and only for objects whose
+// visibility flags include MAP_FLAG (all objects by default, take the flag
+// away from details the map does not need). A screen rectangle in the main
+// scene shows the texture.
+//
+// The texture is allocated once at maxResolution; a lower resolution only
+// draws into a corner of it, so the render target stays the same.
+class Minimap : public Ogre::FrameListener,
+  public Ogre::MaterialManager::Listener
+{
+public:
+  static const Ogre::uint32 MAP_FLAG = 0x80000000;
+
+  struct Stats
+  {
+    int updates;        // redraws of the texture
+    int framesSkipped;  // frames that reused it
+    float updateMs;     // last redraw
+  };
+
+  // the map camera should not be used by any other viewport
+  Minimap(Ogre::SceneManager* sceneMgr, Ogre::Camera* camera, int resolution = 128, Ogre::Real interval = 0.1f,
+    int maxResolution = 512);
+  ~Minimap();
+
+  // seconds between redraws, 0 redraws every frame
+  void setInterval(Ogre::Real interval) { mInterval = std::max(interval, Ogre::Real(0.0f)); }
+  Ogre::Real getInterval(void) const { return mInterval; }
+
+  // width and height drawn, 16 to maxResolution
+  void setResolution(int resolution);
+  int getResolution(void) const { return mResolution; }
+
+  // where the map is shown, in -1..1 screen coordinates
+  void setCorners(Ogre::Real left, Ogre::Real top, Ogre::Real right, Ogre::Real bottom);
+  void setVisible(bool visible);
+
+  Ogre::RenderTarget* getRenderTarget(void) const { return mTarget; }
+  Ogre::Viewport* getViewport(void) const { return mViewport; }
+
+  const Stats& getStats(void) const { return mStats; }
+  void logStats(void) const;
+
+  // FrameListener
+  bool frameStarted(const Ogre::FrameEvent& evt);
+
+  // MaterialManager::Listener, called for the "Minimap" scheme only
+  Ogre::Technique* handleSchemeNotFound(unsigned short schemeIndex, const Ogre::String& schemeName,
+    Ogre::Material* originalMaterial, unsigned short lodIndex, const Ogre::Renderable* rend);
+
+private:
+  void _applyResolution(void);
+
+  Ogre::SceneManager* mSceneMgr;
+  Ogre::Camera* mCamera;
+  Ogre::String mName;
+
+  int mResolution;
+  int mMaxResolution;
+  Ogre::Real mInterval;
+  Ogre::Real mElapsed;
+
+  Ogre::TexturePtr mTexture;
+  Ogre::RenderTarget* mTarget;
+  Ogre::Viewport* mViewport;
+
+  Ogre::MaterialPtr mDisplayMaterial;
+  Ogre::Rectangle2D* mDisplay;
+  Ogre::SceneNode* mDisplayNode;
+
+  std::map<Ogre::String, Ogre::MaterialPtr> mFlatMaterials;   // by original material
+
+  Stats mStats;
+};
@@ -0,0 +1,116 @@
+#include "ObjectListeners.h"
+
+#include <algorithm>
+
+using namespace Ogre;
+
+
+ObjectListeners& ObjectListeners::_getInstance(void)
+{
+  static ObjectListeners instance;
+  return instance;
+}
+
+void ObjectListeners::add(MovableObject* object, MovableObject::Listener* listener)
+{
+  ObjectListeners& instance = _getInstance();
+  ListenerMap::iterator it = instance.mListeners.find(object);
+  if (it == instance.mListeners.end())
+  {
+    it = instance.mListeners.insert(std::make_pair(object, ListenerList())).first;
+    if (object->getListener() && object->getListener() != &instance)
+      it->second.push_back(object->getListener());
+    object->setListener(&instance);
+  }
+
+  ListenerList& listeners = it->second;
+  if (std::find(listeners.begin(), listeners.end(), listener) == listeners.end())
+    listeners.push_back(listener);
+}
+
+void ObjectListeners::remove(MovableObject* object, MovableObject::Listener* listener)
+{
+  ObjectListeners& instance = _getInstance();
+  ListenerMap::iterator it = instance.mListeners.find(object);
+  if (it == instance.mListeners.end())
+    return;
+
+  ListenerList& listeners = it->second;
+  listeners.erase(std::remove(listeners.begin(), listeners.end(), listener), listeners.end());
+  if (!listeners.empty())
+    return;
+
+  instance.mListeners.erase(it);
+  if (object->getListener() == &instance)
+    object->setListener(nullptr);
+}
+
+void ObjectListeners::objectDestroyed(MovableObject* object)
+{
+  ListenerMap::iterator it = mListeners.find(object);
+  if (it == mListeners.end())
+    return;
+
+  // taken out first, the listeners may remove themselves while called
+  const ListenerList listeners = it->second;
+  mListeners.erase(it);
+  for (size_t i = 0; i < listeners.size(); i++)
+    listeners[i]->objectDestroyed(object);
+}
+
+void ObjectListeners::objectAttached(MovableObject* object)
+{
+  if (const ListenerList* listeners = _find(object))
+  {
+    for (size_t i = 0; i < listeners->size(); i++)
+      (*listeners)[i]->objectAttached(object);
+  }
+}
+
+void ObjectListeners::objectDetached(MovableObject* object)
+{
+  if (const ListenerList* listeners = _find(object))
+  {
+    for (size_t i = 0; i < listeners->size(); i++)
+      (*listeners)[i]->objectDetached(object);
+  }
+}
+
+void ObjectListeners::objectMoved(MovableObject* object)
+{
+  if (const ListenerList* listeners = _find(object))
+  {
+    for (size_t i = 0; i < listeners->size(); i++)
+      (*listeners)[i]->objectMoved(object);
+  }
+}
+
+bool ObjectListeners::objectRendering(const MovableObject* object, const Camera* camera)
+{
+  bool render = true;
+  if (const ListenerList* listeners = _find(object))
+  {
+    for (size_t i = 0; i < listeners->size(); i++)
+      render = (*listeners)[i]->objectRendering(object, camera) && render;
+  }
+  return render;
+}
+
+const LightList* ObjectListeners::objectQueryLights(const MovableObject* object)
+{
+  if (const ListenerList* listeners = _find(object))
+  {
+    for (size_t i = 0; i < listeners->size(); i++)
+    {
+      if (const LightList* lights = (*listeners)[i]->objectQueryLights(object))
+        return lights;
+    }
+  }
+  return nullptr;
+}
+
+const ObjectListeners::ListenerList* ObjectListeners::_find(const MovableObject* object) const
+{
+  ListenerMap::const_iterator it = mListeners.find(object);
+  return it != mListeners.end() ? &it->second : nullptr;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <Ogre.h>
+
+#include <unordered_map>
+#include <vector>
+
+// The one MovableObject::Listener of objects that several modules want to
+// hear from. Ogre keeps a single listener per object, so modules add theirs
+// here instead of calling setListener() and are called in the order they
+// were added. A listener the object already had is kept as the first.
+//
+//   objectRendering    the object is drawn only if every listener agrees
+//   objectQueryLights  the first list a listener returns is used
+class ObjectListeners : public Ogre::MovableObject::Listener
+{
+public:
+  static void add(Ogre::MovableObject* object, Ogre::MovableObject::Listener* listener);
+  // the object gets back no listener once the last one is removed
+  static void remove(Ogre::MovableObject* object, Ogre::MovableObject::Listener* listener);
+
+  // MovableObject::Listener
+  void objectDestroyed(Ogre::MovableObject* object);
+  void objectAttached(Ogre::MovableObject* object);
+  void objectDetached(Ogre::MovableObject* object);
+  void objectMoved(Ogre::MovableObject* object);
+  bool objectRendering(const Ogre::MovableObject* object, const Ogre::Camera* camera);
+  const Ogre::LightList* objectQueryLights(const Ogre::MovableObject* object);
+
+private:
+  typedef std::vector<Ogre::MovableObject::Listener*> ListenerList;
+  typedef std::unordered_map<const Ogre::MovableObject*, ListenerList> ListenerMap;
+
+  static ObjectListeners& _getInstance(void);
+  const ListenerList* _find(const Ogre::MovableObject* object) const;
+
+  ListenerMap mListeners;
+};
@@ -0,0 +1,332 @@
+#include "OcclusionBuffer.h"
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+#if defined(_M_X64) || defined(_M_AMD64) || defined(__SSE2__)
+#define OCCLUSION_BUFFER_SSE
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+  // clip space w below this is treated as behind the eye
+  const float NEAR_W = 0.001f;
+
+  inline void transform(const float* m, float x, float y, float z, float* out)
+  {
+    out[0] = m[0] * x + m[1] * y + m[2] * z + m[3];
+    out[1] = m[4] * x + m[5] * y + m[6] * z + m[7];
+    out[2] = m[8] * x + m[9] * y + m[10] * z + m[11];
+    out[3] = m[12] * x + m[13] * y + m[14] * z + m[15];
+  }
+
+  inline void multiply(const float* a, const float* b, float* out)
+  {
+    for (int row = 0; row < 4; row++)
+    {
+      for (int col = 0; col < 4; col++)
+      {
+        out[row * 4 + col] = a[row * 4] * b[col] + a[row * 4 + 1] * b[4 + col]
+          + a[row * 4 + 2] * b[8 + col] + a[row * 4 + 3] * b[12 + col];
+      }
+    }
+  }
+
+  inline void lerpClip(const float* a, const float* b, float t, float* out)
+  {
+    for (int i = 0; i < 4; i++)
+      out[i] = a[i] + (b[i] - a[i]) * t;
+  }
+
+  // edge function E(p) = a * px + b * py + c, positive inside for
+  // triangles with positive area
+  struct Edge
+  {
+    float a, b, c;
+  };
+
+  inline Edge makeEdge(float x0, float y0, float x1, float y1)
+  {
+    Edge edge;
+    edge.a = y0 - y1;
+    edge.b = x1 - x0;
+    edge.c = -(edge.a * x0 + edge.b * y0);
+    return edge;
+  }
+}
+
+
+OcclusionBuffer::OcclusionBuffer(int width, int height)
+  : mWidth(0), mHeight(0), mUseSimd(hasSimd())
+{
+  memset(mViewProj, 0, sizeof(mViewProj));
+  memset(&mStats, 0, sizeof(mStats));
+  resize(width, height);
+}
+
+void OcclusionBuffer::resize(int width, int height)
+{
+  mWidth = std::max(4, (width + 3) & ~3);
+  mHeight = std::max(1, height);
+  mDepth.assign(mWidth * mHeight, 0.0f);
+}
+
+bool OcclusionBuffer::hasSimd(void)
+{
+#ifdef OCCLUSION_BUFFER_SSE
+  return true;
+#else
+  return false;
+#endif
+}
+
+void OcclusionBuffer::clear(const float viewProj[16])
+{
+  memcpy(mViewProj, viewProj, sizeof(mViewProj));
+  std::fill(mDepth.begin(), mDepth.end(), 0.0f);
+  memset(&mStats, 0, sizeof(mStats));
+}
+
+void OcclusionBuffer::rasterize(const float* positions, int vertexCount, const uint32_t* indices, int triangleCount,
+  const float* world)
+{
+  float matrix[16];
+  if (world)
+    multiply(mViewProj, world, matrix);
+  else
+    memcpy(matrix, mViewProj, sizeof(matrix));
+
+  mClip.resize(vertexCount * 4);
+  for (int i = 0; i < vertexCount; i++)
+    transform(matrix, positions[i * 3], positions[i * 3 + 1], positions[i * 3 + 2], &mClip[i * 4]);
+
+  for (int i = 0; i < triangleCount; i++)
+  {
+    const float* a = &mClip[indices[i * 3] * 4];
+    const float* b = &mClip[indices[i * 3 + 1] * 4];
+    const float* c = &mClip[indices[i * 3 + 2] * 4];
+    _rasterizeClipped(a, b, c);
+  }
+}
+
+void OcclusionBuffer::_rasterizeClipped(const float* a, const float* b, const float* c)
+{
+  const float* in[3] = { a, b, c };
+  int behind = 0;
+  for (int i = 0; i < 3; i++)
+  {
+    if (in[i][3] < NEAR_W)
+      behind++;
+  }
+
+  if (behind == 3)
+  {
+    mStats.trianglesSkipped++;
+    return;
+  }
+
+  ScreenVertex screen[4];
+  int count = 0;
+
+  if (behind == 0)
+  {
+    for (int i = 0; i < 3; i++)
+      _toScreen(in[i], screen[count++]);
+  }
+  else
+  {
+    // Sutherland-Hodgman against w = NEAR_W, gives 3 or 4 vertices
+    for (int i = 0; i < 3; i++)
+    {
+      const float* current = in[i];
+      const float* next = in[(i + 1) % 3];
+      const bool currentInside = current[3] >= NEAR_W;
+      const bool nextInside = next[3] >= NEAR_W;
+
+      if (currentInside)
+        _toScreen(current, screen[count++]);
+      if (currentInside != nextInside)
+      {
+        float clipped[4];
+        lerpClip(current, next, (NEAR_W - current[3]) / (next[3] - current[3]), clipped);
+        _toScreen(clipped, screen[count++]);
+      }
+    }
+  }
+
+  _rasterizeScreen(screen[0], screen[1], screen[2]);
+  if (count == 4)
+    _rasterizeScreen(screen[0], screen[2], screen[3]);
+}
+
+void OcclusionBuffer::_toScreen(const float* clip, ScreenVertex& out) const
+{
+  out.iw = 1.0f / clip[3];
+  out.x = (clip[0] * out.iw * 0.5f + 0.5f) * mWidth;
+  out.y = (0.5f - clip[1] * out.iw * 0.5f) * mHeight;
+}
+
+void OcclusionBuffer::_rasterizeScreen(const ScreenVertex& v0, const ScreenVertex& v1, const ScreenVertex& v2)
+{
+  const ScreenVertex* a = &v0;
+  const ScreenVertex* b = &v1;
+  const ScreenVertex* c = &v2;
+
+  float area = (b->x - a->x) * (c->y - a->y) - (b->y - a->y) * (c->x - a->x);
+  if (area < 0.0f)
+  {
+    std::swap(b, c);
+    area = -area;
+  }
+
+  const int minX = std::max(0, (int)std::floor(std::min(a->x, std::min(b->x, c->x))));
+  const int maxX = std::min(mWidth - 1, (int)std::ceil(std::max(a->x, std::max(b->x, c->x))));
+  const int minY = std::max(0, (int)std::floor(std::min(a->y, std::min(b->y, c->y))));
+  const int maxY = std::min(mHeight - 1, (int)std::ceil(std::max(a->y, std::max(b->y, c->y))));
+
+  if (area < 1e-6f || minX > maxX || minY > maxY)
+  {
+    mStats.trianglesSkipped++;
+    return;
+  }
+  mStats.trianglesRasterized++;
+
+  const Edge e0 = makeEdge(b->x, b->y, c->x, c->y);   // weight of a
+  const Edge e1 = makeEdge(c->x, c->y, a->x, a->y);   // weight of b
+  const Edge e2 = makeEdge(a->x, a->y, b->x, b->y);   // weight of c
+
+  // 1/w as a plane over the screen
+  const float inverseArea = 1.0f / area;
+  const float za = (e0.a * a->iw + e1.a * b->iw + e2.a * c->iw) * inverseArea;
+  const float zb = (e0.b * a->iw + e1.b * b->iw + e2.b * c->iw) * inverseArea;
+  const float zc = (e0.c * a->iw + e1.c * b->iw + e2.c * c->iw) * inverseArea;
+
+#ifdef OCCLUSION_BUFFER_SSE
+  if (mUseSimd)
+  {
+    // 4 pixel groups start on a multiple of 4 so a group never leaves the row
+    const int startX = minX & ~3;
+    const __m128 offsets = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+    const __m128 e0a = _mm_set1_ps(e0.a), e1a = _mm_set1_ps(e1.a), e2a = _mm_set1_ps(e2.a);
+    const __m128 e0Step = _mm_set1_ps(e0.a * 4.0f), e1Step = _mm_set1_ps(e1.a * 4.0f), e2Step = _mm_set1_ps(e2.a * 4.0f);
+    const __m128 zStep = _mm_set1_ps(za * 4.0f);
+    const __m128 zero = _mm_setzero_ps();
+
+    for (int y = minY; y <= maxY; y++)
+    {
+      const float py = y + 0.5f;
+      const __m128 px = _mm_add_ps(_mm_set1_ps((float)startX), offsets);
+
+      __m128 w0 = _mm_add_ps(_mm_mul_ps(e0a, px), _mm_set1_ps(e0.b * py + e0.c));
+      __m128 w1 = _mm_add_ps(_mm_mul_ps(e1a, px), _mm_set1_ps(e1.b * py + e1.c));
+      __m128 w2 = _mm_add_ps(_mm_mul_ps(e2a, px), _mm_set1_ps(e2.b * py + e2.c));
+      __m128 z = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(za), px), _mm_set1_ps(zb * py + zc));
+
+      float* row = &mDepth[y * mWidth];
+      for (int x = startX; x <= maxX; x += 4)
+      {
+        const __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(w0, zero), _mm_cmpge_ps(w1, zero)),
+          _mm_cmpge_ps(w2, zero));
+        if (_mm_movemask_ps(inside))
+        {
+          const __m128 current = _mm_loadu_ps(row + x);
+          const __m128 nearest = _mm_max_ps(current, z);
+          _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, current)));
+        }
+
+        w0 = _mm_add_ps(w0, e0Step);
+        w1 = _mm_add_ps(w1, e1Step);
+        w2 = _mm_add_ps(w2, e2Step);
+        z = _mm_add_ps(z, zStep);
+      }
+    }
+    return;
+  }
+#endif
+
+  for (int y = minY; y <= maxY; y++)
+  {
+    const float py = y + 0.5f;
+    float* row = &mDepth[y * mWidth];
+    for (int x = minX; x <= maxX; x++)
+    {
+      const float px = x + 0.5f;
+      if (e0.a * px + e0.b * py + e0.c >= 0.0f && e1.a * px + e1.b * py + e1.c >= 0.0f
+        && e2.a * px + e2.b * py + e2.c >= 0.0f)
+      {
+        row[x] = std::max(row[x], za * px + zb * py + zc);
+      }
+    }
+  }
+}
+
+bool OcclusionBuffer::isVisible(float minX, float minY, float minZ, float maxX, float maxY, float maxZ)
+{
+  mStats.boxesTested++;
+
+  float left = 1e30f, right = -1e30f, top = 1e30f, bottom = -1e30f;
+  float nearest = 0.0f;
+  for (int i = 0; i < 8; i++)
+  {
+    float clip[4];
+    transform(mViewProj, (i & 1) ? maxX : minX, (i & 2) ? maxY : minY, (i & 4) ? maxZ : minZ, clip);
+    if (clip[3] < NEAR_W)
+      return true;
+
+    ScreenVertex screen;
+    _toScreen(clip, screen);
+    left = std::min(left, screen.x);
+    right = std::max(right, screen.x);
+    top = std::min(top, screen.y);
+    bottom = std::max(bottom, screen.y);
+    nearest = std::max(nearest, screen.iw);
+  }
+
+  // one pixel of margin for occluder edges that only cover part of a pixel
+  const int x0 = std::max(0, (int)std::floor(left) - 1);
+  const int x1 = std::min(mWidth - 1, (int)std::ceil(right) + 1);
+  const int y0 = std::max(0, (int)std::floor(top) - 1);
+  const int y1 = std::min(mHeight - 1, (int)std::ceil(bottom) + 1);
+  if (x0 > x1 || y0 > y1)
+    return true;   // off screen, that is the frustum test's business
+
+#ifdef OCCLUSION_BUFFER_SSE
+  if (mUseSimd)
+  {
+    const __m128 limit = _mm_set1_ps(nearest);
+    const __m128 lanes = _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f);
+    const __m128 first = _mm_set1_ps((float)x0 - 0.5f), last = _mm_set1_ps((float)x1 + 0.5f);
+    const int startX = x0 & ~3;
+
+    for (int y = y0; y <= y1; y++)
+    {
+      const float* row = &mDepth[y * mWidth];
+      for (int x = startX; x <= x1; x += 4)
+      {
+        const __m128 px = _mm_add_ps(_mm_set1_ps((float)x), lanes);
+        const __m128 inRect = _mm_and_ps(_mm_cmpgt_ps(px, first), _mm_cmplt_ps(px, last));
+        if (_mm_movemask_ps(_mm_and_ps(inRect, _mm_cmple_ps(_mm_loadu_ps(row + x), limit))))
+          return true;
+      }
+    }
+
+    mStats.boxesOccluded++;
+    return false;
+  }
+#endif
+
+  for (int y = y0; y <= y1; y++)
+  {
+    const float* row = &mDepth[y * mWidth];
+    for (int x = x0; x <= x1; x++)
+    {
+      if (row[x] <= nearest)
+        return true;
+    }
+  }
+
+  mStats.boxesOccluded++;
+  return false;
+}
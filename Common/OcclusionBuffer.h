@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Small software depth buffer for occlusion culling. Occluder triangles
+// are rasterised into it every frame, then object bounds are tested
+// against it: a box is occluded when every pixel it covers already holds
+// an occluder nearer than the nearest point of the box.
+//
+// The buffer stores 1/w (larger is nearer, 0 is empty) because it
+// interpolates linearly in screen space. Rows are filled 4 pixels at a
+// time with SSE2 where available. Tests are conservative, boxes are grown
+// by a pixel and anything crossing the near plane counts as visible.
+//
+// Matrices are 4x4 row major with column vectors, the same layout as
+// Ogre::Matrix4, so Matrix4[0] can be passed directly.
+class OcclusionBuffer
+{
+public:
+  struct Stats
+  {
+    int trianglesRasterized;
+    int trianglesSkipped;   // behind the eye, off screen or degenerate
+    int boxesTested;
+    int boxesOccluded;
+  };
+
+  OcclusionBuffer(int width = 256, int height = 128);
+
+  // the width is rounded up to a multiple of 4
+  void resize(int width, int height);
+  int getWidth(void) const { return mWidth; }
+  int getHeight(void) const { return mHeight; }
+
+  static bool hasSimd(void);
+  void setUseSimd(bool use) { mUseSimd = use && hasSimd(); }
+  bool getUseSimd(void) const { return mUseSimd; }
+
+  // starts a frame: empties the buffer and resets the stats
+  void clear(const float viewProj[16]);
+
+  // positions are xyz triplets, indices three per triangle. world may be
+  // null for positions already in world space. Both windings are drawn.
+  void rasterize(const float* positions, int vertexCount, const uint32_t* indices, int triangleCount,
+    const float* world = nullptr);
+
+  // world space box
+  bool isVisible(float minX, float minY, float minZ, float maxX, float maxY, float maxZ);
+
+  const Stats& getStats(void) const { return mStats; }
+  const float* getDepth(void) const { return &mDepth[0]; }
+
+private:
+  struct ScreenVertex
+  {
+    float x, y;   // pixels, y down
+    float iw;     // 1/w
+  };
+
+  void _rasterizeClipped(const float* a, const float* b, const float* c);
+  void _rasterizeScreen(const ScreenVertex& a, const ScreenVertex& b, const ScreenVertex& c);
+  void _toScreen(const float* clip, ScreenVertex& out) const;
+
+  int mWidth, mHeight;
+  std::vector<float> mDepth;
+  bool mUseSimd;
+
+  float mViewProj[16];
+  std::vector<float> mClip;   // clip space vertices of the occluder being drawn
+
+  Stats mStats;
+};
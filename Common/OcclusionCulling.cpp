@@ -0,0 +1,203 @@
+#include "OcclusionCulling.h"
+
+using namespace Ogre;
+
+namespace
+{
+  void toFloats(const Matrix4& matrix, float* out)
+  {
+    for (int row = 0; row < 4; row++)
+    {
+      for (int col = 0; col < 4; col++)
+        out[row * 4 + col] = (float)matrix[row][col];
+    }
+  }
+}
+
+
+OcclusionCulling::OcclusionCulling(SceneManager* sceneMgr, int width, int height)
+  : mSceneMgr(sceneMgr), mBuffer(width, height), mEnabled(true), mActive(false)
+{
+  memset(&mStats, 0, sizeof(mStats));
+
+  mSceneMgr->addListener(this);
+  mSceneMgr->getRenderQueue()->setRenderableListener(this);
+}
+
+OcclusionCulling::~OcclusionCulling()
+{
+  RenderQueue* queue = mSceneMgr->getRenderQueue();
+  if (queue->getRenderableListener() == this)
+    queue->setRenderableListener(nullptr);
+  mSceneMgr->removeListener(this);
+}
+
+void OcclusionCulling::addOccluder(Entity* entity)
+{
+  if (_isOccluder(entity))
+    return;
+
+  Occluder occluder;
+  occluder.entity = entity;
+  _readMesh(entity->getMesh(), occluder);
+  mOccluders.push_back(occluder);
+
+  mStats.occluders = (int)mOccluders.size();
+  mStats.occluderTriangles += (int)occluder.indices.size() / 3;
+}
+
+void OcclusionCulling::clearOccluders(void)
+{
+  mOccluders.clear();
+  mStats.occluders = mStats.occluderTriangles = 0;
+}
+
+void OcclusionCulling::logStats(void) const
+{
+  LogManager::getSingleton().stream() << "OcclusionCulling: " << mStats.occluders << " occluders ("
+    << mStats.occluderTriangles << " triangles), raster " << mStats.rasterMs << " ms, test " << mStats.testMs
+    << " ms, " << mStats.objectsOccluded << " of " << mStats.objectsTested << " objects occluded, saved "
+    << mStats.renderablesSkipped << " batches and " << mStats.trianglesSkipped << " triangles";
+}
+
+void OcclusionCulling::preFindVisibleObjects(SceneManager* source, SceneManager::IlluminationRenderStage irs, Viewport* v)
+{
+  mActive = mEnabled && irs != SceneManager::IRS_RENDER_TO_TEXTURE;
+  if (!mActive)
+    return;
+
+  mStats.objectsTested = mStats.objectsOccluded = 0;
+  mStats.renderablesSkipped = mStats.trianglesSkipped = 0;
+  mStats.testMs = 0.0f;
+  mResults.clear();
+
+  mTimer.reset();
+
+  Camera* camera = v->getCamera();
+  float viewProj[16];
+  toFloats(camera->getProjectionMatrix() * camera->getViewMatrix(true), viewProj);
+  mBuffer.clear(viewProj);
+
+  for (size_t i = 0; i < mOccluders.size(); i++)
+  {
+    const Occluder& occluder = mOccluders[i];
+    mResults[occluder.entity] = true;   // never tested
+    if (!occluder.entity->isInScene() || !occluder.entity->getVisible() || occluder.indices.empty())
+      continue;
+
+    float world[16];
+    toFloats(occluder.entity->getParentNode()->_getFullTransform(), world);
+    mBuffer.rasterize(&occluder.positions[0], (int)occluder.positions.size() / 3,
+      &occluder.indices[0], (int)occluder.indices.size() / 3, world);
+  }
+
+  mStats.rasterMs = mTimer.getMicroseconds() / 1000.0f;
+}
+
+void OcclusionCulling::postFindVisibleObjects(SceneManager* source, SceneManager::IlluminationRenderStage irs, Viewport* v)
+{
+  mActive = false;
+}
+
+bool OcclusionCulling::renderableQueued(Renderable* rend, uint8 groupID, ushort priority,
+  Technique** ppTech, RenderQueue* pQueue)
+{
+  if (!mActive)
+    return true;
+
+  // only entities are tested, per entity once per search
+  SubEntity* subEntity = dynamic_cast<SubEntity*>(rend);
+  if (!subEntity)
+    return true;
+
+  Entity* entity = subEntity->getParent();
+  std::unordered_map<const Entity*, bool>::iterator it = mResults.find(entity);
+  if (it == mResults.end())
+  {
+    mTimer.reset();
+    const AxisAlignedBox& box = entity->getWorldBoundingBox(true);
+    const bool visible = box.isInfinite() || box.isNull() || mBuffer.isVisible(box.getMinimum().x, box.getMinimum().y,
+      box.getMinimum().z, box.getMaximum().x, box.getMaximum().y, box.getMaximum().z);
+    mStats.testMs += mTimer.getMicroseconds() / 1000.0f;
+
+    mStats.objectsTested++;
+    if (!visible)
+      mStats.objectsOccluded++;
+    it = mResults.insert(std::make_pair(entity, visible)).first;
+  }
+
+  if (it->second)
+    return true;
+
+  RenderOperation op;
+  rend->getRenderOperation(op);
+  mStats.renderablesSkipped++;
+  mStats.trianglesSkipped += (int)((op.useIndexes ? op.indexData->indexCount : op.vertexData->vertexCount) / 3);
+  return false;
+}
+
+void OcclusionCulling::_readMesh(const MeshPtr& mesh, Occluder& occluder)
+{
+  // shared vertices are read once, each sub mesh with its own vertex data appends its own
+  bool sharedAdded = false;
+  size_t sharedOffset = 0;
+
+  for (unsigned short i = 0; i < mesh->getNumSubMeshes(); i++)
+  {
+    SubMesh* subMesh = mesh->getSubMesh(i);
+    if (subMesh->operationType != RenderOperation::OT_TRIANGLE_LIST || !subMesh->indexData->indexCount)
+      continue;
+
+    VertexData* vertexData = subMesh->useSharedVertices ? mesh->sharedVertexData : subMesh->vertexData;
+    size_t offset = occluder.positions.size() / 3;
+
+    if (!subMesh->useSharedVertices || !sharedAdded)
+    {
+      const VertexElement* element = vertexData->vertexDeclaration->findElementBySemantic(VES_POSITION);
+      HardwareVertexBufferSharedPtr buffer = vertexData->vertexBufferBinding->getBuffer(element->getSource());
+
+      unsigned char* vertex = static_cast<unsigned char*>(buffer->lock(HardwareBuffer::HBL_READ_ONLY));
+      vertex += vertexData->vertexStart * buffer->getVertexSize();
+      for (size_t j = 0; j < vertexData->vertexCount; j++, vertex += buffer->getVertexSize())
+      {
+        float* position;
+        element->baseVertexPointerToElement(vertex, &position);
+        occluder.positions.insert(occluder.positions.end(), position, position + 3);
+      }
+      buffer->unlock();
+
+      if (subMesh->useSharedVertices)
+      {
+        sharedAdded = true;
+        sharedOffset = offset;
+      }
+    }
+    else
+    {
+      offset = sharedOffset;
+    }
+
+    IndexData* indexData = subMesh->indexData;
+    HardwareIndexBufferSharedPtr buffer = indexData->indexBuffer;
+    const bool use32 = buffer->getType() == HardwareIndexBuffer::IT_32BIT;
+
+    void* indices = buffer->lock(HardwareBuffer::HBL_READ_ONLY);
+    for (size_t j = 0; j < indexData->indexCount; j++)
+    {
+      const size_t index = indexData->indexStart + j;
+      const uint32_t value = use32 ? static_cast<uint32*>(indices)[index] : static_cast<uint16*>(indices)[index];
+      occluder.indices.push_back((uint32_t)offset + value);
+    }
+    buffer->unlock();
+  }
+}
+
+bool OcclusionCulling::_isOccluder(const Entity* entity) const
+{
+  for (size_t i = 0; i < mOccluders.size(); i++)
+  {
+    if (mOccluders[i].entity == entity)
+      return true;
+  }
+  return false;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <Ogre.h>
+
+#include <unordered_map>
+#include <vector>
+
+#include "OcclusionBuffer.h"
+
+// Optional occlusion stage for a scene manager. Before the visible objects
+// of a viewport are searched, the designated occluders (ground, walls,
+// large static props) are rasterised into a small OcclusionBuffer. While
+// the search runs, every entity that tries to enter the render queue is
+// tested with its world bounds; occluded entities never get queued.
+//
+// The test hooks into the render queue as its renderable listener, so it
+// works with every scene manager type. Shadow texture passes are left
+// alone. Occluders themselves are never tested.
+//
+// Only the CullingBenchmark lab turns it on, with its walls as occluders.
+// The other labs are characters on a flat ground, which hides nothing
+// standing on it; in Lab14 and Lab15 that ground is baked into
+// StaticGeometry tiles, which are not entities and cannot be added here.
+class OcclusionCulling : public Ogre::SceneManager::Listener,
+  public Ogre::RenderQueue::RenderableListener
+{
+public:
+  struct Stats
+  {
+    int occluders;
+    int occluderTriangles;
+    float rasterMs;
+    float testMs;
+    int objectsTested;
+    int objectsOccluded;
+    int renderablesSkipped;   // savings: batches not queued
+    int trianglesSkipped;     // savings: triangles not queued
+  };
+
+  OcclusionCulling(Ogre::SceneManager* sceneMgr, int width = 256, int height = 128);
+  ~OcclusionCulling();
+
+  // reads the entity's mesh once, its node's transform is picked up every frame
+  void addOccluder(Ogre::Entity* entity);
+  void clearOccluders(void);
+
+  void setEnabled(bool enabled) { mEnabled = enabled; }
+  bool isEnabled(void) const { return mEnabled; }
+
+  // stats of the last visible object search
+  const Stats& getStats(void) const { return mStats; }
+  void logStats(void) const;
+
+  OcclusionBuffer& getBuffer(void) { return mBuffer; }
+
+  // SceneManager::Listener
+  void preFindVisibleObjects(Ogre::SceneManager* source, Ogre::SceneManager::IlluminationRenderStage irs, Ogre::Viewport* v);
+  void postFindVisibleObjects(Ogre::SceneManager* source, Ogre::SceneManager::IlluminationRenderStage irs, Ogre::Viewport* v);
+
+  // RenderQueue::RenderableListener
+  bool renderableQueued(Ogre::Renderable* rend, Ogre::uint8 groupID, Ogre::ushort priority,
+    Ogre::Technique** ppTech, Ogre::RenderQueue* pQueue);
+
+private:
+  struct Occluder
+  {
+    Ogre::Entity* entity;
+    std::vector<float> positions;
+    std::vector<uint32_t> indices;
+  };
+
+  static void _readMesh(const Ogre::MeshPtr& mesh, Occluder& occluder);
+  bool _isOccluder(const Ogre::Entity* entity) const;
+
+  Ogre::SceneManager* mSceneMgr;
+  OcclusionBuffer mBuffer;
+  std::vector<Occluder> mOccluders;
+  bool mEnabled;
+
+  // valid between pre and post find visible objects
+  bool mActive;
+  std::unordered_map<const Ogre::Entity*, bool> mResults;
+  Ogre::Timer mTimer;
+
+  Stats mStats;
+};
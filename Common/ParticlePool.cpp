@@ -0,0 +1,402 @@
+#include "ParticlePool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#if defined(_M_X64) || defined(_M_AMD64) || defined(__SSE2__)
+#define PARTICLE_POOL_SSE
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+  typedef std::chrono::high_resolution_clock Clock;
+
+  double millisecondsSince(const Clock::time_point& start)
+  {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+  }
+
+  uint32_t packColour(float r, float g, float b, float a, bool swapRedBlue)
+  {
+    const uint32_t red = (uint32_t)(std::min(std::max(r, 0.0f), 1.0f) * 255.0f + 0.5f);
+    const uint32_t green = (uint32_t)(std::min(std::max(g, 0.0f), 1.0f) * 255.0f + 0.5f);
+    const uint32_t blue = (uint32_t)(std::min(std::max(b, 0.0f), 1.0f) * 255.0f + 0.5f);
+    const uint32_t alpha = (uint32_t)(std::min(std::max(a, 0.0f), 1.0f) * 255.0f + 0.5f);
+    return swapRedBlue ? (blue | green << 8 | red << 16 | alpha << 24) : (red | green << 8 | blue << 16 | alpha << 24);
+  }
+
+  // texture coordinates of the corners, counter clockwise from the bottom left
+  const float CORNER_UV[4][2] = { { 0.0f, 1.0f }, { 1.0f, 1.0f }, { 1.0f, 0.0f }, { 0.0f, 0.0f } };
+}
+
+
+ParticlePool::Emitter::Emitter()
+  : rate(100.0f), lifeMin(1.0f), lifeMax(2.0f), speedMin(50.0f), speedMax(100.0f), angle(0.5f),
+    sizeStart(5.0f), sizeEnd(5.0f), enabled(true)
+{
+  for (int i = 0; i < 4; i++)
+    colourStart[i] = colourEnd[i] = 1.0f;
+  colourEnd[3] = 0.0f;
+  for (int i = 0; i < 3; i++)
+    position[i] = direction[i] = box[i] = 0.0f;
+  direction[1] = 1.0f;
+}
+
+
+ParticlePool::ParticlePool(int capacity, uint64_t seed)
+  : mCapacity(capacity), mSize(0), mRandom(seed), mDrag(0.0f), mSimd(hasSimd())
+{
+  memset(&mStats, 0, sizeof(mStats));
+  for (int i = 0; i < 3; i++)
+  {
+    mGravity[i] = 0.0f;
+    mBoundsMin[i] = mBoundsMax[i] = 0.0f;
+    mPosition[i].resize(capacity);
+    mVelocity[i].resize(capacity);
+  }
+  mAge.resize(capacity);
+  mInverseLife.resize(capacity);
+  mSize0.resize(capacity);
+  mSizeDelta.resize(capacity);
+  for (int i = 0; i < 4; i++)
+  {
+    mColour0[i].resize(capacity);
+    mColourDelta[i].resize(capacity);
+  }
+}
+
+bool ParticlePool::hasSimd(void)
+{
+#ifdef PARTICLE_POOL_SSE
+  return true;
+#else
+  return false;
+#endif
+}
+
+int ParticlePool::addEmitter(const Emitter& emitter)
+{
+  mEmitters.push_back(emitter);
+  mPending.push_back(0.0f);
+  return (int)mEmitters.size() - 1;
+}
+
+void ParticlePool::setGravity(float x, float y, float z)
+{
+  mGravity[0] = x;
+  mGravity[1] = y;
+  mGravity[2] = z;
+}
+
+void ParticlePool::update(float dt)
+{
+  mStats.emitted = mStats.died = mStats.dropped = 0;
+
+  Clock::time_point start = Clock::now();
+  for (size_t i = 0; i < mEmitters.size(); i++)
+  {
+    if (!mEmitters[i].enabled)
+      continue;
+    mPending[i] += mEmitters[i].rate * dt;
+    const int count = (int)mPending[i];
+    mPending[i] -= count;
+    _emit(mEmitters[i], count);
+  }
+  mStats.emitMs = millisecondsSince(start);
+
+  start = Clock::now();
+  for (int i = 0; i < 3; i++)
+  {
+    mBoundsMin[i] = std::numeric_limits<float>::max();
+    mBoundsMax[i] = -std::numeric_limits<float>::max();
+  }
+
+  const int simdEnd = mSimd ? (mSize & ~3) : 0;
+  if (simdEnd > 0)
+    _integrate4(0, simdEnd, dt);
+  _integrate(simdEnd, mSize, dt);
+  _removeDead();
+
+  if (mSize == 0)
+  {
+    for (int i = 0; i < 3; i++)
+      mBoundsMin[i] = mBoundsMax[i] = 0.0f;
+  }
+  mStats.alive = mSize;
+  mStats.integrateMs = millisecondsSince(start);
+}
+
+int ParticlePool::buildBillboards(const float* right, const float* up, Vertex* vertices, int maxParticles, bool swapRedBlue)
+{
+  const Clock::time_point start = Clock::now();
+  const int count = std::min(mSize, maxParticles);
+  const int simdEnd = mSimd ? (count & ~3) : 0;
+  if (simdEnd > 0)
+    _build4(0, simdEnd, right, up, vertices, swapRedBlue);
+  _build(simdEnd, count, right, up, vertices, swapRedBlue);
+  mStats.buildMs = millisecondsSince(start);
+  return count;
+}
+
+void ParticlePool::getBounds(float* min, float* max) const
+{
+  for (int i = 0; i < 3; i++)
+  {
+    min[i] = mBoundsMin[i];
+    max[i] = mBoundsMax[i];
+  }
+}
+
+float ParticlePool::getMaxSize(void) const
+{
+  float size = 0.0f;
+  for (size_t i = 0; i < mEmitters.size(); i++)
+    size = std::max(size, std::max(mEmitters[i].sizeStart, mEmitters[i].sizeEnd));
+  return size;
+}
+
+void ParticlePool::_emit(Emitter& emitter, int count)
+{
+  // a basis around the direction for the cone
+  const float* d = emitter.direction;
+  const float helper[3] = { std::fabs(d[1]) < 0.99f ? 0.0f : 1.0f, std::fabs(d[1]) < 0.99f ? 1.0f : 0.0f, 0.0f };
+  float t1[3] = { d[1] * helper[2] - d[2] * helper[1], d[2] * helper[0] - d[0] * helper[2], d[0] * helper[1] - d[1] * helper[0] };
+  const float length = std::sqrt(t1[0] * t1[0] + t1[1] * t1[1] + t1[2] * t1[2]);
+  for (int i = 0; i < 3; i++)
+    t1[i] /= length;
+  const float t2[3] = { d[1] * t1[2] - d[2] * t1[1], d[2] * t1[0] - d[0] * t1[2], d[0] * t1[1] - d[1] * t1[0] };
+  const float cosAngle = std::cos(emitter.angle);
+
+  for (int n = 0; n < count; n++)
+  {
+    if (mSize >= mCapacity)
+    {
+      mStats.dropped += count - n;
+      return;
+    }
+
+    const int i = mSize++;
+    const float cosTheta = 1.0f - mRandom.nextFloat() * (1.0f - cosAngle);
+    const float sinTheta = std::sqrt(std::max(0.0f, 1.0f - cosTheta * cosTheta));
+    const float phi = mRandom.range(0.0f, 6.2831853f);
+    const float c = std::cos(phi) * sinTheta, s = std::sin(phi) * sinTheta;
+    const float speed = mRandom.range(emitter.speedMin, emitter.speedMax);
+    for (int k = 0; k < 3; k++)
+    {
+      mPosition[k][i] = emitter.position[k] + emitter.box[k] * mRandom.range(-1.0f, 1.0f);
+      mVelocity[k][i] = (d[k] * cosTheta + t1[k] * c + t2[k] * s) * speed;
+    }
+
+    mAge[i] = 0.0f;
+    mInverseLife[i] = 1.0f / std::max(mRandom.range(emitter.lifeMin, emitter.lifeMax), 0.001f);
+    mSize0[i] = emitter.sizeStart;
+    mSizeDelta[i] = emitter.sizeEnd - emitter.sizeStart;
+    for (int k = 0; k < 4; k++)
+    {
+      mColour0[k][i] = emitter.colourStart[k];
+      mColourDelta[k][i] = emitter.colourEnd[k] - emitter.colourStart[k];
+    }
+    mStats.emitted++;
+  }
+}
+
+void ParticlePool::_integrate(int begin, int end, float dt)
+{
+  const float damping = std::max(0.0f, 1.0f - mDrag * dt);
+  for (int k = 0; k < 3; k++)
+  {
+    float* position = &mPosition[k][0];
+    float* velocity = &mVelocity[k][0];
+    const float gravity = mGravity[k] * dt;
+    float low = mBoundsMin[k], high = mBoundsMax[k];
+    for (int i = begin; i < end; i++)
+    {
+      velocity[i] = velocity[i] * damping + gravity;
+      position[i] += velocity[i] * dt;
+      low = std::min(low, position[i]);
+      high = std::max(high, position[i]);
+    }
+    mBoundsMin[k] = low;
+    mBoundsMax[k] = high;
+  }
+
+  for (int i = begin; i < end; i++)
+    mAge[i] += dt;
+}
+
+void ParticlePool::_integrate4(int begin, int end, float dt)
+{
+#ifdef PARTICLE_POOL_SSE
+  const __m128 step = _mm_set1_ps(dt);
+  const __m128 damping = _mm_set1_ps(std::max(0.0f, 1.0f - mDrag * dt));
+  for (int k = 0; k < 3; k++)
+  {
+    float* position = &mPosition[k][0];
+    float* velocity = &mVelocity[k][0];
+    const __m128 gravity = _mm_set1_ps(mGravity[k] * dt);
+    __m128 low = _mm_set1_ps(mBoundsMin[k]), high = _mm_set1_ps(mBoundsMax[k]);
+    for (int i = begin; i < end; i += 4)
+    {
+      const __m128 v = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(velocity + i), damping), gravity);
+      const __m128 p = _mm_add_ps(_mm_loadu_ps(position + i), _mm_mul_ps(v, step));
+      _mm_storeu_ps(velocity + i, v);
+      _mm_storeu_ps(position + i, p);
+      low = _mm_min_ps(low, p);
+      high = _mm_max_ps(high, p);
+    }
+
+    float lows[4], highs[4];
+    _mm_storeu_ps(lows, low);
+    _mm_storeu_ps(highs, high);
+    mBoundsMin[k] = std::min(std::min(lows[0], lows[1]), std::min(lows[2], lows[3]));
+    mBoundsMax[k] = std::max(std::max(highs[0], highs[1]), std::max(highs[2], highs[3]));
+  }
+
+  float* age = &mAge[0];
+  for (int i = begin; i < end; i += 4)
+    _mm_storeu_ps(age + i, _mm_add_ps(_mm_loadu_ps(age + i), step));
+#else
+  _integrate(begin, end, dt);
+#endif
+}
+
+void ParticlePool::_removeDead(void)
+{
+#ifdef PARTICLE_POOL_SSE
+  const __m128 one = _mm_set1_ps(1.0f);
+#endif
+  for (int i = 0; i < mSize;)
+  {
+#ifdef PARTICLE_POOL_SSE
+    // most blocks of four have nobody dying this frame
+    if (mSimd && i + 4 <= mSize
+      && _mm_movemask_ps(_mm_cmpge_ps(_mm_mul_ps(_mm_loadu_ps(&mAge[i]), _mm_loadu_ps(&mInverseLife[i])), one)) == 0)
+    {
+      i += 4;
+      continue;
+    }
+#endif
+    if (mAge[i] * mInverseLife[i] < 1.0f)
+    {
+      i++;
+      continue;
+    }
+
+    // the last one takes its place and is looked at next
+    _move(mSize - 1, i);
+    mSize--;
+    mStats.died++;
+  }
+}
+
+void ParticlePool::_build(int begin, int end, const float* right, const float* up, Vertex* vertices, bool swapRedBlue) const
+{
+  const float a[3] = { right[0] + up[0], right[1] + up[1], right[2] + up[2] };
+  const float b[3] = { right[0] - up[0], right[1] - up[1], right[2] - up[2] };
+
+  for (int i = begin; i < end; i++)
+  {
+    const float t = std::min(mAge[i] * mInverseLife[i], 1.0f);
+    const float size = mSize0[i] + mSizeDelta[i] * t;
+    const uint32_t colour = packColour(mColour0[0][i] + mColourDelta[0][i] * t, mColour0[1][i] + mColourDelta[1][i] * t,
+      mColour0[2][i] + mColourDelta[2][i] * t, mColour0[3][i] + mColourDelta[3][i] * t, swapRedBlue);
+
+    Vertex* quad = vertices + i * 4;
+    for (int k = 0; k < 3; k++)
+    {
+      const float p = mPosition[k][i];
+      quad[0].position[k] = p - a[k] * size;
+      quad[1].position[k] = p + b[k] * size;
+      quad[2].position[k] = p + a[k] * size;
+      quad[3].position[k] = p - b[k] * size;
+    }
+    for (int c = 0; c < 4; c++)
+    {
+      quad[c].colour = colour;
+      quad[c].uv[0] = CORNER_UV[c][0];
+      quad[c].uv[1] = CORNER_UV[c][1];
+    }
+  }
+}
+
+void ParticlePool::_build4(int begin, int end, const float* right, const float* up, Vertex* vertices, bool swapRedBlue) const
+{
+#ifdef PARTICLE_POOL_SSE
+  const __m128 one = _mm_set1_ps(1.0f), zero = _mm_setzero_ps(), scale = _mm_set1_ps(255.0f), half = _mm_set1_ps(0.5f);
+  __m128 a[3], b[3];
+  for (int k = 0; k < 3; k++)
+  {
+    a[k] = _mm_set1_ps(right[k] + up[k]);
+    b[k] = _mm_set1_ps(right[k] - up[k]);
+  }
+
+  float corners[4][3][4];   // corner, axis, particle
+  uint32_t colours[4];
+  for (int i = begin; i < end; i += 4)
+  {
+    const __m128 t = _mm_min_ps(_mm_mul_ps(_mm_loadu_ps(&mAge[i]), _mm_loadu_ps(&mInverseLife[i])), one);
+    const __m128 size = _mm_add_ps(_mm_loadu_ps(&mSize0[i]), _mm_mul_ps(_mm_loadu_ps(&mSizeDelta[i]), t));
+
+    __m128i channel[4];
+    for (int c = 0; c < 4; c++)
+    {
+      __m128 value = _mm_add_ps(_mm_loadu_ps(&mColour0[c][i]), _mm_mul_ps(_mm_loadu_ps(&mColourDelta[c][i]), t));
+      value = _mm_min_ps(_mm_max_ps(value, zero), one);
+      channel[c] = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(value, scale), half));
+    }
+    const __m128i low = swapRedBlue ? channel[2] : channel[0], high = swapRedBlue ? channel[0] : channel[2];
+    const __m128i packed = _mm_or_si128(_mm_or_si128(low, _mm_slli_epi32(channel[1], 8)),
+      _mm_or_si128(_mm_slli_epi32(high, 16), _mm_slli_epi32(channel[3], 24)));
+    _mm_storeu_si128((__m128i*)colours, packed);
+
+    for (int k = 0; k < 3; k++)
+    {
+      const __m128 p = _mm_loadu_ps(&mPosition[k][i]);
+      const __m128 sa = _mm_mul_ps(a[k], size), sb = _mm_mul_ps(b[k], size);
+      _mm_storeu_ps(corners[0][k], _mm_sub_ps(p, sa));
+      _mm_storeu_ps(corners[1][k], _mm_add_ps(p, sb));
+      _mm_storeu_ps(corners[2][k], _mm_add_ps(p, sa));
+      _mm_storeu_ps(corners[3][k], _mm_sub_ps(p, sb));
+    }
+
+    // interleaved for the vertex buffer
+    Vertex* quad = vertices + i * 4;
+    for (int n = 0; n < 4; n++, quad += 4)
+    {
+      for (int c = 0; c < 4; c++)
+      {
+        quad[c].position[0] = corners[c][0][n];
+        quad[c].position[1] = corners[c][1][n];
+        quad[c].position[2] = corners[c][2][n];
+        quad[c].colour = colours[n];
+        quad[c].uv[0] = CORNER_UV[c][0];
+        quad[c].uv[1] = CORNER_UV[c][1];
+      }
+    }
+  }
+#else
+  _build(begin, end, right, up, vertices, swapRedBlue);
+#endif
+}
+
+void ParticlePool::_move(int from, int to)
+{
+  for (int k = 0; k < 3; k++)
+  {
+    mPosition[k][to] = mPosition[k][from];
+    mVelocity[k][to] = mVelocity[k][from];
+  }
+  mAge[to] = mAge[from];
+  mInverseLife[to] = mInverseLife[from];
+  mSize0[to] = mSize0[from];
+  mSizeDelta[to] = mSizeDelta[from];
+  for (int k = 0; k < 4; k++)
+  {
+    mColour0[k][to] = mColour0[k][from];
+    mColourDelta[k][to] = mColourDelta[k][from];
+  }
+}
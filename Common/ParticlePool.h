@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "RandomStream.h"
+
+// CPU particle simulation. Particles live in a fixed size pool in
+// structure of arrays form; update() emits new ones, integrates all of
+// them four at a time where SSE2 is available and swaps the dead ones out
+// of the live range, so the live particles are always 0 .. size() - 1.
+//
+// Emitters spawn particles in world space, in a cone around their
+// direction and a box around their position. Colour and size go linearly
+// from their start to their end value over a particle's life.
+//
+// buildBillboards() writes camera facing quads, four vertices per
+// particle in this layout (24 bytes):
+//
+//   float x, y, z
+//   uint32 colour   red in the low byte, or blue with swapRedBlue
+//   float u, v
+//
+// The quads are listed in particle order with the corners counter
+// clockwise from the bottom left, so one index buffer fits any count.
+class ParticlePool
+{
+public:
+  struct Emitter
+  {
+    float rate;               // particles per second
+    float lifeMin, lifeMax;   // seconds
+    float speedMin, speedMax;
+    float angle;              // half angle of the cone, radians
+    float sizeStart, sizeEnd;   // half the quad side
+    float colourStart[4], colourEnd[4];   // rgba
+    float position[3];
+    float direction[3];       // normalised
+    float box[3];             // half extents of the box particles start in
+    bool enabled;
+
+    Emitter();
+  };
+
+  struct Vertex
+  {
+    float position[3];
+    uint32_t colour;
+    float uv[2];
+  };
+
+  struct Stats
+  {
+    int alive;
+    int emitted;      // by the last update()
+    int died;
+    int dropped;      // could not be emitted, the pool was full
+    double emitMs;
+    double integrateMs;
+    double buildMs;   // last buildBillboards()
+  };
+
+  ParticlePool(int capacity, uint64_t seed = 1);
+
+  int addEmitter(const Emitter& emitter);
+  Emitter& getEmitter(int id) { return mEmitters[id]; }
+  int getEmitterCount(void) const { return (int)mEmitters.size(); }
+
+  // acceleration in units/s^2, drag as the share of the velocity lost per second
+  void setGravity(float x, float y, float z);
+  void setDrag(float drag) { mDrag = drag; }
+
+  void update(float dt);
+  // up to maxParticles quads, returns how many were written
+  int buildBillboards(const float* right, const float* up, Vertex* vertices, int maxParticles, bool swapRedBlue = false);
+  void clear(void) { mSize = 0; }
+
+  int size(void) const { return mSize; }
+  int capacity(void) const { return mCapacity; }
+  // of the live particle centres as of the last update()
+  void getBounds(float* min, float* max) const;
+  float getMaxSize(void) const;
+
+  // off runs the scalar loops, for comparison
+  void setSimd(bool simd) { mSimd = simd && hasSimd(); }
+  bool isSimd(void) const { return mSimd; }
+  static bool hasSimd(void);
+
+  const Stats& getStats(void) const { return mStats; }
+
+private:
+  void _emit(Emitter& emitter, int count);
+  void _integrate(int begin, int end, float dt);
+  void _integrate4(int begin, int end, float dt);
+  void _removeDead(void);
+  void _build(int begin, int end, const float* right, const float* up, Vertex* vertices, bool swapRedBlue) const;
+  void _build4(int begin, int end, const float* right, const float* up, Vertex* vertices, bool swapRedBlue) const;
+  void _move(int from, int to);
+
+  int mCapacity;
+  int mSize;
+  std::vector<Emitter> mEmitters;
+  std::vector<float> mPending;   // fraction of a particle carried to the next update, by emitter
+  RandomStream mRandom;
+  float mGravity[3];
+  float mDrag;
+  bool mSimd;
+
+  // by particle
+  std::vector<float> mPosition[3];
+  std::vector<float> mVelocity[3];
+  std::vector<float> mAge;
+  std::vector<float> mInverseLife;
+  std::vector<float> mSize0, mSizeDelta;
+  std::vector<float> mColour0[4], mColourDelta[4];
+
+  float mBoundsMin[3], mBoundsMax[3];
+  Stats mStats;
+};
@@ -0,0 +1,113 @@
+#include "QuadBatch.h"
+
+using namespace Ogre;
+
+
+QuadBatch::QuadBatch(const String& name)
+  : SimpleRenderable(name), mCapacity(0),
+  mArgb(VertexElement::getBestColourVertexElementType() == VET_COLOUR_ARGB), mRadius(0.0f),
+  mBuiltFrame((unsigned long)-1), mBuiltCamera(0)
+{
+  mRenderOp.operationType = RenderOperation::OT_TRIANGLE_LIST;
+  mRenderOp.useIndexes = true;
+  setCastShadows(false);
+  setBoundingBox(AxisAlignedBox::BOX_NULL);
+}
+
+QuadBatch::~QuadBatch()
+{
+  _destroyBuffers();
+}
+
+void QuadBatch::_notifyCurrentCamera(Camera* camera)
+{
+  SimpleRenderable::_notifyCurrentCamera(camera);
+  if (mCapacity == 0)
+    return;
+
+  // the same camera can be notified more than once a frame
+  const unsigned long frame = Root::getSingleton().getNextFrameNumber();
+  if (frame == mBuiltFrame && camera == mBuiltCamera)
+    return;
+  mBuiltFrame = frame;
+  mBuiltCamera = camera;
+
+  int written = 0;
+  const int count = std::min(_getQuadCount(), mCapacity);
+  if (count > 0)
+  {
+    void* vertices = mVertexBuffer->lock(0, count * 4 * VERTEX_SIZE, HardwareBuffer::HBL_DISCARD);
+    written = _writeQuads(camera->getDerivedRight(), camera->getDerivedUp(), vertices, count);
+    mVertexBuffer->unlock();
+  }
+
+  mRenderOp.vertexData->vertexCount = written * 4;
+  mRenderOp.indexData->indexCount = written * 6;
+}
+
+Real QuadBatch::getSquaredViewDepth(const Camera* camera) const
+{
+  return (getWorldBoundingBox().getCenter() - camera->getDerivedPosition()).squaredLength();
+}
+
+void QuadBatch::_setCapacity(int capacity)
+{
+  _destroyBuffers();
+  mCapacity = capacity;
+  mBuiltFrame = (unsigned long)-1;
+  if (capacity == 0)
+    return;
+
+  mRenderOp.vertexData = OGRE_NEW VertexData();
+  mRenderOp.vertexData->vertexStart = 0;
+  mRenderOp.vertexData->vertexCount = 0;
+
+  VertexDeclaration* decl = mRenderOp.vertexData->vertexDeclaration;
+  decl->addElement(0, 0, VET_FLOAT3, VES_POSITION);
+  decl->addElement(0, 12, mArgb ? VET_COLOUR_ARGB : VET_COLOUR_ABGR, VES_DIFFUSE);
+  decl->addElement(0, 16, VET_FLOAT2, VES_TEXTURE_COORDINATES, 0);
+
+  // rewritten whole for every camera, the driver may hand out a fresh one
+  mVertexBuffer = HardwareBufferManager::getSingleton().createVertexBuffer(VERTEX_SIZE, capacity * 4,
+    HardwareBuffer::HBU_DYNAMIC_WRITE_ONLY_DISCARDABLE);
+  mRenderOp.vertexData->vertexBufferBinding->setBinding(0, mVertexBuffer);
+
+  const bool wide = capacity * 4 > 0xffff;
+  mRenderOp.indexData = OGRE_NEW IndexData();
+  mRenderOp.indexData->indexStart = 0;
+  mRenderOp.indexData->indexCount = 0;
+  mRenderOp.indexData->indexBuffer = HardwareBufferManager::getSingleton().createIndexBuffer(
+    wide ? HardwareIndexBuffer::IT_32BIT : HardwareIndexBuffer::IT_16BIT, capacity * 6, HardwareBuffer::HBU_STATIC_WRITE_ONLY);
+
+  // two triangles per quad
+  HardwareIndexBufferSharedPtr indexBuffer = mRenderOp.indexData->indexBuffer;
+  void* data = indexBuffer->lock(HardwareBuffer::HBL_DISCARD);
+  const uint32 pattern[6] = { 0, 1, 2, 0, 2, 3 };
+  for (int i = 0; i < capacity; i++)
+  {
+    for (int k = 0; k < 6; k++)
+    {
+      if (wide)
+        static_cast<uint32*>(data)[i * 6 + k] = i * 4 + pattern[k];
+      else
+        static_cast<uint16*>(data)[i * 6 + k] = (uint16)(i * 4 + pattern[k]);
+    }
+  }
+  indexBuffer->unlock();
+}
+
+void QuadBatch::_setBounds(const AxisAlignedBox& box)
+{
+  setBoundingBox(box);
+  mRadius = box.isNull() ? 0.0f : Math::boundingRadiusFromAABB(box);
+}
+
+void QuadBatch::_destroyBuffers(void)
+{
+  OGRE_DELETE mRenderOp.vertexData;
+  OGRE_DELETE mRenderOp.indexData;
+  mRenderOp.vertexData = 0;
+  mRenderOp.indexData = 0;
+  mVertexBuffer.setNull();
+  mCapacity = 0;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <Ogre.h>
+
+// Camera facing quads drawn as one batch, what CpuParticleSystem and
+// CharacterImpostors draw with. Vertices are position, colour and uv (24
+// bytes, the layout of ParticlePool::Vertex and ImpostorLod::Vertex), four
+// per quad counter clockwise from the bottom left.
+//
+// For every camera that sees the batch, once a frame, _writeQuads() fills
+// the dynamic vertex buffer with quads facing that camera. The index buffer
+// is static, the quads always use the same corners.
+class QuadBatch : public Ogre::SimpleRenderable
+{
+public:
+  static const size_t VERTEX_SIZE = 24;
+
+  QuadBatch(const Ogre::String& name);
+  ~QuadBatch();
+
+  // SimpleRenderable
+  void _notifyCurrentCamera(Ogre::Camera* camera);
+  Ogre::Real getSquaredViewDepth(const Ogre::Camera* camera) const;
+  Ogre::Real getBoundingRadius(void) const { return mRadius; }
+
+protected:
+  // quads the next _writeQuads() may write at most
+  virtual int _getQuadCount(void) const = 0;
+  // right and up of the camera in world space, returns the quads written
+  virtual int _writeQuads(const Ogre::Vector3& right, const Ogre::Vector3& up, void* vertices, int maxQuads) = 0;
+
+  // makes room for capacity quads, whatever was written is dropped
+  void _setCapacity(int capacity);
+  int _getCapacity(void) const { return mCapacity; }
+  // the render system takes colours as ARGB rather than ABGR
+  bool _isArgb(void) const { return mArgb; }
+  // a null box for nothing to draw
+  void _setBounds(const Ogre::AxisAlignedBox& box);
+
+private:
+  void _destroyBuffers(void);
+
+  Ogre::HardwareVertexBufferSharedPtr mVertexBuffer;
+  int mCapacity;
+  bool mArgb;
+  Ogre::Real mRadius;
+  unsigned long mBuiltFrame;
+  const Ogre::Camera* mBuiltCamera;
+};
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+
+// PCG32 random number generator. Every agent owns its own stream so the
+// numbers it draws do not depend on how many other agents exist or in
+// which order they are updated, unlike the global rand().
+class RandomStream
+{
+public:
+  RandomStream(uint64_t seed = 0x853c49e6748fea9bULL, uint64_t stream = 0)
+  {
+    setSeed(seed, stream);
+  }
+
+  void setSeed(uint64_t seed, uint64_t stream)
+  {
+    mState = 0;
+    mIncrement = (stream << 1) | 1;
+    next();
+    mState += seed;
+    next();
+  }
+
+  uint32_t next(void)
+  {
+    const uint64_t old = mState;
+    mState = old * 6364136223846793005ULL + mIncrement;
+    const uint32_t xorShifted = (uint32_t)(((old >> 18) ^ old) >> 27);
+    const uint32_t rot = (uint32_t)(old >> 59);
+    return (xorShifted >> rot) | (xorShifted << ((0u - rot) & 31));
+  }
+
+  // [0, 1)
+  float nextFloat(void) { return (next() >> 8) * (1.0f / 16777216.0f); }
+
+  float range(float min, float max) { return min + (max - min) * nextFloat(); }
+
+  // [min, max]
+  int range(int min, int max) { return min + (int)(next() % (uint32_t)(max - min + 1)); }
+
+private:
+  uint64_t mState;
+  uint64_t mIncrement;
+};
@@ -0,0 +1,283 @@
+#include "RenderStateSorter.h"
+
+using namespace Ogre;
+
+namespace
+{
+  uint32 hashString(const String& value, uint32 bits)
+  {
+    if (value.empty())
+      return 0;
+    return FastHash(value.c_str(), (int)value.size()) & ((1u << bits) - 1);
+  }
+
+  class StateKeyHash : public Pass::HashFunc
+  {
+  public:
+    uint32 operator()(const Pass* p) const { return RenderStateSorter::getStateKey(p); }
+  };
+
+  StateKeyHash stateKeyHash;
+
+  bool programsDiffer(const Pass* a, const Pass* b)
+  {
+    return a->hasVertexProgram() != b->hasVertexProgram() || a->hasFragmentProgram() != b->hasFragmentProgram()
+      || (a->hasVertexProgram() && a->getVertexProgramName() != b->getVertexProgramName())
+      || (a->hasFragmentProgram() && a->getFragmentProgramName() != b->getFragmentProgramName());
+  }
+
+  bool texturesDiffer(const Pass* a, const Pass* b)
+  {
+    if (a->getNumTextureUnitStates() != b->getNumTextureUnitStates())
+      return true;
+    for (unsigned short i = 0; i < a->getNumTextureUnitStates(); i++)
+    {
+      if (a->getTextureUnitState(i)->getTextureName() != b->getTextureUnitState(i)->getTextureName())
+        return true;
+    }
+    return false;
+  }
+
+  bool blendDiffers(const Pass* a, const Pass* b)
+  {
+    return a->getSourceBlendFactor() != b->getSourceBlendFactor() || a->getDestBlendFactor() != b->getDestBlendFactor()
+      || a->getAlphaRejectFunction() != b->getAlphaRejectFunction() || a->getAlphaRejectValue() != b->getAlphaRejectValue();
+  }
+
+  bool depthDiffers(const Pass* a, const Pass* b)
+  {
+    return a->getDepthCheckEnabled() != b->getDepthCheckEnabled() || a->getDepthWriteEnabled() != b->getDepthWriteEnabled()
+      || a->getDepthFunction() != b->getDepthFunction() || a->getDepthBiasConstant() != b->getDepthBiasConstant()
+      || a->getDepthBiasSlopeScale() != b->getDepthBiasSlopeScale();
+  }
+
+  bool rasterDiffers(const Pass* a, const Pass* b)
+  {
+    return a->getCullingMode() != b->getCullingMode() || a->getManualCullingMode() != b->getManualCullingMode()
+      || a->getPolygonMode() != b->getPolygonMode() || a->getShadingMode() != b->getShadingMode();
+  }
+
+  bool lightingDiffers(const Pass* a, const Pass* b)
+  {
+    return a->getLightingEnabled() != b->getLightingEnabled() || a->getAmbient() != b->getAmbient()
+      || a->getDiffuse() != b->getDiffuse() || a->getSpecular() != b->getSpecular()
+      || a->getSelfIllumination() != b->getSelfIllumination() || a->getShininess() != b->getShininess();
+  }
+
+  // counts the state changes along one draw order
+  class BreakCounter : public QueuedRenderableVisitor
+  {
+  public:
+    BreakCounter(RenderStateSorter::Breaks& breaks, int* draws)
+      : mBreaks(breaks), mDraws(draws), mLast(nullptr) {}
+
+    void visit(RenderablePass* rp)
+    {
+      _change(rp->pass);
+      if (mDraws)
+        (*mDraws)++;
+    }
+
+    bool visit(const Pass* p)
+    {
+      _change(p);
+      return true;
+    }
+
+    void visit(Renderable* r)
+    {
+      if (mDraws)
+        (*mDraws)++;
+    }
+
+  private:
+    void _change(const Pass* pass)
+    {
+      const Pass* last = mLast;
+      mLast = pass;
+      if (!last || last == pass)
+        return;
+
+      mBreaks.passChanges++;
+
+      // in Cause order, everything but CAUSE_PASS
+      const bool differs[RenderStateSorter::CAUSE_PASS] = {
+        programsDiffer(last, pass), texturesDiffer(last, pass), blendDiffers(last, pass),
+        depthDiffers(last, pass), rasterDiffers(last, pass), lightingDiffers(last, pass),
+      };
+
+      bool explained = false;
+      for (int i = 0; i < RenderStateSorter::CAUSE_PASS; i++)
+      {
+        if (differs[i])
+        {
+          mBreaks.causes[i]++;
+          explained = true;
+        }
+      }
+      if (!explained)
+        mBreaks.causes[RenderStateSorter::CAUSE_PASS]++;
+    }
+
+    RenderStateSorter::Breaks& mBreaks;
+    int* mDraws;
+    const Pass* mLast;
+  };
+
+  void logBreaks(const char* name, const RenderStateSorter::Breaks& breaks)
+  {
+    Log::Stream log = LogManager::getSingleton().stream();
+    log << "  " << name << ": " << breaks.passChanges << " state changes (";
+    for (int i = 0; i < RenderStateSorter::CAUSE_COUNT; i++)
+    {
+      log << (i ? ", " : "") << RenderStateSorter::getCauseName((RenderStateSorter::Cause)i) << " "
+        << breaks.causes[i];
+    }
+    log << ")";
+  }
+}
+
+
+RenderStateSorter::RenderStateSorter(SceneManager* sceneMgr)
+  : mSceneMgr(sceneMgr), mEnabled(false), mDiagnostics(true), mFrame(0)
+{
+  memset(&mCurrent, 0, sizeof(mCurrent));
+  memset(&mStats, 0, sizeof(mStats));
+
+  setEnabled(true);
+
+  mSceneMgr->addListener(this);
+  mSceneMgr->addRenderQueueListener(this);
+}
+
+RenderStateSorter::~RenderStateSorter()
+{
+  mSceneMgr->removeRenderQueueListener(this);
+  mSceneMgr->removeListener(this);
+
+  RenderQueue::QueueGroupIterator it = mSceneMgr->getRenderQueue()->_getQueueGroupIterator();
+  while (it.hasMoreElements())
+  {
+    RenderQueueGroup* group = it.getNext();
+    group->resetOrganisationModes();
+    group->addOrganisationMode(QueuedRenderableCollection::OM_PASS_GROUP);
+  }
+
+  setEnabled(false);
+}
+
+void RenderStateSorter::setEnabled(bool enabled)
+{
+  if (enabled == mEnabled)
+    return;
+
+  mEnabled = enabled;
+  if (mEnabled)
+    Pass::setHashFunction(&stateKeyHash);
+  else
+    Pass::setHashFunction(Pass::MIN_TEXTURE_CHANGE);
+
+  // passes keep their hash until they are told it is dirty
+  _rehashPasses();
+}
+
+void RenderStateSorter::logStats(void) const
+{
+  LogManager::getSingleton().stream() << "RenderStateSorter (" << (mEnabled ? "state key" : "Ogre texture hash")
+    << "): " << mStats.draws << " opaque draws, " << mStats.traversal.passChanges - mStats.sorted.passChanges
+    << " state changes saved against traversal order";
+  logBreaks("drawn", mStats.sorted);
+  logBreaks("traversal", mStats.traversal);
+}
+
+const char* RenderStateSorter::getCauseName(Cause cause)
+{
+  static const char* const names[CAUSE_COUNT] = { "program", "texture", "blend", "depth", "raster", "lighting", "pass" };
+  return names[cause];
+}
+
+uint32 RenderStateSorter::getStateKey(const Pass* pass)
+{
+  const String programs = (pass->hasVertexProgram() ? pass->getVertexProgramName() : BLANKSTRING) + "|"
+    + (pass->hasFragmentProgram() ? pass->getFragmentProgramName() : BLANKSTRING);
+  const String texture = pass->getNumTextureUnitStates() ? pass->getTextureUnitState(0)->getTextureName() : BLANKSTRING;
+
+  uint32 state = (pass->getSourceBlendFactor() & 0x3) | ((pass->getDestBlendFactor() & 0x3) << 2);
+  state |= (pass->getDepthWriteEnabled() ? 1 : 0) << 4;
+  state |= (pass->getDepthCheckEnabled() ? 1 : 0) << 5;
+  state |= (pass->getCullingMode() & 0x3) << 6;
+
+  return ((uint32)(pass->getIndex() & 0xF) << 28)
+    | ((programs.size() > 1 ? hashString(programs, 8) : 0) << 20)
+    | (hashString(texture, 12) << 8)
+    | state;
+}
+
+void RenderStateSorter::preFindVisibleObjects(SceneManager* source, SceneManager::IlluminationRenderStage irs, Viewport* v)
+{
+  if (irs == SceneManager::IRS_RENDER_TO_TEXTURE)
+    return;
+
+  const unsigned long frame = Root::getSingleton().getNextFrameNumber();
+  if (frame != mFrame)
+  {
+    mStats = mCurrent;
+    memset(&mCurrent, 0, sizeof(mCurrent));
+    mFrame = frame;
+  }
+
+  if (!mDiagnostics)
+    return;
+
+  // keep the queue order next to the pass groups, groups created later in
+  // the frame get it from the next frame on
+  RenderQueue::QueueGroupIterator it = source->getRenderQueue()->_getQueueGroupIterator();
+  while (it.hasMoreElements())
+  {
+    RenderQueueGroup* group = it.getNext();
+    group->addOrganisationMode(QueuedRenderableCollection::OM_PASS_GROUP);
+    group->addOrganisationMode(QueuedRenderableCollection::OM_SORT_DESCENDING);
+  }
+}
+
+void RenderStateSorter::renderQueueStarted(uint8 queueGroupId, const String& invocation, bool& skipThisInvocation)
+{
+  if (!mDiagnostics || mSceneMgr->_getCurrentRenderStage() == SceneManager::IRS_RENDER_TO_TEXTURE)
+    return;
+
+  // the queue is not depth sorted yet, the sorted list still holds the
+  // renderables in the order they were queued
+  RenderQueueGroup::PriorityMapIterator it = mSceneMgr->getRenderQueue()->getQueueGroup(queueGroupId)->getIterator();
+  while (it.hasMoreElements())
+  {
+    RenderPriorityGroup* priorityGroup = it.getNext();
+    const QueuedRenderableCollection* solids[] = {
+      &priorityGroup->getSolidsBasic(), &priorityGroup->getSolidsDiffuseSpecular(),
+      &priorityGroup->getSolidsDecal(), &priorityGroup->getSolidsNoShadowReceive(),
+    };
+
+    BreakCounter sorted(mCurrent.sorted, &mCurrent.draws);
+    BreakCounter traversal(mCurrent.traversal, nullptr);
+    for (size_t i = 0; i < sizeof(solids) / sizeof(solids[0]); i++)
+    {
+      solids[i]->acceptVisitor(&sorted, QueuedRenderableCollection::OM_PASS_GROUP);
+      solids[i]->acceptVisitor(&traversal, QueuedRenderableCollection::OM_SORT_DESCENDING);
+    }
+  }
+}
+
+void RenderStateSorter::_rehashPasses(void)
+{
+  ResourceManager::ResourceMapIterator it = MaterialManager::getSingleton().getResourceIterator();
+  while (it.hasMoreElements())
+  {
+    Material* material = static_cast<Material*>(it.getNext().getPointer());
+    Material::TechniqueIterator techniques = material->getTechniqueIterator();
+    while (techniques.hasMoreElements())
+    {
+      Technique::PassIterator passes = techniques.getNext()->getPassIterator();
+      while (passes.hasMoreElements())
+        passes.getNext()->_dirtyHash();
+    }
+  }
+}
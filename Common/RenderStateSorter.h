@@ -0,0 +1,83 @@
+#pragma once
+
+#include <Ogre.h>
+
+// Orders the opaque renderables of the render queue by render state and
+// reports what the remaining state changes are.
+//
+// Ogre draws opaque renderables grouped by pass, in the order of the pass
+// hash. The sorter installs a pass hash that puts the most expensive
+// changes in the highest bits:
+//
+//   pass index (4 bits) | GPU programs (8) | first texture (12) | blend, depth, cull (8)
+//
+// so passes that share programs and textures end up next to each other.
+// The pass index stays on top, so multi pass materials keep their order.
+// The pass hash is global to Ogre, keep one sorter per application.
+//
+// For diagnostics it walks the opaque queue groups of every viewport
+// before they are drawn. It counts the batch breaks in draw order and in the
+// order the scene traversal queued the renderables, sorted by cause.
+class RenderStateSorter : public Ogre::SceneManager::Listener,
+  public Ogre::RenderQueueListener
+{
+public:
+  enum Cause
+  {
+    CAUSE_PROGRAM,    // vertex or fragment program
+    CAUSE_TEXTURE,    // texture units
+    CAUSE_BLEND,      // scene blending, alpha rejection
+    CAUSE_DEPTH,      // depth check, write, function, bias
+    CAUSE_RASTER,     // culling, polygon mode, shading
+    CAUSE_LIGHTING,   // lighting switch and material colours
+    CAUSE_PASS,       // another pass with the same state
+    CAUSE_COUNT
+  };
+
+  struct Breaks
+  {
+    int passChanges;           // batches that start with a state change
+    int causes[CAUSE_COUNT];   // a change can have several causes
+  };
+
+  // per frame, summed over the viewports of the frame
+  struct Stats
+  {
+    int draws;          // opaque renderables, once per pass
+    Breaks sorted;      // as drawn
+    Breaks traversal;   // as queued by the scene traversal
+  };
+
+  RenderStateSorter(Ogre::SceneManager* sceneMgr);
+  ~RenderStateSorter();
+
+  // off goes back to Ogre's texture based pass hash
+  void setEnabled(bool enabled);
+  bool isEnabled(void) const { return mEnabled; }
+
+  void setDiagnostics(bool diagnostics) { mDiagnostics = diagnostics; }
+
+  // the last complete frame
+  const Stats& getStats(void) const { return mStats; }
+  void logStats(void) const;
+
+  static const char* getCauseName(Cause cause);
+  static Ogre::uint32 getStateKey(const Ogre::Pass* pass);
+
+  // SceneManager::Listener
+  void preFindVisibleObjects(Ogre::SceneManager* source, Ogre::SceneManager::IlluminationRenderStage irs, Ogre::Viewport* v);
+
+  // RenderQueueListener
+  void renderQueueStarted(Ogre::uint8 queueGroupId, const Ogre::String& invocation, bool& skipThisInvocation);
+
+private:
+  static void _rehashPasses(void);
+
+  Ogre::SceneManager* mSceneMgr;
+  bool mEnabled;
+  bool mDiagnostics;
+
+  unsigned long mFrame;
+  Stats mCurrent;
+  Stats mStats;
+};
@@ -0,0 +1,622 @@
+#include "SceneFile.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+  typedef std::map<std::string, std::vector<std::string> > Values;
+
+  // the records go straight into the file, keep them free of padding
+  static_assert(sizeof(SceneFile::Header) == 52, "SceneFile::Header is padded");
+  static_assert(sizeof(SceneFile::NodeRecord) == 16, "SceneFile::NodeRecord is padded");
+  static_assert(sizeof(SceneFile::EntityRecord) == 20, "SceneFile::EntityRecord is padded");
+  static_assert(sizeof(SceneFile::LightRecord) == 92, "SceneFile::LightRecord is padded");
+
+  class StringTable
+  {
+  public:
+    StringTable() : mData(1, '\0') {}
+
+    uint32_t add(const std::string& value)
+    {
+      if (value.empty())
+        return 0;
+      std::map<std::string, uint32_t>::iterator it = mOffsets.find(value);
+      if (it != mOffsets.end())
+        return it->second;
+
+      const uint32_t offset = (uint32_t)mData.size();
+      mData.insert(mData.end(), value.begin(), value.end());
+      mData.push_back('\0');
+      mOffsets[value] = offset;
+      return offset;
+    }
+
+    const std::vector<char>& getData(void) const { return mData; }
+
+  private:
+    std::vector<char> mData;
+    std::map<std::string, uint32_t> mOffsets;
+  };
+
+  // key=value pairs, a value runs until the next token with a '='
+  bool splitValues(const std::vector<std::string>& tokens, Values& values, std::string& error)
+  {
+    std::vector<std::string>* current = nullptr;
+    for (size_t i = 2; i < tokens.size(); i++)
+    {
+      const size_t equals = tokens[i].find('=');
+      if (equals == std::string::npos)
+      {
+        if (!current)
+        {
+          error = "'" + tokens[i] + "' is not a key=value pair";
+          return false;
+        }
+        current->push_back(tokens[i]);
+        continue;
+      }
+
+      current = &values[tokens[i].substr(0, equals)];
+      current->clear();
+      if (equals + 1 < tokens[i].size())
+        current->push_back(tokens[i].substr(equals + 1));
+    }
+    return true;
+  }
+
+  bool getFloats(const Values& values, const std::string& key, size_t minCount, size_t maxCount, float* out,
+    std::string& error)
+  {
+    Values::const_iterator it = values.find(key);
+    if (it == values.end())
+      return true;
+
+    const std::vector<std::string>& list = it->second;
+    if (list.size() < minCount || list.size() > maxCount)
+    {
+      std::ostringstream message;
+      message << key << " takes " << minCount;
+      if (maxCount != minCount)
+        message << " to " << maxCount;
+      message << " numbers";
+      error = message.str();
+      return false;
+    }
+
+    for (size_t i = 0; i < list.size(); i++)
+    {
+      char* end;
+      out[i] = (float)strtod(list[i].c_str(), &end);
+      if (*end != '\0')
+      {
+        error = "'" + list[i] + "' is not a number";
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool getName(const Values& values, const std::string& key, std::string& out, std::string& error)
+  {
+    Values::const_iterator it = values.find(key);
+    if (it == values.end())
+      return true;
+    if (it->second.size() != 1)
+    {
+      error = key + " takes one name";
+      return false;
+    }
+    out = it->second[0];
+    return true;
+  }
+
+  bool getFlag(const Values& values, const std::string& key, uint32_t flag, uint32_t& flags, std::string& error)
+  {
+    std::string value;
+    if (!getName(values, key, value, error))
+      return false;
+    if (value.empty())
+      return true;
+
+    if (value == "on")
+      flags |= flag;
+    else if (value == "off")
+      flags &= ~flag;
+    else
+    {
+      error = key + " is on or off";
+      return false;
+    }
+    return true;
+  }
+
+  bool checkKeys(const Values& values, const char* const* keys, std::string& error)
+  {
+    for (Values::const_iterator it = values.begin(); it != values.end(); ++it)
+    {
+      bool known = false;
+      for (const char* const* key = keys; *key; key++)
+        known = known || it->first == *key;
+      if (!known)
+      {
+        error = "unknown key '" + it->first + "'";
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // floats of node transforms, a run that is already there is shared
+  class ValueTable
+  {
+  public:
+    uint32_t add(const std::vector<float>& run)
+    {
+      if (run.empty())
+        return 0;
+      std::map<std::vector<float>, uint32_t>::iterator it = mOffsets.find(run);
+      if (it != mOffsets.end())
+        return it->second;
+
+      const uint32_t offset = (uint32_t)mData.size();
+      mData.insert(mData.end(), run.begin(), run.end());
+      mOffsets[run] = offset;
+      return offset;
+    }
+
+    const std::vector<float>& getData(void) const { return mData; }
+
+  private:
+    std::vector<float> mData;
+    std::map<std::vector<float>, uint32_t> mOffsets;
+  };
+
+  const float DEFAULT_POSITION[3] = { 0.0f, 0.0f, 0.0f };
+  const float DEFAULT_ORIENTATION[4] = { 1.0f, 0.0f, 0.0f, 0.0f };
+  const float DEFAULT_SCALE[3] = { 1.0f, 1.0f, 1.0f };
+
+  // adds the part to the node's run unless it is the default
+  void addPart(const float* value, const float* defaults, int count, uint32_t part, uint32_t& parts,
+    std::vector<float>& run)
+  {
+    if (memcmp(value, defaults, count * sizeof(float)) == 0)
+      return;
+    parts |= part;
+    run.insert(run.end(), value, value + count);
+  }
+
+  int countFloats(uint32_t parts)
+  {
+    return ((parts & SceneFile::NODE_POSITION) ? 3 : 0) + ((parts & SceneFile::NODE_ORIENTATION) ? 4 : 0)
+      + ((parts & SceneFile::NODE_SCALE) ? 3 : 0);
+  }
+
+  template <typename T>
+  void append(std::vector<char>& binary, const std::vector<T>& records)
+  {
+    if (!records.empty())
+    {
+      const char* data = reinterpret_cast<const char*>(&records[0]);
+      binary.insert(binary.end(), data, data + records.size() * sizeof(T));
+    }
+  }
+}
+
+
+bool SceneFile::compile(const std::string& text, std::vector<char>& binary, std::string& error)
+{
+  static const char* const nodeKeys[] = { "parent", "position", "orientation", "yaw", "scale", nullptr };
+  static const char* const entityKeys[] = { "mesh", "node", "material", "shadows", "static", "visible", nullptr };
+  static const char* const lightKeys[] = { "type", "node", "position", "direction", "diffuse", "specular",
+    "attenuation", "spot", "shadows", "visible", nullptr };
+
+  std::vector<NodeRecord> nodes;
+  std::vector<EntityRecord> entities;
+  std::vector<LightRecord> lights;
+  std::map<std::string, int> nodeIndex;
+  ValueTable transforms;
+  StringTable strings;
+
+  std::istringstream lines(text);
+  std::string line;
+  for (int lineNumber = 1; std::getline(lines, line); lineNumber++)
+  {
+    const size_t comment = line.find('#');
+    if (comment != std::string::npos)
+      line.erase(comment);
+
+    std::vector<std::string> tokens;
+    std::istringstream words(line);
+    for (std::string word; words >> word;)
+      tokens.push_back(word);
+    if (tokens.empty())
+      continue;
+
+    std::string message;
+    Values values;
+    if (tokens.size() < 2)
+      message = "'" + tokens[0] + "' needs a name";
+    else
+      splitValues(tokens, values, message);
+
+    std::string node;
+    if (message.empty())
+      getName(values, "node", node, message);
+    if (message.empty() && !node.empty() && !nodeIndex.count(node))
+      message = "no node '" + node + "' before this line";
+    const int32_t nodeRef = (message.empty() && !node.empty()) ? nodeIndex[node] : -1;
+
+    if (message.empty())
+    {
+      if (tokens[0] == "node")
+      {
+        NodeRecord record = { 0, -1, 0, 0 };
+        float position[3], orientation[4], scale[3];
+        memcpy(position, DEFAULT_POSITION, sizeof(position));
+        memcpy(orientation, DEFAULT_ORIENTATION, sizeof(orientation));
+        memcpy(scale, DEFAULT_SCALE, sizeof(scale));
+        float yaw = 0.0f;
+        std::string parent;
+        if (checkKeys(values, nodeKeys, message) && getName(values, "parent", parent, message)
+          && getFloats(values, "position", 3, 3, position, message)
+          && getFloats(values, "orientation", 4, 4, orientation, message)
+          && getFloats(values, "yaw", 1, 1, &yaw, message)
+          && getFloats(values, "scale", 1, 3, scale, message))
+        {
+          if (values.count("scale") && values["scale"].size() == 1)
+            scale[1] = scale[2] = scale[0];
+          if (yaw != 0.0f)
+          {
+            // about the local y axis, after the orientation
+            const float half = yaw * 3.14159265f / 360.0f, c = std::cos(half), s = std::sin(half);
+            const float* q = orientation;
+            const float rotated[4] = { q[0] * c - q[2] * s, q[1] * c - q[3] * s, q[2] * c + q[0] * s, q[3] * c + q[1] * s };
+            memcpy(orientation, rotated, sizeof(rotated));
+          }
+
+          std::vector<float> run;
+          addPart(position, DEFAULT_POSITION, 3, NODE_POSITION, record.parts, run);
+          addPart(orientation, DEFAULT_ORIENTATION, 4, NODE_ORIENTATION, record.parts, run);
+          addPart(scale, DEFAULT_SCALE, 3, NODE_SCALE, record.parts, run);
+          record.values = transforms.add(run);
+
+          if (!parent.empty() && !nodeIndex.count(parent))
+            message = "no node '" + parent + "' before this line";
+          else if (tokens[1] != "-" && nodeIndex.count(tokens[1]))
+            message = "node '" + tokens[1] + "' is defined twice";
+          else
+          {
+            record.parent = parent.empty() ? -1 : nodeIndex[parent];
+            if (tokens[1] != "-")
+            {
+              record.name = strings.add(tokens[1]);
+              nodeIndex[tokens[1]] = (int)nodes.size();
+            }
+            nodes.push_back(record);
+          }
+        }
+      }
+      else if (tokens[0] == "entity")
+      {
+        EntityRecord record = { strings.add(tokens[1]), 0, 0, nodeRef, FLAG_SHADOWS | FLAG_VISIBLE };
+        std::string mesh, material;
+        if (checkKeys(values, entityKeys, message) && getName(values, "mesh", mesh, message)
+          && getName(values, "material", material, message)
+          && getFlag(values, "shadows", FLAG_SHADOWS, record.flags, message)
+          && getFlag(values, "static", FLAG_STATIC, record.flags, message)
+          && getFlag(values, "visible", FLAG_VISIBLE, record.flags, message))
+        {
+          if (mesh.empty())
+            message = "entity '" + tokens[1] + "' needs a mesh";
+          else
+          {
+            record.mesh = strings.add(mesh);
+            record.material = strings.add(material);
+            entities.push_back(record);
+          }
+        }
+      }
+      else if (tokens[0] == "light")
+      {
+        LightRecord record = { strings.add(tokens[1]), nodeRef, LIGHT_POINT, FLAG_SHADOWS | FLAG_VISIBLE,
+          { 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 1.0f }, { 1.0f, 1.0f, 1.0f }, { 0.0f, 0.0f, 0.0f },
+          { 100000.0f, 1.0f, 0.0f, 0.0f }, { 30.0f, 40.0f, 1.0f } };
+        std::string type;
+        if (checkKeys(values, lightKeys, message) && getName(values, "type", type, message)
+          && getFloats(values, "position", 3, 3, record.position, message)
+          && getFloats(values, "direction", 3, 3, record.direction, message)
+          && getFloats(values, "diffuse", 3, 3, record.diffuse, message)
+          && getFloats(values, "specular", 3, 3, record.specular, message)
+          && getFloats(values, "attenuation", 4, 4, record.attenuation, message)
+          && getFloats(values, "spot", 2, 3, record.spot, message)
+          && getFlag(values, "shadows", FLAG_SHADOWS, record.flags, message)
+          && getFlag(values, "visible", FLAG_VISIBLE, record.flags, message))
+        {
+          if (type == "directional")
+            record.type = LIGHT_DIRECTIONAL;
+          else if (type == "spot")
+            record.type = LIGHT_SPOT;
+          else if (type != "point" && !type.empty())
+            message = "unknown light type '" + type + "'";
+          if (message.empty())
+            lights.push_back(record);
+        }
+      }
+      else
+        message = "unknown object '" + tokens[0] + "'";
+    }
+
+    if (!message.empty())
+    {
+      std::ostringstream stream;
+      stream << "line " << lineNumber << ": " << message;
+      error = stream.str();
+      return false;
+    }
+  }
+
+  Header header;
+  memcpy(header.magic, "SCNB", 4);
+  header.version = VERSION;
+  header.nodeCount = (uint32_t)nodes.size();
+  header.nodeOffset = sizeof(Header);
+  header.entityCount = (uint32_t)entities.size();
+  header.entityOffset = header.nodeOffset + header.nodeCount * sizeof(NodeRecord);
+  header.lightCount = (uint32_t)lights.size();
+  header.lightOffset = header.entityOffset + header.entityCount * sizeof(EntityRecord);
+  header.valueCount = (uint32_t)transforms.getData().size();
+  header.valueOffset = header.lightOffset + header.lightCount * sizeof(LightRecord);
+  header.stringSize = (uint32_t)strings.getData().size();
+  header.stringOffset = header.valueOffset + header.valueCount * sizeof(float);
+  header.fileSize = header.stringOffset + header.stringSize;
+
+  binary.clear();
+  binary.reserve(header.fileSize);
+  binary.insert(binary.end(), reinterpret_cast<const char*>(&header), reinterpret_cast<const char*>(&header + 1));
+  append(binary, nodes);
+  append(binary, entities);
+  append(binary, lights);
+  append(binary, transforms.getData());
+  append(binary, strings.getData());
+  return true;
+}
+
+bool SceneFile::compileFile(const std::string& textFile, const std::string& binaryFile, std::string& error)
+{
+  std::ifstream input(textFile.c_str(), std::ios::binary);
+  if (!input)
+  {
+    error = "cannot open " + textFile;
+    return false;
+  }
+  std::ostringstream text;
+  text << input.rdbuf();
+
+  std::vector<char> binary;
+  if (!compile(text.str(), binary, error))
+  {
+    error = textFile + ", " + error;
+    return false;
+  }
+
+  std::ofstream output(binaryFile.c_str(), std::ios::binary);
+  output.write(&binary[0], binary.size());
+  if (!output)
+  {
+    error = "cannot write " + binaryFile;
+    return false;
+  }
+  return true;
+}
+
+bool SceneFile::isOutOfDate(const std::string& textFile, const std::string& binaryFile)
+{
+  struct stat text, binary;
+  if (stat(binaryFile.c_str(), &binary) != 0)
+    return true;
+  return stat(textFile.c_str(), &text) == 0 && text.st_mtime > binary.st_mtime;
+}
+
+
+SceneFile::SceneFile()
+  : mData(nullptr), mSize(0),
+#ifdef _WIN32
+  mFile(INVALID_HANDLE_VALUE), mMapping(nullptr),
+#endif
+  mHeader(nullptr), mNodes(nullptr), mEntities(nullptr), mLights(nullptr), mValues(nullptr), mStrings(nullptr)
+{
+}
+
+SceneFile::~SceneFile()
+{
+  close();
+}
+
+bool SceneFile::open(const std::string& binaryFile, std::string& error)
+{
+  close();
+
+#ifdef _WIN32
+  mFile = CreateFileA(binaryFile.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+    FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (mFile == INVALID_HANDLE_VALUE)
+  {
+    error = "cannot open " + binaryFile;
+    return false;
+  }
+  mSize = GetFileSize(mFile, nullptr);
+  mMapping = mSize ? CreateFileMappingA(mFile, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+  mData = mMapping ? static_cast<const char*>(MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0)) : nullptr;
+#else
+  const int file = ::open(binaryFile.c_str(), O_RDONLY);
+  if (file < 0)
+  {
+    error = "cannot open " + binaryFile;
+    return false;
+  }
+  struct stat status;
+  mSize = (fstat(file, &status) == 0) ? (size_t)status.st_size : 0;
+  if (mSize)
+  {
+    void* data = mmap(nullptr, mSize, PROT_READ, MAP_PRIVATE, file, 0);
+    mData = (data == MAP_FAILED) ? nullptr : static_cast<const char*>(data);
+  }
+  ::close(file);
+#endif
+
+  if (!mData)
+  {
+    close();
+    error = "cannot map " + binaryFile;
+    return false;
+  }
+
+  if (!_validate(error))
+  {
+    error = binaryFile + ": " + error;
+    close();
+    return false;
+  }
+  return true;
+}
+
+void SceneFile::close(void)
+{
+#ifdef _WIN32
+  if (mData)
+    UnmapViewOfFile(mData);
+  if (mMapping)
+    CloseHandle(mMapping);
+  if (mFile != INVALID_HANDLE_VALUE)
+    CloseHandle(mFile);
+  mFile = INVALID_HANDLE_VALUE;
+  mMapping = nullptr;
+#else
+  if (mData)
+    munmap(const_cast<char*>(mData), mSize);
+#endif
+
+  mData = nullptr;
+  mSize = 0;
+  mHeader = nullptr;
+  mNodes = nullptr;
+  mEntities = nullptr;
+  mLights = nullptr;
+  mValues = nullptr;
+  mStrings = nullptr;
+}
+
+bool SceneFile::_validate(std::string& error)
+{
+  const Header* header = reinterpret_cast<const Header*>(mData);
+  if (mSize < sizeof(Header) || memcmp(header->magic, "SCNB", 4) != 0)
+  {
+    error = "not a scene file";
+    return false;
+  }
+  if (header->version != VERSION)
+  {
+    error = "scene file version " + std::to_string(header->version) + ", expected " + std::to_string((int)VERSION);
+    return false;
+  }
+
+  // 64 bit sums, the counts come from the file
+  const uint64_t size = mSize;
+  if (header->fileSize != size
+    || header->nodeOffset % 4 || header->nodeOffset + (uint64_t)header->nodeCount * sizeof(NodeRecord) > size
+    || header->entityOffset % 4 || header->entityOffset + (uint64_t)header->entityCount * sizeof(EntityRecord) > size
+    || header->lightOffset % 4 || header->lightOffset + (uint64_t)header->lightCount * sizeof(LightRecord) > size
+    || header->valueOffset % 4 || header->valueOffset + (uint64_t)header->valueCount * sizeof(float) > size
+    || header->stringSize == 0 || header->stringOffset + (uint64_t)header->stringSize > size
+    || mData[header->stringOffset] != '\0' || mData[header->stringOffset + header->stringSize - 1] != '\0')
+  {
+    error = "truncated or damaged";
+    return false;
+  }
+
+  const NodeRecord* nodes = reinterpret_cast<const NodeRecord*>(mData + header->nodeOffset);
+  const EntityRecord* entities = reinterpret_cast<const EntityRecord*>(mData + header->entityOffset);
+  const LightRecord* lights = reinterpret_cast<const LightRecord*>(mData + header->lightOffset);
+  const uint32_t strings = header->stringSize;
+  const int32_t nodeCount = (int32_t)header->nodeCount;
+
+  for (int32_t i = 0; i < nodeCount; i++)
+  {
+    if (nodes[i].name >= strings || nodes[i].parent < -1 || nodes[i].parent >= i
+      || (nodes[i].parts & ~(uint32_t)(NODE_POSITION | NODE_ORIENTATION | NODE_SCALE))
+      || nodes[i].values + (uint64_t)countFloats(nodes[i].parts) > header->valueCount)
+    {
+      error = "bad node record " + std::to_string(i);
+      return false;
+    }
+  }
+  for (uint32_t i = 0; i < header->entityCount; i++)
+  {
+    const EntityRecord& entity = entities[i];
+    if (entity.name >= strings || entity.mesh == 0 || entity.mesh >= strings || entity.material >= strings
+      || entity.node < -1 || entity.node >= nodeCount)
+    {
+      error = "bad entity record " + std::to_string(i);
+      return false;
+    }
+  }
+  for (uint32_t i = 0; i < header->lightCount; i++)
+  {
+    const LightRecord& light = lights[i];
+    if (light.name >= strings || light.node < -1 || light.node >= nodeCount || light.type > LIGHT_SPOT)
+    {
+      error = "bad light record " + std::to_string(i);
+      return false;
+    }
+  }
+
+  mHeader = header;
+  mNodes = nodes;
+  mEntities = entities;
+  mLights = lights;
+  mValues = reinterpret_cast<const float*>(mData + header->valueOffset);
+  mStrings = mData + header->stringOffset;
+  return true;
+}
+
+void SceneFile::getPosition(const NodeRecord& node, float* position) const
+{
+  const float* value = _getPart(node, NODE_POSITION);
+  memcpy(position, value ? value : DEFAULT_POSITION, sizeof(DEFAULT_POSITION));
+}
+
+void SceneFile::getOrientation(const NodeRecord& node, float* orientation) const
+{
+  const float* value = _getPart(node, NODE_ORIENTATION);
+  memcpy(orientation, value ? value : DEFAULT_ORIENTATION, sizeof(DEFAULT_ORIENTATION));
+}
+
+void SceneFile::getScale(const NodeRecord& node, float* scale) const
+{
+  const float* value = _getPart(node, NODE_SCALE);
+  memcpy(scale, value ? value : DEFAULT_SCALE, sizeof(DEFAULT_SCALE));
+}
+
+const float* SceneFile::_getPart(const NodeRecord& node, uint32_t part) const
+{
+  if (!(node.parts & part))
+    return nullptr;
+  // the parts stored before this one
+  return mValues + node.values + countFloats(node.parts & (part - 1));
+}
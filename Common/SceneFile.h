@@ -0,0 +1,148 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Binary scene description: scene nodes, entities and lights as flat
+// arrays of fixed size records plus a value table and a string table. The
+// text form is compiled once; open() maps the binary file into memory and
+// the records are read in place, nothing is parsed at load time. A node
+// keeps only the parts of its transform that are not the default, in the
+// value table, where nodes with the same values share them.
+//
+// Text form, one object per line, '#' starts a comment. Values that are
+// vectors list their components separated by spaces:
+//
+//   node <name> [parent=<node>] [position=x y z] [orientation=w x y z]
+//               [yaw=degrees] [scale=s | x y z]
+//   entity <name> mesh=<mesh> [node=<node>] [material=<material>]
+//                 [shadows=on|off] [static=on|off] [visible=on|off]
+//   light <name> type=point|directional|spot [node=<node>] [position=x y z]
+//                [direction=x y z] [diffuse=r g b] [specular=r g b]
+//                [attenuation=range constant linear quadratic]
+//                [spot=inner outer [falloff]] [shadows=on|off] [visible=on|off]
+//
+// A node's parent must come before it, nodes without one hang under the
+// node the scene is loaded into. Entities without a node get an unnamed
+// node of their own. Node names of "-" stay unnamed.
+class SceneFile
+{
+public:
+  enum { VERSION = 2 };
+
+  enum LightType
+  {
+    LIGHT_POINT,
+    LIGHT_DIRECTIONAL,
+    LIGHT_SPOT
+  };
+
+  enum Flags
+  {
+    FLAG_SHADOWS = 1,
+    FLAG_STATIC = 2,
+    FLAG_VISIBLE = 4
+  };
+
+  // parts of a node transform stored in the value table
+  enum NodeParts
+  {
+    NODE_POSITION = 1,      // 3 floats
+    NODE_ORIENTATION = 2,   // 4 floats, w x y z
+    NODE_SCALE = 4          // 3 floats
+  };
+
+  // offsets in bytes from the start of the file, strings are offsets into
+  // the string table (0 is the empty string)
+  struct Header
+  {
+    char magic[4];   // "SCNB"
+    uint32_t version;
+    uint32_t fileSize;
+    uint32_t nodeCount, nodeOffset;
+    uint32_t entityCount, entityOffset;
+    uint32_t lightCount, lightOffset;
+    uint32_t valueCount, valueOffset;   // floats
+    uint32_t stringSize, stringOffset;
+  };
+
+  struct NodeRecord
+  {
+    uint32_t name;
+    int32_t parent;   // node index, -1 for the load parent
+    uint32_t parts;   // NodeParts stored, in that order
+    uint32_t values;  // index of the first in the value table
+  };
+
+  struct EntityRecord
+  {
+    uint32_t name;
+    uint32_t mesh;
+    uint32_t material;   // 0 keeps the mesh's materials
+    int32_t node;        // -1 for a node of its own
+    uint32_t flags;
+  };
+
+  struct LightRecord
+  {
+    uint32_t name;
+    int32_t node;        // -1 for the load parent
+    uint32_t type;
+    uint32_t flags;
+    float position[3];
+    float direction[3];
+    float diffuse[3];
+    float specular[3];
+    float attenuation[4];
+    float spot[3];       // inner and outer angle in degrees, falloff
+  };
+
+  // text to binary, false with the line number in error when the text is wrong
+  static bool compile(const std::string& text, std::vector<char>& binary, std::string& error);
+  static bool compileFile(const std::string& textFile, const std::string& binaryFile, std::string& error);
+  // the binary file is missing or older than the text file
+  static bool isOutOfDate(const std::string& textFile, const std::string& binaryFile);
+
+  SceneFile();
+  ~SceneFile();
+
+  // maps the file and checks the header and the record references
+  bool open(const std::string& binaryFile, std::string& error);
+  void close(void);
+
+  int getNodeCount(void) const { return mHeader ? (int)mHeader->nodeCount : 0; }
+  int getEntityCount(void) const { return mHeader ? (int)mHeader->entityCount : 0; }
+  int getLightCount(void) const { return mHeader ? (int)mHeader->lightCount : 0; }
+  const NodeRecord* getNodes(void) const { return mNodes; }
+  const EntityRecord* getEntities(void) const { return mEntities; }
+  const LightRecord* getLights(void) const { return mLights; }
+  // a node's transform, the default where the node leaves it out
+  void getPosition(const NodeRecord& node, float* position) const;
+  void getOrientation(const NodeRecord& node, float* orientation) const;
+  void getScale(const NodeRecord& node, float* scale) const;
+  const char* getString(uint32_t offset) const { return mStrings + offset; }
+  size_t getSize(void) const { return mSize; }
+
+private:
+  SceneFile(const SceneFile&);
+  SceneFile& operator=(const SceneFile&);
+
+  bool _validate(std::string& error);
+  const float* _getPart(const NodeRecord& node, uint32_t part) const;
+
+  const char* mData;
+  size_t mSize;
+#ifdef _WIN32
+  void* mFile;
+  void* mMapping;
+#endif
+
+  const Header* mHeader;
+  const NodeRecord* mNodes;
+  const EntityRecord* mEntities;
+  const LightRecord* mLights;
+  const float* mValues;
+  const char* mStrings;
+};
@@ -0,0 +1,116 @@
+#include "SceneLoader.h"
+#include "StaticSceneBaker.h"
+
+using namespace Ogre;
+
+SceneLoader::Result SceneLoader::load(SceneManager* sceneMgr, const String& textFile, SceneNode* parent)
+{
+  Result result;
+  result.compileMs = result.loadMs = 0.0f;
+
+  const String binaryFile = textFile + ".bin";
+  String error;
+  Timer timer;
+  const bool outOfDate = SceneFile::isOutOfDate(textFile, binaryFile);
+  if (outOfDate)
+  {
+    if (!SceneFile::compileFile(textFile, binaryFile, error))
+      OGRE_EXCEPT(Exception::ERR_INVALIDPARAMS, error, "SceneLoader::load");
+    result.compileMs = timer.getMicroseconds() / 1000.0f;
+    timer.reset();
+  }
+
+  SceneFile file;
+  if (!file.open(binaryFile, error) && !outOfDate)
+  {
+    // written for an older version of the format, or damaged
+    LogManager::getSingleton().logMessage("SceneLoader: " + error + ", compiling " + textFile + " again");
+    if (!SceneFile::compileFile(textFile, binaryFile, error))
+      OGRE_EXCEPT(Exception::ERR_INVALIDPARAMS, error, "SceneLoader::load");
+    result.compileMs = timer.getMicroseconds() / 1000.0f;
+    timer.reset();
+    file.open(binaryFile, error);
+  }
+  if (!file.getSize())
+    OGRE_EXCEPT(Exception::ERR_FILE_NOT_FOUND, error, "SceneLoader::load");
+  instantiate(sceneMgr, file, parent ? parent : sceneMgr->getRootSceneNode(), result);
+  result.loadMs = timer.getMicroseconds() / 1000.0f;
+
+  LogManager::getSingleton().stream() << "SceneLoader: " << textFile << ", " << result.nodes.size() << " nodes, "
+    << result.entities.size() << " entities, " << result.lights.size() << " lights from " << file.getSize()
+    << " bytes in " << result.loadMs << " ms" << (result.compileMs > 0.0f ? " after compiling in " : "")
+    << (result.compileMs > 0.0f ? StringConverter::toString(result.compileMs) + " ms" : "");
+  return result;
+}
+
+void SceneLoader::instantiate(SceneManager* sceneMgr, const SceneFile& file, SceneNode* parent, Result& result)
+{
+  const size_t firstNode = result.nodes.size();
+  result.nodes.reserve(firstNode + file.getNodeCount());
+  result.entities.reserve(result.entities.size() + file.getEntityCount());
+  result.lights.reserve(result.lights.size() + file.getLightCount());
+
+  // parents always come first
+  const SceneFile::NodeRecord* nodes = file.getNodes();
+  for (int i = 0; i < file.getNodeCount(); i++)
+  {
+    const SceneFile::NodeRecord& record = nodes[i];
+    SceneNode* nodeParent = (record.parent < 0) ? parent : result.nodes[firstNode + record.parent];
+    float position[3], orientation[4], scale[3];
+    file.getPosition(record, position);
+    file.getOrientation(record, orientation);
+    file.getScale(record, scale);
+
+    const Quaternion rotation(orientation[0], orientation[1], orientation[2], orientation[3]);
+    SceneNode* node = record.name
+      ? nodeParent->createChildSceneNode(file.getString(record.name), Vector3(position), rotation)
+      : nodeParent->createChildSceneNode(Vector3(position), rotation);
+    node->setScale(Vector3(scale));
+    result.nodes.push_back(node);
+  }
+
+  const SceneFile::EntityRecord* entities = file.getEntities();
+  for (int i = 0; i < file.getEntityCount(); i++)
+  {
+    const SceneFile::EntityRecord& record = entities[i];
+    Entity* entity = sceneMgr->createEntity(file.getString(record.name), file.getString(record.mesh));
+    if (record.material)
+      entity->setMaterialName(file.getString(record.material));
+    entity->setCastShadows((record.flags & SceneFile::FLAG_SHADOWS) != 0);
+    entity->setVisible((record.flags & SceneFile::FLAG_VISIBLE) != 0);
+
+    SceneNode* node = (record.node < 0) ? parent->createChildSceneNode() : result.nodes[firstNode + record.node];
+    node->attachObject(entity);
+    if (record.flags & SceneFile::FLAG_STATIC)
+      StaticSceneBaker::markStatic(entity);
+    result.entities.push_back(entity);
+  }
+
+  const SceneFile::LightRecord* lights = file.getLights();
+  for (int i = 0; i < file.getLightCount(); i++)
+  {
+    const SceneFile::LightRecord& record = lights[i];
+    Light* light = sceneMgr->createLight(file.getString(record.name));
+    switch (record.type)
+    {
+    case SceneFile::LIGHT_POINT: light->setType(Light::LT_POINT); break;
+    case SceneFile::LIGHT_DIRECTIONAL: light->setType(Light::LT_DIRECTIONAL); break;
+    case SceneFile::LIGHT_SPOT: light->setType(Light::LT_SPOTLIGHT); break;
+    }
+    light->setPosition(Vector3(record.position));
+    light->setDirection(Vector3(record.direction));
+    light->setDiffuseColour(record.diffuse[0], record.diffuse[1], record.diffuse[2]);
+    light->setSpecularColour(record.specular[0], record.specular[1], record.specular[2]);
+    light->setAttenuation(record.attenuation[0], record.attenuation[1], record.attenuation[2], record.attenuation[3]);
+    light->setSpotlightRange(Degree(record.spot[0]), Degree(record.spot[1]), record.spot[2]);
+    light->setCastShadows((record.flags & SceneFile::FLAG_SHADOWS) != 0);
+    light->setVisible((record.flags & SceneFile::FLAG_VISIBLE) != 0);
+
+    // lights without a node stay in world space when loaded into the root
+    if (record.node >= 0)
+      result.nodes[firstNode + record.node]->attachObject(light);
+    else if (parent != sceneMgr->getRootSceneNode())
+      parent->attachObject(light);
+    result.lights.push_back(light);
+  }
+}
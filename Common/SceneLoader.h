@@ -0,0 +1,31 @@
+#pragma once
+
+#include <Ogre.h>
+
+#include <vector>
+
+#include "SceneFile.h"
+
+// Creates the scene nodes, entities and lights of a SceneFile. load()
+// takes the text file, compiles it next to itself (light.scn becomes
+// light.scn.bin) when the binary is missing or older, maps the binary and
+// instantiates it, so after the first start only the binary is read.
+//
+// Entities marked static are handed to StaticSceneBaker::markStatic().
+// Errors in the file throw Ogre::Exception.
+class SceneLoader
+{
+public:
+  struct Result
+  {
+    std::vector<Ogre::SceneNode*> nodes;   // in file order
+    std::vector<Ogre::Entity*> entities;
+    std::vector<Ogre::Light*> lights;
+    float compileMs;                       // 0 when the binary was up to date
+    float loadMs;                          // mapping and instantiation
+  };
+
+  // parent null loads into the root scene node
+  static Result load(Ogre::SceneManager* sceneMgr, const Ogre::String& textFile, Ogre::SceneNode* parent = nullptr);
+  static void instantiate(Ogre::SceneManager* sceneMgr, const SceneFile& file, Ogre::SceneNode* parent, Result& result);
+};
@@ -0,0 +1,137 @@
+#include "SceneManagerSelector.h"
+#include "LooseGridSceneManager.h"
+
+#include <fstream>
+
+using namespace Ogre;
+
+namespace
+{
+  // Installed with the root so the root tells it when it shuts down, the
+  // way the octree plugin takes its factory out again before the scene
+  // managers go away
+  class LooseGridPlugin : public Plugin
+  {
+  public:
+    const String& getName(void) const
+    {
+      static const String name = "LooseGridPlugin";
+      return name;
+    }
+
+    void install(void) { Root::getSingleton().addSceneManagerFactory(&mFactory); }
+    void initialise(void) {}
+    void shutdown(void) { Root::getSingleton().removeSceneManagerFactory(&mFactory); }
+    void uninstall(void) {}
+
+  private:
+    LooseGridSceneManagerFactory mFactory;
+  };
+
+  LooseGridPlugin looseGridPlugin;
+}
+
+
+SceneManagerSelector::Settings::Settings()
+  : type("generic"), octreeDepth(8),
+  octreeSize(-10000.0f, -10000.0f, -10000.0f, 10000.0f, 10000.0f, 10000.0f),
+  cellSize(250.0f), cellsPerSide(64)
+{
+}
+
+SceneManagerSelector::Settings SceneManagerSelector::load(const String& fileName)
+{
+  Settings settings;
+
+  std::ifstream file(fileName.c_str());
+  if (!file)
+    return settings;
+
+  ConfigFile config;
+  config.load(fileName, "\t:=", true);
+
+  settings.type = config.getSetting("SceneManager", BLANKSTRING, settings.type);
+  StringUtil::toLowerCase(settings.type);
+
+  settings.octreeDepth = StringConverter::parseInt(config.getSetting("OctreeDepth"), settings.octreeDepth);
+  settings.cellSize = StringConverter::parseReal(config.getSetting("LooseGridCellSize"), settings.cellSize);
+  settings.cellsPerSide = StringConverter::parseInt(config.getSetting("LooseGridCells"), settings.cellsPerSide);
+
+  const StringVector size = StringUtil::split(config.getSetting("OctreeSize"));
+  if (size.size() == 6)
+  {
+    settings.octreeSize.setExtents(
+      StringConverter::parseReal(size[0]), StringConverter::parseReal(size[1]), StringConverter::parseReal(size[2]),
+      StringConverter::parseReal(size[3]), StringConverter::parseReal(size[4]), StringConverter::parseReal(size[5]));
+  }
+  return settings;
+}
+
+SceneManager* SceneManagerSelector::create(Root* root, const String& instanceName, const Settings& settings)
+{
+  registerFactories(root);
+
+  SceneManager* sceneMgr = nullptr;
+  if (settings.type == "octree")
+  {
+    if (isAvailable(root, "OctreeSceneManager"))
+    {
+      sceneMgr = root->createSceneManager("OctreeSceneManager", instanceName);
+      int depth = settings.octreeDepth;
+      AxisAlignedBox size = settings.octreeSize;
+      sceneMgr->setOption("Depth", &depth);
+      sceneMgr->setOption("Size", &size);
+    }
+    else
+    {
+      LogManager::getSingleton().logMessage("SceneManagerSelector: OctreeSceneManager is not loaded, using the generic scene manager");
+      sceneMgr = root->createSceneManager(ST_GENERIC, instanceName);
+    }
+  }
+  else if (settings.type == "loosegrid")
+  {
+    sceneMgr = root->createSceneManager(LooseGridSceneManager::TYPE_NAME, instanceName);
+    Real cellSize = settings.cellSize;
+    int cellsPerSide = settings.cellsPerSide;
+    sceneMgr->setOption("CellSize", &cellSize);
+    sceneMgr->setOption("CellsPerSide", &cellsPerSide);
+  }
+  else if (settings.type == "generic")
+  {
+    sceneMgr = root->createSceneManager(ST_GENERIC, instanceName);
+  }
+  else
+  {
+    OGRE_EXCEPT(Exception::ERR_INVALIDPARAMS, "Unknown scene manager type '" + settings.type + "'",
+      "SceneManagerSelector::create");
+  }
+
+  LogManager::getSingleton().stream() << "SceneManagerSelector: created " << sceneMgr->getTypeName()
+    << " '" << sceneMgr->getName() << "'";
+  return sceneMgr;
+}
+
+SceneManager* SceneManagerSelector::create(Root* root, const String& instanceName, const String& fileName)
+{
+  return create(root, instanceName, load(fileName));
+}
+
+void SceneManagerSelector::registerFactories(Root* root)
+{
+  // a root that was shut down has taken the factory out again
+  if (isAvailable(root, LooseGridSceneManager::TYPE_NAME))
+    return;
+
+  root->installPlugin(&looseGridPlugin);
+}
+
+bool SceneManagerSelector::isAvailable(Root* root, const String& typeName)
+{
+  SceneManagerEnumerator::MetaDataIterator it = root->getSceneManagerMetaDataIterator();
+  while (it.hasMoreElements())
+  {
+    if (it.getNext()->typeName == typeName)
+      return true;
+  }
+  return false;
+}
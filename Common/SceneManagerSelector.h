@@ -0,0 +1,42 @@
+#pragma once
+
+#include <Ogre.h>
+
+// Picks the scene manager type at run time from a plugins.cfg style file
+// (scene.cfg next to the executable):
+//
+//   # generic, octree or loosegrid
+//   SceneManager=octree
+//   OctreeDepth=8
+//   OctreeSize=-10000 -10000 -10000 10000 10000 10000
+//   LooseGridCellSize=250
+//   LooseGridCells=64
+//
+// Without the file the labs keep the generic scene manager they always used.
+// If the octree plugin is not loaded the generic one is used and a warning
+// is logged.
+class SceneManagerSelector
+{
+public:
+  struct Settings
+  {
+    Ogre::String type;
+    int octreeDepth;
+    Ogre::AxisAlignedBox octreeSize;
+    Ogre::Real cellSize;
+    int cellsPerSide;
+
+    Settings();
+  };
+
+  static Settings load(const Ogre::String& fileName = "scene.cfg");
+
+  static Ogre::SceneManager* create(Ogre::Root* root, const Ogre::String& instanceName, const Settings& settings);
+  static Ogre::SceneManager* create(Ogre::Root* root, const Ogre::String& instanceName = Ogre::BLANKSTRING,
+    const Ogre::String& fileName = "scene.cfg");
+
+  // registers the loose grid factory with the root once; it is taken out
+  // again when that root shuts down
+  static void registerFactories(Ogre::Root* root);
+  static bool isAvailable(Ogre::Root* root, const Ogre::String& typeName);
+};
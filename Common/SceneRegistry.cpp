@@ -0,0 +1,253 @@
+#include "SceneRegistry.h"
+#include "ObjectListeners.h"
+
+using namespace Ogre;
+
+template<> SceneRegistry* Singleton<SceneRegistry>::msSingleton = 0;
+
+SceneRegistry& SceneRegistry::getSingleton(void)
+{
+  assert(msSingleton);
+  return *msSingleton;
+}
+
+SceneRegistry* SceneRegistry::getSingletonPtr(void)
+{
+  return msSingleton;
+}
+
+
+SceneRegistry::SceneRegistry()
+{
+}
+
+SceneRegistry::~SceneRegistry()
+{
+  clear();
+}
+
+NodeHandle SceneRegistry::add(SceneNode* node)
+{
+  SlotMap::iterator it = mNodeSlots.find(static_cast<Node*>(node));
+  if (it != mNodeSlots.end())
+    return mNodes.getHandleAt(it->second);
+
+  NodeHandle handle = mNodes.add(node, node->getName());
+  mNodeSlots[static_cast<Node*>(node)] = handle.index;
+  _listenTo(node);
+  return handle;
+}
+
+EntityHandle SceneRegistry::add(Entity* entity)
+{
+  SlotMap::iterator it = mEntitySlots.find(static_cast<MovableObject*>(entity));
+  if (it != mEntitySlots.end())
+    return mEntities.getHandleAt(it->second);
+
+  EntityHandle handle = mEntities.add(entity, entity->getName());
+  mEntitySlots[static_cast<MovableObject*>(entity)] = handle.index;
+  _listenTo(entity);
+  return handle;
+}
+
+LightHandle SceneRegistry::add(Light* light)
+{
+  SlotMap::iterator it = mLightSlots.find(static_cast<MovableObject*>(light));
+  if (it != mLightSlots.end())
+    return mLights.getHandleAt(it->second);
+
+  LightHandle handle = mLights.add(light, light->getName());
+  mLightSlots[static_cast<MovableObject*>(light)] = handle.index;
+  _listenTo(light);
+  return handle;
+}
+
+CameraHandle SceneRegistry::add(Camera* camera)
+{
+  SlotMap::iterator it = mCameraSlots.find(static_cast<MovableObject*>(camera));
+  if (it != mCameraSlots.end())
+    return mCameras.getHandleAt(it->second);
+
+  CameraHandle handle = mCameras.add(camera, camera->getName());
+  mCameraSlots[static_cast<MovableObject*>(camera)] = handle.index;
+  _listenTo(camera);
+  return handle;
+}
+
+AnimationHandle SceneRegistry::addAnimation(EntityHandle entity, const String& animation)
+{
+  Entity* owner = get(entity);
+  if (!owner)
+    OGRE_EXCEPT(Exception::ERR_INVALIDPARAMS, "Stale entity handle", "SceneRegistry::addAnimation");
+
+  return mAnimations.add(owner->getAnimationState(animation), owner->getName() + "/" + animation, entity.index + 1);
+}
+
+void SceneRegistry::remove(NodeHandle handle)
+{
+  SceneNode* node = get(handle);
+  if (!node)
+    return;
+
+  _stopListening(node);
+  mNodeSlots.erase(static_cast<Node*>(node));
+  mNodes.remove(handle);
+}
+
+void SceneRegistry::remove(EntityHandle handle)
+{
+  Entity* entity = get(handle);
+  if (!entity)
+    return;
+
+  _stopListening(entity);
+  mEntitySlots.erase(static_cast<MovableObject*>(entity));
+  _forgetEntity(handle.index);
+}
+
+void SceneRegistry::remove(LightHandle handle)
+{
+  Light* light = get(handle);
+  if (!light)
+    return;
+
+  _stopListening(light);
+  mLightSlots.erase(static_cast<MovableObject*>(light));
+  mLights.remove(handle);
+}
+
+void SceneRegistry::remove(CameraHandle handle)
+{
+  Camera* camera = get(handle);
+  if (!camera)
+    return;
+
+  _stopListening(camera);
+  mCameraSlots.erase(static_cast<MovableObject*>(camera));
+  mCameras.remove(handle);
+}
+
+void SceneRegistry::clear(void)
+{
+  // the objects outlive the registry, stop them from calling back
+  for (uint32_t i = 0; i < mNodes.getSlotCount(); i++)
+    remove(mNodes.getHandleAt(i));
+  for (uint32_t i = 0; i < mEntities.getSlotCount(); i++)
+    remove(mEntities.getHandleAt(i));
+  for (uint32_t i = 0; i < mLights.getSlotCount(); i++)
+    remove(mLights.getHandleAt(i));
+  for (uint32_t i = 0; i < mCameras.getSlotCount(); i++)
+    remove(mCameras.getHandleAt(i));
+  mAnimations.clear();
+}
+
+void SceneRegistry::logContents(void) const
+{
+  LogManager::getSingleton().stream() << "SceneRegistry: " << mNodes.size() << " nodes, " << mEntities.size()
+    << " entities, " << mLights.size() << " lights, " << mCameras.size() << " cameras, "
+    << mAnimations.size() << " animation states";
+
+  for (uint32_t i = 0; i < mEntities.getSlotCount(); i++)
+  {
+    if (mEntities.getAt(i))
+      LogManager::getSingleton().stream() << "  entity " << i << ": " << mEntities.getNameAt(i);
+  }
+}
+
+void SceneRegistry::nodeUpdated(const Node* node)
+{
+  if (Node::Listener* previous = _previous(node))
+    previous->nodeUpdated(node);
+}
+
+void SceneRegistry::nodeDestroyed(const Node* node)
+{
+  _forget(mNodes, mNodeSlots, node);
+
+  Node::Listener* previous = _previous(node);
+  mNodeListeners.erase(node);
+  if (previous)
+    previous->nodeDestroyed(node);
+}
+
+void SceneRegistry::nodeAttached(const Node* node)
+{
+  if (Node::Listener* previous = _previous(node))
+    previous->nodeAttached(node);
+}
+
+void SceneRegistry::nodeDetached(const Node* node)
+{
+  if (Node::Listener* previous = _previous(node))
+    previous->nodeDetached(node);
+}
+
+void SceneRegistry::objectDestroyed(MovableObject* object)
+{
+  SlotMap::iterator it = mEntitySlots.find(object);
+  if (it != mEntitySlots.end())
+  {
+    const uint32_t index = it->second;
+    mEntitySlots.erase(it);
+    _forgetEntity(index);
+  }
+  else if (!_forget(mLights, mLightSlots, object))
+  {
+    _forget(mCameras, mCameraSlots, object);
+  }
+}
+
+void SceneRegistry::_listenTo(Node* node)
+{
+  // still in the node's chain from an earlier add
+  if (mNodeListeners.count(node))
+    return;
+
+  mNodeListeners[node] = node->getListener();
+  node->setListener(this);
+}
+
+void SceneRegistry::_listenTo(MovableObject* object)
+{
+  ObjectListeners::add(object, this);
+}
+
+void SceneRegistry::_stopListening(Node* node)
+{
+  // a listener set after ours calls us as its previous one, we stay in the
+  // chain and only pass the calls on
+  if (node->getListener() != this)
+    return;
+
+  node->setListener(_previous(node));
+  mNodeListeners.erase(node);
+}
+
+void SceneRegistry::_stopListening(MovableObject* object)
+{
+  ObjectListeners::remove(object, this);
+}
+
+Node::Listener* SceneRegistry::_previous(const Node* node) const
+{
+  NodeListenerMap::const_iterator it = mNodeListeners.find(node);
+  return it != mNodeListeners.end() ? it->second : nullptr;
+}
+
+void SceneRegistry::_forgetEntity(uint32_t index)
+{
+  mAnimations.removeOwnedBy(index + 1);
+  mEntities.removeAt(index);
+}
+
+template <typename T>
+bool SceneRegistry::_forget(HandleTable<T>& table, SlotMap& slots, const void* object)
+{
+  SlotMap::iterator it = slots.find(object);
+  if (it == slots.end())
+    return false;
+
+  table.removeAt(it->second);
+  slots.erase(it);
+  return true;
+}
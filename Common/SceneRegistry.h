@@ -0,0 +1,238 @@
+#pragma once
+
+#include <Ogre.h>
+
+#include <cstdint>
+#include <vector>
+#include <unordered_map>
+
+// Handle to an object in the SceneRegistry: a slot index plus the
+// generation the slot had when the object was registered. When the object
+// is destroyed its slot gets a new generation, so old handles resolve to
+// null instead of to whatever reuses the slot.
+template <typename T>
+struct SceneHandle
+{
+  uint32_t index;
+  uint32_t generation;   // 0 is never handed out
+
+  SceneHandle() : index(0), generation(0) {}
+  SceneHandle(uint32_t i, uint32_t g) : index(i), generation(g) {}
+
+  bool isNull(void) const { return generation == 0; }
+  bool operator==(const SceneHandle& other) const { return index == other.index && generation == other.generation; }
+  bool operator!=(const SceneHandle& other) const { return !(*this == other); }
+};
+
+typedef SceneHandle<Ogre::SceneNode> NodeHandle;
+typedef SceneHandle<Ogre::Entity> EntityHandle;
+typedef SceneHandle<Ogre::Light> LightHandle;
+typedef SceneHandle<Ogre::Camera> CameraHandle;
+typedef SceneHandle<Ogre::AnimationState> AnimationHandle;
+
+
+// Slot array behind one handle type, get() is an index and a compare.
+template <typename T>
+class HandleTable
+{
+public:
+  SceneHandle<T> add(T* object, const Ogre::String& name, uint32_t owner = 0)
+  {
+    uint32_t index;
+    if (!mFree.empty())
+    {
+      index = mFree.back();
+      mFree.pop_back();
+    }
+    else
+    {
+      index = (uint32_t)mSlots.size();
+      mSlots.push_back(Slot());
+    }
+
+    Slot& slot = mSlots[index];
+    slot.object = object;
+    slot.name = name;
+    slot.owner = owner;
+    return SceneHandle<T>(index, slot.generation);
+  }
+
+  T* get(SceneHandle<T> handle) const
+  {
+    if (handle.index >= mSlots.size() || mSlots[handle.index].generation != handle.generation)
+      return nullptr;
+    return mSlots[handle.index].object;
+  }
+
+  void remove(SceneHandle<T> handle)
+  {
+    if (get(handle))
+      _release(handle.index);
+  }
+
+  void removeAt(uint32_t index)
+  {
+    if (index < mSlots.size() && mSlots[index].object)
+      _release(index);
+  }
+
+  // removes every object registered with the given owner
+  void removeOwnedBy(uint32_t owner)
+  {
+    for (uint32_t i = 0; i < mSlots.size(); i++)
+    {
+      if (mSlots[i].object && mSlots[i].owner == owner)
+        _release(i);
+    }
+  }
+
+  SceneHandle<T> find(const Ogre::String& name) const
+  {
+    for (uint32_t i = 0; i < mSlots.size(); i++)
+    {
+      if (mSlots[i].object && mSlots[i].name == name)
+        return SceneHandle<T>(i, mSlots[i].generation);
+    }
+    return SceneHandle<T>();
+  }
+
+  const Ogre::String& getName(SceneHandle<T> handle) const
+  {
+    return get(handle) ? mSlots[handle.index].name : Ogre::BLANKSTRING;
+  }
+
+  // live objects, for walking the table
+  uint32_t getSlotCount(void) const { return (uint32_t)mSlots.size(); }
+  T* getAt(uint32_t index) const { return mSlots[index].object; }
+  SceneHandle<T> getHandleAt(uint32_t index) const { return SceneHandle<T>(index, mSlots[index].generation); }
+  const Ogre::String& getNameAt(uint32_t index) const { return mSlots[index].name; }
+
+  void clear(void)
+  {
+    for (uint32_t i = 0; i < mSlots.size(); i++)
+    {
+      if (mSlots[i].object)
+        _release(i);
+    }
+  }
+
+  size_t size(void) const { return mSlots.size() - mFree.size(); }
+
+private:
+  struct Slot
+  {
+    T* object;
+    uint32_t generation;
+    uint32_t owner;
+    Ogre::String name;
+
+    Slot() : object(nullptr), generation(1), owner(0) {}
+  };
+
+  void _release(uint32_t index)
+  {
+    Slot& slot = mSlots[index];
+    slot.object = nullptr;
+    slot.name.clear();
+    slot.generation = (slot.generation == UINT32_MAX) ? 1 : slot.generation + 1;
+    mFree.push_back(index);
+  }
+
+  std::vector<Slot> mSlots;
+  std::vector<uint32_t> mFree;
+};
+
+
+// Central table of the scene objects controllers work with. The scene set
+// up code registers what it creates and hands the typed handles to the
+// controllers, which resolve them in O(1) instead of looking names up in the
+// scene manager. The registry listens to registered nodes and movable
+// objects, so destroying them (clearScene included) invalidates their
+// handles; animation states go away with their entity. A node listener set
+// before is kept and called for every event, and removing a node only puts
+// it back while the registry is still the one set. Movable objects are
+// listened to through ObjectListeners, which other modules share.
+//
+// Names are only kept for tools and logs, find() is a linear search.
+class SceneRegistry : public Ogre::Singleton<SceneRegistry>,
+  public Ogre::Node::Listener,
+  public Ogre::MovableObject::Listener
+{
+public:
+  SceneRegistry();
+  ~SceneRegistry();
+
+  NodeHandle add(Ogre::SceneNode* node);
+  EntityHandle add(Ogre::Entity* entity);
+  LightHandle add(Ogre::Light* light);
+  CameraHandle add(Ogre::Camera* camera);
+  AnimationHandle addAnimation(EntityHandle entity, const Ogre::String& animation);
+
+  Ogre::SceneNode* get(NodeHandle handle) const { return mNodes.get(handle); }
+  Ogre::Entity* get(EntityHandle handle) const { return mEntities.get(handle); }
+  Ogre::Light* get(LightHandle handle) const { return mLights.get(handle); }
+  Ogre::Camera* get(CameraHandle handle) const { return mCameras.get(handle); }
+  Ogre::AnimationState* get(AnimationHandle handle) const { return mAnimations.get(handle); }
+
+  void remove(NodeHandle handle);
+  void remove(EntityHandle handle);
+  void remove(LightHandle handle);
+  void remove(CameraHandle handle);
+  void remove(AnimationHandle handle) { mAnimations.remove(handle); }
+  void clear(void);
+
+  // tooling only
+  NodeHandle findNode(const Ogre::String& name) const { return mNodes.find(name); }
+  EntityHandle findEntity(const Ogre::String& name) const { return mEntities.find(name); }
+  LightHandle findLight(const Ogre::String& name) const { return mLights.find(name); }
+  CameraHandle findCamera(const Ogre::String& name) const { return mCameras.find(name); }
+  const Ogre::String& getName(NodeHandle handle) const { return mNodes.getName(handle); }
+  const Ogre::String& getName(EntityHandle handle) const { return mEntities.getName(handle); }
+  const Ogre::String& getName(LightHandle handle) const { return mLights.getName(handle); }
+  const Ogre::String& getName(CameraHandle handle) const { return mCameras.getName(handle); }
+  const Ogre::String& getName(AnimationHandle handle) const { return mAnimations.getName(handle); }
+  void logContents(void) const;
+
+  // Node::Listener
+  void nodeUpdated(const Ogre::Node* node);
+  void nodeDestroyed(const Ogre::Node* node);
+  void nodeAttached(const Ogre::Node* node);
+  void nodeDetached(const Ogre::Node* node);
+
+  // MovableObject::Listener
+  void objectDestroyed(Ogre::MovableObject* object);
+
+  static SceneRegistry& getSingleton(void);
+  static SceneRegistry* getSingletonPtr(void);
+
+private:
+  typedef std::unordered_map<const void*, uint32_t> SlotMap;
+  typedef std::unordered_map<const Ogre::Node*, Ogre::Node::Listener*> NodeListenerMap;
+
+  void _listenTo(Ogre::Node* node);
+  void _listenTo(Ogre::MovableObject* object);
+  void _stopListening(Ogre::Node* node);
+  void _stopListening(Ogre::MovableObject* object);
+  Ogre::Node::Listener* _previous(const Ogre::Node* node) const;
+
+  void _forgetEntity(uint32_t index);
+  template <typename T>
+  static bool _forget(HandleTable<T>& table, SlotMap& slots, const void* object);
+
+  HandleTable<Ogre::SceneNode> mNodes;
+  HandleTable<Ogre::Entity> mEntities;
+  HandleTable<Ogre::Light> mLights;
+  HandleTable<Ogre::Camera> mCameras;
+  HandleTable<Ogre::AnimationState> mAnimations;   // owner is the entity slot + 1
+
+  // slots by Node/MovableObject base pointer, only needed when an object
+  // reports its destruction (its type cannot be asked for from there)
+  SlotMap mNodeSlots;
+  SlotMap mEntitySlots;
+  SlotMap mLightSlots;
+  SlotMap mCameraSlots;
+
+  // the listeners the nodes had before the registry, null included, for as
+  // long as the registry is in their chain
+  NodeListenerMap mNodeListeners;
+};
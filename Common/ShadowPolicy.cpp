@@ -0,0 +1,351 @@
+#include "ShadowPolicy.h"
+
+#include <algorithm>
+#include <fstream>
+
+using namespace Ogre;
+
+namespace
+{
+  bool byImportance(const std::pair<Real, Light*>& a, const std::pair<Real, Light*>& b)
+  {
+    return a.first > b.first;
+  }
+}
+
+
+ShadowPolicy::Settings::Settings()
+  : technique(TECHNIQUE_STENCIL), maxShadowLights(2), casterDistance(1500.0f), casterScreenSize(0.02f),
+  textureSize(1024), cacheStaticMaps(true)
+{
+}
+
+ShadowPolicy::Settings ShadowPolicy::load(const String& fileName)
+{
+  Settings settings;
+
+  std::ifstream file(fileName.c_str());
+  if (!file)
+    return settings;
+
+  ConfigFile config;
+  config.load(fileName, "\t:=", true);
+
+  const String technique = config.getSetting("ShadowTechnique", BLANKSTRING, "stencil");
+  settings.technique = (technique == "texture") ? TECHNIQUE_TEXTURE : TECHNIQUE_STENCIL;
+  settings.maxShadowLights = StringConverter::parseInt(config.getSetting("MaxShadowLights"), settings.maxShadowLights);
+  settings.casterDistance = StringConverter::parseReal(config.getSetting("CasterDistance"), settings.casterDistance);
+  settings.casterScreenSize = StringConverter::parseReal(config.getSetting("CasterScreenSize"), settings.casterScreenSize);
+  settings.textureSize = StringConverter::parseInt(config.getSetting("ShadowTextureSize"), settings.textureSize);
+  settings.cacheStaticMaps = StringConverter::parseBool(config.getSetting("CacheStaticShadowMaps"), settings.cacheStaticMaps);
+  return settings;
+}
+
+ShadowPolicy::ShadowPolicy(SceneManager* sceneMgr, Camera* camera, const Settings& settings)
+  : mSceneMgr(sceneMgr), mCamera(camera), mSettings(settings), mMapIndex(0), mMainPass(false)
+{
+  memset(&mStats, 0, sizeof(mStats));
+
+  mSettings.maxShadowLights = std::max(mSettings.maxShadowLights, 1);
+  mSceneMgr->setShadowFarDistance(mSettings.casterDistance);
+  setTechnique(mSettings.technique);
+
+  mSceneMgr->addListener(this);
+}
+
+ShadowPolicy::~ShadowPolicy()
+{
+  mSceneMgr->removeListener(this);
+
+  // hand back what the policy turned off; lights are looked up in the scene
+  // since some may be gone already
+  SceneManager::MovableObjectIterator it = mSceneMgr->getMovableObjectIterator(LightFactory::FACTORY_TYPE_NAME);
+  while (it.hasMoreElements())
+  {
+    Light* light = static_cast<Light*>(it.getNext());
+    if (mLights.count(light))
+      light->setCastShadows(true);
+  }
+
+  for (size_t i = 0; i < mCasters.size(); i++)
+    mCasters[i].entity->setCastShadows(true);
+
+  for (size_t i = 0; i < mMaps.size() && i < mSceneMgr->getShadowTextureCount(); i++)
+  {
+    Viewport* viewport = mSceneMgr->getShadowTexture(i)->getBuffer()->getRenderTarget()->getViewport(0);
+    viewport->setVisibilityMask(0xFFFFFFFF);
+    viewport->setClearEveryFrame(true);
+  }
+}
+
+void ShadowPolicy::addCaster(Entity* entity, bool isStatic)
+{
+  for (size_t i = 0; i < mCasters.size(); i++)
+  {
+    if (mCasters[i].entity == entity)
+    {
+      mCasters[i].isStatic = isStatic;
+      return;
+    }
+  }
+
+  Caster caster;
+  caster.entity = entity;
+  caster.isStatic = isStatic;
+  caster.active = true;
+  mCasters.push_back(caster);
+
+  entity->setCastShadows(true);
+}
+
+void ShadowPolicy::addAllCasters(void)
+{
+  SceneManager::MovableObjectIterator it = mSceneMgr->getMovableObjectIterator(EntityFactory::FACTORY_TYPE_NAME);
+  while (it.hasMoreElements())
+  {
+    Entity* entity = static_cast<Entity*>(it.getNext());
+    if (entity->getCastShadows())
+      addCaster(entity);
+  }
+}
+
+void ShadowPolicy::removeCaster(Entity* entity)
+{
+  for (size_t i = 0; i < mCasters.size(); i++)
+  {
+    if (mCasters[i].entity == entity)
+    {
+      entity->setCastShadows(true);
+      mCasters.erase(mCasters.begin() + i);
+      return;
+    }
+  }
+}
+
+void ShadowPolicy::setTechnique(Technique technique)
+{
+  mSettings.technique = technique;
+  mMaps.clear();
+
+  if (technique == TECHNIQUE_TEXTURE)
+  {
+    mSceneMgr->setShadowTextureSize((unsigned short)mSettings.textureSize);
+    mSceneMgr->setShadowTextureCount(mSettings.maxShadowLights);
+    mSceneMgr->setShadowColour(ColourValue(0.5f, 0.5f, 0.5f));
+    mSceneMgr->setShadowTechnique(SHADOWTYPE_TEXTURE_MODULATIVE);
+  }
+  else
+  {
+    mSceneMgr->setShadowTechnique(SHADOWTYPE_STENCIL_ADDITIVE);
+  }
+
+  LogManager::getSingleton().logMessage(String("ShadowPolicy: ") + getTechniqueName() + " shadows");
+}
+
+const char* ShadowPolicy::getTechniqueName(void) const
+{
+  return mSettings.technique == TECHNIQUE_TEXTURE ? "texture" : "stencil";
+}
+
+void ShadowPolicy::logStats(void) const
+{
+  Log::Stream log = LogManager::getSingleton().stream();
+  log << "ShadowPolicy (" << getTechniqueName() << "): " << mStats.shadowLights << " shadow lights ("
+    << mStats.lightsLimited << " limited), " << mStats.casters << " casters (" << mStats.castersCulled << " culled), ";
+  if (mSettings.technique == TECHNIQUE_TEXTURE)
+    log << mStats.mapsRendered << " shadow maps rendered, " << mStats.mapsCached << " cached";
+  else
+    log << mStats.volumes << " shadow volumes";
+}
+
+void ShadowPolicy::postUpdateSceneGraph(SceneManager* source, Camera* camera)
+{
+  // shadow texture cameras update the graph as well
+  if (source->_getCurrentRenderStage() == SceneManager::IRS_RENDER_TO_TEXTURE)
+    return;
+
+  mMainPass = camera == mCamera;
+  if (!mMainPass)
+    return;
+
+  mStats.mapsRendered = mStats.mapsCached = 0;
+  mMapIndex = 0;
+
+  _limitLights();
+  _cullCasters();
+  _countVolumes();
+}
+
+void ShadowPolicy::shadowTextureCasterPreViewProj(Light* light, Camera* camera, size_t iteration)
+{
+  if (mSettings.technique != TECHNIQUE_TEXTURE)
+    return;
+
+  const size_t index = mMainPass ? mMapIndex++ : mSceneMgr->getShadowTextureCount();
+  if (mMaps.size() < mSceneMgr->getShadowTextureCount())
+    mMaps.resize(mSceneMgr->getShadowTextureCount());
+
+  // Ogre draws the maps every frame; a cached map is kept by letting its
+  // viewport see nothing and skip the clear
+  if (index >= mMaps.size())
+  {
+    // another camera's maps, drawn in full and not cached
+    for (size_t i = 0; i < mMaps.size(); i++)
+    {
+      Viewport* viewport = mSceneMgr->getShadowTexture(i)->getBuffer()->getRenderTarget()->getViewport(0);
+      viewport->setVisibilityMask(0xFFFFFFFF);
+      viewport->setClearEveryFrame(true);
+      mMaps[i].valid = false;
+    }
+    return;
+  }
+
+  MapState current;
+  current.light = light;
+  current.lightPosition = light->getDerivedPosition();
+  current.lightDirection = light->getDerivedDirection();
+  current.cameraPosition = mCamera->getDerivedPosition();
+  current.cameraOrientation = mCamera->getDerivedOrientation();
+  current.valid = true;
+
+  const MapState& last = mMaps[index];
+  const bool cached = mSettings.cacheStaticMaps && last.valid && last.light == light && !mDirty[light]
+    && last.lightPosition == current.lightPosition && last.lightDirection == current.lightDirection
+    && last.cameraPosition == current.cameraPosition && last.cameraOrientation == current.cameraOrientation;
+
+  Viewport* viewport = mSceneMgr->getShadowTexture(index)->getBuffer()->getRenderTarget()->getViewport(0);
+  viewport->setVisibilityMask(cached ? 0 : 0xFFFFFFFF);
+  viewport->setClearEveryFrame(!cached);
+
+  if (cached)
+  {
+    mStats.mapsCached++;
+  }
+  else
+  {
+    mMaps[index] = current;
+    mStats.mapsRendered++;
+  }
+}
+
+Real ShadowPolicy::_getImportance(const Light* light) const
+{
+  const ColourValue& colour = light->getDiffuseColour();
+  const Real luminance = 0.3f * colour.r + 0.59f * colour.g + 0.11f * colour.b;
+
+  // the sun is always the first to cast
+  if (light->getType() == Light::LT_DIRECTIONAL)
+    return 1000.0f + luminance;
+
+  const Real range = light->getAttenuationRange();
+  const Real distance = light->getDerivedPosition().distance(mCamera->getDerivedPosition());
+  return luminance * range / (range + distance);
+}
+
+bool ShadowPolicy::_isInRange(const Light* light, const Entity* entity) const
+{
+  if (light->getType() == Light::LT_DIRECTIONAL)
+    return true;
+
+  const AxisAlignedBox& box = entity->getWorldBoundingBox(true);
+  if (box.isNull() || box.isInfinite())
+    return true;
+
+  return light->getDerivedPosition().distance(box.getCenter()) - box.getHalfSize().length() <= light->getAttenuationRange();
+}
+
+void ShadowPolicy::_limitLights(void)
+{
+  std::vector<std::pair<Real, Light*> > lights;
+
+  SceneManager::MovableObjectIterator it = mSceneMgr->getMovableObjectIterator(LightFactory::FACTORY_TYPE_NAME);
+  while (it.hasMoreElements())
+  {
+    Light* light = static_cast<Light*>(it.getNext());
+
+    // lights that never cast are not the policy's business
+    if (!mLights.count(light))
+    {
+      if (!light->getCastShadows())
+        continue;
+      mLights[light] = true;
+    }
+
+    if (light->getVisible())
+      lights.push_back(std::make_pair(_getImportance(light), light));
+  }
+
+  std::sort(lights.begin(), lights.end(), byImportance);
+
+  mShadowLights.clear();
+  mStats.shadowLights = mStats.lightsLimited = 0;
+  for (size_t i = 0; i < lights.size(); i++)
+  {
+    const bool casts = (int)i < mSettings.maxShadowLights;
+    lights[i].second->setCastShadows(casts);
+    mLights[lights[i].second] = casts;
+
+    if (casts)
+    {
+      mShadowLights.push_back(lights[i].second);
+      mStats.shadowLights++;
+    }
+    else
+      mStats.lightsLimited++;
+  }
+}
+
+void ShadowPolicy::_cullCasters(void)
+{
+  const Vector3 eye = mCamera->getDerivedPosition();
+  const Real tanHalfFov = Math::Tan(mCamera->getFOVy() * 0.5f);
+
+  mStats.casters = mStats.castersCulled = 0;
+  for (size_t i = 0; i < mCasters.size(); i++)
+  {
+    Caster& caster = mCasters[i];
+    bool active = caster.entity->isInScene() && caster.entity->getVisible();
+
+    const AxisAlignedBox& box = caster.entity->getWorldBoundingBox(true);
+    if (active && !box.isNull() && !box.isInfinite())
+    {
+      const Real radius = box.getHalfSize().length();
+      const Real distance = eye.distance(box.getCenter());
+      const Real screenSize = radius / (std::max(distance, Real(1.0f)) * tanHalfFov);
+      active = distance - radius <= mSettings.casterDistance && screenSize >= mSettings.casterScreenSize;
+
+      if (!active)
+        mStats.castersCulled++;
+    }
+
+    if (active != caster.active || caster.entity->getCastShadows() != active)
+      caster.entity->setCastShadows(active);
+    caster.active = active;
+
+    if (active)
+      mStats.casters++;
+  }
+}
+
+void ShadowPolicy::_countVolumes(void)
+{
+  // one volume per caster and shadow light that reaches it; Ogre 1.9 does not
+  // report the volumes it builds, this counts what it is asked to build
+  mStats.volumes = 0;
+  mDirty.clear();
+
+  for (size_t light = 0; light < mShadowLights.size(); light++)
+  {
+    for (size_t i = 0; i < mCasters.size(); i++)
+    {
+      const Caster& caster = mCasters[i];
+      if (!caster.active || !_isInRange(mShadowLights[light], caster.entity))
+        continue;
+
+      if (mSettings.technique == TECHNIQUE_STENCIL)
+        mStats.volumes++;
+      if (!caster.isStatic)
+        mDirty[mShadowLights[light]] = true;
+    }
+  }
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <Ogre.h>
+
+#include <map>
+#include <vector>
+
+// Keeps the shadow cost of a scene from growing with casters x lights.
+// Every frame of the main camera it
+//   - lets only the most important lights cast shadows (directional
+//     lights first, then by brightness and distance to the camera),
+//   - stops casters that are too far away or too small on screen from
+//     casting,
+//   - with texture shadows, reuses the shadow map of a light that saw no
+//     change (light, camera and dynamic casters in its range) since it was
+//     last rendered, so maps holding only static casters are drawn once.
+// Settings come from an optional shadow.cfg:
+//
+//   # stencil (additive) or texture (modulative)
+//   ShadowTechnique=stencil
+//   MaxShadowLights=2
+//   CasterDistance=1500
+//   # bounding radius over half the view height at that distance
+//   CasterScreenSize=0.02
+//   ShadowTextureSize=1024
+//   CacheStaticShadowMaps=true
+class ShadowPolicy : public Ogre::SceneManager::Listener
+{
+public:
+  enum Technique
+  {
+    TECHNIQUE_STENCIL,
+    TECHNIQUE_TEXTURE
+  };
+
+  struct Settings
+  {
+    Technique technique;
+    int maxShadowLights;
+    Ogre::Real casterDistance;
+    Ogre::Real casterScreenSize;
+    int textureSize;
+    bool cacheStaticMaps;
+
+    Settings();
+  };
+
+  // per frame of the main camera
+  struct Stats
+  {
+    int shadowLights;    // lights casting shadows
+    int lightsLimited;   // shadow lights turned off by the policy
+    int casters;         // casters casting
+    int castersCulled;   // casters turned off by distance or screen size
+    int volumes;         // stencil: caster and light pairs that build a shadow volume
+    int mapsRendered;    // texture: shadow maps drawn
+    int mapsCached;      // texture: shadow maps reused
+  };
+
+  static Settings load(const Ogre::String& fileName = "shadow.cfg");
+
+  ShadowPolicy(Ogre::SceneManager* sceneMgr, Ogre::Camera* camera, const Settings& settings = load());
+  ~ShadowPolicy();
+
+  // static casters never invalidate a cached shadow map
+  void addCaster(Ogre::Entity* entity, bool isStatic = false);
+  // every entity that casts shadows right now, as a dynamic caster
+  void addAllCasters(void);
+  void removeCaster(Ogre::Entity* entity);
+
+  void setTechnique(Technique technique);
+  Technique getTechnique(void) const { return mSettings.technique; }
+  const char* getTechniqueName(void) const;
+
+  const Stats& getStats(void) const { return mStats; }
+  void logStats(void) const;
+
+  // SceneManager::Listener
+  void postUpdateSceneGraph(Ogre::SceneManager* source, Ogre::Camera* camera);
+  void shadowTextureCasterPreViewProj(Ogre::Light* light, Ogre::Camera* camera, size_t iteration);
+
+private:
+  struct Caster
+  {
+    Ogre::Entity* entity;
+    bool isStatic;
+    bool active;
+  };
+
+  // what a shadow map was rendered from
+  struct MapState
+  {
+    const Ogre::Light* light;
+    Ogre::Vector3 lightPosition;
+    Ogre::Vector3 lightDirection;
+    Ogre::Vector3 cameraPosition;
+    Ogre::Quaternion cameraOrientation;
+    bool valid;
+
+    MapState() : light(nullptr), valid(false) {}
+  };
+
+  Ogre::Real _getImportance(const Ogre::Light* light) const;
+  bool _isInRange(const Ogre::Light* light, const Ogre::Entity* entity) const;
+  void _limitLights(void);
+  void _cullCasters(void);
+  void _countVolumes(void);
+
+  Ogre::SceneManager* mSceneMgr;
+  Ogre::Camera* mCamera;
+  Settings mSettings;
+
+  std::vector<Caster> mCasters;
+  std::map<const Ogre::Light*, bool> mLights;  // shadow lights before the policy, casting this frame
+  std::vector<Ogre::Light*> mShadowLights;     // casting this frame
+  std::map<const Ogre::Light*, bool> mDirty;   // a dynamic caster is in range this frame
+
+  std::vector<MapState> mMaps;
+  size_t mMapIndex;
+  bool mMainPass;   // the shadow maps being drawn are the main camera's
+
+  Stats mStats;
+};
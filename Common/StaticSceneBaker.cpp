@@ -0,0 +1,162 @@
+#include "StaticSceneBaker.h"
+
+#include <set>
+
+using namespace Ogre;
+
+namespace
+{
+  const char* STATIC_BINDING = "StaticSceneBaker";
+}
+
+
+StaticSceneBaker::StaticSceneBaker(SceneManager* sceneMgr, const String& name, const Vector3& regionSize)
+  : mSceneMgr(sceneMgr), mName(name), mRegionSize(regionSize), mCastShadows(false), mGeometry(nullptr)
+{
+  mStats.entities = mStats.batchesBefore = mStats.batchesAfter = mStats.regions = 0;
+}
+
+StaticSceneBaker::~StaticSceneBaker()
+{
+  if (mGeometry)
+    mSceneMgr->destroyStaticGeometry(mGeometry);
+}
+
+void StaticSceneBaker::markStatic(Entity* entity)
+{
+  entity->getUserObjectBindings().setUserAny(STATIC_BINDING, Any(true));
+}
+
+bool StaticSceneBaker::isStatic(Entity* entity)
+{
+  return !entity->getUserObjectBindings().getUserAny(STATIC_BINDING).isEmpty();
+}
+
+void StaticSceneBaker::createTiledGround(SceneManager* sceneMgr, const String& name, const String& material,
+  Real size, int tiles)
+{
+  const Real tileSize = size / tiles;
+  MeshManager::getSingleton().createPlane(name + "/Tile", ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME,
+    Plane(Vector3::UNIT_Y, 0.0f), tileSize, tileSize, 1, 1, true, 1, 1.0f, 1.0f, Vector3::NEGATIVE_UNIT_Z);
+
+  SceneNode* root = sceneMgr->getRootSceneNode()->createChildSceneNode(name + "Node");
+  for (int z = 0; z < tiles; z++)
+  {
+    for (int x = 0; x < tiles; x++)
+    {
+      Entity* entity = sceneMgr->createEntity(name + "/" + StringConverter::toString(z * tiles + x), name + "/Tile");
+      entity->setMaterialName(material);
+      entity->setCastShadows(false);
+      markStatic(entity);
+
+      const Vector3 centre((x + 0.5f) * tileSize - size * 0.5f, 0.0f, (z + 0.5f) * tileSize - size * 0.5f);
+      root->createChildSceneNode(centre)->attachObject(entity);
+    }
+  }
+}
+
+const StaticSceneBaker::Stats& StaticSceneBaker::bake(void)
+{
+  if (mGeometry)
+    mSceneMgr->destroyStaticGeometry(mGeometry);
+  mGeometry = nullptr;
+
+  mStats.entities = mStats.batchesBefore = mStats.batchesAfter = mStats.regions = 0;
+
+  // collect first, destroying while iterating would invalidate the iterator
+  std::vector<Entity*> baked;
+  SceneManager::MovableObjectIterator it = mSceneMgr->getMovableObjectIterator("Entity");
+  while (it.hasMoreElements())
+  {
+    Entity* entity = static_cast<Entity*>(it.getNext());
+    SceneNode* node = entity->getParentSceneNode();
+    if (!node || !isStatic(entity) || entity->hasSkeleton())
+      continue;
+
+    mStats.batchesBefore += (int)entity->getNumSubEntities();
+    baked.push_back(entity);
+  }
+
+  // a StaticGeometry only pays off when sub entities share a material in a
+  // region; otherwise it draws as many batches and the entities lose their
+  // own culling, so they are left as they are
+  if (_countMergedBatches(baked) >= mStats.batchesBefore)
+  {
+    mStats.batchesAfter = mStats.batchesBefore;
+    LogManager::getSingleton().stream() << "StaticSceneBaker " << mName << ": " << baked.size()
+      << " entities, " << mStats.batchesBefore << " batches, no material shared within a region, left as entities";
+    return mStats;
+  }
+
+  mGeometry = mSceneMgr->createStaticGeometry(mName);
+  mGeometry->setRegionDimensions(mRegionSize);
+  mGeometry->setOrigin(-mRegionSize * 0.5f);
+  mGeometry->setCastShadows(mCastShadows);
+  for (size_t i = 0; i < baked.size(); i++)
+  {
+    SceneNode* node = baked[i]->getParentSceneNode();
+    mGeometry->addEntity(baked[i], node->_getDerivedPosition(), node->_getDerivedOrientation(), node->_getDerivedScale());
+  }
+
+  for (size_t i = 0; i < baked.size(); i++)
+  {
+    baked[i]->detachFromParent();
+    mSceneMgr->destroyEntity(baked[i]);
+  }
+  mStats.entities = (int)baked.size();
+
+  mGeometry->build();
+  _countBatches();
+
+  LogManager::getSingleton().stream() << "StaticSceneBaker " << mName << ": " << mStats.entities
+    << " entities, " << mStats.batchesBefore << " batches -> " << mStats.batchesAfter
+    << " batches in " << mStats.regions << " regions";
+
+  return mStats;
+}
+
+int StaticSceneBaker::_countMergedBatches(const std::vector<Entity*>& entities) const
+{
+  // StaticGeometry places each entity in the region holding the centre of
+  // its world bounds and keeps one bucket per material there
+  std::set<std::pair<String, String> > buckets;
+  for (size_t i = 0; i < entities.size(); i++)
+  {
+    const Vector3 centre = entities[i]->getWorldBoundingBox(true).getCenter();
+    const Vector3 cell = centre / mRegionSize + Vector3(0.5f);
+    const String region = StringConverter::toString((int)Math::Floor(cell.x)) + ","
+      + StringConverter::toString((int)Math::Floor(cell.y)) + "," + StringConverter::toString((int)Math::Floor(cell.z));
+    for (unsigned int s = 0; s < entities[i]->getNumSubEntities(); s++)
+      buckets.insert(std::make_pair(region, entities[i]->getSubEntity(s)->getMaterialName()));
+  }
+  return (int)buckets.size();
+}
+
+void StaticSceneBaker::_countBatches(void)
+{
+  mStats.batchesAfter = mStats.regions = 0;
+
+  StaticGeometry::RegionIterator regions = mGeometry->getRegionIterator();
+  while (regions.hasMoreElements())
+  {
+    StaticGeometry::Region* region = regions.getNext();
+    mStats.regions++;
+
+    // full detail only, lower LODs replace it rather than add to it
+    StaticGeometry::Region::LODIterator lods = region->getLODIterator();
+    if (!lods.hasMoreElements())
+      continue;
+
+    StaticGeometry::LODBucket::MaterialIterator materials = lods.getNext()->getMaterialIterator();
+    while (materials.hasMoreElements())
+    {
+      StaticGeometry::MaterialBucket* material = materials.getNext();
+      StaticGeometry::MaterialBucket::GeometryIterator geometry = material->getGeometryIterator();
+      while (geometry.hasMoreElements())
+      {
+        geometry.getNext();
+        mStats.batchesAfter++;
+      }
+    }
+  }
+}
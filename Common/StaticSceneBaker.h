@@ -0,0 +1,63 @@
+#pragma once
+
+#include <Ogre.h>
+
+#include <vector>
+
+// Scene build step for content that never moves. Entities are marked with
+// markStatic() while the scene is set up; bake() then moves every marked
+// entity into an Ogre StaticGeometry, which merges them per region and
+// material so they are culled and drawn as a few large batches. The scene
+// nodes stay in place (other code may still look them up), only the
+// entities are destroyed. When no two marked sub entities share a material
+// within a region there is nothing to merge and bake() leaves them alone.
+//
+// Regions are centred on the origin, so a scene built around it that fits
+// in one region is baked into one batch per material.
+class StaticSceneBaker
+{
+public:
+  struct Stats
+  {
+    int entities;        // entities baked
+    int batchesBefore;   // sub entities, one batch each
+    int batchesAfter;    // geometry buckets at full detail
+    int regions;
+  };
+
+  StaticSceneBaker(Ogre::SceneManager* sceneMgr, const Ogre::String& name,
+    const Ogre::Vector3& regionSize = Ogre::Vector3(1000.0f, 1000.0f, 1000.0f));
+  ~StaticSceneBaker();
+
+  static void markStatic(Ogre::Entity* entity);
+  static bool isStatic(Ogre::Entity* entity);
+
+  // a size x size ground on the XZ plane, centred on the origin, as tiles x
+  // tiles static entities "<name>/<i>" sharing material, each with the
+  // texture once: the same look as one plane with the texture repeated
+  // tiles times, and what bake() merges into a batch per region
+  static void createTiledGround(Ogre::SceneManager* sceneMgr, const Ogre::String& name,
+    const Ogre::String& material, Ogre::Real size, int tiles);
+
+  void setRegionSize(const Ogre::Vector3& size) { mRegionSize = size; }
+  void setCastShadows(bool cast) { mCastShadows = cast; }
+
+  // collects the marked entities, builds the geometry and logs the batch counts;
+  // getStaticGeometry() stays null when nothing was merged
+  const Stats& bake(void);
+  const Stats& getStats(void) const { return mStats; }
+
+  Ogre::StaticGeometry* getStaticGeometry(void) const { return mGeometry; }
+
+private:
+  int _countMergedBatches(const std::vector<Ogre::Entity*>& entities) const;
+  void _countBatches(void);
+
+  Ogre::SceneManager* mSceneMgr;
+  Ogre::String mName;
+  Ogre::Vector3 mRegionSize;
+  bool mCastShadows;
+
+  Ogre::StaticGeometry* mGeometry;
+  Stats mStats;
+};
@@ -0,0 +1,143 @@
+#include "StreamedWorld.h"
+
+using namespace Ogre;
+
+namespace
+{
+  const char* GROUND_MATERIAL = "StreamedWorld/Ground";
+}
+
+
+StreamedWorld::Settings::Settings()
+  : lowColour(0.25f, 0.35f, 0.15f), highColour(0.45f, 0.6f, 0.3f)
+{
+}
+
+
+StreamedWorld::StreamedWorld(SceneManager* sceneMgr, SceneNode* focus, const Settings& settings)
+  : mSceneMgr(sceneMgr), mFocus(focus), mSettings(settings), mLastFrame((unsigned long)-1), mAttachMs(0.0f)
+{
+  _createMaterial();
+  for (size_t i = 0; i < mSettings.propMeshes.size(); i++)
+    MeshManager::getSingleton().load(mSettings.propMeshes[i], ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME);
+  mSettings.streaming.propKinds = (int)mSettings.propMeshes.size();
+
+  mStreamer = new TileStreamer(mSettings.streaming, this);
+  mSceneMgr->addListener(this);
+}
+
+StreamedWorld::~StreamedWorld()
+{
+  mSceneMgr->removeListener(this);
+  logStats();
+  mStreamer->clear();
+  delete mStreamer;
+}
+
+void StreamedWorld::preload(void)
+{
+  const Vector3 position = mFocus->_getDerivedPosition();
+  mStreamer->update(position.x, position.z);
+  mStreamer->flush();
+}
+
+void StreamedWorld::logStats(void) const
+{
+  const TileStreamer::Stats& stats = mStreamer->getStats();
+  LogManager::getSingleton().stream() << "StreamedWorld: " << stats.resident << " tiles resident ("
+    << stats.residentBytes / 1024 << " KB, peak " << stats.peakBytes / 1024 << " KB), " << stats.loading
+    << " loading, " << stats.waiting << " held back by the caps; " << stats.loaded << " loaded, " << stats.unloaded
+    << " unloaded (" << stats.evicted << " evicted), " << stats.cancelled << " cancelled; latency "
+    << stats.averageLatencyMs << " ms average, " << stats.maxLatencyMs << " ms worst, " << stats.averageLoadMs
+    << " ms generating a tile, " << (stats.loaded ? mAttachMs / stats.loaded : 0.0f) << " ms attaching one";
+}
+
+void StreamedWorld::preUpdateSceneGraph(SceneManager* source, Camera* camera)
+{
+  // once per frame, not once per camera
+  const unsigned long frame = Root::getSingleton().getNextFrameNumber();
+  if (frame == mLastFrame)
+    return;
+  mLastFrame = frame;
+
+  const Vector3 position = mFocus->_getDerivedPosition();
+  mStreamer->update(position.x, position.z);
+}
+
+void StreamedWorld::attachTile(const WorldTile& tile)
+{
+  Timer timer;
+  TileObjects objects;
+  objects.node = mSceneMgr->getRootSceneNode()->createChildSceneNode();
+
+  // vertices are in world space, the tile node stays at the origin
+  objects.ground = mSceneMgr->createManualObject();
+  objects.ground->setCastShadows(false);
+  objects.ground->estimateVertexCount(tile.getVertexCount());
+  objects.ground->estimateIndexCount(tile.indices.size());
+  objects.ground->begin(GROUND_MATERIAL, RenderOperation::OT_TRIANGLE_LIST);
+
+  const Vector3 sun = Vector3(0.4f, 0.8f, 0.45f).normalisedCopy();
+  const float* vertex = &tile.vertices[0];
+  for (int i = 0; i < tile.getVertexCount(); i++, vertex += WorldTile::FLOATS_PER_VERTEX)
+  {
+    // the material is unlit, the slopes are shaded here once
+    const Vector3 normal(vertex[3], vertex[4], vertex[5]);
+    const float height = 1.0f + vertex[1] / WorldTile::HEIGHT_RANGE;
+    const float shade = 0.55f + 0.45f * std::max(normal.dotProduct(sun), 0.0f);
+    ColourValue colour = mSettings.lowColour + (mSettings.highColour - mSettings.lowColour) * height;
+    colour = colour * shade;
+    colour.a = 1.0f;
+
+    objects.ground->position(vertex[0], vertex[1], vertex[2]);
+    objects.ground->normal(normal);
+    objects.ground->colour(colour);
+    objects.ground->textureCoord(vertex[6], vertex[7]);
+  }
+  for (size_t i = 0; i < tile.indices.size(); i++)
+    objects.ground->index(tile.indices[i]);
+  objects.ground->end();
+  objects.node->attachObject(objects.ground);
+
+  for (size_t i = 0; i < tile.props.size(); i++)
+  {
+    const WorldTile::Prop& prop = tile.props[i];
+    Entity* entity = mSceneMgr->createEntity(mSettings.propMeshes[prop.kind]);
+    entity->setCastShadows(false);
+
+    SceneNode* node = objects.node->createChildSceneNode(Vector3(prop.position),
+      Quaternion(Radian(prop.yaw), Vector3::UNIT_Y));
+    node->setScale(prop.scale, prop.scale, prop.scale);
+    node->attachObject(entity);
+    objects.props.push_back(entity);
+  }
+
+  mTiles[WorldTile::key(tile.x, tile.z)] = objects;
+  mAttachMs += timer.getMicroseconds() / 1000.0f;
+}
+
+void StreamedWorld::detachTile(const WorldTile& tile)
+{
+  auto it = mTiles.find(WorldTile::key(tile.x, tile.z));
+  if (it == mTiles.end())
+    return;
+
+  TileObjects& objects = it->second;
+  for (size_t i = 0; i < objects.props.size(); i++)
+    mSceneMgr->destroyEntity(objects.props[i]);
+  mSceneMgr->destroyManualObject(objects.ground);
+  objects.node->removeAndDestroyAllChildren();
+  mSceneMgr->destroySceneNode(objects.node);
+  mTiles.erase(it);
+}
+
+void StreamedWorld::_createMaterial(void)
+{
+  MaterialPtr material = MaterialManager::getSingleton().getByName(GROUND_MATERIAL);
+  if (!material.isNull())
+    return;
+
+  material = MaterialManager::getSingleton().create(GROUND_MATERIAL, ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME);
+  material->setReceiveShadows(false);
+  material->getTechnique(0)->setLightingEnabled(false);
+}
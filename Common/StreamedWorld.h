@@ -0,0 +1,64 @@
+#pragma once
+
+#include <Ogre.h>
+
+#include <unordered_map>
+
+#include "TileStreamer.h"
+
+// Ground tiles and props streamed in around a focus node, usually the
+// controlled character. A TileStreamer generates the tiles on its threads;
+// before every scene graph update this class moves it to the focus node's
+// position and turns the tiles it hands over into a ManualObject for the
+// ground and one entity per prop, and destroys those of the tiles it lets
+// go of.
+//
+// Prop kinds index propMeshes, the meshes are loaded up front so the first
+// tile that uses one does not stall the frame.
+class StreamedWorld : public Ogre::SceneManager::Listener,
+  public TileStreamer::Listener
+{
+public:
+  struct Settings
+  {
+    TileStreamer::Settings streaming;
+    Ogre::StringVector propMeshes;
+    Ogre::ColourValue lowColour, highColour;   // ground at its lowest and highest
+
+    Settings();
+  };
+
+  StreamedWorld(Ogre::SceneManager* sceneMgr, Ogre::SceneNode* focus, const Settings& settings = Settings());
+  ~StreamedWorld();
+
+  // blocks until the tiles around the focus node are in, for the first frame
+  void preload(void);
+
+  const TileStreamer::Stats& getStats(void) const { return mStreamer->getStats(); }
+  void logStats(void) const;
+
+  // SceneManager::Listener
+  void preUpdateSceneGraph(Ogre::SceneManager* source, Ogre::Camera* camera);
+
+  // TileStreamer::Listener
+  void attachTile(const WorldTile& tile);
+  void detachTile(const WorldTile& tile);
+
+private:
+  struct TileObjects
+  {
+    Ogre::SceneNode* node;
+    Ogre::ManualObject* ground;
+    std::vector<Ogre::Entity*> props;
+  };
+
+  void _createMaterial(void);
+
+  Ogre::SceneManager* mSceneMgr;
+  Ogre::SceneNode* mFocus;
+  Settings mSettings;
+  TileStreamer* mStreamer;
+  std::unordered_map<int64_t, TileObjects> mTiles;
+  unsigned long mLastFrame;
+  float mAttachMs;   // creating scene objects, all tiles
+};
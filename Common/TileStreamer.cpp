@@ -0,0 +1,475 @@
+#include "TileStreamer.h"
+#include "RandomStream.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+  float lattice(int64_t x, int64_t z, uint64_t seed)
+  {
+    // splitmix64 of the lattice point
+    uint64_t h = seed ^ ((uint64_t)x * 0x9e3779b97f4a7c15ULL) ^ ((uint64_t)z * 0xc2b2ae3d27d4eb4fULL);
+    h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+    return (h >> 40) * (1.0f / 16777216.0f);
+  }
+
+  float valueNoise(float x, float z, uint64_t seed)
+  {
+    const float fx = std::floor(x), fz = std::floor(z);
+    const int64_t ix = (int64_t)fx, iz = (int64_t)fz;
+    float tx = x - fx, tz = z - fz;
+    tx = tx * tx * (3.0f - 2.0f * tx);
+    tz = tz * tz * (3.0f - 2.0f * tz);
+
+    const float a = lattice(ix, iz, seed), b = lattice(ix + 1, iz, seed);
+    const float c = lattice(ix, iz + 1, seed), d = lattice(ix + 1, iz + 1, seed);
+    return (a + (b - a) * tx) + ((c + (d - c) * tx) - (a + (b - a) * tx)) * tz;
+  }
+}
+
+
+const float WorldTile::HEIGHT_RANGE = 12.0f;
+
+size_t WorldTile::getBytes(void) const
+{
+  return sizeof(WorldTile) + vertices.size() * sizeof(float) + indices.size() * sizeof(uint16_t)
+    + props.size() * sizeof(Prop);
+}
+
+size_t WorldTile::estimateBytes(int resolution, int propCount)
+{
+  const size_t vertexCount = (size_t)(resolution + 1) * (resolution + 1);
+  return sizeof(WorldTile) + vertexCount * FLOATS_PER_VERTEX * sizeof(float)
+    + (size_t)resolution * resolution * 6 * sizeof(uint16_t) + propCount * sizeof(Prop);
+}
+
+float WorldTile::height(float x, float z, uint64_t seed)
+{
+  const float n = valueNoise(x / 700.0f, z / 700.0f, seed) * 0.6f
+    + valueNoise(x / 230.0f, z / 230.0f, seed + 1) * 0.3f
+    + valueNoise(x / 80.0f, z / 80.0f, seed + 2) * 0.1f;
+  return -HEIGHT_RANGE * n;
+}
+
+void WorldTile::generate(WorldTile& tile, int x, int z, float size, int resolution, int propCount, int propKinds, uint64_t seed)
+{
+  const auto start = std::chrono::steady_clock::now();
+
+  tile.x = x;
+  tile.z = z;
+  tile.size = size;
+  tile.resolution = resolution;
+
+  const int side = resolution + 1;
+  const float step = size / resolution;
+  const float x0 = x * size, z0 = z * size;
+
+  tile.vertices.resize((size_t)side * side * FLOATS_PER_VERTEX);
+  float* vertex = &tile.vertices[0];
+  for (int j = 0; j < side; j++)
+  {
+    for (int i = 0; i < side; i++)
+    {
+      const float wx = x0 + i * step, wz = z0 + j * step;
+
+      // from the height function rather than the tile's own samples, so
+      // the normals on both sides of a tile edge agree
+      const float dx = height(wx + step, wz, seed) - height(wx - step, wz, seed);
+      const float dz = height(wx, wz + step, seed) - height(wx, wz - step, seed);
+      const float nx = -dx, ny = 2.0f * step, nz = -dz;
+      const float length = std::sqrt(nx * nx + ny * ny + nz * nz);
+
+      vertex[0] = wx;
+      vertex[1] = height(wx, wz, seed);
+      vertex[2] = wz;
+      vertex[3] = nx / length;
+      vertex[4] = ny / length;
+      vertex[5] = nz / length;
+      vertex[6] = (float)i / resolution;
+      vertex[7] = (float)j / resolution;
+      vertex += FLOATS_PER_VERTEX;
+    }
+  }
+
+  tile.indices.resize((size_t)resolution * resolution * 6);
+  uint16_t* index = &tile.indices[0];
+  for (int j = 0; j < resolution; j++)
+  {
+    for (int i = 0; i < resolution; i++)
+    {
+      // counter-clockwise seen from above
+      const uint16_t a = (uint16_t)(j * side + i), b = (uint16_t)(a + 1);
+      const uint16_t c = (uint16_t)(a + side), d = (uint16_t)(c + 1);
+      index[0] = a; index[1] = c; index[2] = b;
+      index[3] = b; index[4] = c; index[5] = d;
+      index += 6;
+    }
+  }
+
+  tile.props.clear();
+  if (propKinds > 0)
+  {
+    RandomStream random(seed, (uint64_t)key(x, z));
+    tile.props.resize(propCount);
+    for (int i = 0; i < propCount; i++)
+    {
+      Prop& prop = tile.props[i];
+      prop.position[0] = x0 + random.range(0.0f, size);
+      prop.position[2] = z0 + random.range(0.0f, size);
+      prop.position[1] = height(prop.position[0], prop.position[2], seed);
+      prop.yaw = random.range(0.0f, 6.2831853f);
+      prop.scale = random.range(0.6f, 1.4f);
+      prop.kind = random.range(0, propKinds - 1);
+    }
+  }
+
+  tile.loadMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+
+TileStreamer::Settings::Settings()
+  : tileSize(500.0f), resolution(32), propsPerTile(8), propKinds(1), loadRadius(1000.0f), unloadRadius(1500.0f),
+    memoryBudget(0), maxTiles(0), threads(2), maxAttachPerUpdate(2), seed(2016)
+{
+}
+
+TileStreamer::TileStreamer(const Settings& settings, Listener* listener)
+  : mSettings(settings), mListener(listener), mLatencySum(0.0), mLoadSum(0.0), mLoadCount(0), mBusy(0), mStopping(false)
+{
+  // 16 bit indices
+  mSettings.resolution = std::max(1, std::min(mSettings.resolution, 255));
+  mSettings.unloadRadius = std::max(mSettings.unloadRadius, mSettings.loadRadius);
+  mSettings.threads = std::max(1, mSettings.threads);
+  mEstimatedBytes = WorldTile::estimateBytes(mSettings.resolution, mSettings.propKinds > 0 ? mSettings.propsPerTile : 0);
+  memset(&mStats, 0, sizeof(mStats));
+
+  for (int i = 0; i < mSettings.threads; i++)
+    mThreads.push_back(std::thread(&TileStreamer::_run, this));
+}
+
+TileStreamer::~TileStreamer()
+{
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mStopping = true;
+  }
+  mWake.notify_all();
+  for (size_t i = 0; i < mThreads.size(); i++)
+    mThreads[i].join();
+
+  for (auto it = mEntries.begin(); it != mEntries.end(); ++it)
+    delete it->second.tile;
+  for (size_t i = 0; i < mDone.size(); i++)
+    delete mDone[i];
+}
+
+void TileStreamer::update(float x, float z)
+{
+  _collect();
+
+  // out of range
+  for (auto it = mEntries.begin(); it != mEntries.end();)
+  {
+    Entry& entry = it->second;
+    if (entry.cancelled || _distance(entry.x, entry.z, x, z) <= mSettings.unloadRadius)
+    {
+      ++it;
+      continue;
+    }
+
+    if (entry.state == STATE_RESIDENT)
+    {
+      auto next = std::next(it);
+      _unload(it);
+      mStats.unloaded++;
+      it = next;
+    }
+    else
+    {
+      auto next = std::next(it);
+      _cancel(it);
+      it = next;
+    }
+  }
+
+  // in range and not there yet, nearest first
+  std::vector<Request> wanted;
+  const int minX = tileCoordinate(x - mSettings.loadRadius), maxX = tileCoordinate(x + mSettings.loadRadius);
+  const int minZ = tileCoordinate(z - mSettings.loadRadius), maxZ = tileCoordinate(z + mSettings.loadRadius);
+  for (int tz = minZ; tz <= maxZ; tz++)
+  {
+    for (int tx = minX; tx <= maxX; tx++)
+    {
+      const float distance = _distance(tx, tz, x, z);
+      if (distance > mSettings.loadRadius)
+        continue;
+
+      auto it = mEntries.find(WorldTile::key(tx, tz));
+      if (it == mEntries.end())
+      {
+        Request request = { WorldTile::key(tx, tz), tx, tz, distance };
+        wanted.push_back(request);
+      }
+      else if (it->second.cancelled)
+        it->second.cancelled = false;   // back in range while it was loading
+    }
+  }
+  std::sort(wanted.begin(), wanted.end(), [](const Request& a, const Request& b) { return a.distance < b.distance; });
+
+  mStats.waiting = 0;
+  for (size_t i = 0; i < wanted.size(); i++)
+  {
+    const bool overBytes = mSettings.memoryBudget > 0 && _committedBytes() + mEstimatedBytes > mSettings.memoryBudget;
+    const bool overCount = mSettings.maxTiles > 0 && (int)mEntries.size() >= mSettings.maxTiles;
+    if ((overBytes || overCount) && !_makeRoom(x, z))
+    {
+      mStats.waiting = (int)(wanted.size() - i);
+      break;
+    }
+    _request(wanted[i].x, wanted[i].z, wanted[i].distance);
+  }
+
+  {
+    // where the position is now decides what is loaded next
+    std::lock_guard<std::mutex> lock(mMutex);
+    for (size_t i = 0; i < mQueue.size(); i++)
+      mQueue[i].distance = _distance(mQueue[i].x, mQueue[i].z, x, z);
+    std::sort(mQueue.begin(), mQueue.end(), [](const Request& a, const Request& b) { return a.distance > b.distance; });
+  }
+  if (!wanted.empty())
+    mWake.notify_all();
+
+  _attach(mSettings.maxAttachPerUpdate > 0 ? (size_t)mSettings.maxAttachPerUpdate : mReady.size());
+  _updateStats();
+}
+
+void TileStreamer::flush(void)
+{
+  {
+    std::unique_lock<std::mutex> lock(mMutex);
+    mIdle.wait(lock, [this] { return mQueue.empty() && mBusy == 0; });
+  }
+  _collect();
+  _attach(mReady.size());
+  _updateStats();
+}
+
+void TileStreamer::clear(void)
+{
+  _collect();
+  for (auto it = mEntries.begin(); it != mEntries.end();)
+  {
+    auto next = std::next(it);
+    if (it->second.state == STATE_RESIDENT)
+      _unload(it);
+    else if (!it->second.cancelled)
+      _cancel(it);
+    it = next;
+  }
+  _updateStats();
+}
+
+bool TileStreamer::isResident(int x, int z) const
+{
+  auto it = mEntries.find(WorldTile::key(x, z));
+  return it != mEntries.end() && it->second.state == STATE_RESIDENT;
+}
+
+int TileStreamer::tileCoordinate(float position) const
+{
+  return (int)std::floor(position / mSettings.tileSize);
+}
+
+float TileStreamer::_distance(int x, int z, float px, float pz) const
+{
+  const float size = mSettings.tileSize;
+  const float dx = std::max(std::max(x * size - px, px - (x + 1) * size), 0.0f);
+  const float dz = std::max(std::max(z * size - pz, pz - (z + 1) * size), 0.0f);
+  return std::sqrt(dx * dx + dz * dz);
+}
+
+size_t TileStreamer::_committedBytes(void) const
+{
+  size_t bytes = 0;
+  for (auto it = mEntries.begin(); it != mEntries.end(); ++it)
+    bytes += it->second.tile ? it->second.tile->getBytes() : mEstimatedBytes;
+  return bytes;
+}
+
+bool TileStreamer::_makeRoom(float px, float pz)
+{
+  // resident tiles kept only by the hysteresis, farthest first
+  std::vector<std::pair<float, int64_t> > spare;
+  for (auto it = mEntries.begin(); it != mEntries.end(); ++it)
+  {
+    const float distance = _distance(it->second.x, it->second.z, px, pz);
+    if (it->second.state == STATE_RESIDENT && distance > mSettings.loadRadius)
+      spare.push_back(std::make_pair(distance, it->first));
+  }
+  std::sort(spare.begin(), spare.end());
+
+  while (true)
+  {
+    const bool overBytes = mSettings.memoryBudget > 0 && _committedBytes() + mEstimatedBytes > mSettings.memoryBudget;
+    const bool overCount = mSettings.maxTiles > 0 && (int)mEntries.size() >= mSettings.maxTiles;
+    if (!overBytes && !overCount)
+      return true;
+    if (spare.empty())
+      return false;
+
+    _unload(mEntries.find(spare.back().second));
+    spare.pop_back();
+    mStats.unloaded++;
+    mStats.evicted++;
+  }
+}
+
+void TileStreamer::_request(int x, int z, float distance)
+{
+  Entry entry = { x, z, STATE_PENDING, false, nullptr, _now() };
+  mEntries[WorldTile::key(x, z)] = entry;
+
+  Request request = { WorldTile::key(x, z), x, z, distance };
+  std::lock_guard<std::mutex> lock(mMutex);
+  mQueue.push_back(request);
+}
+
+void TileStreamer::_cancel(std::unordered_map<int64_t, Entry>::iterator it)
+{
+  Entry& entry = it->second;
+  mStats.cancelled++;
+
+  if (entry.state == STATE_READY)
+  {
+    mReady.erase(std::find(mReady.begin(), mReady.end(), it->first));
+    delete entry.tile;
+    mEntries.erase(it);
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(mMutex);
+  for (size_t i = 0; i < mQueue.size(); i++)
+  {
+    if (mQueue[i].key == it->first)
+    {
+      mQueue.erase(mQueue.begin() + i);
+      if (mQueue.empty() && mBusy == 0)
+        mIdle.notify_all();
+      mEntries.erase(it);
+      return;
+    }
+  }
+
+  // a thread has it, dropped when it comes back
+  entry.cancelled = true;
+}
+
+void TileStreamer::_collect(void)
+{
+  std::vector<WorldTile*> done;
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    done.swap(mDone);
+  }
+
+  for (size_t i = 0; i < done.size(); i++)
+  {
+    WorldTile* tile = done[i];
+    mLoadSum += tile->loadMs;
+    mLoadCount++;
+
+    auto it = mEntries.find(WorldTile::key(tile->x, tile->z));
+    if (it == mEntries.end() || it->second.cancelled)
+    {
+      delete tile;
+      if (it != mEntries.end())
+        mEntries.erase(it);
+      continue;
+    }
+
+    it->second.state = STATE_READY;
+    it->second.tile = tile;
+    mReady.push_back(it->first);
+  }
+}
+
+void TileStreamer::_attach(size_t limit)
+{
+  const double now = _now();
+  size_t attached = 0;
+  for (; attached < limit && attached < mReady.size(); attached++)
+  {
+    Entry& entry = mEntries[mReady[attached]];
+    entry.state = STATE_RESIDENT;
+    if (mListener)
+      mListener->attachTile(*entry.tile);
+
+    const double latency = now - entry.requested;
+    mStats.loaded++;
+    mStats.lastLatencyMs = latency;
+    mStats.maxLatencyMs = std::max(mStats.maxLatencyMs, latency);
+    mLatencySum += latency;
+  }
+  mReady.erase(mReady.begin(), mReady.begin() + attached);
+}
+
+void TileStreamer::_updateStats(void)
+{
+  mStats.resident = 0;
+  mStats.residentBytes = 0;
+  for (auto it = mEntries.begin(); it != mEntries.end(); ++it)
+  {
+    if (it->second.state != STATE_RESIDENT)
+      continue;
+    mStats.resident++;
+    mStats.residentBytes += it->second.tile->getBytes();
+  }
+  mStats.loading = (int)mEntries.size() - mStats.resident;
+  mStats.peakBytes = std::max(mStats.peakBytes, mStats.residentBytes);
+  mStats.averageLatencyMs = mStats.loaded ? mLatencySum / mStats.loaded : 0.0;
+  mStats.averageLoadMs = mLoadCount ? mLoadSum / mLoadCount : 0.0;
+}
+
+void TileStreamer::_unload(std::unordered_map<int64_t, Entry>::iterator it)
+{
+  if (mListener)
+    mListener->detachTile(*it->second.tile);
+  delete it->second.tile;
+  mEntries.erase(it);
+}
+
+double TileStreamer::_now(void) const
+{
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void TileStreamer::_run(void)
+{
+  std::unique_lock<std::mutex> lock(mMutex);
+  while (true)
+  {
+    mWake.wait(lock, [this] { return mStopping || !mQueue.empty(); });
+    if (mStopping)
+      return;
+
+    const Request request = mQueue.back();
+    mQueue.pop_back();
+    mBusy++;
+    lock.unlock();
+
+    WorldTile* tile = new WorldTile();
+    WorldTile::generate(*tile, request.x, request.z, mSettings.tileSize, mSettings.resolution,
+      mSettings.propsPerTile, mSettings.propKinds, mSettings.seed);
+
+    lock.lock();
+    mDone.push_back(tile);
+    mBusy--;
+    if (mQueue.empty() && mBusy == 0)
+      mIdle.notify_all();
+  }
+}
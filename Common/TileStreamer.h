@@ -0,0 +1,184 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// One square of ground and the props standing on it. Generated from the
+// tile coordinates and the world seed, the same tile always comes out the
+// same and neighbouring tiles share their edge heights.
+struct WorldTile
+{
+  struct Prop
+  {
+    float position[3];   // world space
+    float yaw;           // radians
+    float scale;
+    int kind;
+  };
+
+  int x, z;           // tile coordinates, the tile covers [x, x + 1) * size
+  float size;
+  int resolution;     // quads per side
+  std::vector<float> vertices;   // x y z nx ny nz u v, world space
+  std::vector<uint16_t> indices;
+  std::vector<Prop> props;
+  double loadMs;      // on the loading thread
+
+  enum { FLOATS_PER_VERTEX = 8 };
+  static const float HEIGHT_RANGE;   // heights are in [-HEIGHT_RANGE, 0]
+
+  int getVertexCount(void) const { return (int)vertices.size() / FLOATS_PER_VERTEX; }
+  // what the tile keeps resident, the ground buffers take the same again on the GPU
+  size_t getBytes(void) const;
+
+  // the tile coordinates in one value, for maps and seeds
+  static int64_t key(int x, int z) { return (int64_t)(((uint64_t)(uint32_t)x << 32) | (uint32_t)z); }
+
+  static size_t estimateBytes(int resolution, int propCount);
+  static void generate(WorldTile& tile, int x, int z, float size, int resolution, int propCount, int propKinds, uint64_t seed);
+  // ground height at a world position
+  static float height(float x, float z, uint64_t seed);
+};
+
+
+// Keeps the tiles around a moving position resident. update() asks for the
+// tiles whose nearest point is within loadRadius and lets go of those
+// farther than unloadRadius; tiles in between stay as they are, so walking
+// along a tile edge does not load and unload the same tiles every frame.
+//
+// Tiles are generated on background threads, nearest first. Finished tiles
+// are handed to the Listener from update(), on the calling thread, at most
+// maxAttachPerUpdate per call to spread the cost of creating their scene
+// objects. Tiles that moved out of range while they were queued or loading
+// are dropped without being attached.
+//
+// memoryBudget and maxTiles cap the resident and loading tiles together.
+// Before a new tile goes over a cap, resident tiles outside loadRadius are
+// unloaded, farthest first; when that is not enough the farthest wanted
+// tiles wait.
+class TileStreamer
+{
+public:
+  struct Settings
+  {
+    float tileSize;
+    int resolution;
+    int propsPerTile;
+    int propKinds;
+    float loadRadius;
+    float unloadRadius;       // raised to loadRadius when smaller
+    size_t memoryBudget;      // bytes, 0 for no cap
+    int maxTiles;             // 0 for no cap
+    int threads;
+    int maxAttachPerUpdate;   // 0 for no limit
+    uint64_t seed;
+
+    Settings();
+  };
+
+  class Listener
+  {
+  public:
+    virtual ~Listener() {}
+
+    // the tile stays valid until it is detached
+    virtual void attachTile(const WorldTile& tile) = 0;
+    virtual void detachTile(const WorldTile& tile) = 0;
+  };
+
+  struct Stats
+  {
+    int resident;
+    int loading;          // queued, loading or waiting to be attached
+    int waiting;          // wanted but held back by a cap
+    size_t residentBytes;
+    size_t peakBytes;
+    int loaded;           // attached since the start
+    int unloaded;
+    int evicted;          // unloaded early to stay under a cap
+    int cancelled;        // out of range before they were attached
+    double lastLatencyMs;     // from the request to the attach
+    double averageLatencyMs;
+    double maxLatencyMs;
+    double averageLoadMs;     // on the loading threads
+  };
+
+  TileStreamer(const Settings& settings, Listener* listener);
+  // stops the threads, does not call the listener
+  ~TileStreamer();
+
+  void update(float x, float z);
+  // blocks until every queued tile is loaded, then attaches them all
+  void flush(void);
+  // detaches every resident tile
+  void clear(void);
+
+  bool isResident(int x, int z) const;
+  int tileCoordinate(float position) const;
+  const Settings& getSettings(void) const { return mSettings; }
+  const Stats& getStats(void) const { return mStats; }
+
+private:
+  enum State
+  {
+    STATE_PENDING,    // queued or loading
+    STATE_READY,      // loaded, not attached yet
+    STATE_RESIDENT
+  };
+
+  struct Entry
+  {
+    int x, z;
+    State state;
+    bool cancelled;   // dropped while a thread was loading it
+    WorldTile* tile;
+    double requested;
+  };
+
+  struct Request
+  {
+    int64_t key;
+    int x, z;
+    float distance;
+  };
+
+  float _distance(int x, int z, float px, float pz) const;
+  size_t _committedBytes(void) const;
+  bool _makeRoom(float px, float pz);
+  void _request(int x, int z, float distance);
+  void _cancel(std::unordered_map<int64_t, Entry>::iterator it);
+  void _collect(void);
+  void _attach(size_t limit);
+  void _unload(std::unordered_map<int64_t, Entry>::iterator it);
+  void _updateStats(void);
+  double _now(void) const;
+  void _run(void);
+
+  Settings mSettings;
+  Listener* mListener;
+  size_t mEstimatedBytes;   // of a tile that is not loaded yet
+
+  // update() thread only
+  std::unordered_map<int64_t, Entry> mEntries;
+  std::vector<int64_t> mReady;   // in the order they finished
+  Stats mStats;
+  double mLatencySum;
+  double mLoadSum;
+  int mLoadCount;
+
+  // shared with the loading threads
+  std::mutex mMutex;
+  std::condition_variable mWake;
+  std::condition_variable mIdle;
+  std::vector<Request> mQueue;   // farthest first, threads take from the back
+  std::vector<WorldTile*> mDone;
+  int mBusy;
+  bool mStopping;
+
+  std::vector<std::thread> mThreads;
+};
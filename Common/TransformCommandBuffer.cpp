@@ -0,0 +1,257 @@
+#include "TransformCommandBuffer.h"
+
+#include <algorithm>
+
+using namespace Ogre;
+
+namespace
+{
+  uint64_t handleKey(NodeHandle node)
+  {
+    return ((uint64_t)node.index << 32) | node.generation;
+  }
+}
+
+
+TransformCommandBuffer::TransformCommandBuffer(SceneManager* sceneMgr, SceneRegistry* registry)
+  : mSceneMgr(sceneMgr), mRegistry(registry), mDeferred(true), mRecorded(0)
+{
+  memset(&mStats, 0, sizeof(mStats));
+  mSceneMgr->addListener(this);
+}
+
+TransformCommandBuffer::~TransformCommandBuffer()
+{
+  mSceneMgr->removeListener(this);
+}
+
+void TransformCommandBuffer::setPosition(NodeHandle node, const Vector3& position)
+{
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    Command& command = _record(node);
+    command.flags |= SET_POSITION;
+    command.position = position;
+    command.parentDelta = command.localDelta = command.worldDelta = Vector3::ZERO;
+  }
+  _applyIfImmediate();
+}
+
+void TransformCommandBuffer::translate(NodeHandle node, const Vector3& delta, Node::TransformSpace space)
+{
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    Command& command = _record(node);
+    switch (space)
+    {
+    case Node::TS_LOCAL: command.localDelta += delta; break;
+    case Node::TS_PARENT: command.parentDelta += delta; break;
+    case Node::TS_WORLD: command.worldDelta += delta; break;
+    }
+  }
+  _applyIfImmediate();
+}
+
+void TransformCommandBuffer::setOrientation(NodeHandle node, const Quaternion& orientation)
+{
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    Command& command = _record(node);
+    command.flags |= SET_ORIENTATION;
+    command.orientation = orientation;
+    command.preRotation = command.postRotation = command.worldRotation = Quaternion::IDENTITY;
+  }
+  _applyIfImmediate();
+}
+
+void TransformCommandBuffer::rotate(NodeHandle node, const Quaternion& rotation, Node::TransformSpace space)
+{
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    Command& command = _record(node);
+    switch (space)
+    {
+    case Node::TS_LOCAL: command.postRotation = command.postRotation * rotation; break;
+    case Node::TS_PARENT: command.preRotation = rotation * command.preRotation; break;
+    case Node::TS_WORLD: command.worldRotation = rotation * command.worldRotation; break;
+    }
+  }
+  _applyIfImmediate();
+}
+
+void TransformCommandBuffer::rotate(NodeHandle node, const Vector3& axis, const Radian& angle, Node::TransformSpace space)
+{
+  Quaternion rotation;
+  rotation.FromAngleAxis(angle, axis);
+  rotate(node, rotation, space);
+}
+
+void TransformCommandBuffer::yaw(NodeHandle node, const Radian& angle, Node::TransformSpace space)
+{
+  rotate(node, Vector3::UNIT_Y, angle, space);
+}
+
+void TransformCommandBuffer::pitch(NodeHandle node, const Radian& angle, Node::TransformSpace space)
+{
+  rotate(node, Vector3::UNIT_X, angle, space);
+}
+
+void TransformCommandBuffer::roll(NodeHandle node, const Radian& angle, Node::TransformSpace space)
+{
+  rotate(node, Vector3::UNIT_Z, angle, space);
+}
+
+void TransformCommandBuffer::setScale(NodeHandle node, const Vector3& scale)
+{
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    Command& command = _record(node);
+    command.flags |= SET_SCALE;
+    command.scale = scale;
+  }
+  _applyIfImmediate();
+}
+
+void TransformCommandBuffer::scale(NodeHandle node, const Vector3& factor)
+{
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    _record(node).scale *= factor;
+  }
+  _applyIfImmediate();
+}
+
+void TransformCommandBuffer::setDeferred(bool deferred)
+{
+  mDeferred = deferred;
+  if (!mDeferred)
+    apply();
+}
+
+void TransformCommandBuffer::apply(void)
+{
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mPending.empty())
+      return;
+
+    mApplying.swap(mPending);
+    mPending.clear();
+    mPendingIndex.clear();
+    mStats.commands = mRecorded;
+    mRecorded = 0;
+  }
+
+  Timer timer;
+  mStats.nodesUpdated = mStats.nodesDropped = 0;
+
+  // parents first: a world space translation reads the parent's derived
+  // transform, which must already have its own changes
+  for (size_t i = 0; i < mApplying.size(); i++)
+  {
+    Command& command = mApplying[i];
+    command.depth = -1;
+    if (SceneNode* node = mRegistry->get(command.node))
+    {
+      command.depth = 0;
+      for (Node* parent = node->getParent(); parent; parent = parent->getParent())
+        command.depth++;
+    }
+  }
+  std::stable_sort(mApplying.begin(), mApplying.end(),
+    [](const Command& a, const Command& b) { return a.depth < b.depth; });
+
+  for (size_t i = 0; i < mApplying.size(); i++)
+  {
+    if (SceneNode* node = mRegistry->get(mApplying[i].node))
+    {
+      _apply(node, mApplying[i]);
+      mStats.nodesUpdated++;
+    }
+    else
+      mStats.nodesDropped++;
+  }
+  mApplying.clear();
+
+  mStats.applyMs = timer.getMicroseconds() / 1000.0f;
+}
+
+void TransformCommandBuffer::logStats(void) const
+{
+  LogManager::getSingleton().stream() << "TransformCommandBuffer: " << (mDeferred ? "deferred, " : "immediate, ")
+    << mStats.commands << " commands merged into " << mStats.nodesUpdated << " node updates ("
+    << mStats.nodesDropped << " dropped) in " << mStats.applyMs << " ms";
+}
+
+void TransformCommandBuffer::preUpdateSceneGraph(SceneManager* source, Camera* camera)
+{
+  apply();
+}
+
+TransformCommandBuffer::Command& TransformCommandBuffer::_record(NodeHandle node)
+{
+  mRecorded++;
+
+  std::unordered_map<uint64_t, size_t>::iterator it = mPendingIndex.find(handleKey(node));
+  if (it != mPendingIndex.end())
+    return mPending[it->second];
+
+  mPendingIndex[handleKey(node)] = mPending.size();
+  mPending.push_back(Command());
+  Command& command = mPending.back();
+  command.node = node;
+  command.flags = 0;
+  command.position = command.parentDelta = command.localDelta = command.worldDelta = Vector3::ZERO;
+  command.orientation = command.preRotation = command.postRotation = command.worldRotation = Quaternion::IDENTITY;
+  command.scale = Vector3::UNIT_SCALE;
+  command.depth = 0;
+  return command;
+}
+
+void TransformCommandBuffer::_applyIfImmediate(void)
+{
+  if (!mDeferred)
+    apply();
+}
+
+void TransformCommandBuffer::_apply(SceneNode* node, const Command& command)
+{
+  Node* parent = node->getParent();
+
+  Quaternion preRotation = command.preRotation;
+  if (command.worldRotation != Quaternion::IDENTITY)
+  {
+    // the world rotation as seen from the parent
+    const Quaternion parentOrientation = parent ? parent->_getDerivedOrientation() : Quaternion::IDENTITY;
+    preRotation = parentOrientation.Inverse() * command.worldRotation * parentOrientation * preRotation;
+  }
+
+  const bool rotated = (command.flags & SET_ORIENTATION) || preRotation != Quaternion::IDENTITY
+    || command.postRotation != Quaternion::IDENTITY;
+  Quaternion orientation = (command.flags & SET_ORIENTATION) ? command.orientation : node->getOrientation();
+  if (rotated)
+  {
+    orientation = preRotation * orientation * command.postRotation;
+    orientation.normalise();
+    node->setOrientation(orientation);
+  }
+
+  const bool moved = (command.flags & SET_POSITION) || command.parentDelta != Vector3::ZERO
+    || command.localDelta != Vector3::ZERO || command.worldDelta != Vector3::ZERO;
+  if (moved)
+  {
+    Vector3 position = (command.flags & SET_POSITION) ? command.position : node->getPosition();
+    position += command.parentDelta + orientation * command.localDelta;
+    if (command.worldDelta != Vector3::ZERO)
+    {
+      position += parent ? (parent->_getDerivedOrientation().Inverse() * command.worldDelta) / parent->_getDerivedScale()
+        : command.worldDelta;
+    }
+    node->setPosition(position);
+  }
+
+  if (command.flags & SET_SCALE)
+    node->setScale(command.scale);
+  else if (command.scale != Vector3::UNIT_SCALE)
+    node->scale(command.scale);
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <Ogre.h>
+
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "SceneRegistry.h"
+
+// Records scene node transform changes and applies them once per frame.
+// Input handlers, controllers and worker threads call the recording
+// functions as often as they like; every node gets one pending entry that
+// later writes merge into:
+//
+//   setPosition, setOrientation, setScale  replace what was pending
+//   translate                              adds up per transform space
+//   rotate, yaw, pitch, roll               concatenate (parent space in
+//                                          front, local space behind,
+//                                          world space in front of both)
+//   scale                                  multiplies
+//
+// Local and world space translations use the orientation the node has
+// after the frame's rotations, not the one at the time of the call.
+//
+// The nodes are addressed by SceneRegistry handle and resolved when the
+// buffer is applied, so commands for a node destroyed in the meantime are
+// dropped. apply() runs from preUpdateSceneGraph of the scene manager, on
+// the render thread, parents before their children, so every node is
+// dirtied once and the scene graph update right after computes each
+// derived transform once.
+class TransformCommandBuffer : public Ogre::SceneManager::Listener
+{
+public:
+  struct Stats
+  {
+    int commands;        // recorded since the last apply
+    int nodesUpdated;
+    int nodesDropped;    // handle went stale
+    float applyMs;
+  };
+
+  TransformCommandBuffer(Ogre::SceneManager* sceneMgr, SceneRegistry* registry);
+  ~TransformCommandBuffer();
+
+  // thread safe
+  void setPosition(NodeHandle node, const Ogre::Vector3& position);
+  void translate(NodeHandle node, const Ogre::Vector3& delta, Ogre::Node::TransformSpace space = Ogre::Node::TS_PARENT);
+  void setOrientation(NodeHandle node, const Ogre::Quaternion& orientation);
+  void rotate(NodeHandle node, const Ogre::Quaternion& rotation, Ogre::Node::TransformSpace space = Ogre::Node::TS_LOCAL);
+  void rotate(NodeHandle node, const Ogre::Vector3& axis, const Ogre::Radian& angle, Ogre::Node::TransformSpace space = Ogre::Node::TS_LOCAL);
+  void yaw(NodeHandle node, const Ogre::Radian& angle, Ogre::Node::TransformSpace space = Ogre::Node::TS_LOCAL);
+  void pitch(NodeHandle node, const Ogre::Radian& angle, Ogre::Node::TransformSpace space = Ogre::Node::TS_LOCAL);
+  void roll(NodeHandle node, const Ogre::Radian& angle, Ogre::Node::TransformSpace space = Ogre::Node::TS_LOCAL);
+  void setScale(NodeHandle node, const Ogre::Vector3& scale);
+  void scale(NodeHandle node, const Ogre::Vector3& factor);
+
+  // off applies every command right away, on the calling thread
+  void setDeferred(bool deferred);
+  bool isDeferred(void) const { return mDeferred; }
+
+  // render thread only, normally called by the scene manager
+  void apply(void);
+
+  // the last apply
+  const Stats& getStats(void) const { return mStats; }
+  void logStats(void) const;
+
+  // SceneManager::Listener
+  void preUpdateSceneGraph(Ogre::SceneManager* source, Ogre::Camera* camera);
+
+private:
+  enum Flags
+  {
+    SET_POSITION = 1,
+    SET_ORIENTATION = 2,
+    SET_SCALE = 4
+  };
+
+  struct Command
+  {
+    NodeHandle node;
+    unsigned flags;
+    Ogre::Vector3 position;
+    Ogre::Vector3 parentDelta, localDelta, worldDelta;
+    Ogre::Quaternion orientation;
+    Ogre::Quaternion preRotation;    // parent space
+    Ogre::Quaternion postRotation;   // local space
+    Ogre::Quaternion worldRotation;
+    Ogre::Vector3 scale;             // set value or factor
+
+    int depth;                       // filled in by apply()
+  };
+
+  Command& _record(NodeHandle node);
+  void _applyIfImmediate(void);
+  void _apply(Ogre::SceneNode* sceneNode, const Command& command);
+
+  Ogre::SceneManager* mSceneMgr;
+  SceneRegistry* mRegistry;
+  bool mDeferred;
+
+  std::mutex mMutex;
+  std::vector<Command> mPending;
+  std::unordered_map<uint64_t, size_t> mPendingIndex;   // handle to mPending
+  int mRecorded;
+
+  std::vector<Command> mApplying;
+  Stats mStats;
+};
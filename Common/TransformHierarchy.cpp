@@ -0,0 +1,389 @@
+#include "TransformHierarchy.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_AMD64) || defined(__SSE2__)
+#define TRANSFORM_HIERARCHY_SSE
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+  bool anySet(const uint8_t* flags)
+  {
+    uint32_t four;
+    memcpy(&four, flags, sizeof(four));
+    return four != 0;
+  }
+
+  // values[from[i]] moves to i
+  template <typename T>
+  void permute(std::vector<T>& values, const std::vector<int>& from)
+  {
+    std::vector<T> sorted(from.size());
+    for (size_t i = 0; i < from.size(); i++)
+      sorted[i] = values[from[i]];
+    values.swap(sorted);
+  }
+}
+
+
+TransformHierarchy::TransformHierarchy()
+  : mSorted(true), mSimd(hasSimd())
+{
+  memset(&mStats, 0, sizeof(mStats));
+  mLevelStart.push_back(0);
+}
+
+bool TransformHierarchy::hasSimd(void)
+{
+#ifdef TRANSFORM_HIERARCHY_SSE
+  return true;
+#else
+  return false;
+#endif
+}
+
+int TransformHierarchy::add(int parent, bool inheritOrientation)
+{
+  const int id = size();
+  const int slot = (int)mIdOf.size();
+
+  mSlotOf.push_back(slot);
+  mParentId.push_back(parent);
+  mDepth.push_back(parent < 0 ? 0 : mDepth[parent] + 1);
+
+  // appended for now, update() moves it to its level
+  mIdOf.push_back(id);
+  mParent.push_back(parent < 0 ? -1 : mSlotOf[parent]);
+  mInherit.push_back(inheritOrientation ? 1 : 0);
+  for (int i = 0; i < 3; i++)
+  {
+    mPosition[i].push_back(0.0f);
+    mScale[i].push_back(1.0f);
+  }
+  mOrientation[0].push_back(1.0f);
+  for (int i = 1; i < 4; i++)
+    mOrientation[i].push_back(0.0f);
+  for (int i = 0; i < 12; i++)
+  {
+    const float identity = (i % 5 == 0) ? 1.0f : 0.0f;
+    mLocal[i].push_back(identity);
+    mWorld[i].push_back(identity);
+  }
+  // both padded for reading four flags at a time
+  mLocalDirty.resize(slot + 4, 0);
+  mLocalDirty[slot] = 1;
+  mWorldChanged.resize(slot + 4, 0);
+
+  if (slot > 0 && mDepth[id] < mDepth[mIdOf[slot - 1]])
+    mSorted = false;
+  else if (mDepth[id] + 1 < (int)mLevelStart.size())
+    mLevelStart.back() = slot + 1;
+  else
+    mLevelStart.push_back(slot + 1);
+  return id;
+}
+
+int TransformHierarchy::getParent(int id) const
+{
+  return mParentId[id];
+}
+
+void TransformHierarchy::setPosition(int id, float x, float y, float z)
+{
+  const int slot = mSlotOf[id];
+  mPosition[0][slot] = x;
+  mPosition[1][slot] = y;
+  mPosition[2][slot] = z;
+  mLocalDirty[slot] = 1;
+}
+
+void TransformHierarchy::setOrientation(int id, float w, float x, float y, float z)
+{
+  const int slot = mSlotOf[id];
+  mOrientation[0][slot] = w;
+  mOrientation[1][slot] = x;
+  mOrientation[2][slot] = y;
+  mOrientation[3][slot] = z;
+  mLocalDirty[slot] = 1;
+}
+
+void TransformHierarchy::setScale(int id, float x, float y, float z)
+{
+  const int slot = mSlotOf[id];
+  mScale[0][slot] = x;
+  mScale[1][slot] = y;
+  mScale[2][slot] = z;
+  mLocalDirty[slot] = 1;
+}
+
+void TransformHierarchy::getPosition(int id, float* xyz) const
+{
+  for (int i = 0; i < 3; i++)
+    xyz[i] = mPosition[i][mSlotOf[id]];
+}
+
+void TransformHierarchy::getOrientation(int id, float* wxyz) const
+{
+  for (int i = 0; i < 4; i++)
+    wxyz[i] = mOrientation[i][mSlotOf[id]];
+}
+
+void TransformHierarchy::getScale(int id, float* xyz) const
+{
+  for (int i = 0; i < 3; i++)
+    xyz[i] = mScale[i][mSlotOf[id]];
+}
+
+void TransformHierarchy::getWorld(int id, float* matrix) const
+{
+  for (int i = 0; i < 12; i++)
+    matrix[i] = mWorld[i][mSlotOf[id]];
+}
+
+void TransformHierarchy::update(void)
+{
+  if (!mSorted)
+    _sort();
+
+  const int count = (int)mIdOf.size();
+  mStats.nodes = count;
+  mStats.levels = (int)mLevelStart.size() - 1;
+  mStats.localsUpdated = mStats.worldsUpdated = 0;
+
+  int slot = 0;
+  if (mSimd)
+  {
+    for (; slot + 4 <= count; slot += 4)
+    {
+      if (anySet(&mLocalDirty[slot]))
+        _updateLocal4(slot);
+    }
+  }
+  for (; slot < count; slot++)
+  {
+    if (mLocalDirty[slot])
+      _updateLocal(slot);
+  }
+
+  for (int level = 0; level + 1 < (int)mLevelStart.size(); level++)
+  {
+    const int begin = mLevelStart[level], end = mLevelStart[level + 1];
+    for (slot = begin; slot < end; slot++)
+    {
+      const int parent = mParent[slot];
+      mWorldChanged[slot] = mLocalDirty[slot] | (parent >= 0 ? mWorldChanged[parent] : 0);
+      mStats.localsUpdated += mLocalDirty[slot];
+      mStats.worldsUpdated += mWorldChanged[slot];
+    }
+
+    slot = begin;
+    if (mSimd && level > 0)
+    {
+      // recomputing an unchanged lane gives the same matrix, only lanes
+      // that do not inherit orientation need the scalar path
+      for (; slot + 4 <= end; slot += 4)
+      {
+        if (!anySet(&mWorldChanged[slot]))
+          continue;
+        if (mInherit[slot] & mInherit[slot + 1] & mInherit[slot + 2] & mInherit[slot + 3])
+          _updateWorld4(slot);
+        else
+        {
+          for (int i = slot; i < slot + 4; i++)
+          {
+            if (mWorldChanged[i])
+              _updateWorld(i);
+          }
+        }
+      }
+    }
+    for (; slot < end; slot++)
+    {
+      if (mWorldChanged[slot])
+        _updateWorld(slot);
+    }
+  }
+
+  mLocalDirty.assign(count + 3, 0);
+}
+
+void TransformHierarchy::_sort(void)
+{
+  const int count = (int)mIdOf.size();
+  std::vector<int> order(mIdOf);
+  std::stable_sort(order.begin(), order.end(), [this](int a, int b) { return mDepth[a] < mDepth[b]; });
+
+  // old slot of every new slot
+  std::vector<int> from(count);
+  for (int slot = 0; slot < count; slot++)
+    from[slot] = mSlotOf[order[slot]];
+
+  permute(mInherit, from);
+  permute(mLocalDirty, from);
+  permute(mWorldChanged, from);
+  mLocalDirty.resize(count + 3, 0);
+  mWorldChanged.resize(count + 3, 0);
+  for (int i = 0; i < 3; i++)
+  {
+    permute(mPosition[i], from);
+    permute(mScale[i], from);
+  }
+  for (int i = 0; i < 4; i++)
+    permute(mOrientation[i], from);
+  for (int i = 0; i < 12; i++)
+  {
+    permute(mLocal[i], from);
+    permute(mWorld[i], from);
+  }
+
+  mIdOf = order;
+  mLevelStart.assign(1, 0);
+  for (int slot = 0; slot < count; slot++)
+  {
+    const int id = mIdOf[slot];
+    mSlotOf[id] = slot;
+    if (mDepth[id] + 1 >= (int)mLevelStart.size())
+      mLevelStart.push_back(slot + 1);
+    else
+      mLevelStart.back() = slot + 1;
+  }
+  for (int slot = 0; slot < count; slot++)
+  {
+    const int parent = mParentId[mIdOf[slot]];
+    mParent[slot] = parent < 0 ? -1 : mSlotOf[parent];
+  }
+
+  mSorted = true;
+}
+
+void TransformHierarchy::_updateLocal(int slot)
+{
+  const float w = mOrientation[0][slot], x = mOrientation[1][slot], y = mOrientation[2][slot], z = mOrientation[3][slot];
+  const float sx = mScale[0][slot], sy = mScale[1][slot], sz = mScale[2][slot];
+
+  mLocal[0][slot] = (1.0f - 2.0f * (y * y + z * z)) * sx;
+  mLocal[1][slot] = 2.0f * (x * y - w * z) * sy;
+  mLocal[2][slot] = 2.0f * (x * z + w * y) * sz;
+  mLocal[3][slot] = mPosition[0][slot];
+  mLocal[4][slot] = 2.0f * (x * y + w * z) * sx;
+  mLocal[5][slot] = (1.0f - 2.0f * (x * x + z * z)) * sy;
+  mLocal[6][slot] = 2.0f * (y * z - w * x) * sz;
+  mLocal[7][slot] = mPosition[1][slot];
+  mLocal[8][slot] = 2.0f * (x * z - w * y) * sx;
+  mLocal[9][slot] = 2.0f * (y * z + w * x) * sy;
+  mLocal[10][slot] = (1.0f - 2.0f * (x * x + y * y)) * sz;
+  mLocal[11][slot] = mPosition[2][slot];
+}
+
+void TransformHierarchy::_updateWorld(int slot)
+{
+  const int parent = mParent[slot];
+  if (parent < 0)
+  {
+    for (int i = 0; i < 12; i++)
+      mWorld[i][slot] = mLocal[i][slot];
+    return;
+  }
+
+  float p[12], l[12];
+  for (int i = 0; i < 12; i++)
+  {
+    p[i] = mWorld[i][parent];
+    l[i] = mLocal[i][slot];
+  }
+
+  if (!mInherit[slot])
+  {
+    // own orientation, scaled by the parent's scale
+    for (int j = 0; j < 3; j++)
+    {
+      const float scale = std::sqrt(p[j] * p[j] + p[4 + j] * p[4 + j] + p[8 + j] * p[8 + j]);
+      for (int i = 0; i < 3; i++)
+        mWorld[i * 4 + j][slot] = l[i * 4 + j] * scale;
+    }
+    for (int i = 0; i < 3; i++)
+      mWorld[i * 4 + 3][slot] = p[i * 4] * l[3] + p[i * 4 + 1] * l[7] + p[i * 4 + 2] * l[11] + p[i * 4 + 3];
+    return;
+  }
+
+  for (int i = 0; i < 3; i++)
+  {
+    for (int j = 0; j < 4; j++)
+    {
+      mWorld[i * 4 + j][slot] = p[i * 4] * l[j] + p[i * 4 + 1] * l[4 + j] + p[i * 4 + 2] * l[8 + j]
+        + (j == 3 ? p[i * 4 + 3] : 0.0f);
+    }
+  }
+}
+
+#ifdef TRANSFORM_HIERARCHY_SSE
+
+void TransformHierarchy::_updateLocal4(int slot)
+{
+  const __m128 one = _mm_set1_ps(1.0f), two = _mm_set1_ps(2.0f);
+  const __m128 w = _mm_loadu_ps(&mOrientation[0][slot]), x = _mm_loadu_ps(&mOrientation[1][slot]);
+  const __m128 y = _mm_loadu_ps(&mOrientation[2][slot]), z = _mm_loadu_ps(&mOrientation[3][slot]);
+  const __m128 sx = _mm_loadu_ps(&mScale[0][slot]), sy = _mm_loadu_ps(&mScale[1][slot]);
+  const __m128 sz = _mm_loadu_ps(&mScale[2][slot]);
+
+  const __m128 xx = _mm_mul_ps(x, x), yy = _mm_mul_ps(y, y), zz = _mm_mul_ps(z, z);
+  const __m128 xy = _mm_mul_ps(x, y), xz = _mm_mul_ps(x, z), yz = _mm_mul_ps(y, z);
+  const __m128 wx = _mm_mul_ps(w, x), wy = _mm_mul_ps(w, y), wz = _mm_mul_ps(w, z);
+
+  _mm_storeu_ps(&mLocal[0][slot], _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), sx));
+  _mm_storeu_ps(&mLocal[1][slot], _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, wz)), sy));
+  _mm_storeu_ps(&mLocal[2][slot], _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, wy)), sz));
+  _mm_storeu_ps(&mLocal[3][slot], _mm_loadu_ps(&mPosition[0][slot]));
+  _mm_storeu_ps(&mLocal[4][slot], _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, wz)), sx));
+  _mm_storeu_ps(&mLocal[5][slot], _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), sy));
+  _mm_storeu_ps(&mLocal[6][slot], _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, wx)), sz));
+  _mm_storeu_ps(&mLocal[7][slot], _mm_loadu_ps(&mPosition[1][slot]));
+  _mm_storeu_ps(&mLocal[8][slot], _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, wy)), sx));
+  _mm_storeu_ps(&mLocal[9][slot], _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, wx)), sy));
+  _mm_storeu_ps(&mLocal[10][slot], _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), sz));
+  _mm_storeu_ps(&mLocal[11][slot], _mm_loadu_ps(&mPosition[2][slot]));
+}
+
+void TransformHierarchy::_updateWorld4(int slot)
+{
+  const int* parent = &mParent[slot];
+  __m128 p[12], l[12];
+  for (int i = 0; i < 12; i++)
+  {
+    const float* world = &mWorld[i][0];
+    p[i] = _mm_set_ps(world[parent[3]], world[parent[2]], world[parent[1]], world[parent[0]]);
+    l[i] = _mm_loadu_ps(&mLocal[i][slot]);
+  }
+
+  for (int i = 0; i < 3; i++)
+  {
+    for (int j = 0; j < 4; j++)
+    {
+      __m128 sum = _mm_add_ps(_mm_add_ps(_mm_mul_ps(p[i * 4], l[j]), _mm_mul_ps(p[i * 4 + 1], l[4 + j])),
+        _mm_mul_ps(p[i * 4 + 2], l[8 + j]));
+      if (j == 3)
+        sum = _mm_add_ps(sum, p[i * 4 + 3]);
+      _mm_storeu_ps(&mWorld[i * 4 + j][slot], sum);
+    }
+  }
+}
+
+#else
+
+void TransformHierarchy::_updateLocal4(int slot)
+{
+  for (int i = slot; i < slot + 4; i++)
+    _updateLocal(i);
+}
+
+void TransformHierarchy::_updateWorld4(int slot)
+{
+  for (int i = slot; i < slot + 4; i++)
+    _updateWorld(i);
+}
+
+#endif
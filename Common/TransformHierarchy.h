@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Flat transform store for node hierarchies. Every node's position,
+// orientation and scale live in structure of arrays form, ordered by depth
+// so a parent always comes before its children; update() then turns the
+// changed local transforms into world matrices in two linear passes, four
+// nodes at a time where SSE2 is available:
+//
+//   local  matrix from position, orientation and scale, for nodes set
+//          since the last update
+//   world  parent world * local, level by level, for the changed nodes and
+//          everything below them
+//
+// Node ids are handed out by add() and stay valid; parents must be added
+// before their children. Matrices are 3x4, row major, like the top of an
+// Ogre::Matrix4. Orientations are quaternions in w, x, y, z order.
+//
+// A node that does not inherit orientation keeps its own orientation in
+// the world, its position still follows the parent, like
+// Ogre::Node::setInheritOrientation(false).
+class TransformHierarchy
+{
+public:
+  struct Stats
+  {
+    int nodes;
+    int levels;
+    int localsUpdated;   // by the last update()
+    int worldsUpdated;
+  };
+
+  TransformHierarchy();
+
+  // -1 for a root
+  int add(int parent, bool inheritOrientation = true);
+  int getParent(int id) const;
+  int size(void) const { return (int)mSlotOf.size(); }
+
+  void setPosition(int id, float x, float y, float z);
+  void setOrientation(int id, float w, float x, float y, float z);
+  void setScale(int id, float x, float y, float z);
+  void getPosition(int id, float* xyz) const;
+  void getOrientation(int id, float* wxyz) const;
+  void getScale(int id, float* xyz) const;
+
+  void update(void);
+
+  // valid after update()
+  void getWorld(int id, float* matrix) const;
+  // the world matrix was recomputed by the last update()
+  bool isWorldChanged(int id) const { return mWorldChanged[mSlotOf[id]] != 0; }
+
+  // off runs the scalar passes, for comparison
+  void setSimd(bool simd) { mSimd = simd && hasSimd(); }
+  bool isSimd(void) const { return mSimd; }
+  static bool hasSimd(void);
+
+  const Stats& getStats(void) const { return mStats; }
+
+private:
+  void _sort(void);
+  void _updateLocal(int slot);
+  void _updateLocal4(int slot);
+  void _updateWorld(int slot);
+  void _updateWorld4(int slot);
+
+  // by id
+  std::vector<int> mSlotOf;
+  std::vector<int> mDepth;
+  std::vector<int> mParentId;
+
+  // by slot, depth order
+  std::vector<int> mIdOf;
+  std::vector<int> mParent;          // slot of the parent, -1 for roots
+  std::vector<uint8_t> mInherit;
+  std::vector<float> mPosition[3];
+  std::vector<float> mOrientation[4];
+  std::vector<float> mScale[3];
+  std::vector<float> mLocal[12];
+  std::vector<float> mWorld[12];
+  std::vector<uint8_t> mLocalDirty;
+  std::vector<uint8_t> mWorldChanged;
+  std::vector<int> mLevelStart;      // first slot of every level, plus the end
+
+  bool mSorted;
+  bool mSimd;
+  Stats mStats;
+};
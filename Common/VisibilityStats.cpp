@@ -0,0 +1,197 @@
+#include "VisibilityStats.h"
+
+#include "LooseGridSceneManager.h"
+
+using namespace Ogre;
+
+namespace
+{
+  size_t countObjects(SceneNode* node)
+  {
+    size_t count = 0;
+
+    SceneNode::ObjectIterator objects = node->getAttachedObjectIterator();
+    while (objects.hasMoreElements())
+    {
+      if (objects.getNext()->getVisible())
+        count++;
+    }
+
+    Node::ChildNodeIterator children = node->getChildIterator();
+    while (children.hasMoreElements())
+      count += countObjects(static_cast<SceneNode*>(children.getNext()));
+
+    return count;
+  }
+}
+
+
+VisibilityStats::VisibilityStats(SceneManager* sceneMgr, RenderTarget* target)
+  : mSceneMgr(sceneMgr), mTarget(target), mCurrent(nullptr), mPreviousListener(nullptr),
+  mObjectsFrame(0), mObjects(0)
+{
+  mSceneMgr->addListener(this);
+  mTarget->addListener(this);
+}
+
+VisibilityStats::~VisibilityStats()
+{
+  stopCsv();
+  mTarget->removeListener(this);
+  mSceneMgr->removeListener(this);
+}
+
+void VisibilityStats::addViewport(Viewport* viewport)
+{
+  View view;
+  view.viewport = viewport;
+  view.stats.camera = view.current.camera = viewport->getCamera()->getName();
+  mViews.push_back(view);
+}
+
+const VisibilityStats::CameraStats* VisibilityStats::getStats(const Camera* camera) const
+{
+  for (size_t i = 0; i < mViews.size(); i++)
+  {
+    if (mViews[i].viewport->getCamera() == camera)
+      return &mViews[i].stats;
+  }
+  return nullptr;
+}
+
+bool VisibilityStats::startCsv(const String& fileName)
+{
+  stopCsv();
+
+  mCsv.open(fileName.c_str());
+  if (!mCsv.is_open())
+  {
+    LogManager::getSingleton().logMessage("VisibilityStats: cannot write " + fileName);
+    return false;
+  }
+
+  mCsv << "frame,camera,objects,tested,culled,rendered,renderables,batches,triangles,cullingMs" << std::endl;
+  return true;
+}
+
+void VisibilityStats::stopCsv(void)
+{
+  if (mCsv.is_open())
+    mCsv.close();
+}
+
+void VisibilityStats::logStats(void) const
+{
+  for (size_t i = 0; i < mViews.size(); i++)
+  {
+    const CameraStats& stats = mViews[i].stats;
+    LogManager::getSingleton().stream() << "Visibility " << stats.camera << ", frame " << stats.frame << ": "
+      << stats.objects << " objects, " << stats.tested << " tested, " << stats.culled << " culled, "
+      << stats.rendered << " rendered (" << stats.renderables << " renderables), " << stats.batches
+      << " batches, " << stats.triangles << " triangles, culling " << stats.cullingMs << " ms";
+  }
+}
+
+void VisibilityStats::preFindVisibleObjects(SceneManager* source, SceneManager::IlluminationRenderStage irs, Viewport* v)
+{
+  if (irs == SceneManager::IRS_RENDER_TO_TEXTURE)
+    return;
+
+  mCurrent = _findView(v);
+  if (!mCurrent)
+    return;
+
+  CameraStats& current = mCurrent->current;
+  current.renderables = 0;
+  mQueuedObjects.clear();
+
+  // only listen to the queue while this viewport's objects are being found
+  RenderQueue* queue = source->getRenderQueue();
+  mPreviousListener = queue->getRenderableListener();
+  queue->setRenderableListener(this);
+
+  mTimer.reset();
+}
+
+void VisibilityStats::postFindVisibleObjects(SceneManager* source, SceneManager::IlluminationRenderStage irs, Viewport* v)
+{
+  if (!mCurrent || irs == SceneManager::IRS_RENDER_TO_TEXTURE)
+    return;
+
+  // the queue listener is part of the measured time, it is a set insert per renderable
+  CameraStats& current = mCurrent->current;
+  current.cullingMs = mTimer.getMicroseconds() / 1000.0f;
+  current.rendered = mQueuedObjects.size();
+
+  source->getRenderQueue()->setRenderableListener(mPreviousListener);
+  mPreviousListener = nullptr;
+
+  if (source->getTypeName() == LooseGridSceneManager::TYPE_NAME)
+    current.tested = static_cast<LooseGridSceneManager*>(source)->getGrid().getQueryStats().objectsTested;
+  else
+    current.tested = 0;
+
+  mCurrent = nullptr;
+}
+
+void VisibilityStats::postViewportUpdate(const RenderTargetViewportEvent& evt)
+{
+  View* view = _findView(evt.source);
+  if (!view)
+    return;
+
+  CameraStats& current = view->current;
+  current.frame = Root::getSingleton().getNextFrameNumber();
+  current.camera = evt.source->getCamera()->getName();
+  current.objects = _countObjects();
+  if (current.tested == 0)
+    current.tested = current.objects;
+  current.culled = current.objects > current.rendered ? current.objects - current.rendered : 0;
+  current.batches = evt.source->_getNumRenderedBatches();
+  current.triangles = evt.source->_getNumRenderedFaces();
+
+  view->stats = current;
+
+  if (mCsv.is_open())
+  {
+    mCsv << current.frame << "," << current.camera << "," << current.objects << "," << current.tested << ","
+      << current.culled << "," << current.rendered << "," << current.renderables << "," << current.batches << ","
+      << current.triangles << "," << current.cullingMs << "\n";
+  }
+}
+
+bool VisibilityStats::renderableQueued(Renderable* rend, uint8 groupID, ushort priority,
+  Technique** ppTech, RenderQueue* pQueue)
+{
+  // a listener that was installed before (an occlusion stage) may still reject it
+  if (mPreviousListener && !mPreviousListener->renderableQueued(rend, groupID, priority, ppTech, pQueue))
+    return false;
+
+  mCurrent->current.renderables++;
+
+  // sub entities count as their entity, any other renderable as one object
+  SubEntity* subEntity = dynamic_cast<SubEntity*>(rend);
+  mQueuedObjects.insert(subEntity ? static_cast<const void*>(subEntity->getParent()) : rend);
+  return true;
+}
+
+VisibilityStats::View* VisibilityStats::_findView(const Viewport* viewport)
+{
+  for (size_t i = 0; i < mViews.size(); i++)
+  {
+    if (mViews[i].viewport == viewport)
+      return &mViews[i];
+  }
+  return nullptr;
+}
+
+size_t VisibilityStats::_countObjects(void)
+{
+  const unsigned long frame = Root::getSingleton().getNextFrameNumber();
+  if (frame != mObjectsFrame || mObjects == 0)
+  {
+    mObjects = countObjects(mSceneMgr->getRootSceneNode());
+    mObjectsFrame = frame;
+  }
+  return mObjects;
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <Ogre.h>
+
+#include <fstream>
+#include <unordered_set>
+#include <vector>
+
+// Per camera visibility counters for the viewports of one render target.
+// For every watched viewport and frame it records how many objects the
+// scene manager had to consider, how many made it into the render queue,
+// the batches and triangles the viewport drew and how long culling (the
+// visible object search) took. Stats of the last frame can be read back,
+// every frame can also be appended to a CSV file.
+//
+// Only the main render stage is counted, shadow texture passes are not.
+class VisibilityStats : public Ogre::SceneManager::Listener,
+  public Ogre::RenderTargetListener,
+  public Ogre::RenderQueue::RenderableListener
+{
+public:
+  struct CameraStats
+  {
+    Ogre::String camera;
+    unsigned long frame;
+    size_t objects;       // visible flagged objects attached to the scene graph
+    size_t tested;        // objects tested against the frustum (objects, unless the scene manager reports it)
+    size_t culled;        // objects - rendered
+    size_t rendered;      // objects that queued at least one renderable
+    size_t renderables;   // renderables queued
+    size_t batches;
+    size_t triangles;
+    float cullingMs;      // pre to post find visible objects
+
+    CameraStats() : frame(0), objects(0), tested(0), culled(0), rendered(0), renderables(0),
+      batches(0), triangles(0), cullingMs(0.0f) {}
+  };
+
+  VisibilityStats(Ogre::SceneManager* sceneMgr, Ogre::RenderTarget* target);
+  ~VisibilityStats();
+
+  void addViewport(Ogre::Viewport* viewport);
+
+  // stats of the last finished frame, null for cameras that are not watched
+  const CameraStats* getStats(const Ogre::Camera* camera) const;
+  size_t getCameraCount(void) const { return mViews.size(); }
+  const CameraStats& getStatsAt(size_t index) const { return mViews[index].stats; }
+
+  // one row per watched camera and frame until stopCsv
+  bool startCsv(const Ogre::String& fileName);
+  void stopCsv(void);
+  bool isWritingCsv(void) const { return mCsv.is_open(); }
+
+  void logStats(void) const;
+
+  // SceneManager::Listener
+  void preFindVisibleObjects(Ogre::SceneManager* source, Ogre::SceneManager::IlluminationRenderStage irs, Ogre::Viewport* v);
+  void postFindVisibleObjects(Ogre::SceneManager* source, Ogre::SceneManager::IlluminationRenderStage irs, Ogre::Viewport* v);
+
+  // RenderTargetListener
+  void postViewportUpdate(const Ogre::RenderTargetViewportEvent& evt);
+
+  // RenderQueue::RenderableListener
+  bool renderableQueued(Ogre::Renderable* rend, Ogre::uint8 groupID, Ogre::ushort priority,
+    Ogre::Technique** ppTech, Ogre::RenderQueue* pQueue);
+
+private:
+  struct View
+  {
+    Ogre::Viewport* viewport;
+    CameraStats stats;     // last finished frame
+    CameraStats current;   // frame being rendered
+  };
+
+  View* _findView(const Ogre::Viewport* viewport);
+  size_t _countObjects(void);
+
+  Ogre::SceneManager* mSceneMgr;
+  Ogre::RenderTarget* mTarget;
+  std::vector<View> mViews;
+
+  // state of the visible object search in progress
+  View* mCurrent;
+  Ogre::RenderQueue::RenderableListener* mPreviousListener;
+  std::unordered_set<const void*> mQueuedObjects;
+  Ogre::Timer mTimer;
+
+  // the scene graph is only walked once per frame for all cameras
+  unsigned long mObjectsFrame;
+  size_t mObjects;
+
+  std::ofstream mCsv;
+};
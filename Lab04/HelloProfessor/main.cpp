@@ -6,6 +6,8 @@
 #include <Ogre.h>
 #include <OIS/OIS.h>
 
+#include "SceneManagerSelector.h"
+
 
 using namespace Ogre;
 
@@ -67,7 +69,7 @@ public:
 	mESCListener = new ESCListener(mKeyboard);
     mRoot->addFrameListener(mESCListener);
 
-	mSceneMgr = mRoot->createSceneManager(ST_GENERIC);
+	mSceneMgr = SceneManagerSelector::create(mRoot);
 
     mCamera = mSceneMgr->createCamera("camera");
     mCamera->setPosition(0.0f, 200.0f, 300.0f);
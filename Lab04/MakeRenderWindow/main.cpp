@@ -6,6 +6,8 @@
 #include <Ogre.h>
 #include <OIS/OIS.h>
 
+#include "SceneManagerSelector.h"
+
 using namespace Ogre;
 
 class ESCListener : public FrameListener {
@@ -72,7 +74,7 @@ public:
 	  mRoot->addFrameListener(mESCListener);
 
 	  // ⺻  Ŵ 
-	  mSceneMgr = mRoot->createSceneManager(ST_GENERIC);
+	  mSceneMgr = SceneManagerSelector::create(mRoot);
 
 	  // ī޶   
 	  mCamera = mSceneMgr->createCamera("camera");
@@ -3,6 +3,12 @@
 #include <Ogre.h>
 #include <OIS/OIS.h>
 
+#include "CloneSet.h"
+#include "CharacterImpostors.h"
+#include "MeshLodBuilder.h"
+#include "DebugGeometry.h"
+#include "SceneManagerSelector.h"
+
 
 using namespace Ogre;
 
@@ -32,6 +38,105 @@ public:
   }
 };
 
+// 1/2/3 switch between 12, 1000 and 10000 clones, I toggles instancing and
+// L cycles the layout. A swaps the static clones for walking ones, O turns
+// their impostors on and off. Batch count, frame time and the LOD triangle
+// savings of the entity clones go to ogre.log.
+class CloneListener : public FrameListener {
+  OIS::Keyboard *mKeyboard;
+  RenderWindow *mWindow;
+  SceneManager *mSceneMgr;
+  CloneSet *mClones;
+  CharacterImpostors *mWalkers;
+
+  int mCount;
+  bool mInstancing;
+  bool mAnimated;
+  CloneSet::Layout mLayout;
+  bool mKeyDown[7];
+  float mLogTime;
+
+public:
+  CloneListener(OIS::Keyboard *keyboard, RenderWindow *window, SceneManager *sceneMgr, CloneSet *clones,
+    CharacterImpostors *walkers)
+    : mKeyboard(keyboard), mWindow(window), mSceneMgr(sceneMgr), mClones(clones), mWalkers(walkers),
+      mCount(12), mInstancing(true), mAnimated(false), mLayout(CloneSet::LAYOUT_RING), mLogTime(0.0f)
+  {
+    for (int i = 0; i < 7; i++)
+      mKeyDown[i] = false;
+    _rebuild();
+  }
+
+  bool frameStarted(const FrameEvent &evt)
+  {
+    // ESCListener captures the keyboard before us
+    if (_pressed(0, OIS::KC_1)) { mCount = 12; _rebuild(); }
+    if (_pressed(1, OIS::KC_2)) { mCount = 1000; _rebuild(); }
+    if (_pressed(2, OIS::KC_3)) { mCount = 10000; _rebuild(); }
+    if (_pressed(3, OIS::KC_I)) { mInstancing = !mInstancing; _rebuild(); }
+    if (_pressed(4, OIS::KC_L)) { mLayout = (CloneSet::Layout)((mLayout + 1) % 3); _rebuild(); }
+    if (_pressed(5, OIS::KC_A)) { mAnimated = !mAnimated; _rebuild(); }
+    if (_pressed(6, OIS::KC_O))
+    {
+      // same field, so the frame times compare directly
+      mWalkers->setEnabled(!mWalkers->isEnabled());
+      mWindow->resetStatistics();
+      mLogTime = 0.0f;
+    }
+
+    mLogTime += evt.timeSinceLastFrame;
+    if (mLogTime >= 2.0f)
+    {
+      const RenderTarget::FrameStats& stats = mWindow->getStatistics();
+      if (mAnimated)
+      {
+        const ImpostorLod::Stats& walkers = mWalkers->getStats();
+        LogManager::getSingleton().stream() << "Walking clones: " << mWalkers->getCount() << ", impostors "
+          << (mWalkers->isEnabled() ? "on" : "off") << ", " << walkers.meshes << " meshes, " << walkers.impostors
+          << " billboards, frame batches " << stats.batchCount << ", triangles " << stats.triangleCount
+          << ", avg " << 1000.0f / std::max(stats.avgFPS, 1.0f) << " ms";
+      }
+      else
+      {
+        LogManager::getSingleton().stream() << "Clones: " << mClones->getCount() << ", "
+          << mClones->getTechniqueName() << ", clone batches " << mClones->getBatchCount()
+          << ", frame batches " << stats.batchCount << ", triangles " << stats.triangleCount
+          << ", avg " << 1000.0f / std::max(stats.avgFPS, 1.0f) << " ms";
+      }
+      MeshLodBuilder::logSavings(mSceneMgr);
+      mLogTime = 0.0f;
+    }
+    return true;
+  }
+
+private:
+  bool _pressed(int slot, OIS::KeyCode key)
+  {
+    bool down = mKeyboard->isKeyDown(key);
+    bool pressed = down && !mKeyDown[slot];
+    mKeyDown[slot] = down;
+    return pressed;
+  }
+
+  void _rebuild(void)
+  {
+    if (mAnimated)
+    {
+      std::vector<Vector3> positions;
+      CloneSet::computePositions(mCount, mLayout, 130.0f, 2016, positions);
+      mClones->destroy();
+      mWalkers->create(positions);
+    }
+    else
+    {
+      mWalkers->destroy();
+      mClones->create(mCount, mLayout, 130.0f, mInstancing);
+    }
+    mWindow->resetStatistics();
+    mLogTime = 0.0f;
+  }
+};
+
 class LectureApp {
 
   Root* mRoot;
@@ -42,6 +147,7 @@ class LectureApp {
   OIS::Keyboard* mKeyboard;
   OIS::InputManager *mInputManager;
   ESCListener* mESCListener;
+  CloneListener* mCloneListener;
 
 public:
 
@@ -78,7 +184,7 @@ public:
     mESCListener = new ESCListener(mKeyboard);
     mRoot->addFrameListener(mESCListener);
 
-    mSceneMgr = mRoot->createSceneManager(ST_GENERIC);
+    mSceneMgr = SceneManagerSelector::create(mRoot);
 
     circleCamera = mCamera = mSceneMgr->createCamera("camera");
 
@@ -103,28 +209,27 @@ public:
     ResourceGroupManager::getSingleton().addResourceLocation("resource.zip", "Zip");
     ResourceGroupManager::getSingleton().initialiseAllResourceGroups();
 
+    // reduced levels for the clones, generated once and cached. Instanced
+    // clones are always drawn at full detail, entity clones (I) use them.
+    MeshLodBuilder* lodBuilder = new MeshLodBuilder();
+    lodBuilder->prepare("DustinBody.mesh");
+
     mSceneMgr->setAmbientLight(ColourValue(1.0f, 1.0f, 1.0f));
 
     // ǥ ǥ
-    Ogre::Entity* mAxesEntity = mSceneMgr->createEntity("Axes", "axes.mesh");
-    mSceneMgr->getRootSceneNode()->createChildSceneNode("AxesNode",Ogre::Vector3(0,0,0))->attachObject(mAxesEntity);
-    mSceneMgr->getSceneNode("AxesNode")->setScale(5, 5, 5);
+    DebugGeometry::createAxes(mSceneMgr);
 
-    _drawGridPlane();
+    DebugGeometry::createGrid(mSceneMgr);
 
 
-    Entity* entity[12];
-    SceneNode* node[12];
+    // the first ring holds twelve professors 250 units from the origin
+    CloneSet* clones = new CloneSet(mSceneMgr, "Professor", "DustinBody.mesh");
 
-    for (int i = 0; i < 12; i++) {
-      char name[20];
-      sprintf(name, "Professor%d", i);
-      entity[i] = mSceneMgr->createEntity(name, "DustinBody.mesh");
-      float x = 250.0f * cos((float)i / 12.0f * 2.0f * 3.14f);
-      float z = -250.0f * sin((float)i / 12.0f * 2.0f * 3.14f);
-      node[i] = mSceneMgr->getRootSceneNode()->createChildSceneNode(Vector3(x, 0, z));
-      node[i]->attachObject(entity[i]);
-    }
+    // the same professors walking, the ones that are small on screen drawn
+    // as billboards from an atlas rendered here
+    CharacterImpostors* walkers = new CharacterImpostors(mSceneMgr, mCamera, "Walkers", "DustinBody.mesh", "Walk");
+    mCloneListener = new CloneListener(mKeyboard, mWindow, mSceneMgr, clones, walkers);
+    mRoot->addFrameListener(mCloneListener);
 
 
     mRoot->startRendering();
@@ -132,35 +237,13 @@ public:
     mInputManager->destroyInputObject(mKeyboard);
     OIS::InputManager::destroyInputSystem(mInputManager);
 
-    delete mRoot;
-  }
-
-private:
-  void _drawGridPlane(void)
-  {
-    Ogre::ManualObject* gridPlane =  mSceneMgr->createManualObject("GridPlane"); 
-    Ogre::SceneNode* gridPlaneNode = mSceneMgr->getRootSceneNode()->createChildSceneNode("GridPlaneNode"); 
-
-    Ogre::MaterialPtr gridPlaneMaterial = Ogre::MaterialManager::getSingleton().create("GridPlanMaterial","General"); 
-    gridPlaneMaterial->setReceiveShadows(false); 
-    gridPlaneMaterial->getTechnique(0)->setLightingEnabled(true); 
-    gridPlaneMaterial->getTechnique(0)->getPass(0)->setDiffuse(1,1,1,0); 
-    gridPlaneMaterial->getTechnique(0)->getPass(0)->setAmbient(1,1,1); 
-    gridPlaneMaterial->getTechnique(0)->getPass(0)->setSelfIllumination(1,1,1); 
-
-    gridPlane->begin("GridPlaneMaterial", Ogre::RenderOperation::OT_LINE_LIST); 
-    for(int i=0; i<21; i++)
-    {
-      gridPlane->position(-500, 0, 500-i*50);
-      gridPlane->position(500, 0, 500-i*50);
-
-      gridPlane->position(-500+i*50, 0, 500);
-      gridPlane->position(-500+i*50, 0, -500);
-    }
+    delete mCloneListener;
+    delete walkers;
+    delete clones;
+    delete mESCListener;
 
-    gridPlane->end(); 
-
-    gridPlaneNode->attachObject(gridPlane);
+    delete mRoot;
+    delete lodBuilder;
   }
 };
 
@@ -0,0 +1,390 @@
+#define CLIENT_DESCRIPTION "Culling Benchmark"
+
+#if OGRE_PLATFORM == OGRE_PLATFORM_WIN32
+#define WIN32_LEAN_AND_MEAN
+#include "windows.h"
+#endif
+
+#include <Ogre.h>
+#include <OIS/OIS.h>
+#include <iostream>
+#include <fstream>
+
+#include "RandomStream.h"
+#include "SceneManagerSelector.h"
+#include "LooseGridSceneManager.h"
+#include "OcclusionCulling.h"
+#include "FrameCapture.h"
+
+using namespace std;
+using namespace Ogre;
+
+
+// times the scene graph update and the visible object search (culling plus
+// render queue build) of the scene manager it is attached to
+class CullingTimer : public SceneManager::Listener
+{
+public:
+  CullingTimer() { reset(); }
+
+  void reset(void) { mUpdateUs = mFindUs = 0; }
+
+  void preUpdateSceneGraph(SceneManager* source, Camera* camera) { mTimer.reset(); }
+  void postUpdateSceneGraph(SceneManager* source, Camera* camera) { mUpdateUs += mTimer.getMicroseconds(); }
+
+  void preFindVisibleObjects(SceneManager* source, SceneManager::IlluminationRenderStage irs, Viewport* v) { mTimer.reset(); }
+  void postFindVisibleObjects(SceneManager* source, SceneManager::IlluminationRenderStage irs, Viewport* v) { mFindUs += mTimer.getMicroseconds(); }
+
+  unsigned long getUpdateUs(void) const { return mUpdateUs; }
+  unsigned long getFindUs(void) const { return mFindUs; }
+
+private:
+  Timer mTimer;
+  unsigned long mUpdateUs;
+  unsigned long mFindUs;
+};
+
+
+// Renders the same scattered DustinBody scene with every scene manager in
+// culling.cfg, with and without the occlusion stage (walls are the
+// occluders). The camera follows a fixed path per frame index, so every run
+// sees exactly the same frames. With Capture set every run also records
+// its frames through FrameCapture. Quits after the last run.
+class CullingBenchmark : public FrameListener
+{
+public:
+  CullingBenchmark(Root* root, RenderWindow* window, OIS::Keyboard* keyboard, const String& configFile)
+    : mRoot(root), mWindow(window), mKeyboard(keyboard), mSceneMgr(nullptr), mCamera(nullptr),
+    mOcclusion(nullptr), mCapture(nullptr), mRun(-1), mFrame(0)
+  {
+    ConfigFile config;
+    config.load(configFile, "\t:=", true);
+
+    const StringVector types = StringUtil::split(config.getSetting("SceneManagers", BLANKSTRING, "generic octree loosegrid"));
+    const String occlusion = config.getSetting("Occlusion", BLANKSTRING, "both");
+    for (size_t i = 0; i < types.size(); i++)
+    {
+      if (occlusion != "on")
+        mRuns.push_back(Run(types[i], false));
+      if (occlusion != "off")
+        mRuns.push_back(Run(types[i], true));
+    }
+
+    mObjects = StringConverter::parseInt(config.getSetting("Objects"), 5000);
+    mArea = StringConverter::parseReal(config.getSetting("Area"), 6000.0f);
+    mFrames = StringConverter::parseInt(config.getSetting("Frames"), 600);
+    mSeed = StringConverter::parseInt(config.getSetting("Seed"), 2016);
+    mWalls = StringConverter::parseInt(config.getSetting("Walls"), 150);
+    mSettings = SceneManagerSelector::load(configFile);
+
+    const String capture = config.getSetting("Capture", BLANKSTRING, "off");
+    mCaptureEnabled = capture != "off";
+    mCaptureSettings.format = (capture == "raw") ? FrameEncoder::FORMAT_RAW : FrameEncoder::FORMAT_PNG;
+    const StringVector size = StringUtil::split(config.getSetting("CaptureSize", BLANKSTRING, "320 240"));
+    if (size.size() == 2)
+    {
+      mCaptureSettings.width = StringConverter::parseInt(size[0], 320);
+      mCaptureSettings.height = StringConverter::parseInt(size[1], 240);
+    }
+    mCaptureSettings.latency = StringConverter::parseInt(config.getSetting("CaptureLatency"), 3);
+
+    mCsv.open("culling.csv");
+    mCsv << "type,occlusion,objects,frames,updateMs,findVisibleMs,frameMs,batches,triangles,"
+      "occlusionRasterMs,occlusionTestMs,occluded,captureMs" << endl;
+
+    // a vertical quad, the walls are the same in every run
+    MeshManager::getSingleton().createPlane("Wall", ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME,
+      Plane(Vector3::UNIT_Z, 0.0f), 800.0f, 300.0f, 1, 1, true, 1, 1.0f, 1.0f, Vector3::UNIT_Y);
+
+    _nextRun();
+  }
+
+  ~CullingBenchmark()
+  {
+    _destroyScene();
+  }
+
+  bool frameStarted(const FrameEvent &evt)
+  {
+    mKeyboard->capture();
+    if (mKeyboard->isKeyDown(OIS::KC_ESCAPE))
+      return false;
+
+    if (mFrame == mFrames)
+    {
+      _report();
+      if (!_nextRun())
+        return false;
+    }
+
+    // a slow circle looking outwards, only a few percent of the objects are in view
+    const Real angle = Math::TWO_PI * mFrame / mFrames;
+    const Real radius = mArea * 0.5f;
+    mCamera->setPosition(Math::Cos(angle) * radius, 300.0f, Math::Sin(angle) * radius);
+    mCamera->lookAt(Math::Cos(angle) * mArea * 2.0f, 0.0f, Math::Sin(angle) * mArea * 2.0f);
+
+    // the first frames load meshes and skeletons
+    if (mFrame == 10)
+    {
+      mCullingTimer.reset();
+      mOccludedObjects = 0;
+      mOcclusionRasterMs = mOcclusionTestMs = 0.0f;
+      mCaptureMs = 0.0f;
+      mWindow->resetStatistics();
+      mRunTimer.reset();
+    }
+    else if (mFrame > 10 && mOcclusion)
+    {
+      // stats of the previous frame's search
+      const OcclusionCulling::Stats& stats = mOcclusion->getStats();
+      mOccludedObjects += stats.objectsOccluded;
+      mOcclusionRasterMs += stats.rasterMs;
+      mOcclusionTestMs += stats.testMs;
+    }
+    if (mFrame > 10 && mCapture)
+    {
+      const FrameCapture::Stats& stats = mCapture->getStats();
+      mCaptureMs += stats.renderMs + stats.readMs;
+    }
+    mFrame++;
+    return true;
+  }
+
+private:
+  bool _nextRun(void)
+  {
+    _destroyScene();
+
+    if (++mRun >= (int)mRuns.size())
+      return false;
+
+    SceneManagerSelector::Settings settings = mSettings;
+    settings.type = mRuns[mRun].type;
+    mSceneMgr = SceneManagerSelector::create(mRoot, "culling" + StringConverter::toString(mRun), settings);
+    mSceneMgr->addListener(&mCullingTimer);
+    mSceneMgr->setAmbientLight(ColourValue(1.0f, 1.0f, 1.0f));
+
+    mCamera = mSceneMgr->createCamera("main");
+    mCamera->setNearClipDistance(5.0f);
+    mCamera->setFarClipDistance(2500.0f);
+
+    Viewport* viewport = mWindow->addViewport(mCamera);
+    viewport->setBackgroundColour(ColourValue(0.0f, 0.0f, 0.5f));
+    mCamera->setAspectRatio(Real(viewport->getActualWidth()) / Real(viewport->getActualHeight()));
+
+    RandomStream random(mSeed);
+    for (int i = 0; i < mObjects; i++)
+    {
+      Entity* entity = mSceneMgr->createEntity("Body" + StringConverter::toString(i), "DustinBody.mesh");
+      SceneNode* node = mSceneMgr->getRootSceneNode()->createChildSceneNode();
+      node->setPosition(random.range(-mArea, mArea), 0.0f, random.range(-mArea, mArea));
+      node->yaw(Degree(random.range(0.0f, 360.0f)));
+      node->attachObject(entity);
+    }
+
+    // walls standing on the ground, taller than the camera is high
+    if (mRuns[mRun].occlusion)
+      mOcclusion = new OcclusionCulling(mSceneMgr);
+    for (int i = 0; i < mWalls; i++)
+    {
+      Entity* entity = mSceneMgr->createEntity("Wall" + StringConverter::toString(i), "Wall");
+      entity->setMaterialName("BaseWhiteNoLighting");
+      SceneNode* node = mSceneMgr->getRootSceneNode()->createChildSceneNode();
+      node->setPosition(random.range(-mArea, mArea), 150.0f, random.range(-mArea, mArea));
+      node->yaw(Degree(random.range(0.0f, 180.0f)));
+      node->attachObject(entity);
+      if (mOcclusion)
+        mOcclusion->addOccluder(entity);
+    }
+
+    if (mCaptureEnabled)
+    {
+      FrameCapture::Settings settings = mCaptureSettings;
+      settings.path = "capture_" + StringConverter::toString(mRun) + "_";
+      mCapture = new FrameCapture(mCamera, settings);
+    }
+
+    mFrame = 0;
+    return true;
+  }
+
+  void _destroyScene(void)
+  {
+    if (!mSceneMgr)
+      return;
+
+    delete mOcclusion;
+    mOcclusion = nullptr;
+    delete mCapture;
+    mCapture = nullptr;
+
+    mWindow->removeAllViewports();
+    mSceneMgr->removeListener(&mCullingTimer);
+    mRoot->destroySceneManager(mSceneMgr);
+    mSceneMgr = nullptr;
+  }
+
+  void _report(void)
+  {
+    const int frames = mFrames - 10;
+    const RenderTarget::FrameStats& stats = mWindow->getStatistics();
+    const Real updateMs = mCullingTimer.getUpdateUs() / 1000.0f / frames;
+    const Real findMs = mCullingTimer.getFindUs() / 1000.0f / frames;
+    const Real frameMs = mRunTimer.getMicroseconds() / 1000.0f / frames;
+
+    const Run& run = mRuns[mRun];
+    LogManager::getSingleton().stream() << "Culling " << mSceneMgr->getTypeName()
+      << (run.occlusion ? " with occlusion" : "") << ": " << mObjects
+      << " objects, scene graph update " << updateMs << " ms, culling and render queue " << findMs
+      << " ms, frame " << frameMs << " ms, " << stats.batchCount << " batches";
+
+    if (mSceneMgr->getTypeName() == LooseGridSceneManager::TYPE_NAME)
+    {
+      const LooseGrid::QueryStats& grid = static_cast<LooseGridSceneManager*>(mSceneMgr)->getGrid().getQueryStats();
+      LogManager::getSingleton().stream() << "  loose grid, last frame: " << grid.cellsTested << " cells tested, "
+        << grid.cellsInside << " fully inside, " << grid.objectsTested << " objects tested, "
+        << grid.objectsAccepted << " accepted";
+    }
+
+    if (mOcclusion)
+    {
+      LogManager::getSingleton().stream() << "  occlusion: raster " << mOcclusionRasterMs / frames << " ms, test "
+        << mOcclusionTestMs / frames << " ms, " << (Real)mOccludedObjects / frames << " objects occluded per frame";
+      mOcclusion->logStats();
+    }
+
+    if (mCapture)
+    {
+      LogManager::getSingleton().stream() << "  capture: " << mCaptureMs / frames << " ms per frame on the render thread";
+      mCapture->logStats();
+    }
+
+    mCsv << run.type << "," << (run.occlusion ? 1 : 0) << "," << mObjects << "," << frames << "," << updateMs << ","
+      << findMs << "," << frameMs << "," << stats.batchCount << "," << stats.triangleCount << ","
+      << mOcclusionRasterMs / frames << "," << mOcclusionTestMs / frames << "," << (Real)mOccludedObjects / frames << ","
+      << mCaptureMs / frames << endl;
+  }
+
+  Root* mRoot;
+  RenderWindow* mWindow;
+  OIS::Keyboard* mKeyboard;
+  SceneManager* mSceneMgr;
+  Camera* mCamera;
+  OcclusionCulling* mOcclusion;
+  FrameCapture* mCapture;
+
+  struct Run
+  {
+    String type;
+    bool occlusion;
+
+    Run(const String& t, bool o) : type(t), occlusion(o) {}
+  };
+  std::vector<Run> mRuns;
+  SceneManagerSelector::Settings mSettings;
+  int mObjects;
+  Real mArea;
+  int mFrames;
+  int mSeed;
+  int mWalls;
+  bool mCaptureEnabled;
+  FrameCapture::Settings mCaptureSettings;
+
+  int mRun;
+  int mFrame;
+  CullingTimer mCullingTimer;
+  long mOccludedObjects;
+  Real mOcclusionRasterMs;
+  Real mOcclusionTestMs;
+  Real mCaptureMs;
+  Timer mRunTimer;
+  std::ofstream mCsv;
+};
+
+
+class LectureApp {
+
+  Root* mRoot;
+  RenderWindow* mWindow;
+  OIS::Keyboard* mKeyboard;
+  OIS::InputManager *mInputManager;
+
+public:
+
+  LectureApp() {}
+
+  ~LectureApp() {}
+
+  void go(void)
+  {
+#if !defined(_DEBUG)
+    mRoot = new Root("plugins.cfg", "ogre.cfg", "ogre.log");
+#else
+    mRoot = new Root("plugins_d.cfg", "ogre.cfg", "ogre.log");
+#endif
+
+    if (!mRoot->restoreConfig()) {
+      if (!mRoot->showConfigDialog()) return;
+    }
+
+    mWindow = mRoot->initialise(true, CLIENT_DESCRIPTION " : Copyleft by Dae-Hyun Lee");
+
+    ResourceGroupManager::getSingleton().addResourceLocation("resource.zip", "Zip");
+    ResourceGroupManager::getSingleton().initialiseAllResourceGroups();
+
+    size_t windowHnd = 0;
+    std::ostringstream windowHndStr;
+    OIS::ParamList pl;
+    mWindow->getCustomAttribute("WINDOW", &windowHnd);
+    windowHndStr << windowHnd;
+    pl.insert(std::make_pair(std::string("WINDOW"), windowHndStr.str()));
+    mInputManager = OIS::InputManager::createInputSystem(pl);
+    mKeyboard = static_cast<OIS::Keyboard*>(mInputManager->createInputObject(OIS::OISKeyboard, false));
+
+    CullingBenchmark* benchmark = new CullingBenchmark(mRoot, mWindow, mKeyboard, "culling.cfg");
+    mRoot->addFrameListener(benchmark);
+
+    mRoot->startRendering();
+
+    mInputManager->destroyInputObject(mKeyboard);
+    OIS::InputManager::destroyInputSystem(mInputManager);
+
+    delete benchmark;
+
+    delete mRoot;
+  }
+};
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if OGRE_PLATFORM == OGRE_PLATFORM_WIN32
+  INT WINAPI WinMain(HINSTANCE hInst, HINSTANCE, LPSTR strCmdLine, INT)
+#else
+  int main(int argc, char *argv[])
+#endif
+  {
+    LectureApp app;
+
+    try {
+
+      app.go();
+
+    }
+    catch (Ogre::Exception& e) {
+#if OGRE_PLATFORM == OGRE_PLATFORM_WIN32
+      MessageBox(NULL, e.getFullDescription().c_str(), "An exception has occured!", MB_OK | MB_ICONERROR | MB_TASKMODAL);
+#else
+      std::cerr << "An exception has occured: " <<
+        e.getFullDescription().c_str() << std::endl;
+#endif
+    }
+
+    return 0;
+  }
+
+#ifdef __cplusplus
+}
+#endif
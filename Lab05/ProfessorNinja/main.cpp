@@ -5,6 +5,10 @@
 
 #include <Ogre.h>
 #include <OIS/OIS.h>
+
+#include "DebugGeometry.h"
+#include "SceneManagerSelector.h"
+#include "MeshLodBuilder.h"
 #include <string>
 
 using namespace Ogre;
@@ -79,7 +83,7 @@ public:
     mESCListener = new ESCListener(mKeyboard);
     mRoot->addFrameListener(mESCListener);
 
-    mSceneMgr = mRoot->createSceneManager(ST_GENERIC);
+    mSceneMgr = SceneManagerSelector::create(mRoot);
 
     mCamera = mSceneMgr->createCamera("camera");
 
@@ -98,14 +102,16 @@ public:
     ResourceGroupManager::getSingleton().addResourceLocation("resource.zip", "Zip");
     ResourceGroupManager::getSingleton().initialiseAllResourceGroups();
 
+    MeshLodBuilder* lodBuilder = new MeshLodBuilder();
+    lodBuilder->prepare("DustinBody.mesh");
+    lodBuilder->prepare("ninja.mesh");
+
     mSceneMgr->setAmbientLight(ColourValue(1.0f, 1.0f, 1.0f));
 
     // ǥ ǥ
-    Ogre::Entity* mAxesEntity = mSceneMgr->createEntity("Axes", "axes.mesh");
-    mSceneMgr->getRootSceneNode()->createChildSceneNode("AxesNode",Ogre::Vector3(0,0,0))->attachObject(mAxesEntity);
-    mSceneMgr->getSceneNode("AxesNode")->setScale(5, 5, 5);
+    DebugGeometry::createAxes(mSceneMgr);
 
-    _drawGridPlane();
+    DebugGeometry::createGrid(mSceneMgr);
 
     // fill here --------------------------------------------------------------------------------------------------
 	Entity* CenterEntity = mSceneMgr->createEntity("Center", SceneManager::PrefabType::PT_SPHERE);
@@ -136,34 +142,7 @@ public:
     OIS::InputManager::destroyInputSystem(mInputManager);
 
     delete mRoot;
-  }
-
-private:
-  void _drawGridPlane(void)
-  {
-    Ogre::ManualObject* gridPlane =  mSceneMgr->createManualObject("GridPlane"); 
-    Ogre::SceneNode* gridPlaneNode = mSceneMgr->getRootSceneNode()->createChildSceneNode("GridPlaneNode"); 
-
-    Ogre::MaterialPtr gridPlaneMaterial = Ogre::MaterialManager::getSingleton().create("GridPlanMaterial","General"); 
-    gridPlaneMaterial->setReceiveShadows(false); 
-    gridPlaneMaterial->getTechnique(0)->setLightingEnabled(true); 
-    gridPlaneMaterial->getTechnique(0)->getPass(0)->setDiffuse(1,1,1,0); 
-    gridPlaneMaterial->getTechnique(0)->getPass(0)->setAmbient(1,1,1); 
-    gridPlaneMaterial->getTechnique(0)->getPass(0)->setSelfIllumination(1,1,1); 
-
-    gridPlane->begin("GridPlaneMaterial", Ogre::RenderOperation::OT_LINE_LIST); 
-    for(int i=0; i<21; i++)
-    {
-      gridPlane->position(-500, 0, 500-i*50);
-      gridPlane->position(500, 0, 500-i*50);
-
-      gridPlane->position(-500+i*50, 0, 500);
-      gridPlane->position(-500+i*50, 0, -500);
-    }
-
-    gridPlane->end(); 
-
-    gridPlaneNode->attachObject(gridPlane);
+    delete lodBuilder;
   }
 };
 
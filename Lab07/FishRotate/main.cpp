@@ -6,6 +6,10 @@
 #include <Ogre.h>
 #include <OIS/OIS.h>
 
+#include "DebugGeometry.h"
+#include "SceneManagerSelector.h"
+#include "FlatSceneTransforms.h"
+
 
 using namespace Ogre;
 
@@ -29,8 +33,13 @@ class MainListener : public FrameListener {
   Root* mRoot;
   SceneNode *mProfessorNode, *mFishNode, *mFishRotationPivotNode;
 
+  // Professor -> Pivot -> Fish, moved through the flat transform store
+  FlatSceneTransforms* mTransforms;
+  int mProfessor, mFishRotationPivot;
+
 public:
-  MainListener(Root* root, OIS::Keyboard *keyboard) : mKeyboard(keyboard), mRoot(root) 
+  MainListener(Root* root, OIS::Keyboard *keyboard, FlatSceneTransforms* transforms)
+    : mKeyboard(keyboard), mRoot(root), mTransforms(transforms)
   {
     mProfessorNode = mRoot->getSceneManager("main")->getSceneNode("Professor");
 	mFishRotationPivotNode = mRoot->getSceneManager("main")->getSceneNode("Pivot");
@@ -38,6 +47,10 @@ public:
 
 	mFishRotationPivotNode->setInheritOrientation(false);
 	//mFishNode->setInheritOrientation(false);
+
+	mProfessor = mTransforms->add(mProfessorNode);
+	mFishRotationPivot = mTransforms->add(mFishRotationPivotNode, mProfessor);
+	mTransforms->add(mFishNode, mFishRotationPivot);
   }
 
   bool frameStarted(const FrameEvent &evt)
@@ -55,11 +68,11 @@ public:
 	  static float fMovingDir           = 1.0f;
 	  
 	  float fFrameRotationDegree = fRotationSpeedPerSecond * fFrameTime;
-	  mFishRotationPivotNode->yaw(Degree(-fFrameRotationDegree));
+	  mTransforms->yaw(mFishRotationPivot, Degree(-fFrameRotationDegree));
 
 	  if (bTurning)
 	  {
-		  mProfessorNode->yaw(Degree(fFrameRotationDegree));
+		  mTransforms->yaw(mProfessor, Degree(fFrameRotationDegree));
 		  fProfessorAccumAngle += fFrameRotationDegree;
 
 		  if (fProfessorAccumAngle >= fGoalTurningDegree)
@@ -70,14 +83,14 @@ public:
 	  else // false == bTurning
 	  {
 		  Vector3 vecVelocity = LookVector * fMovingDir * fFrameTime * fMovingSpeedPerSecond;
-		  mProfessorNode->translate(vecVelocity);
+		  mTransforms->translate(mProfessor, vecVelocity);
 		  
-		  Vector3 vecPos = mProfessorNode->getPosition();
+		  Vector3 vecPos = mTransforms->getPosition(mProfessor);
 		  if (abs(vecPos.z) >= fLimitDistance)
 		  {
 			  // ġ Ų.
 			  vecPos.z = fMovingDir * fLimitDistance;
-			  mProfessorNode->setPosition(vecPos);
+			  mTransforms->setPosition(mProfessor, vecPos);
 
 			  bTurning = true;
 			  fMovingDir *= -1;
@@ -140,7 +153,7 @@ public:
     mKeyboard = static_cast<OIS::Keyboard*>(mInputManager->createInputObject(OIS::OISKeyboard, false));
 
 
-    mSceneMgr = mRoot->createSceneManager(ST_GENERIC, "main");
+    mSceneMgr = SceneManagerSelector::create(mRoot, "main");
     mCamera = mSceneMgr->createCamera("main");
 
 
@@ -161,11 +174,9 @@ public:
     mSceneMgr->setAmbientLight(ColourValue(1.0f, 1.0f, 1.0f));
 
     // ǥ ǥ
-    Ogre::Entity* mAxesEntity = mSceneMgr->createEntity("Axes", "axes.mesh");
-    mSceneMgr->getRootSceneNode()->createChildSceneNode("AxesNode",Ogre::Vector3(0,0,0))->attachObject(mAxesEntity);
-    mSceneMgr->getSceneNode("AxesNode")->setScale(5, 5, 5);
+    DebugGeometry::createAxes(mSceneMgr);
 
-    _drawGridPlane();
+    DebugGeometry::createGrid(mSceneMgr);
 
 
     Entity* entity1 = mSceneMgr->createEntity("Professor", "DustinBody.mesh");
@@ -184,7 +195,9 @@ public:
     mESCListener =new ESCListener(mKeyboard);
     mRoot->addFrameListener(mESCListener);
 
-    mMainListener = new MainListener(mRoot, mKeyboard);
+    FlatSceneTransforms* transforms = new FlatSceneTransforms(mSceneMgr);
+
+    mMainListener = new MainListener(mRoot, mKeyboard, transforms);
     mRoot->addFrameListener(mMainListener);
 
     mRoot->startRendering();
@@ -192,36 +205,10 @@ public:
     mInputManager->destroyInputObject(mKeyboard);
     OIS::InputManager::destroyInputSystem(mInputManager);
 
+    transforms->logStats();
+    delete transforms;
     delete mRoot;
   }
-
-private:
-  void _drawGridPlane(void)
-  {
-    Ogre::ManualObject* gridPlane =  mSceneMgr->createManualObject("GridPlane"); 
-    Ogre::SceneNode* gridPlaneNode = mSceneMgr->getRootSceneNode()->createChildSceneNode("GridPlaneNode"); 
-
-    Ogre::MaterialPtr gridPlaneMaterial = Ogre::MaterialManager::getSingleton().create("GridPlanMaterial","General"); 
-    gridPlaneMaterial->setReceiveShadows(false); 
-    gridPlaneMaterial->getTechnique(0)->setLightingEnabled(true); 
-    gridPlaneMaterial->getTechnique(0)->getPass(0)->setDiffuse(1,1,1,0); 
-    gridPlaneMaterial->getTechnique(0)->getPass(0)->setAmbient(1,1,1); 
-    gridPlaneMaterial->getTechnique(0)->getPass(0)->setSelfIllumination(1,1,1); 
-
-    gridPlane->begin("GridPlaneMaterial", Ogre::RenderOperation::OT_LINE_LIST); 
-    for(int i=0; i<21; i++)
-    {
-      gridPlane->position(-500.0f, 0.0f, 500.0f-i*50);
-      gridPlane->position(500.0f, 0.0f, 500.0f-i*50);
-
-      gridPlane->position(-500.f+i*50, 0.f, 500.0f);
-      gridPlane->position(-500.f+i*50, 0.f, -500.f);
-    }
-
-    gridPlane->end(); 
-
-    gridPlaneNode->attachObject(gridPlane);
-  }
 };
 
 
@@ -0,0 +1,257 @@
+#define CLIENT_DESCRIPTION "Crowd Scenario"
+
+#if OGRE_PLATFORM == OGRE_PLATFORM_WIN32
+#define WIN32_LEAN_AND_MEAN
+#include "windows.h"
+#endif
+
+#include <Ogre.h>
+#include <OIS/OIS.h>
+#include <iostream>
+
+#include "CrowdScenario.h"
+#include "CrowdScenarioScene.h"
+#include "DebugGeometry.h"
+#include "SceneManagerSelector.h"
+
+using namespace std;
+using namespace Ogre;
+
+class InputController : public FrameListener,
+	public OIS::KeyListener,
+	public OIS::MouseListener
+{
+
+public:
+	InputController(Root* root, OIS::Keyboard *keyboard, OIS::Mouse *mouse) : mRoot(root), mKeyboard(keyboard), mMouse(mouse)
+	{
+		mCameraMoveVector = Vector3::ZERO;
+		mCamera = mRoot->getSceneManager("main")->getCamera("main");
+		mContinue = true;
+
+		keyboard->setEventCallback(this);
+		mouse->setEventCallback(this);
+	}
+
+	bool frameStarted(const FrameEvent &evt)
+	{
+		mKeyboard->capture();
+		mMouse->capture();
+
+		mCamera->moveRelative(mCameraMoveVector * 10.f);
+
+		return mContinue;
+	}
+
+	bool keyPressed(const OIS::KeyEvent &evt)
+	{
+		switch (evt.key)
+		{
+		case OIS::KC_W: mCameraMoveVector.y += 1; break;
+		case OIS::KC_S: mCameraMoveVector.y -= 1; break;
+		case OIS::KC_A: mCameraMoveVector.x -= 1; break;
+		case OIS::KC_D: mCameraMoveVector.x += 1; break;
+		case OIS::KC_ESCAPE: mContinue = false; break;
+		}
+		return true;
+	}
+
+	bool keyReleased(const OIS::KeyEvent &evt)
+	{
+		switch (evt.key)
+		{
+		case OIS::KC_W: mCameraMoveVector.y -= 1; break;
+		case OIS::KC_S: mCameraMoveVector.y += 1; break;
+		case OIS::KC_A: mCameraMoveVector.x += 1; break;
+		case OIS::KC_D: mCameraMoveVector.x -= 1; break;
+		}
+		return true;
+	}
+
+	bool mouseMoved(const OIS::MouseEvent &evt)
+	{
+		if (evt.state.buttonDown(OIS::MB_Right)) {
+			mCamera->yaw(Degree(-evt.state.X.rel));
+			mCamera->pitch(Degree(-evt.state.Y.rel));
+		}
+
+		mCamera->moveRelative(Ogre::Vector3(0, 0, -evt.state.Z.rel * 0.5f));
+
+		return true;
+	}
+
+	bool mousePressed(const OIS::MouseEvent &evt, OIS::MouseButtonID id) { return true; }
+	bool mouseReleased(const OIS::MouseEvent &evt, OIS::MouseButtonID id) { return true; }
+
+private:
+	bool mContinue;
+	Ogre::Root* mRoot;
+	OIS::Keyboard* mKeyboard;
+	OIS::Mouse* mMouse;
+	Camera* mCamera;
+
+	Ogre::Vector3 mCameraMoveVector;
+};
+
+
+// ticks the scenario and logs the checksum once the configured ticks are done,
+// it has to match the benchmark run on this lab's own scene,
+// "Benchmark scenario ..\Lab08\CrowdScenario\crowd.cfg"
+class CrowdController : public FrameListener
+{
+public:
+	CrowdController(CrowdScenario* scenario, CrowdScenarioScene* scene) : mScenario(scenario), mScene(scene), mReported(false) {}
+
+	bool frameStarted(const FrameEvent &evt)
+	{
+		mScene->update(evt.timeSinceLastFrame);
+
+		if (!mReported && mScenario->getTickCount() >= mScenario->getConfig().ticks)
+		{
+			std::ostringstream checksum;
+			checksum << std::hex << mScenario->getChecksum();
+			LogManager::getSingleton().stream() << "Crowd scenario: " << mScenario->getAgentCount() << " agents, "
+				<< mScenario->getTickCount() << " ticks, checksum " << checksum.str();
+			mReported = true;
+		}
+		return true;
+	}
+
+private:
+	CrowdScenario * mScenario;
+	CrowdScenarioScene * mScene;
+	bool mReported;
+};
+
+
+
+class LectureApp {
+
+	Root* mRoot;
+	RenderWindow* mWindow;
+	SceneManager* mSceneMgr;
+	Camera* mCamera;
+	Viewport* mViewport;
+	OIS::Keyboard* mKeyboard;
+	OIS::Mouse* mMouse;
+
+	OIS::InputManager *mInputManager;
+
+public:
+
+	LectureApp() {}
+
+	~LectureApp() {}
+
+	void go(void)
+	{
+#if !defined(_DEBUG)
+		mRoot = new Root("plugins.cfg", "ogre.cfg", "ogre.log");
+#else
+		mRoot = new Root("plugins_d.cfg", "ogre.cfg", "ogre.log");
+#endif
+
+		if (!mRoot->restoreConfig()) {
+			if (!mRoot->showConfigDialog()) return;
+		}
+
+		CrowdScenarioConfig config;
+		std::string error;
+		if (!config.load("crowd.cfg", error))
+			OGRE_EXCEPT(Exception::ERR_FILE_NOT_FOUND, error, "LectureApp::go");
+
+		mWindow = mRoot->initialise(true, CLIENT_DESCRIPTION " : Copyleft by Dae-Hyun Lee");
+
+		mSceneMgr = SceneManagerSelector::create(mRoot, "main");
+		mCamera = mSceneMgr->createCamera("main");
+
+		mCamera->setPosition(0.0f, 900.0f, 1200.0f);
+		mCamera->lookAt(0.0f, 0.0f, 0.0f);
+		mCamera->setNearClipDistance(5.0f);
+
+		mViewport = mWindow->addViewport(mCamera);
+		mViewport->setBackgroundColour(ColourValue(0.0f, 0.0f, 0.5f));
+		mCamera->setAspectRatio(Real(mViewport->getActualWidth()) / Real(mViewport->getActualHeight()));
+
+		ResourceGroupManager::getSingleton().addResourceLocation("resource.zip", "Zip");
+		ResourceGroupManager::getSingleton().initialiseAllResourceGroups();
+
+		mSceneMgr->setAmbientLight(ColourValue(1.0f, 1.0f, 1.0f));
+
+		DebugGeometry::createGrid(mSceneMgr);
+
+		CrowdScenario* scenario = new CrowdScenario();
+		scenario->setup(config);
+
+		CrowdScenarioScene* scene = new CrowdScenarioScene(mSceneMgr, scenario);
+		scene->create();
+
+		size_t windowHnd = 0;
+		std::ostringstream windowHndStr;
+		OIS::ParamList pl;
+		mWindow->getCustomAttribute("WINDOW", &windowHnd);
+		windowHndStr << windowHnd;
+		pl.insert(std::make_pair(std::string("WINDOW"), windowHndStr.str()));
+		pl.insert(std::make_pair(std::string("w32_mouse"), std::string("DISCL_FOREGROUND")));
+		pl.insert(std::make_pair(std::string("w32_mouse"), std::string("DISCL_NONEXCLUSIVE")));
+		pl.insert(std::make_pair(std::string("w32_keyboard"), std::string("DISCL_FOREGROUND")));
+		pl.insert(std::make_pair(std::string("w32_keyboard"), std::string("DISCL_NONEXCLUSIVE")));
+		mInputManager = OIS::InputManager::createInputSystem(pl);
+
+		mKeyboard = static_cast<OIS::Keyboard*>(mInputManager->createInputObject(OIS::OISKeyboard, true));
+		mMouse = static_cast<OIS::Mouse*>(mInputManager->createInputObject(OIS::OISMouse, true));
+
+		InputController* inputController = new InputController(mRoot, mKeyboard, mMouse);
+		mRoot->addFrameListener(inputController);
+
+		CrowdController* crowdController = new CrowdController(scenario, scene);
+		mRoot->addFrameListener(crowdController);
+
+		mRoot->startRendering();
+
+		mInputManager->destroyInputObject(mKeyboard);
+		mInputManager->destroyInputObject(mMouse);
+		OIS::InputManager::destroyInputSystem(mInputManager);
+
+		delete crowdController;
+		delete inputController;
+		delete scene;
+		delete scenario;
+
+		delete mRoot;
+	}
+};
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if OGRE_PLATFORM == OGRE_PLATFORM_WIN32
+	INT WINAPI WinMain(HINSTANCE hInst, HINSTANCE, LPSTR strCmdLine, INT)
+#else
+	int main(int argc, char *argv[])
+#endif
+	{
+		LectureApp app;
+
+		try {
+
+			app.go();
+
+		}
+		catch (Ogre::Exception& e) {
+#if OGRE_PLATFORM == OGRE_PLATFORM_WIN32
+			MessageBox(NULL, e.getFullDescription().c_str(), "An exception has occured!", MB_OK | MB_ICONERROR | MB_TASKMODAL);
+#else
+			std::cerr << "An exception has occured: " <<
+				e.getFullDescription().c_str() << std::endl;
+#endif
+		}
+
+		return 0;
+	}
+
+#ifdef __cplusplus
+}
+#endif
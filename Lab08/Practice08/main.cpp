@@ -10,6 +10,16 @@
 #include <iostream>
 #include <map>
 
+#include "CrowdAvoidance.h"
+#include "AIScheduler.h"
+#include "RandomStream.h"
+#include "CharacterCollision.h"
+#include "InfluenceMap.h"
+#include "InfluenceMapOverlay.h"
+#include "DebugGeometry.h"
+#include "SceneManagerSelector.h"
+#include "SceneRegistry.h"
+
 using namespace std;
 using namespace Ogre;
 
@@ -33,6 +43,9 @@ public:
 		mDestQuat       = Quaternion::ZERO;
 
 		mBasicLookVector = Vector3::UNIT_Z;
+
+		mAvoidance = nullptr;
+		mAvoidanceAgent = -1;
 	}
 
 	~AnimationObject()
@@ -52,10 +65,16 @@ public:
 	void setIdleAnim(const char * name) { mAnimList[eIDLE] = string(name); }
 	void setWalkAnim(const char * name) { mAnimList[eWALKING] = string(name); }
 	void setSpeed(float speed) { mSpeed = speed; }
-	void setData(Root * root, const char * objName, const char * initAnimState, char * initWalkState)
+	void setAvoidance(CrowdAvoidance * avoidance, float radius)
+	{
+		mAvoidance = avoidance;
+		Vector3 pos = mNode->getPosition();
+		mAvoidanceAgent = mAvoidance->addAgent(pos.x, pos.z, radius, mSpeed);
+	}
+	void setData(const SceneRegistry& registry, NodeHandle node, EntityHandle entity, const char * initAnimState, char * initWalkState)
 	{
-		mNode   = root->getSceneManager("main")->getSceneNode(objName);
-		mEntity = root->getSceneManager("main")->getEntity(objName);
+		mNode   = registry.get(node);
+		mEntity = registry.get(entity);
 		setIdleAnim(initAnimState);
 		setWalkAnim(initWalkState);
 
@@ -100,6 +119,7 @@ public:
 	void update(float frameTime)
 	{
 		mAnimationState->addTime(frameTime);
+		Vector3 preferred = Vector3::ZERO;
 
 		if (mState == eROTATING)
 		{
@@ -118,20 +138,46 @@ public:
 		}
 		else if (mState == eWALKING)
 		{
+			bool moving = true;
 			if (isMovingToPoint())
 			{
-				mTargetDistance -= mSpeed * frameTime;
-				if (mTargetDistance < 0.1f)
+				// aim from where the node really is, avoidance and collision move it sideways
+				Vector3 toTarget = mTargetPos - mNode->getPosition();
+				toTarget.y = 0.f;
+				mTargetDistance = toTarget.normalise();
+				if (mTargetDistance <= mSpeed * frameTime)
 				{
-					mNode->setPosition(mTargetPos);
+					// walk the last bit instead of jumping onto the target
+					mNode->translate(toTarget * mTargetDistance);
 					mTargetDistance = 0.f;
-					return;
+					moving = false;
 				}
+				else
+					mDirVector = toTarget;
+			}
+			else if (mVelocity == Vector3::ZERO)
+			{
+				// arrived, wait for the next point
+				moving = false;
+			}
+
+			if (moving)
+			{
+				preferred = mDirVector * mSpeed;
+				mNode->translate(_steeredVelocity(preferred) * frameTime);
+
+				Quaternion rot = mBasicLookVector.getRotationTo(mDirVector);
+				mNode->setOrientation(rot);
 			}
-			mNode->translate(mDirVector * mSpeed * frameTime);
+		}
 
-			Quaternion rot = mBasicLookVector.getRotationTo(mDirVector);
-			mNode->setOrientation(rot);
+		// every frame, or the others keep avoiding where this one was and
+		// where it meant to go; idle, turning and arrived agents stand still
+		if (mAvoidance)
+		{
+			Vector3 pos = mNode->getPosition();
+			mAvoidance->setPreferredVelocity(mAvoidanceAgent, preferred.x, preferred.z);
+			mAvoidance->setPosition(mAvoidanceAgent, pos.x, pos.z);
 		}
 	}
 
@@ -167,6 +213,14 @@ public:
 	}
 
 private:
+	// velocity of this frame, corrected by the avoidance solved at the end of last frame
+	Vector3 _steeredVelocity(const Vector3& preferred)
+	{
+		if (!mAvoidance)
+			return preferred;
+		return Vector3(mAvoidance->getVelocityX(mAvoidanceAgent), 0.f, mAvoidance->getVelocityZ(mAvoidanceAgent));
+	}
+
 	SceneNode * mNode;
 	Entity * mEntity;
 	AnimationState* mAnimationState;
@@ -185,6 +239,9 @@ private:
 	Vector3 mBasicLookVector;
 
 	std::map<OBJ_STATE, string> mAnimList;
+
+	CrowdAvoidance * mAvoidance;
+	int mAvoidanceAgent;
 };
 
 
@@ -194,15 +251,18 @@ class InputController : public FrameListener,
 {
 
 public:
-	InputController(Root* root, OIS::Keyboard *keyboard, OIS::Mouse *mouse) : mRoot(root), mKeyboard(keyboard), mMouse(mouse)
+	InputController(Root* root, OIS::Keyboard *keyboard, OIS::Mouse *mouse, CrowdAvoidance* avoidance, InfluenceMapOverlay* overlay,
+		const SceneRegistry& registry, NodeHandle node, EntityHandle entity, CameraHandle camera)
+		: mRoot(root), mKeyboard(keyboard), mMouse(mouse), mOverlay(overlay)
 	{
 		mProfessor = new AnimationObject();
-		mProfessor->setData(root, "Professor", "Idle", "Walk");
+		mProfessor->setData(registry, node, entity, "Idle", "Walk");
 		mProfessor->setSpeed(100.f);
+		mProfessor->setAvoidance(avoidance, 30.f);
 
 		mCameraMoveVector = Vector3::ZERO;
 
-		mCamera = mRoot->getSceneManager("main")->getCamera("main");
+		mCamera = registry.get(camera);
 
 		keyboard->setEventCallback(this);
 		mouse->setEventCallback(this);
@@ -239,6 +299,8 @@ public:
 		case OIS::KC_RIGHT: mProfessor->move(Vector3::UNIT_X);  break;
 		case OIS::KC_UP:    mProfessor->move(-Vector3::UNIT_Z); break;
 		case OIS::KC_DOWN:  mProfessor->move(Vector3::UNIT_Z);  break;
+
+		case OIS::KC_TAB: mOverlay->nextLayer(); break;
 		
 		case OIS::KC_ESCAPE: mContinue = false; break;
 		}
@@ -298,41 +360,58 @@ private:
 	OIS::Keyboard* mKeyboard;
 	OIS::Mouse* mMouse;
 	Camera* mCamera;
+	InfluenceMapOverlay* mOverlay;
 
 	Ogre::Vector3 mCameraMoveVector;
 };
 
-class NinjaController : public FrameListener
+class NinjaController : public FrameListener, public AIAgent
 {
 
 public:
-	NinjaController(Root* root)
+	NinjaController(const SceneRegistry& registry, NodeHandle node, EntityHandle entity,
+		CrowdAvoidance* avoidance, AIScheduler* scheduler, const InfluenceMap* influence, unsigned int seed = 2016)
+		: mRandom(seed, 0), mInfluence(influence)
 	{
-		mProfessorNode = root->getSceneManager("main")->getSceneNode("Professor");
+		mThreatLayer = influence->getLayer("threat");
+		mCrowdLayer = influence->getLayer("crowd");
 
 		mNinja = new AnimationObject();
-		mNinja->setData(root, "Ninja", "Walk", "Walk");
+		mNinja->setData(registry, node, entity, "Walk", "Walk");
 		mNinja->basicRotate(-Vector3::UNIT_Z);
 		mNinja->setSpeed(80.f);
+		mNinja->setAvoidance(avoidance, 30.f);
 
 		mWalkList.push_back(randomVector());
 
 		nextLocation();
+
+		// decisions only need to be refreshed a few times per second
+		scheduler->add(this, 0.2f);
 	}
 
 	bool frameStarted(const FrameEvent &evt)
 	{
 		mNinja->update(evt.timeSinceLastFrame);
-		Vector3 professorPos = mProfessorNode->getPosition();
-		if (mNinja->getPosition().distance(professorPos) < 100.f)
+		return true;
+	}
+
+	void think(float elapsed)
+	{
+		// inside the professor's threat, follow it uphill towards the professor
+		Vector3 pos = mNinja->getPosition();
+		if (mInfluence->sample(mThreatLayer, pos.x, pos.z) > 0.f)
 		{
-			mNinja->moveToPoint(professorPos);
+			float targetX, targetZ;
+			if (mInfluence->climb(mThreatLayer, pos.x, pos.z, targetX, targetZ))
+				mNinja->moveToPoint(Vector3(targetX, 0.f, targetZ));
+			else
+				mNinja->moveToPoint(pos);  // same cell, wait there
 		}
 		else if (false == mNinja->isMovingToPoint())
 		{
 			nextLocation();
 		}
-		return true;
 	}
 
 	bool nextLocation(void)
@@ -347,15 +426,148 @@ public:
 		return true;
 	}
 
+	// least crowded of a few random points
 	Vector3 randomVector()
 	{
-		return Vector3(rand() % 500 - 250, 0.f, rand() % 500 - 250);
+		Vector3 best;
+		float bestCrowd = 0.f;
+		for (int i = 0; i < 3; i++)
+		{
+			Vector3 candidate(mRandom.range(-250.f, 250.f), 0.f, mRandom.range(-250.f, 250.f));
+			float crowd = mInfluence->sample(mCrowdLayer, candidate.x, candidate.z);
+			if (i == 0 || crowd < bestCrowd)
+			{
+				best = candidate;
+				bestCrowd = crowd;
+			}
+		}
+		return best;
 	}
 
 private:
+	RandomStream mRandom;
 	std::deque<Vector3> mWalkList;
 	AnimationObject * mNinja;
-	SceneNode * mProfessorNode;
+	const InfluenceMap * mInfluence;
+	int mThreatLayer;
+	int mCrowdLayer;
+};
+
+
+
+// solves avoidance once per frame after every agent has written its
+// position and preferred velocity
+class AvoidanceController : public FrameListener
+{
+public:
+	AvoidanceController(CrowdAvoidance* avoidance) : mAvoidance(avoidance) {}
+
+	bool frameEnded(const FrameEvent &evt)
+	{
+		mAvoidance->computeVelocities(evt.timeSinceLastFrame);
+		return true;
+	}
+
+private:
+	CrowdAvoidance * mAvoidance;
+};
+
+
+
+// keeps the influence sources on their nodes and refreshes the debug overlay
+class InfluenceController : public FrameListener
+{
+public:
+	InfluenceController(InfluenceMap* influence, InfluenceMapOverlay* overlay) : mInfluence(influence), mOverlay(overlay) {}
+
+	void add(SceneNode* node, int layer, float strength)
+	{
+		Vector3 pos = node->getPosition();
+		mSources.push_back(mInfluence->addSource(layer, pos.x, pos.z, strength));
+		mNodes.push_back(node);
+	}
+
+	bool frameStarted(const FrameEvent &evt)
+	{
+		for (size_t i = 0; i < mNodes.size(); i++)
+		{
+			Vector3 pos = mNodes[i]->getPosition();
+			mInfluence->moveSource(mSources[i], pos.x, pos.z);
+		}
+
+		mOverlay->update(evt.timeSinceLastFrame);
+		return true;
+	}
+
+private:
+	InfluenceMap * mInfluence;
+	InfluenceMapOverlay * mOverlay;
+	std::vector<int> mSources;
+	std::vector<SceneNode*> mNodes;
+};
+
+
+
+// pushes overlapping characters apart after everything has moved
+class CollisionController : public FrameListener
+{
+public:
+	CollisionController(CharacterCollision* collision) : mCollision(collision) {}
+
+	void add(SceneNode* node, float radius, float height, float inverseMass)
+	{
+		Vector3 pos = node->getPosition();
+		mCollision->addBody(pos.x, pos.y, pos.z, radius, height, inverseMass);
+		mNodes.push_back(node);
+	}
+
+	bool frameEnded(const FrameEvent &evt)
+	{
+		for (size_t i = 0; i < mNodes.size(); i++)
+		{
+			Vector3 pos = mNodes[i]->getPosition();
+			mCollision->setPosition((int)i, pos.x, pos.y, pos.z);
+		}
+
+		mCollision->step();
+
+		for (size_t i = 0; i < mNodes.size(); i++)
+			mNodes[i]->setPosition(mCollision->getX((int)i), mCollision->getY((int)i), mCollision->getZ((int)i));
+		return true;
+	}
+
+private:
+	CharacterCollision * mCollision;
+	std::vector<SceneNode*> mNodes;
+};
+
+
+
+// runs the time-sliced AI and logs how many agents were updated or deferred
+class AIController : public FrameListener
+{
+public:
+	AIController(AIScheduler* scheduler) : mScheduler(scheduler), mLogTime(0.f) {}
+
+	bool frameStarted(const FrameEvent &evt)
+	{
+		mScheduler->update(evt.timeSinceLastFrame);
+
+		mLogTime += evt.timeSinceLastFrame;
+		if (mLogTime >= 1.f)
+		{
+			const AIScheduler::FrameStats& stats = mScheduler->getFrameStats();
+			LogManager::getSingleton().stream() << "AI: " << stats.agents << " agents, "
+				<< stats.updated << " updated, " << stats.deferred << " deferred, "
+				<< stats.milliseconds << " ms";
+			mLogTime = 0.f;
+		}
+		return true;
+	}
+
+private:
+	AIScheduler * mScheduler;
+	float mLogTime;
 };
 
 
@@ -371,6 +583,7 @@ class LectureApp {
 	OIS::Mouse* mMouse;
 
 	OIS::InputManager *mInputManager;
+	SceneRegistry* mRegistry;
 
 
 
@@ -397,7 +610,7 @@ public:
 
 		mWindow = mRoot->initialise(true, CLIENT_DESCRIPTION " : Copyleft by Dae-Hyun Lee");
 
-		mSceneMgr = mRoot->createSceneManager(ST_GENERIC, "main");
+		mSceneMgr = SceneManagerSelector::create(mRoot, "main");
 		mCamera = mSceneMgr->createCamera("main");
 
 
@@ -415,11 +628,9 @@ public:
 		mSceneMgr->setAmbientLight(ColourValue(1.0f, 1.0f, 1.0f));
 
 		// ǥ ǥ
-		Ogre::Entity* mAxesEntity = mSceneMgr->createEntity("Axes", "axes.mesh");
-		mSceneMgr->getRootSceneNode()->createChildSceneNode("AxesNode", Ogre::Vector3(0, 0, 0))->attachObject(mAxesEntity);
-		mSceneMgr->getSceneNode("AxesNode")->setScale(5, 5, 5);
+		DebugGeometry::createAxes(mSceneMgr);
 
-		_drawGridPlane();
+		DebugGeometry::createGrid(mSceneMgr);
 
 
 		Entity* entity1 = mSceneMgr->createEntity("Professor", "DustinBody.mesh");
@@ -433,6 +644,13 @@ public:
 
 		node2->setOrientation(Ogre::Quaternion(Ogre::Degree(180), Ogre::Vector3::UNIT_Y));
 
+		mRegistry = new SceneRegistry();
+		CameraHandle camera = mRegistry->add(mCamera);
+		NodeHandle professorNode = mRegistry->add(node1);
+		EntityHandle professorEntity = mRegistry->add(entity1);
+		NodeHandle ninjaNode = mRegistry->add(node2);
+		EntityHandle ninjaEntity = mRegistry->add(entity2);
+
 
 		size_t windowHnd = 0;
 		std::ostringstream windowHndStr;
@@ -450,50 +668,61 @@ public:
 		mKeyboard = static_cast<OIS::Keyboard*>(mInputManager->createInputObject(OIS::OISKeyboard, true));
 		mMouse = static_cast<OIS::Mouse*>(mInputManager->createInputObject(OIS::OISMouse, true));
 
-		InputController* inputController = new InputController(mRoot, mKeyboard, mMouse);
+		CrowdAvoidance* avoidance = new CrowdAvoidance();
+		AIScheduler* scheduler = new AIScheduler(4, 1.0);
+
+		// same area as the grid plane, the professor's threat reaches as far as the old chase distance
+		InfluenceMap* influence = new InfluenceMap(-500.f, -500.f, 25.f, 40, 40);
+		int threatLayer = influence->addLayer("threat", 100.f);
+		int crowdLayer = influence->addLayer("crowd", 60.f);
+		InfluenceMapOverlay* overlay = new InfluenceMapOverlay(mSceneMgr, influence);
+
+		InfluenceController* influenceController = new InfluenceController(influence, overlay);
+		influenceController->add(node1, threatLayer, 1.f);
+		influenceController->add(node1, crowdLayer, 1.f);
+		influenceController->add(node2, crowdLayer, 1.f);
+		mRoot->addFrameListener(influenceController);
+
+		InputController* inputController = new InputController(mRoot, mKeyboard, mMouse, avoidance, overlay,
+			*mRegistry, professorNode, professorEntity, camera);
 		mRoot->addFrameListener(inputController);
 
-		NinjaController* professorController = new NinjaController(mRoot);
+		NinjaController* professorController = new NinjaController(*mRegistry, ninjaNode, ninjaEntity, avoidance, scheduler, influence);
 		mRoot->addFrameListener(professorController);
 
+		AIController* aiController = new AIController(scheduler);
+		mRoot->addFrameListener(aiController);
+
+		AvoidanceController* avoidanceController = new AvoidanceController(avoidance);
+		mRoot->addFrameListener(avoidanceController);
+
+		// the professor is player controlled, the ninja gives way
+		CharacterCollision* collision = new CharacterCollision();
+		CollisionController* collisionController = new CollisionController(collision);
+		collisionController->add(node1, 30.f, 180.f, 0.2f);
+		collisionController->add(node2, 30.f, 180.f, 1.f);
+		mRoot->addFrameListener(collisionController);
+
 		mRoot->startRendering();
 
 		mInputManager->destroyInputObject(mKeyboard);
 		mInputManager->destroyInputObject(mMouse);
 		OIS::InputManager::destroyInputSystem(mInputManager);
 
+		delete collisionController;
+		delete collision;
+		delete influenceController;
+		delete overlay;
+		delete influence;
+		delete aiController;
+		delete avoidanceController;
 		delete professorController;
 		delete inputController;
+		delete scheduler;
+		delete avoidance;
 
 		delete mRoot;
-	}
-
-private:
-	void _drawGridPlane(void)
-	{
-		Ogre::ManualObject* gridPlane = mSceneMgr->createManualObject("GridPlane");
-		Ogre::SceneNode* gridPlaneNode = mSceneMgr->getRootSceneNode()->createChildSceneNode("GridPlaneNode");
-
-		Ogre::MaterialPtr gridPlaneMaterial = Ogre::MaterialManager::getSingleton().create("GridPlanMaterial", "General");
-		gridPlaneMaterial->setReceiveShadows(false);
-		gridPlaneMaterial->getTechnique(0)->setLightingEnabled(true);
-		gridPlaneMaterial->getTechnique(0)->getPass(0)->setDiffuse(1, 1, 1, 0);
-		gridPlaneMaterial->getTechnique(0)->getPass(0)->setAmbient(1, 1, 1);
-		gridPlaneMaterial->getTechnique(0)->getPass(0)->setSelfIllumination(1, 1, 1);
-
-		gridPlane->begin("GridPlaneMaterial", Ogre::RenderOperation::OT_LINE_LIST);
-		for (int i = 0; i < 21; i++)
-		{
-			gridPlane->position(-500.0f, 0.0f, 500.0f - i * 50);
-			gridPlane->position(500.0f, 0.0f, 500.0f - i * 50);
-
-			gridPlane->position(-500.f + i * 50, 0.f, 500.0f);
-			gridPlane->position(-500.f + i * 50, 0.f, -500.f);
-		}
-
-		gridPlane->end();
-
-		gridPlaneNode->attachObject(gridPlane);
+		delete mRegistry;
 	}
 };
 
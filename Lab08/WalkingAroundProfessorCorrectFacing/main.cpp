@@ -8,6 +8,9 @@
 #include <Ogre.h>
 #include <OIS/OIS.h>
 
+#include "DebugGeometry.h"
+#include "SceneManagerSelector.h"
+
 
 using namespace Ogre;
 
@@ -234,7 +237,7 @@ public:
 
 		mWindow = mRoot->initialise(true, CLIENT_DESCRIPTION " : Copyleft by Dae-Hyun Lee");
 
-		mSceneMgr = mRoot->createSceneManager(ST_GENERIC, "main");
+		mSceneMgr = SceneManagerSelector::create(mRoot, "main");
 		mCamera = mSceneMgr->createCamera("main");
 
 
@@ -252,11 +255,9 @@ public:
 		mSceneMgr->setAmbientLight(ColourValue(1.0f, 1.0f, 1.0f));
 
 		// ǥ ǥ
-		Ogre::Entity* mAxesEntity = mSceneMgr->createEntity("Axes", "axes.mesh");
-		mSceneMgr->getRootSceneNode()->createChildSceneNode("AxesNode", Ogre::Vector3(0, 0, 0))->attachObject(mAxesEntity);
-		mSceneMgr->getSceneNode("AxesNode")->setScale(5, 5, 5);
+		DebugGeometry::createAxes(mSceneMgr);
 
-		_drawGridPlane();
+		DebugGeometry::createGrid(mSceneMgr);
 
 
 		Entity* entity1 = mSceneMgr->createEntity("Professor", "DustinBody.mesh");
@@ -306,34 +307,6 @@ public:
 
 		delete mRoot;
 	}
-
-private:
-	void _drawGridPlane(void)
-	{
-		Ogre::ManualObject* gridPlane = mSceneMgr->createManualObject("GridPlane");
-		Ogre::SceneNode* gridPlaneNode = mSceneMgr->getRootSceneNode()->createChildSceneNode("GridPlaneNode");
-
-		Ogre::MaterialPtr gridPlaneMaterial = Ogre::MaterialManager::getSingleton().create("GridPlanMaterial", "General");
-		gridPlaneMaterial->setReceiveShadows(false);
-		gridPlaneMaterial->getTechnique(0)->setLightingEnabled(true);
-		gridPlaneMaterial->getTechnique(0)->getPass(0)->setDiffuse(1, 1, 1, 0);
-		gridPlaneMaterial->getTechnique(0)->getPass(0)->setAmbient(1, 1, 1);
-		gridPlaneMaterial->getTechnique(0)->getPass(0)->setSelfIllumination(1, 1, 1);
-
-		gridPlane->begin("GridPlaneMaterial", Ogre::RenderOperation::OT_LINE_LIST);
-		for (int i = 0; i < 21; i++)
-		{
-			gridPlane->position(-500.0f, 0.0f, 500.0f - i * 50);
-			gridPlane->position(500.0f, 0.0f, 500.0f - i * 50);
-
-			gridPlane->position(-500.f + i * 50, 0.f, 500.0f);
-			gridPlane->position(-500.f + i * 50, 0.f, -500.f);
-		}
-
-		gridPlane->end();
-
-		gridPlaneNode->attachObject(gridPlane);
-	}
 };
 
 
@@ -8,6 +8,11 @@
 #include <Ogre.h>
 #include <OIS/OIS.h>
 
+#include "DebugGeometry.h"
+#include "SceneManagerSelector.h"
+#include "VisibilityStats.h"
+#include "Minimap.h"
+
 
 using namespace Ogre;
 
@@ -17,7 +22,9 @@ class InputController : public FrameListener,
 {
 
 public:
-  InputController(Root* root, OIS::Keyboard *keyboard, OIS::Mouse *mouse) : mRoot(root), mKeyboard(keyboard), mMouse(mouse)
+  InputController(Root* root, OIS::Keyboard *keyboard, OIS::Mouse *mouse, VisibilityStats* stats,
+    VisibilityStats* mapStats, Minimap* minimap)
+    : mRoot(root), mKeyboard(keyboard), mMouse(mouse), mStats(stats), mMapStats(mapStats), mMinimap(minimap)
   {
     mCamera = mRoot->getSceneManager("main")->getCamera("main");
 	mCameraMoveVector = Ogre::Vector3::ZERO;
@@ -49,6 +56,32 @@ public:
     case OIS::KC_S: mCameraMoveVector.y -= 1; break;
     case OIS::KC_A: mCameraMoveVector.x -= 1; break;
     case OIS::KC_D: mCameraMoveVector.x += 1; break;
+
+    // F5 records the per camera stats to visibility.csv until pressed again, F6 logs the last frame
+    case OIS::KC_F5:
+      if (mStats->isWritingCsv())
+      {
+        mStats->stopCsv();
+        mMapStats->stopCsv();
+      }
+      else
+      {
+        mStats->startCsv("visibility.csv");
+        mMapStats->startCsv("visibility_map.csv");
+      }
+      break;
+    case OIS::KC_F6:
+      mStats->logStats();
+      mMapStats->logStats();
+      mMinimap->logStats();
+      break;
+
+    // F7/F8 halve and double the map's refresh interval, F9/F10 its resolution
+    case OIS::KC_F7: mMinimap->setInterval(mMinimap->getInterval() * 0.5f); mMinimap->logStats(); break;
+    case OIS::KC_F8: mMinimap->setInterval(std::max(mMinimap->getInterval() * 2.0f, 0.02f)); mMinimap->logStats(); break;
+    case OIS::KC_F9: mMinimap->setResolution(mMinimap->getResolution() / 2); mMinimap->logStats(); break;
+    case OIS::KC_F10: mMinimap->setResolution(mMinimap->getResolution() * 2); mMinimap->logStats(); break;
+
     case OIS::KC_ESCAPE: mContinue = false; break;
     }
 
@@ -102,6 +135,9 @@ private:
   OIS::Keyboard* mKeyboard;
   OIS::Mouse* mMouse;
   Camera* mCamera;
+  VisibilityStats* mStats;
+  VisibilityStats* mMapStats;
+  Minimap* mMinimap;
 
   Ogre::Vector3 mCameraMoveVector;
 };
@@ -197,7 +233,7 @@ class LectureApp {
   Camera* mCamera;
   Camera* mMapCamera;
   Viewport* mViewport;
-  Viewport* mMapViewport;
+  Minimap* mMinimap;
   OIS::Keyboard* mKeyboard;
   OIS::Mouse* mMouse;
 
@@ -228,7 +264,7 @@ public:
 
     mWindow = mRoot->initialise(true, CLIENT_DESCRIPTION " : Copyleft by Dae-Hyun Lee");
 
-    mSceneMgr = mRoot->createSceneManager(ST_GENERIC, "main");
+    mSceneMgr = SceneManagerSelector::create(mRoot, "main");
 
     // Fill Here -----------------------------------------------
 	mCamera = mSceneMgr->createCamera("main");
@@ -244,12 +280,6 @@ public:
 	mMapCamera = mSceneMgr->createCamera("MapCamera");
 	mMapCamera->setPosition(0.f, 800.f, 1.f);
 	mMapCamera->lookAt(0.f, 0.f, 0.f);
-	
-	mMapViewport = mWindow->addViewport(mMapCamera, 1, 0.79, 0.01, 0.2, 0.2);
-	mMapViewport->setBackgroundColour(ColourValue(0.f, 0.f, 1.f));
-
-	mMapCamera->setAspectRatio(Real(mMapViewport->getActualWidth())
-		/ Real(mMapViewport->getActualHeight()));
 
     // ---------------------------------------------------------
 
@@ -260,17 +290,20 @@ public:
     mSceneMgr->setAmbientLight(ColourValue(1.0f, 1.0f, 1.0f));
 
     // ǥ ǥ
-    Ogre::Entity* mAxesEntity = mSceneMgr->createEntity("Axes", "axes.mesh");
-    mSceneMgr->getRootSceneNode()->createChildSceneNode("AxesNode",Ogre::Vector3(0,0,0))->attachObject(mAxesEntity);
-    mSceneMgr->getSceneNode("AxesNode")->setScale(5, 5, 5);
+    DebugGeometry::createAxes(mSceneMgr)->removeVisibilityFlags(Minimap::MAP_FLAG);
 
-    _drawGridPlane();
+    DebugGeometry::createGrid(mSceneMgr);
 
 
     Entity* entity1 = mSceneMgr->createEntity("Professor", "DustinBody.mesh");
     SceneNode* node1 = mSceneMgr->getRootSceneNode()->createChildSceneNode("Professor", Vector3(0.0f, 0.0f, 0.0f));
     node1->attachObject(entity1);
 
+    // the map camera draws a flat 128x128 texture ten times a second, shown
+    // in the top right corner where its viewport used to be
+    mMinimap = new Minimap(mSceneMgr, mMapCamera, 128, 0.1f);
+    mMinimap->setCorners(0.58f, 0.98f, 0.98f, 0.58f);
+
 
 #if 0
     Entity* entity2 = mSceneMgr->createEntity("Ninja", "ninja.mesh");
@@ -295,7 +328,13 @@ public:
     mKeyboard = static_cast<OIS::Keyboard*>(mInputManager->createInputObject(OIS::OISKeyboard, true));
     mMouse = static_cast<OIS::Mouse*>( mInputManager->createInputObject(OIS::OISMouse, true));
 
-    InputController* inputController = new InputController(mRoot, mKeyboard, mMouse);
+    VisibilityStats* stats = new VisibilityStats(mSceneMgr, mWindow);
+    stats->addViewport(mViewport);
+
+    VisibilityStats* mapStats = new VisibilityStats(mSceneMgr, mMinimap->getRenderTarget());
+    mapStats->addViewport(mMinimap->getViewport());
+
+    InputController* inputController = new InputController(mRoot, mKeyboard, mMouse, stats, mapStats, mMinimap);
     mRoot->addFrameListener(inputController);
 
     ProfessorController* professorController = new ProfessorController(mRoot);
@@ -309,37 +348,12 @@ public:
 
     delete professorController;
     delete inputController;
+    delete mapStats;
+    delete stats;
+    delete mMinimap;
 
     delete mRoot;
   }
-
-private:
-  void _drawGridPlane(void)
-  {
-    Ogre::ManualObject* gridPlane =  mSceneMgr->createManualObject("GridPlane"); 
-    Ogre::SceneNode* gridPlaneNode = mSceneMgr->getRootSceneNode()->createChildSceneNode("GridPlaneNode"); 
-
-    Ogre::MaterialPtr gridPlaneMaterial = Ogre::MaterialManager::getSingleton().create("GridPlanMaterial","General"); 
-    gridPlaneMaterial->setReceiveShadows(false); 
-    gridPlaneMaterial->getTechnique(0)->setLightingEnabled(true); 
-    gridPlaneMaterial->getTechnique(0)->getPass(0)->setDiffuse(1,1,1,0); 
-    gridPlaneMaterial->getTechnique(0)->getPass(0)->setAmbient(1,1,1); 
-    gridPlaneMaterial->getTechnique(0)->getPass(0)->setSelfIllumination(1,1,1); 
-
-    gridPlane->begin("GridPlaneMaterial", Ogre::RenderOperation::OT_LINE_LIST); 
-    for(int i=0; i<21; i++)
-    {
-      gridPlane->position(-500.0f, 0.0f, 500.0f-i*50);
-      gridPlane->position(500.0f, 0.0f, 500.0f-i*50);
-
-      gridPlane->position(-500.f+i*50, 0.f, 500.0f);
-      gridPlane->position(-500.f+i*50, 0.f, -500.f);
-    }
-
-    gridPlane->end(); 
-
-    gridPlaneNode->attachObject(gridPlane);
-  }
 };
 
 
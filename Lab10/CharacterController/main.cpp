@@ -8,19 +8,35 @@
 #include <Ogre.h>
 #include <OIS/OIS.h>
 
+#include "CharacterCollision.h"
+#include "DebugGeometry.h"
+#include "SceneManagerSelector.h"
+#include "SceneRegistry.h"
+
 
 using namespace Ogre;
 
+// what the controller drives, filled in while the scene is set up
+struct CharacterScene
+{
+  AnimationHandle idle, walk;
+  NodeHandle characterRoot, characterYaw;
+  NodeHandle cameraYaw, cameraPitch, cameraHolder;
+};
+
 class InputController : public FrameListener, 
   public OIS::KeyListener, 
   public OIS::MouseListener
 {
 
 public:
-  InputController(Root* root, OIS::Keyboard *keyboard, OIS::Mouse *mouse) : mRoot(root), mKeyboard(keyboard), mMouse(mouse)
+  InputController(Root* root, OIS::Keyboard *keyboard, OIS::Mouse *mouse, CharacterCollision* collision, int body,
+    const SceneRegistry& registry, const CharacterScene& scene)
+    : mRoot(root), mKeyboard(keyboard), mMouse(mouse), mCollision(collision), mCollisionBody(body)
   {
-    mIdleState = root->getSceneManager("main")->getEntity("Professor")->getAnimationState("Idle");
-    mWalkState = root->getSceneManager("main")->getEntity("Professor")->getAnimationState("Walk");
+    // the scene lives as long as this controller, so the handles are resolved once
+    mIdleState = registry.get(scene.idle);
+    mWalkState = registry.get(scene.walk);
 
     mIdleState->setLoop(true);
     mWalkState->setLoop(true);
@@ -28,13 +44,13 @@ public:
     mIdleState->setEnabled(true);
     mWalkState->setEnabled(false);
 
-    mCharacterRoot = mRoot->getSceneManager("main")->getSceneNode("ProfessorRoot");
-    mCharacterYaw = mRoot->getSceneManager("main")->getSceneNode("ProfessorYaw");
+    mCharacterRoot = registry.get(scene.characterRoot);
+    mCharacterYaw = registry.get(scene.characterYaw);
     mCharacterDirection = Ogre::Vector3::ZERO;
 
-    mCameraYaw = mRoot->getSceneManager("main")->getSceneNode("CameraYaw");
-    mCameraPitch = mRoot->getSceneManager("main")->getSceneNode("CameraPitch");
-    mCameraHolder = mRoot->getSceneManager("main")->getSceneNode("CameraHolder");
+    mCameraYaw = registry.get(scene.cameraYaw);
+    mCameraPitch = registry.get(scene.cameraPitch);
+    mCameraHolder = registry.get(scene.cameraHolder);
 
 
     mContinue = true;
@@ -62,6 +78,12 @@ public:
 		mCharacterRoot->translate(mCharacterDirection.normalisedCopy() * 111 * evt.timeSinceLastFrame,
 			Node::TransformSpace::TS_LOCAL);
 
+		// slide along the ninjas instead of walking through them
+		Vector3 pos = mCharacterRoot->getPosition();
+		mCollision->setPosition(mCollisionBody, pos.x, pos.y, pos.z);
+		mCollision->step();
+		mCharacterRoot->setPosition(mCollision->getX(mCollisionBody), pos.y, mCollision->getZ(mCollisionBody));
+
 		if (!mWalkState->getEnabled())
 		{
 			mWalkState->setEnabled(true);
@@ -159,6 +181,9 @@ private:
 
   Ogre::Vector3 mCharacterDirection;
 
+  CharacterCollision* mCollision;
+  int mCollisionBody;
+
   bool mRotating;  
   Quaternion mSrcQuat, mDestQuat;  
   float mRotatingTime;
@@ -199,7 +224,7 @@ public:
 
     mWindow = mRoot->initialise(true, CLIENT_DESCRIPTION " : Copyleft by Dae-Hyun Lee");
 
-    mSceneMgr = mRoot->createSceneManager(ST_GENERIC, "main");
+    mSceneMgr = SceneManagerSelector::create(mRoot, "main");
     mCamera = mSceneMgr->createCamera("main");
 
     mViewport = mWindow->addViewport(mCamera);
@@ -213,11 +238,9 @@ public:
     mSceneMgr->setAmbientLight(ColourValue(1.0f, 1.0f, 1.0f));
 
     // ǥ ǥ
-    Ogre::Entity* mAxesEntity = mSceneMgr->createEntity("Axes", "axes.mesh");
-    mSceneMgr->getRootSceneNode()->createChildSceneNode("AxesNode",Ogre::Vector3(0,0,0))->attachObject(mAxesEntity);
-    mSceneMgr->getSceneNode("AxesNode")->setScale(5, 5, 5);
+    DebugGeometry::createAxes(mSceneMgr);
 
-    _drawGridPlane();
+    DebugGeometry::createGrid(mSceneMgr, 81, 50.0f);
 
     // Fill Here -----------------------------------------------
 	SceneNode * professorRoot =
@@ -233,14 +256,40 @@ public:
 		cameraPitch->createChildSceneNode("CameraHolder", Vector3(0.f, 80.f, 500.f));
 	cameraYaw->setInheritOrientation(false);
 
+	SceneRegistry* registry = new SceneRegistry();
+	CharacterScene scene;
+	scene.characterRoot = registry->add(professorRoot);
+	scene.characterYaw = registry->add(professorYaw);
+	scene.cameraYaw = registry->add(cameraYaw);
+	scene.cameraPitch = registry->add(cameraPitch);
+	scene.cameraHolder = registry->add(cameraHolder);
+
     // ---------------------------------------------------------
 
     Entity* entity = mSceneMgr->createEntity("Professor", "DustinBody.mesh");
     professorYaw->attachObject(entity);
 
+    EntityHandle professor = registry->add(entity);
+    scene.idle = registry->addAnimation(professor, "Idle");
+    scene.walk = registry->addAnimation(professor, "Walk");
+
     cameraHolder->attachObject(mCamera);
     mCamera->lookAt(cameraYaw->getPosition());
 
+    // ninjas standing in a ring, they do not move so their inverse mass is 0
+    CharacterCollision* collision = new CharacterCollision();
+    int professorBody = collision->addBody(0.f, 0.f, 0.f, 30.f, 180.f, 1.f);
+    for (int i = 0; i < 8; i++)
+    {
+      Radian angle = Degree(i * 45.f);
+      Vector3 pos(Math::Cos(angle) * 400.f, 0.f, Math::Sin(angle) * 400.f);
+
+      Entity* ninja = mSceneMgr->createEntity("Ninja" + StringConverter::toString(i), "ninja.mesh");
+      SceneNode* ninjaNode = mSceneMgr->getRootSceneNode()->createChildSceneNode(pos);
+      ninjaNode->attachObject(ninja);
+      collision->addBody(pos.x, pos.y, pos.z, 30.f, 180.f, 0.f);
+    }
+
     size_t windowHnd = 0;
     std::ostringstream windowHndStr;
     OIS::ParamList pl;
@@ -256,7 +305,7 @@ public:
     mKeyboard = static_cast<OIS::Keyboard*>(mInputManager->createInputObject(OIS::OISKeyboard, true));
     mMouse = static_cast<OIS::Mouse*>( mInputManager->createInputObject(OIS::OISMouse, true));
 
-    InputController* inputController = new InputController(mRoot, mKeyboard, mMouse);
+    InputController* inputController = new InputController(mRoot, mKeyboard, mMouse, collision, professorBody, *registry, scene);
     mRoot->addFrameListener(inputController);
 
     mRoot->startRendering();
@@ -266,37 +315,13 @@ public:
     OIS::InputManager::destroyInputSystem(mInputManager);
 
     delete inputController;
+    delete collision;
 
     delete mRoot;
+    delete registry;
   }
 
 private:
-  void _drawGridPlane(void)
-  {
-    Ogre::ManualObject* gridPlane =  mSceneMgr->createManualObject("GridPlane"); 
-    Ogre::SceneNode* gridPlaneNode = mSceneMgr->getRootSceneNode()->createChildSceneNode("GridPlaneNode"); 
-
-    Ogre::MaterialPtr gridPlaneMaterial = Ogre::MaterialManager::getSingleton().create("GridPlanMaterial","General"); 
-    gridPlaneMaterial->setReceiveShadows(false); 
-    gridPlaneMaterial->getTechnique(0)->setLightingEnabled(true); 
-    gridPlaneMaterial->getTechnique(0)->getPass(0)->setDiffuse(1,1,1,0); 
-    gridPlaneMaterial->getTechnique(0)->getPass(0)->setAmbient(1,1,1); 
-    gridPlaneMaterial->getTechnique(0)->getPass(0)->setSelfIllumination(1,1,1); 
-
-    gridPlane->begin("GridPlaneMaterial", Ogre::RenderOperation::OT_LINE_LIST); 
-	for (int i = 0; i<81; i++)
-	{
-		gridPlane->position(-2000.0f, 0.0f, 2000.0f - i * 50);
-		gridPlane->position(2000.0f, 0.0f, 2000.0f - i * 50);
-
-		gridPlane->position(-2000.f + i * 50, 0.f, 2000.0f);
-		gridPlane->position(-2000.f + i * 50, 0.f, -2000.f);
-	}
-
-    gridPlane->end(); 
-
-    gridPlaneNode->attachObject(gridPlane);
-  }
 
 
   Root* mRoot;
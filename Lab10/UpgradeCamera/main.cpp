@@ -8,6 +8,10 @@
 #include <Ogre.h>
 #include <OIS/OIS.h>
 
+#include "DebugGeometry.h"
+#include "SceneManagerSelector.h"
+#include "StreamedWorld.h"
+
 
 using namespace Ogre;
 
@@ -17,7 +21,7 @@ class InputController : public FrameListener,
 {
 
 public:
-  InputController(Root* root, OIS::Keyboard *keyboard, OIS::Mouse *mouse) : mRoot(root), mKeyboard(keyboard), mMouse(mouse)
+  InputController(Root* root, OIS::Keyboard *keyboard, OIS::Mouse *mouse, StreamedWorld* world) : mRoot(root), mKeyboard(keyboard), mMouse(mouse), mWorld(world)
   {
     mIdleState = root->getSceneManager("main")->getEntity("Professor")->getAnimationState("Idle");
     mRunState = root->getSceneManager("main")->getEntity("Professor")->getAnimationState("Run");
@@ -120,6 +124,7 @@ public:
 	  case OIS::KC_S: case OIS::KC_DOWN:  mCharacterDirection.z += 1.f; break;
 	  case OIS::KC_A: case OIS::KC_LEFT:  mCharacterDirection.x += -1.f; break;
 	  case OIS::KC_D: case OIS::KC_RIGHT: mCharacterDirection.x += 1.f; break;
+	  case OIS::KC_T: mWorld->logStats(); break;
 	  case OIS::KC_ESCAPE: mContinue = false; break;
 	  }
     // ---------------------------------------------------------
@@ -169,6 +174,7 @@ private:
   Ogre::Root* mRoot;
   OIS::Keyboard* mKeyboard;
   OIS::Mouse* mMouse;
+  StreamedWorld* mWorld;
 
 
   Ogre::AnimationState* mRunState;
@@ -223,7 +229,7 @@ public:
 
     mWindow = mRoot->initialise(true, CLIENT_DESCRIPTION " : Copyleft by Dae-Hyun Lee");
 
-    mSceneMgr = mRoot->createSceneManager(ST_GENERIC, "main");
+    mSceneMgr = SceneManagerSelector::create(mRoot, "main");
     mCamera = mSceneMgr->createCamera("main");
 
     mViewport = mWindow->addViewport(mCamera);
@@ -237,11 +243,7 @@ public:
     mSceneMgr->setAmbientLight(ColourValue(1.0f, 1.0f, 1.0f));
 
     // ǥ ǥ
-    Ogre::Entity* mAxesEntity = mSceneMgr->createEntity("Axes", "axes.mesh");
-    mSceneMgr->getRootSceneNode()->createChildSceneNode("AxesNode",Ogre::Vector3(0,0,0))->attachObject(mAxesEntity);
-    mSceneMgr->getSceneNode("AxesNode")->setScale(5, 5, 5);
-
-    _drawGridPlane();
+    DebugGeometry::createAxes(mSceneMgr);
 
     // Fill Here -----------------------------------------------
 	SceneNode * professorRoot =
@@ -265,6 +267,19 @@ public:
     cameraHolder->attachObject(mCamera);
     mCamera->lookAt(cameraYaw->getPosition());
 
+    // ground and props around the professor instead of a fixed grid, T logs the streaming stats
+    StreamedWorld::Settings worldSettings;
+    worldSettings.streaming.tileSize = 500.0f;
+    worldSettings.streaming.resolution = 32;
+    worldSettings.streaming.propsPerTile = 6;
+    worldSettings.streaming.loadRadius = 2000.0f;
+    worldSettings.streaming.unloadRadius = 2500.0f;
+    worldSettings.streaming.memoryBudget = 8 * 1024 * 1024;
+    worldSettings.streaming.maxAttachPerUpdate = 1;
+    worldSettings.propMeshes.push_back("ninja.mesh");
+    StreamedWorld* world = new StreamedWorld(mSceneMgr, professorRoot, worldSettings);
+    world->preload();
+
     size_t windowHnd = 0;
     std::ostringstream windowHndStr;
     OIS::ParamList pl;
@@ -280,7 +295,7 @@ public:
     mKeyboard = static_cast<OIS::Keyboard*>(mInputManager->createInputObject(OIS::OISKeyboard, true));
     mMouse = static_cast<OIS::Mouse*>( mInputManager->createInputObject(OIS::OISMouse, true));
 
-    InputController* inputController = new InputController(mRoot, mKeyboard, mMouse);
+    InputController* inputController = new InputController(mRoot, mKeyboard, mMouse, world);
     mRoot->addFrameListener(inputController);
 
     mRoot->startRendering();
@@ -290,37 +305,12 @@ public:
     OIS::InputManager::destroyInputSystem(mInputManager);
 
     delete inputController;
+    delete world;
 
     delete mRoot;
   }
 
 private:
-  void _drawGridPlane(void)
-  {
-    Ogre::ManualObject* gridPlane =  mSceneMgr->createManualObject("GridPlane"); 
-    Ogre::SceneNode* gridPlaneNode = mSceneMgr->getRootSceneNode()->createChildSceneNode("GridPlaneNode"); 
-
-    Ogre::MaterialPtr gridPlaneMaterial = Ogre::MaterialManager::getSingleton().create("GridPlanMaterial","General"); 
-    gridPlaneMaterial->setReceiveShadows(false); 
-    gridPlaneMaterial->getTechnique(0)->setLightingEnabled(true); 
-    gridPlaneMaterial->getTechnique(0)->getPass(0)->setDiffuse(1,1,1,0); 
-    gridPlaneMaterial->getTechnique(0)->getPass(0)->setAmbient(1,1,1); 
-    gridPlaneMaterial->getTechnique(0)->getPass(0)->setSelfIllumination(1,1,1); 
-
-    gridPlane->begin("GridPlaneMaterial", Ogre::RenderOperation::OT_LINE_LIST); 
-	for (int i = 0; i<81; i++)
-	{
-		gridPlane->position(-2000.0f, 0.0f, 2000.0f - i * 50);
-		gridPlane->position(2000.0f, 0.0f, 2000.0f - i * 50);
-
-		gridPlane->position(-2000.f + i * 50, 0.f, 2000.0f);
-		gridPlane->position(-2000.f + i * 50, 0.f, -2000.f);
-	}
-
-    gridPlane->end(); 
-
-    gridPlaneNode->attachObject(gridPlane);
-  }
 
 
   Root* mRoot;
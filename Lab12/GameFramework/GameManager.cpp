@@ -2,12 +2,15 @@
 
 #include "GameManager.h"
 #include "GameState.h"
+#include "SceneManagerSelector.h"
+#include "SceneRegistry.h"
 
 using namespace Ogre;
 
 GameManager::GameManager()
 {
   mRoot = 0;
+  mRegistry = 0;
 }
 
 GameManager::~GameManager()
@@ -19,6 +22,9 @@ GameManager::~GameManager()
 
   if (mRoot)
     delete mRoot;
+
+  // after the root, destroying the scene still reports to the registry
+  delete mRegistry;
 }
 
 void GameManager::init(void)
@@ -38,7 +44,8 @@ void GameManager::init(void)
 
   mWindow = mRoot->initialise(true, CLIENT_DESCRIPTION " : Copyleft by Dae-Hyun Lee");
 
-  mSceneMgr = mRoot->createSceneManager(ST_GENERIC, "main");
+  mSceneMgr = SceneManagerSelector::create(mRoot, "main");
+  mRegistry = new SceneRegistry();
 
   Ogre::OverlaySystem* mOverlaySystem = new Ogre::OverlaySystem();
   mSceneMgr->addRenderQueueListener(mOverlaySystem);
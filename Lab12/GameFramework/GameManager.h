@@ -22,6 +22,7 @@
 
 
 class GameState;
+class SceneRegistry;
 
 class GameManager :  
   public Ogre::FrameListener,
@@ -63,6 +64,8 @@ private:
   Ogre::SceneManager* mSceneMgr;
   Ogre::Camera* mCamera;
   Ogre::Viewport* mViewport;
+
+  SceneRegistry* mRegistry;
 };
 
 
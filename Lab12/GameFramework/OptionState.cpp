@@ -10,21 +10,20 @@ void OptionState::enter(void)
 {
 	mRoot = Root::getSingletonPtr();
 	//mRoot->getAutoCreatedWindow()->resetStatistics();
+	mRegistry = SceneRegistry::getSingletonPtr();
 
-	mSceneMgr = mRoot->getSceneManager("main");
-	mCamera = mSceneMgr->getCamera("main");
+	mCamera = mRoot->getAutoCreatedWindow()->getViewport(0)->getCamera();
+	mSceneMgr = mCamera->getSceneManager();
 	mCamera->setPosition(Ogre::Vector3::ZERO);
 
-	mCharacterEntity = mSceneMgr->getEntity("Professor");
-
-	mAnimationState = mCharacterEntity->getAnimationState("Run");
-	mAnimationState->setLoop(true);
-	mAnimationState->setEnabled(true);
+	// the play state below us owns the character
+	mAnimation = AnimationHandle();
+	_play(PlayState::getInstance()->getRunAnimation());
 }
 
 void OptionState::exit(void)
 {
-	PlayState::getInstance()->setAnimState(mAnimationState);
+	PlayState::getInstance()->setAnimState(mAnimation);
 }
 
 void OptionState::pause(void)
@@ -37,7 +36,7 @@ void OptionState::resume(void)
 
 bool OptionState::frameStarted(GameManager* game, const FrameEvent& evt)
 {
-	mAnimationState->addTime(evt.timeSinceLastFrame);
+	mRegistry->get(mAnimation)->addTime(evt.timeSinceLastFrame);
 
 	return true;
 }
@@ -59,17 +58,11 @@ bool OptionState::keyPressed(GameManager* game, const OIS::KeyEvent &e)
 	switch (e.key)
 	{
 	case OIS::KC_W:
-		mAnimationState->setEnabled(false);
-		mAnimationState = mCharacterEntity->getAnimationState("Walk");
-		mAnimationState->setLoop(true);
-		mAnimationState->setEnabled(true);
+		_play(PlayState::getInstance()->getWalkAnimation());
 		break;
 
 	case OIS::KC_R:
-		mAnimationState->setEnabled(false);
-		mAnimationState = mCharacterEntity->getAnimationState("Run");
-		mAnimationState->setLoop(true);
-		mAnimationState->setEnabled(true);
+		_play(PlayState::getInstance()->getRunAnimation());
 		break;
 
 	case OIS::KC_ESCAPE:
@@ -96,5 +89,12 @@ bool OptionState::mouseMoved(GameManager* game, const OIS::MouseEvent &e)
 	return true;
 }
 
+void OptionState::_play(AnimationHandle animation)
+{
+	if (AnimationState* current = mRegistry->get(mAnimation))
+		current->setEnabled(false);
 
-
+	mAnimation = animation;
+	mRegistry->get(mAnimation)->setLoop(true);
+	mRegistry->get(mAnimation)->setEnabled(true);
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "GameState.h"
+#include "SceneRegistry.h"
 
 class OptionState : public GameState
 {
@@ -36,9 +37,11 @@ private:
 	Ogre::Light *mLightP, *mLightD, *mLightS;
 
 
-	Ogre::Entity* mCharacterEntity;
+	void _play(AnimationHandle animation);
 
-	Ogre::AnimationState* mAnimationState;
+	SceneRegistry* mRegistry;
+
+	AnimationHandle mAnimation;
 
 	Ogre::Overlay*           mInformationOverlay;
 
@@ -1,6 +1,7 @@
 #include "PlayState.h"
 #include "TitleState.h"
 #include "OptionState.h"
+#include "DebugGeometry.h"
 
 using namespace Ogre;
 
@@ -11,12 +12,14 @@ void PlayState::enter(void)
 {
   mRoot = Root::getSingletonPtr(); 
   mRoot->getAutoCreatedWindow()->resetStatistics();
+  mRegistry = SceneRegistry::getSingletonPtr();
 
-  mSceneMgr = mRoot->getSceneManager("main");
-  mCamera = mSceneMgr->getCamera("main");
+  mCamera = mRoot->getAutoCreatedWindow()->getViewport(0)->getCamera();
+  mSceneMgr = mCamera->getSceneManager();
   mCamera->setPosition(Ogre::Vector3::ZERO);
 
-  _drawGridPlane();
+  DebugGeometry::createAxes(mSceneMgr);
+  DebugGeometry::createGrid(mSceneMgr);
   _setLights();
   _drawGroundPlane();
 
@@ -37,14 +40,30 @@ void PlayState::enter(void)
   mCameraHolder->attachObject(mCamera);
   mCamera->lookAt(mCameraYaw->getPosition());
 
-  mAnimationState = mCharacterEntity->getAnimationState("Run");
-  mAnimationState->setLoop(true);
-  mAnimationState->setEnabled(true);
+  mCharacterHandle = mRegistry->add(mCharacterEntity);
+  mCameraYawHandle = mRegistry->add(mCameraYaw);
+  mCameraPitchHandle = mRegistry->add(mCameraPitch);
+  mCameraHolderHandle = mRegistry->add(mCameraHolder);
+  mRunAnimation = mRegistry->addAnimation(mCharacterHandle, "Run");
+  mWalkAnimation = mRegistry->addAnimation(mCharacterHandle, "Walk");
+
+  mAnimation = mRunAnimation;
+  mRegistry->get(mAnimation)->setLoop(true);
+  mRegistry->get(mAnimation)->setEnabled(true);
+
+  mShadowPolicy = new ShadowPolicy(mSceneMgr, mCamera);
+  mShadowPolicy->addCaster(mCharacterEntity);
+
+  mCommands = new TransformCommandBuffer(mSceneMgr, mRegistry);
 }
 
 void PlayState::exit(void)
 {
   // Fill Here -----------------------------
+	delete mShadowPolicy;
+	mShadowPolicy = nullptr;
+	delete mCommands;
+	mCommands = nullptr;
 	mSceneMgr->clearScene();
 	mInformationOverlay->hide();
   // ---------------------------------------
@@ -54,20 +73,20 @@ void PlayState::pause(void)
 {
 //	mAnimationState = mCharacterEntity->getA
 //	mAnimationState = mCharacterEntity->getAnimationState("Run");
-	mAnimationState->setLoop(false);
-	mAnimationState->setEnabled(false);
+	mRegistry->get(mAnimation)->setLoop(false);
+	mRegistry->get(mAnimation)->setEnabled(false);
 }
 
 void PlayState::resume(void)
 {
 //	mAnimationState = mCharacterEntity->Anima`
-	mAnimationState->setLoop(true);
-	mAnimationState->setEnabled(true);
+	mRegistry->get(mAnimation)->setLoop(true);
+	mRegistry->get(mAnimation)->setEnabled(true);
 }
 
 bool PlayState::frameStarted(GameManager* game, const FrameEvent& evt)
 {
-  mAnimationState->addTime(evt.timeSinceLastFrame);
+  mRegistry->get(mAnimation)->addTime(evt.timeSinceLastFrame);
 
   return true;
 }
@@ -113,6 +132,15 @@ bool PlayState::keyPressed(GameManager* game, const OIS::KeyEvent &e)
 	case OIS::KC_ESCAPE:
 		game->changeState(TitleState::getInstance());
 		break;
+
+	case OIS::KC_T:
+		mShadowPolicy->setTechnique(mShadowPolicy->getTechnique() == ShadowPolicy::TECHNIQUE_STENCIL
+			? ShadowPolicy::TECHNIQUE_TEXTURE : ShadowPolicy::TECHNIQUE_STENCIL);
+		break;
+
+	case OIS::KC_G:
+		mShadowPolicy->logStats();
+		break;
 	}
   // -----------------------------------------------------
   return true;
@@ -131,10 +159,10 @@ bool PlayState::mouseReleased(GameManager* game, const OIS::MouseEvent &e, OIS::
 
 bool PlayState::mouseMoved(GameManager* game, const OIS::MouseEvent &e)
 { 
-  mCameraYaw->yaw(Degree(-e.state.X.rel));
-  mCameraPitch->pitch(Degree(-e.state.Y.rel));
+  mCommands->yaw(mCameraYawHandle, Degree(-e.state.X.rel));
+  mCommands->pitch(mCameraPitchHandle, Degree(-e.state.Y.rel));
 
-  mCameraHolder->translate(Ogre::Vector3(0, 0, -e.state.Z.rel * 0.1f));
+  mCommands->translate(mCameraHolderHandle, Ogre::Vector3(0, 0, -e.state.Z.rel * 0.1f));
   return true;
 }
 
@@ -168,36 +196,4 @@ void PlayState::_drawGroundPlane(void)
   mSceneMgr->getRootSceneNode()->createChildSceneNode()->attachObject(groundEntity);
   groundEntity->setMaterialName("KPU_LOGO");
   groundEntity->setCastShadows(false);
-}
-
-void PlayState::_drawGridPlane(void)
-{
-  // ǥ ǥ
-  Ogre::Entity* mAxesEntity = mSceneMgr->createEntity("Axes", "axes.mesh");
-  mSceneMgr->getRootSceneNode()->createChildSceneNode("AxesNode",Ogre::Vector3(0,0,0))->attachObject(mAxesEntity);
-  mSceneMgr->getSceneNode("AxesNode")->setScale(5, 5, 5);
-
-  Ogre::ManualObject* gridPlane =  mSceneMgr->createManualObject("GridPlane"); 
-  Ogre::SceneNode* gridPlaneNode = mSceneMgr->getRootSceneNode()->createChildSceneNode("GridPlaneNode"); 
-
-  Ogre::MaterialPtr gridPlaneMaterial = Ogre::MaterialManager::getSingleton().create("GridPlanMaterial","General"); 
-  gridPlaneMaterial->setReceiveShadows(false); 
-  gridPlaneMaterial->getTechnique(0)->setLightingEnabled(true); 
-  gridPlaneMaterial->getTechnique(0)->getPass(0)->setDiffuse(1,1,1,0); 
-  gridPlaneMaterial->getTechnique(0)->getPass(0)->setAmbient(1,1,1); 
-  gridPlaneMaterial->getTechnique(0)->getPass(0)->setSelfIllumination(1,1,1); 
-
-  gridPlane->begin("GridPlaneMaterial", Ogre::RenderOperation::OT_LINE_LIST); 
-  for(int i=0; i<21; i++)
-  {
-    gridPlane->position(-500.0f, 0.0f, 500.0f-i*50);
-    gridPlane->position(500.0f, 0.0f, 500.0f-i*50);
-
-    gridPlane->position(-500.f+i*50, 0.f, 500.0f);
-    gridPlane->position(-500.f+i*50, 0.f, -500.f);
-  }
-
-  gridPlane->end(); 
-
-  gridPlaneNode->attachObject(gridPlane);
 }
\ No newline at end of file
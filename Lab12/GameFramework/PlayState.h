@@ -1,6 +1,9 @@
 #pragma once
 
 #include "GameState.h"
+#include "SceneRegistry.h"
+#include "ShadowPolicy.h"
+#include "TransformCommandBuffer.h"
 
 class PlayState : public GameState
 {
@@ -23,13 +26,17 @@ public:
 
   static PlayState* getInstance() { return &mPlayState; }
 
-  void setAnimState(Ogre::AnimationState* anim) { mAnimationState = anim; }
+  // handles for the option state, they go stale once the play scene is cleared
+  EntityHandle getCharacter(void) const { return mCharacterHandle; }
+  AnimationHandle getRunAnimation(void) const { return mRunAnimation; }
+  AnimationHandle getWalkAnimation(void) const { return mWalkAnimation; }
+
+  void setAnimState(AnimationHandle anim) { mAnimation = anim; }
 
 private:
 
   void _setLights(void);
   void _drawGroundPlane(void);
-  void _drawGridPlane(void);
 
 
   static PlayState mPlayState;
@@ -46,10 +53,20 @@ private:
   Ogre::SceneNode* mCameraHolder;
   Ogre::SceneNode* mCameraYaw;
   Ogre::SceneNode* mCameraPitch;
+  NodeHandle mCameraYawHandle;
+  NodeHandle mCameraPitchHandle;
+  NodeHandle mCameraHolderHandle;
 
   Ogre::Entity* mCharacterEntity;
+  EntityHandle mCharacterHandle;
+
+  AnimationHandle mRunAnimation;
+  AnimationHandle mWalkAnimation;
+  AnimationHandle mAnimation;
 
-  Ogre::AnimationState* mAnimationState;
+  SceneRegistry* mRegistry;
+  ShadowPolicy* mShadowPolicy;
+  TransformCommandBuffer* mCommands;
 
   Ogre::Overlay*           mInformationOverlay;
 
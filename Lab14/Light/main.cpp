@@ -8,29 +8,37 @@
 #include <Ogre.h>
 #include <OIS/OIS.h>
 
+#include "StaticSceneBaker.h"
+#include "DebugGeometry.h"
+#include "SceneManagerSelector.h"
+#include "SceneRegistry.h"
+#include "SceneLoader.h"
+#include "MaterialCache.h"
+
 
 using namespace Ogre;
 
+// what the controller drives, filled in while the scene is set up
+struct LightScene
+{
+  LightHandle lightD, lightP, lightS;
+  AnimationHandle walk;
+  NodeHandle cameraYaw, cameraPitch, cameraHolder;
+};
+
 class InputController : public FrameListener, 
   public OIS::KeyListener, 
   public OIS::MouseListener
 {
 
 public:
-  InputController(Root* root, OIS::Keyboard *keyboard, OIS::Mouse *mouse) : mRoot(root), mKeyboard(keyboard), mMouse(mouse)
+  InputController(Root* root, OIS::Keyboard *keyboard, OIS::Mouse *mouse, SceneRegistry* registry, const LightScene& scene)
+    : mRoot(root), mKeyboard(keyboard), mMouse(mouse), mRegistry(registry), mScene(scene)
   {
-    mSceneMgr = root->getSceneManager("main");
-    mLightD = mSceneMgr->getLight("LightD");
-    mLightP = mSceneMgr->getLight("LightP");
-    mLightS = mSceneMgr->getLight("LightS");
-
-    mIdleState = mSceneMgr->getEntity("Professor")->getAnimationState("Walk");
-    mIdleState->setLoop(true);
-    mIdleState->setEnabled(true);
+    mSceneMgr = mRegistry->get(mScene.cameraHolder)->getCreator();
 
-    mCameraYaw = mSceneMgr->getSceneNode("CameraYaw");
-    mCameraPitch = mSceneMgr->getSceneNode("CameraPitch");
-    mCameraHolder = mSceneMgr->getSceneNode("CameraHolder");
+    mRegistry->get(mScene.walk)->setLoop(true);
+    mRegistry->get(mScene.walk)->setEnabled(true);
 
     mContinue = true;
 
@@ -43,7 +51,8 @@ public:
   {
     mKeyboard->capture();
     mMouse->capture();
-    mIdleState->addTime(evt.timeSinceLastFrame);
+    if (AnimationState* walk = mRegistry->get(mScene.walk))
+      walk->addTime(evt.timeSinceLastFrame);
     return mContinue;
   }
 
@@ -62,9 +71,9 @@ public:
 	  }
 	  break;
 
-	  case OIS::KC_D: mLightD->setVisible(!mLightD->getVisible()); break;
-	  case OIS::KC_P: mLightP->setVisible(!mLightP->getVisible()); break;
-	  case OIS::KC_S: mLightS->setVisible(!mLightS->getVisible()); break;
+	  case OIS::KC_D: _toggle(mScene.lightD); break;
+	  case OIS::KC_P: _toggle(mScene.lightP); break;
+	  case OIS::KC_S: _toggle(mScene.lightS); break;
 	  }
     // ---------------------------------------------------------
 
@@ -88,10 +97,10 @@ public:
 
   bool mouseMoved( const OIS::MouseEvent &evt )
   {
-    mCameraYaw->yaw(Degree(-evt.state.X.rel));
-    mCameraPitch->pitch(Degree(-evt.state.Y.rel));
+    mRegistry->get(mScene.cameraYaw)->yaw(Degree(-evt.state.X.rel));
+    mRegistry->get(mScene.cameraPitch)->pitch(Degree(-evt.state.Y.rel));
 
-    mCameraHolder->translate(Ogre::Vector3(0, 0, -evt.state.Z.rel * 0.1f));
+    mRegistry->get(mScene.cameraHolder)->translate(Ogre::Vector3(0, 0, -evt.state.Z.rel * 0.1f));
 
     return true;
   }
@@ -108,24 +117,20 @@ public:
 
 
 private:
+  void _toggle(LightHandle handle)
+  {
+    if (Light* light = mRegistry->get(handle))
+      light->setVisible(!light->getVisible());
+  }
+
   bool mContinue;
   Ogre::Root* mRoot;
   Ogre::SceneManager* mSceneMgr;
   OIS::Keyboard* mKeyboard;
   OIS::Mouse* mMouse;
 
-  Ogre::Light *mLightP, *mLightD, *mLightS;
-
-
-  Ogre::AnimationState* mWalkState;
-  Ogre::AnimationState* mIdleState;
-
-  SceneNode* mCharacterRoot;
-  SceneNode* mCharacterYaw;
-
-  SceneNode* mCameraHolder;
-  SceneNode* mCameraYaw;
-  SceneNode* mCameraPitch;
+  SceneRegistry* mRegistry;
+  LightScene mScene;
 
   Ogre::Vector3 mCharacterDirection;
 
@@ -167,9 +172,11 @@ public:
       if (!mRoot->showConfigDialog()) return;
     }
 
+    Timer startup;
     mWindow = mRoot->initialise(true, CLIENT_DESCRIPTION " : Copyleft by Dae-Hyun Lee 2010");
 
-    mSceneMgr = mRoot->createSceneManager(ST_GENERIC, "main");
+    mSceneMgr = SceneManagerSelector::create(mRoot, "main");
+    mRegistry = new SceneRegistry();
 
     mSceneMgr->setAmbientLight(ColourValue(1.0f, 1.0f, 1.0f));
 
@@ -182,25 +189,22 @@ public:
 
     ResourceGroupManager::getSingleton().addResourceLocation("resource.zip", "Zip");
     ResourceGroupManager::getSingleton().addResourceLocation("./", "FileSystem");
-    ResourceGroupManager::getSingleton().initialiseAllResourceGroups();
+    const unsigned long windowMs = startup.getMilliseconds();
 
+    // compiled programs and decoded textures from earlier runs
+    MaterialCache* materialCache = new MaterialCache();
+    materialCache->loadPrograms();
+    ResourceGroupManager::getSingleton().initialiseAllResourceGroups();
+    const unsigned long scriptsMs = startup.getMilliseconds() - windowMs;
+    materialCache->prepareTextures();
+    materialCache->loadMaterials();
 
-    _drawGridPlane();
 
-    _setLights();
+    StaticSceneBaker::markStatic(DebugGeometry::createAxes(mSceneMgr));
+    DebugGeometry::createGrid(mSceneMgr);
 
     _drawGroundPlane();
 
-
-
-    SceneNode* professorRoot = mSceneMgr->getRootSceneNode()->createChildSceneNode("ProfessorRoot");
-    SceneNode* professorYaw = professorRoot->createChildSceneNode("ProfessorYaw");
-
-
-    SceneNode* cameraYaw = professorRoot->createChildSceneNode("CameraYaw", Vector3(0.0f, 120.0f, 0.0f));
-    SceneNode* cameraPitch = cameraYaw->createChildSceneNode("CameraPitch");
-    SceneNode* cameraHolder = cameraPitch->createChildSceneNode("CameraHolder", Vector3(0.0f, 80.0f, 500.0f));
-    
     MeshPtr pMesh = MeshManager::getSingleton().load("DustinBody.mesh",
         ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME,    
         HardwareBuffer::HBU_DYNAMIC_WRITE_ONLY, 
@@ -212,15 +216,24 @@ public:
         pMesh->buildTangentVectors(VES_TANGENT, src, dest);
     }
 
-    Entity* entity = mSceneMgr->createEntity("Professor", "DustinBody.mesh");
-    professorYaw->attachObject(entity);
-    // Fill Here ----------------------------------
-	entity->setCastShadows(true);
-    // --------------------------------------------
+    // the professor, its camera rig and the lights
+    SceneLoader::load(mSceneMgr, "light.scn");
+    _setLights();
+
+    SceneNode* cameraYaw = mSceneMgr->getSceneNode("CameraYaw");
+    SceneNode* cameraHolder = mSceneMgr->getSceneNode("CameraHolder");
+    mScene.cameraYaw = mRegistry->add(cameraYaw);
+    mScene.cameraPitch = mRegistry->add(mSceneMgr->getSceneNode("CameraPitch"));
+    mScene.cameraHolder = mRegistry->add(cameraHolder);
+    mScene.walk = mRegistry->addAnimation(mRegistry->add(mSceneMgr->getEntity("Professor")), "Walk");
 
     cameraHolder->attachObject(mCamera);
     mCamera->lookAt(cameraYaw->getPosition());
 
+    materialCache->logStats();
+    LogManager::getSingleton().stream() << "Startup: " << startup.getMilliseconds() << " ms, window " << windowMs
+      << " ms, scripts " << scriptsMs << " ms, materials " << materialCache->getStats().materialMs << " ms";
+
     size_t windowHnd = 0;
     std::ostringstream windowHndStr;
     OIS::ParamList pl;
@@ -236,9 +249,14 @@ public:
     mKeyboard = static_cast<OIS::Keyboard*>(mInputManager->createInputObject(OIS::OISKeyboard, true));
     mMouse = static_cast<OIS::Mouse*>( mInputManager->createInputObject(OIS::OISMouse, true));
 
-    InputController* inputController = new InputController(mRoot, mKeyboard, mMouse);
+    InputController* inputController = new InputController(mRoot, mKeyboard, mMouse, mRegistry, mScene);
     mRoot->addFrameListener(inputController);
 
+    // bake everything marked static into 1000 unit regions: the 100 ground
+    // tiles become one batch, the axes stay one of their own
+    StaticSceneBaker* staticBaker = new StaticSceneBaker(mSceneMgr, "StaticScene", Vector3(1000.0f, 1000.0f, 1000.0f));
+    staticBaker->bake();
+
     mRoot->startRendering();
 
     mInputManager->destroyInputObject(mKeyboard);
@@ -247,7 +265,11 @@ public:
 
     delete inputController;
 
+    delete staticBaker;
+    materialCache->savePrograms();
     delete mRoot;
+    delete materialCache;
+    delete mRegistry;
   }
 
 private:
@@ -258,22 +280,14 @@ private:
 	  mSceneMgr->setAmbientLight(ColourValue(0.f, 0.f, 0.f));
 	  mSceneMgr->setShadowTechnique(SHADOWTYPE_STENCIL_ADDITIVE);
 
-	  mLightD = mSceneMgr->createLight("LightD");
-	  mLightD->setType(Light::LT_DIRECTIONAL);
-	  mLightD->setDirection(Vector3(1, -2.f, -1));
-	  mLightD->setVisible(false);
+	  // created by light.scn
+	  mLightD = mSceneMgr->getLight("LightD");
+	  mLightP = mSceneMgr->getLight("LightP");
+	  mLightS = mSceneMgr->getLight("LightS");
 
-	  mLightP = mSceneMgr->createLight("LightP");
-	  mLightP->setType(Light::LT_POINT);
-	  mLightP->setPosition(Vector3(-250, 50, 250));
-	  mLightP->setVisible(false);
-
-	  mLightS = mSceneMgr->createLight("LightS");
-	  mLightS->setType(Light::LT_SPOTLIGHT);
-	  mLightS->setDirection(Ogre::Vector3::NEGATIVE_UNIT_Y);
-	  mLightS->setPosition(Vector3(250, 900, 250));
-	  mLightS->setSpotlightRange(Degree(10), Degree(80));
-	  mLightS->setVisible(false);
+	  mScene.lightD = mRegistry->add(mLightD);
+	  mScene.lightP = mRegistry->add(mLightP);
+	  mScene.lightS = mRegistry->add(mLightS);
 
     // --------------------------------------------------------------------------------------------------------
   }
@@ -282,56 +296,11 @@ private:
   {
 	  // Fill Here ----------------------------------------------------------------------------------------------
 
-	  Plane plane(Vector3::UNIT_Y, 0);
-	  MeshManager::getSingleton().createPlane(
-		  "Ground",
-		  ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME,
-		  plane,
-		  500, 500,
-		  1, 1,
-		  true, 1, 10, 10,
-		  Vector3::NEGATIVE_UNIT_Z
-		  );
-
-	  Entity* groundEntity = mSceneMgr->createEntity("GroundPlane", "Ground");
-	  mSceneMgr->getRootSceneNode()->createChildSceneNode()->attachObject(groundEntity);
-	  groundEntity->setMaterialName("KPU_LOGO");
-	  groundEntity->setCastShadows(false);
+	  // the texture once per tile, so the tiles share the material and bake into one batch
+	  StaticSceneBaker::createTiledGround(mSceneMgr, "Ground", "KPU_LOGO", 500.0f, 10);
 	  // --------------------------------------------------------------------------------------------------------
   }
 
-  void _drawGridPlane(void)
-  {
-    // ǥ ǥ
-    Ogre::Entity* mAxesEntity = mSceneMgr->createEntity("Axes", "axes.mesh");
-    mSceneMgr->getRootSceneNode()->createChildSceneNode("AxesNode",Ogre::Vector3(0,0,0))->attachObject(mAxesEntity);
-    mSceneMgr->getSceneNode("AxesNode")->setScale(5, 5, 5);
-
-    Ogre::ManualObject* gridPlane =  mSceneMgr->createManualObject("GridPlane"); 
-    Ogre::SceneNode* gridPlaneNode = mSceneMgr->getRootSceneNode()->createChildSceneNode("GridPlaneNode"); 
-
-    Ogre::MaterialPtr gridPlaneMaterial = Ogre::MaterialManager::getSingleton().create("GridPlanMaterial","General"); 
-    gridPlaneMaterial->setReceiveShadows(false); 
-    gridPlaneMaterial->getTechnique(0)->setLightingEnabled(true); 
-    gridPlaneMaterial->getTechnique(0)->getPass(0)->setDiffuse(1,1,1,0); 
-    gridPlaneMaterial->getTechnique(0)->getPass(0)->setAmbient(1,1,1); 
-    gridPlaneMaterial->getTechnique(0)->getPass(0)->setSelfIllumination(1,1,1); 
-
-    gridPlane->begin("GridPlaneMaterial", Ogre::RenderOperation::OT_LINE_LIST); 
-    for(int i=0; i<21; i++)
-    {
-      gridPlane->position(-500.0f, 0.0f, 500.0f-i*50);
-      gridPlane->position(500.0f, 0.0f, 500.0f-i*50);
-
-      gridPlane->position(-500.f+i*50, 0.f, 500.0f);
-      gridPlane->position(-500.f+i*50, 0.f, -500.f);
-    }
-
-    gridPlane->end(); 
-
-    gridPlaneNode->attachObject(gridPlane);
-  }
-
 
   Root* mRoot;
   RenderWindow* mWindow;
@@ -341,6 +310,9 @@ private:
 
   Ogre::Light *mLightP, *mLightD, *mLightS;
 
+  SceneRegistry* mRegistry;
+  LightScene mScene;
+
   OIS::Keyboard* mKeyboard;
   OIS::Mouse* mMouse;
   OIS::InputManager *mInputManager;
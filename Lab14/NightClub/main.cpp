@@ -8,46 +8,52 @@
 #include <Ogre.h>
 #include <OIS/OIS.h>
 
+#include "StaticSceneBaker.h"
+#include "DebugGeometry.h"
+#include "SceneManagerSelector.h"
+#include "SceneRegistry.h"
+#include "MeshLodBuilder.h"
+#include "ShadowPolicy.h"
+#include "ClusteredLighting.h"
+#include "RenderStateSorter.h"
+#include "TransformCommandBuffer.h"
+#include "CpuParticleSystem.h"
+
 
 using namespace Ogre;
 
+// what the controller drives, filled in while the scene is set up
+struct ClubScene
+{
+  LightHandle lightD, lightP, lightS;
+  AnimationHandle professorAnimations[5];
+  NodeHandle professorNodes[5];
+  NodeHandle cameraYaw, cameraPitch, cameraHolder;
+  NodeHandle night;
+  std::vector<LightHandle> disco;
+};
+
 class InputController : public FrameListener, 
   public OIS::KeyListener, 
   public OIS::MouseListener
 {
 
 public:
-  InputController(Root* root, OIS::Keyboard *keyboard, OIS::Mouse *mouse) : mRoot(root), mKeyboard(keyboard), mMouse(mouse)
+  InputController(Root* root, OIS::Keyboard *keyboard, OIS::Mouse *mouse, SceneRegistry* registry, const ClubScene& scene,
+    ShadowPolicy* shadowPolicy, ClusteredLighting* clusteredLighting, RenderStateSorter* stateSorter,
+    TransformCommandBuffer* commands, CpuParticleSystem* fog, CpuParticleSystem* sparkles)
+    : mRoot(root), mKeyboard(keyboard), mMouse(mouse), mRegistry(registry), mScene(scene), mShadowPolicy(shadowPolicy),
+    mClusteredLighting(clusteredLighting), mStateSorter(stateSorter), mCommands(commands), mFog(fog), mSparkles(sparkles)
   {
-    mSceneMgr = root->getSceneManager("main");
-    mLightD = mSceneMgr->getLight("LightD");
-    mLightP = mSceneMgr->getLight("LightP");
-    mLightS = mSceneMgr->getLight("LightS");
-
-	mProfessorState[0] = mSceneMgr->getEntity("Professor")->getAnimationState("Idle");
-	mProfessorState[1] = mSceneMgr->getEntity("Professor1")->getAnimationState("Walk");
-	mProfessorState[2] = mSceneMgr->getEntity("Professor2")->getAnimationState("Run");
-	mProfessorState[3] = mSceneMgr->getEntity("Professor3")->getAnimationState("Climb");
-	mProfessorState[4] = mSceneMgr->getEntity("Professor4")->getAnimationState("Run");
-
-	for (auto anim : mProfessorState) {
+    mSceneMgr = mRegistry->get(mScene.cameraHolder)->getCreator();
+
+	for (auto handle : mScene.professorAnimations) {
+		AnimationState* anim = mRegistry->get(handle);
 		anim->setLoop(true);
 		anim->setEnabled(true);
 	}
 
-	mProfessorNodes[0] = mSceneMgr->getSceneNode("ProfessorYaw");
-	mProfessorNodes[1] = mSceneMgr->getSceneNode("Professor1");
-	mProfessorNodes[2] = mSceneMgr->getSceneNode("Professor2");
-	mProfessorNodes[3] = mSceneMgr->getSceneNode("Professor3");
-	mProfessorNodes[4] = mSceneMgr->getSceneNode("Professor4");
-
-
-    mCameraYaw = mSceneMgr->getSceneNode("CameraYaw");
-    mCameraPitch = mSceneMgr->getSceneNode("CameraPitch");
-    mCameraHolder = mSceneMgr->getSceneNode("CameraHolder");
-
-	mNightNode = mSceneMgr->getSceneNode("Night");
-
+    _showDisco();
     mContinue = true;
 
     keyboard->setEventCallback(this);
@@ -59,13 +65,14 @@ public:
   {
     mKeyboard->capture();
     mMouse->capture();
-	for (auto anim : mProfessorState) 
-		anim->addTime(evt.timeSinceLastFrame);
+	for (auto handle : mScene.professorAnimations)
+		if (AnimationState* anim = mRegistry->get(handle))
+			anim->addTime(evt.timeSinceLastFrame);
 	
-	for (auto node : mProfessorNodes)
-		node->rotate(Vector3::UNIT_Y, Degree(90 * evt.timeSinceLastFrame));
+	for (auto handle : mScene.professorNodes)
+		mCommands->rotate(handle, Vector3::UNIT_Y, Degree(90 * evt.timeSinceLastFrame));
 	
-	mNightNode->rotate(Vector3::UNIT_Y, Degree(180 * evt.timeSinceLastFrame));
+	mCommands->rotate(mScene.night, Vector3::UNIT_Y, Degree(180 * evt.timeSinceLastFrame));
 
     return mContinue;
   }
@@ -85,9 +92,43 @@ public:
 	  }
 	  break;
 
-	  case OIS::KC_D: mLightD->setVisible(!mLightD->getVisible()); break;
-	  case OIS::KC_P: mLightP->setVisible(!mLightP->getVisible()); break;
-	  case OIS::KC_S: mLightS->setVisible(!mLightS->getVisible()); break;
+	  case OIS::KC_D: _toggle(mScene.lightD); break;
+	  case OIS::KC_P: _toggle(mScene.lightP); break;
+	  case OIS::KC_S: _toggle(mScene.lightS); break;
+	  case OIS::KC_L: MeshLodBuilder::logSavings(mSceneMgr); break;
+	  case OIS::KC_T:
+		  mShadowPolicy->setTechnique(mShadowPolicy->getTechnique() == ShadowPolicy::TECHNIQUE_STENCIL
+			  ? ShadowPolicy::TECHNIQUE_TEXTURE : ShadowPolicy::TECHNIQUE_STENCIL);
+		  _showDisco();
+		  break;
+	  case OIS::KC_G: mShadowPolicy->logStats(); break;
+	  case OIS::KC_C:
+		  // the 27 lights here are far below MIN_LIGHTS, C forces the clusters to compare
+		  mClusteredLighting->setMinLights(mClusteredLighting->getMinLights() ? 0 : ClusteredLighting::MIN_LIGHTS);
+		  LogManager::getSingleton().logMessage(mClusteredLighting->getMinLights() ? "Clustered lights from "
+			  + StringConverter::toString(ClusteredLighting::MIN_LIGHTS) + " lights" : "Clustered lights forced");
+		  break;
+	  case OIS::KC_K:
+		  // compare with C on and off, with the texture shadows of T
+		  mClusteredLighting->logStats();
+		  LogManager::getSingleton().stream() << "Frame: " << 1000.0f / std::max(mRoot->getAutoCreatedWindow()->getLastFPS(), 1.0f)
+			  << " ms over the last second, " << mShadowPolicy->getTechniqueName() << " shadows";
+		  break;
+	  case OIS::KC_R:
+		  mStateSorter->setEnabled(!mStateSorter->isEnabled());
+		  mStateSorter->logStats();
+		  break;
+	  case OIS::KC_E: mStateSorter->logStats(); break;
+	  case OIS::KC_F:
+		  mCommands->setDeferred(!mCommands->isDeferred());
+		  mCommands->logStats();
+		  break;
+	  case OIS::KC_X:
+		  mFog->setSimd(!mFog->isSimd());
+		  mSparkles->setSimd(mFog->isSimd());
+		  mFog->logStats();
+		  mSparkles->logStats();
+		  break;
 	  }
     // ---------------------------------------------------------
 
@@ -111,10 +152,11 @@ public:
 
   bool mouseMoved( const OIS::MouseEvent &evt )
   {
-    mCameraYaw->yaw(Degree(-evt.state.X.rel));
-    mCameraPitch->pitch(Degree(-evt.state.Y.rel));
+    // several mouse events a frame end up in one update per node
+    mCommands->yaw(mScene.cameraYaw, Degree(-evt.state.X.rel));
+    mCommands->pitch(mScene.cameraPitch, Degree(-evt.state.Y.rel));
 
-    mCameraHolder->translate(Ogre::Vector3(0, 0, -evt.state.Z.rel * 0.1f));
+    mCommands->translate(mScene.cameraHolder, Ogre::Vector3(0, 0, -evt.state.Z.rel * 0.1f));
 
     return true;
   }
@@ -131,27 +173,39 @@ public:
 
 
 private:
+  void _toggle(LightHandle handle)
+  {
+    if (Light* light = mRegistry->get(handle))
+      light->setVisible(!light->getVisible());
+  }
+
+  // the disco ring only with texture shadows: with additive stencil shadows
+  // every light is another pass over the whole scene and the clusters have
+  // no say in it
+  void _showDisco(void)
+  {
+    const bool additive = mSceneMgr->isShadowTechniqueAdditive();
+    for (size_t i = 0; i < mScene.disco.size(); i++)
+    {
+      if (Light* light = mRegistry->get(mScene.disco[i]))
+        light->setVisible(!additive);
+    }
+  }
+
   bool mContinue;
   Ogre::Root* mRoot;
   Ogre::SceneManager* mSceneMgr;
   OIS::Keyboard* mKeyboard;
   OIS::Mouse* mMouse;
 
-  Ogre::Light *mLightP, *mLightD, *mLightS;
-
-
-  Ogre::AnimationState* mProfessorState[5];
-  SceneNode* mProfessorNodes[5];
-//  Ogre::AnimationState* mIdleState;
-
-  SceneNode* mCharacterRoot;
-  SceneNode* mCharacterYaw;
-
-  SceneNode* mCameraHolder;
-  SceneNode* mCameraYaw;
-  SceneNode* mCameraPitch;
-
-  SceneNode* mNightNode;
+  SceneRegistry* mRegistry;
+  ClubScene mScene;
+  ShadowPolicy* mShadowPolicy;
+  ClusteredLighting* mClusteredLighting;
+  RenderStateSorter* mStateSorter;
+  TransformCommandBuffer* mCommands;
+  CpuParticleSystem* mFog;
+  CpuParticleSystem* mSparkles;
 
   Ogre::Vector3 mCharacterDirection;
 
@@ -195,7 +249,8 @@ public:
 
     mWindow = mRoot->initialise(true, CLIENT_DESCRIPTION " : Copyleft by Dae-Hyun Lee 2010");
 
-    mSceneMgr = mRoot->createSceneManager(ST_GENERIC, "main");
+    mSceneMgr = SceneManagerSelector::create(mRoot, "main");
+    mRegistry = new SceneRegistry();
 
     mSceneMgr->setAmbientLight(ColourValue(1.0f, 1.0f, 1.0f));
 
@@ -210,8 +265,15 @@ public:
     ResourceGroupManager::getSingleton().addResourceLocation("./", "FileSystem");
     ResourceGroupManager::getSingleton().initialiseAllResourceGroups();
 
+    // reduced levels for the professors, generated once and cached; with the
+    // shadow buffers the stencil shadows and the tangent build below read
+    mLodBuilder = new MeshLodBuilder();
+    mLodBuilder->prepare("DustinBody.mesh", ResourceGroupManager::AUTODETECT_RESOURCE_GROUP_NAME,
+      HardwareBuffer::HBU_DYNAMIC_WRITE_ONLY, HardwareBuffer::HBU_STATIC_WRITE_ONLY, true, true);
+
 
-    _drawGridPlane();
+    StaticSceneBaker::markStatic(DebugGeometry::createAxes(mSceneMgr));
+    DebugGeometry::createGrid(mSceneMgr);
 
     _setLights();
 
@@ -226,6 +288,10 @@ public:
     SceneNode* cameraYaw = professorRoot->createChildSceneNode("CameraYaw", Vector3(0.0f, 120.0f, 0.0f));
     SceneNode* cameraPitch = cameraYaw->createChildSceneNode("CameraPitch");
     SceneNode* cameraHolder = cameraPitch->createChildSceneNode("CameraHolder", Vector3(0.0f, 80.0f, 500.0f));
+    mScene.professorNodes[0] = mRegistry->add(professorYaw);
+    mScene.cameraYaw = mRegistry->add(cameraYaw);
+    mScene.cameraPitch = mRegistry->add(cameraPitch);
+    mScene.cameraHolder = mRegistry->add(cameraHolder);
     
     MeshPtr pMesh = MeshManager::getSingleton().load("DustinBody.mesh",
         ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME,    
@@ -241,30 +307,39 @@ public:
     Entity* entity = mSceneMgr->createEntity("Professor", "DustinBody.mesh");
 	professorYaw->attachObject(entity);
 	entity->setCastShadows(true);
+	mScene.professorAnimations[0] = mRegistry->addAnimation(mRegistry->add(entity), "Idle");
 
 	entity = mSceneMgr->createEntity("Professor1", "DustinBody.mesh");
 	entity->setCastShadows(true);
 	SceneNode* professorCopyNode = professorRoot->createChildSceneNode("Professor1");
 	professorCopyNode->attachObject(entity);
 	professorCopyNode->setPosition(Vector3(100, 0, -100));
+	mScene.professorNodes[1] = mRegistry->add(professorCopyNode);
+	mScene.professorAnimations[1] = mRegistry->addAnimation(mRegistry->add(entity), "Walk");
 
 	entity = mSceneMgr->createEntity("Professor2", "DustinBody.mesh");
 	entity->setCastShadows(true);
 	professorCopyNode = professorRoot->createChildSceneNode("Professor2");
 	professorCopyNode->attachObject(entity);
 	professorCopyNode->setPosition(Vector3(100, 0, 100));
+	mScene.professorNodes[2] = mRegistry->add(professorCopyNode);
+	mScene.professorAnimations[2] = mRegistry->addAnimation(mRegistry->add(entity), "Run");
 
 	entity = mSceneMgr->createEntity("Professor3", "DustinBody.mesh");
 	entity->setCastShadows(true);
 	professorCopyNode = professorRoot->createChildSceneNode("Professor3");
 	professorCopyNode->attachObject(entity);
 	professorCopyNode->setPosition(Vector3(-100, 0, 100));
+	mScene.professorNodes[3] = mRegistry->add(professorCopyNode);
+	mScene.professorAnimations[3] = mRegistry->addAnimation(mRegistry->add(entity), "Climb");
 
 	entity = mSceneMgr->createEntity("Professor4", "DustinBody.mesh");
 	entity->setCastShadows(true);
 	professorCopyNode = professorRoot->createChildSceneNode("Professor4");
 	professorCopyNode->attachObject(entity);
 	professorCopyNode->setPosition(Vector3(-100, 0, -100));    // Fill Here ----------------------------------
+	mScene.professorNodes[4] = mRegistry->add(professorCopyNode);
+	mScene.professorAnimations[4] = mRegistry->addAnimation(mRegistry->add(entity), "Run");
 
     // --------------------------------------------
 
@@ -286,9 +361,35 @@ public:
     mKeyboard = static_cast<OIS::Keyboard*>(mInputManager->createInputObject(OIS::OISKeyboard, true));
     mMouse = static_cast<OIS::Mouse*>( mInputManager->createInputObject(OIS::OISMouse, true));
 
-    InputController* inputController = new InputController(mRoot, mKeyboard, mMouse);
+    // at most two shadow lights and no far or tiny casters, see shadow.cfg
+    ShadowPolicy* shadowPolicy = new ShadowPolicy(mSceneMgr, mCamera);
+    shadowPolicy->addAllCasters();
+
+    // the professors take their lights from the clusters of the main camera,
+    // once there are enough lights and with texture shadows; K logs which
+    ClusteredLighting* clusteredLighting = new ClusteredLighting(mSceneMgr, mCamera);
+    clusteredLighting->addAllEntities();
+
+    // opaque passes grouped by program, texture and state
+    RenderStateSorter* stateSorter = new RenderStateSorter(mSceneMgr);
+
+    // node transforms from input and animation, applied before the scene graph update
+    TransformCommandBuffer* commands = new TransformCommandBuffer(mSceneMgr, mRegistry);
+
+    // fog drifting over the floor and sparkles thrown out by the turning spots
+    CpuParticleSystem* fog = new CpuParticleSystem("Fog", 4000, CpuParticleSystem::FOG_MATERIAL);
+    CpuParticleSystem* sparkles = new CpuParticleSystem("Sparkles", 6000, CpuParticleSystem::SPARKLE_MATERIAL);
+    _addParticleEffects(fog, sparkles);
+
+    InputController* inputController = new InputController(mRoot, mKeyboard, mMouse, mRegistry, mScene,
+      shadowPolicy, clusteredLighting, stateSorter, commands, fog, sparkles);
     mRoot->addFrameListener(inputController);
 
+    // bake everything marked static into 1000 unit regions: the 100 ground
+    // tiles become one batch, the axes stay one of their own
+    StaticSceneBaker* staticBaker = new StaticSceneBaker(mSceneMgr, "StaticScene", Vector3(1000.0f, 1000.0f, 1000.0f));
+    staticBaker->bake();
+
     mRoot->startRendering();
 
     mInputManager->destroyInputObject(mKeyboard);
@@ -297,7 +398,20 @@ public:
 
     delete inputController;
 
+    // before the root, they hold hardware buffers
+    sparkles->detachFromParent();
+    fog->detachFromParent();
+    delete sparkles;
+    delete fog;
+
+    delete commands;
+    delete stateSorter;
+    delete clusteredLighting;
+    delete shadowPolicy;
+    delete staticBaker;
     delete mRoot;
+    delete mRegistry;
+    delete mLodBuilder;
   }
 
 private:
@@ -325,8 +439,13 @@ private:
 	  mLightS->setSpotlightRange(Degree(10), Degree(80));
 	  mLightS->setVisible(false);
 
+	  mScene.lightD = mRegistry->add(mLightD);
+	  mScene.lightP = mRegistry->add(mLightP);
+	  mScene.lightS = mRegistry->add(mLightS);
+
 	  SceneNode * NightNode = 
 		  mSceneMgr->getRootSceneNode()->createChildSceneNode("Night", Vector3(0, 50, 0));
+	  mScene.night = mRegistry->add(NightNode);
 
 	  Light * mLightRed = mSceneMgr->createLight("LightRed");
 	  mLightRed->setType(Light::LT_SPOTLIGHT);
@@ -354,61 +473,83 @@ private:
 	  mLightBlue->setDiffuseColour(0.f, 0.f, 1.f);
 	  mLightBlue->setVisible(true);
 	  NightNode->attachObject(mLightBlue);
+
+	  // a ring of short range lights turning with the spots, each professor
+	  // only gets the few that reach it; shown with texture shadows (T) only
+	  const int discoLights = 24;
+	  for (int i = 0; i < discoLights; i++)
+	  {
+		  const Radian angle(Math::TWO_PI * i / discoLights);
+		  Light* disco = mSceneMgr->createLight("Disco" + StringConverter::toString(i));
+		  disco->setType(Light::LT_POINT);
+		  disco->setPosition(Vector3(Math::Cos(angle) * 200.0f, 0.0f, Math::Sin(angle) * 200.0f));
+		  disco->setDiffuseColour(i % 3 == 0 ? 1.0f : 0.0f, i % 3 == 1 ? 1.0f : 0.0f, i % 3 == 2 ? 1.0f : 0.0f);
+		  disco->setAttenuation(150.0f, 1.0f, 0.03f, 0.0033f);
+		  disco->setCastShadows(false);
+		  NightNode->attachObject(disco);
+		  mScene.disco.push_back(mRegistry->add(disco));
+	  }
     // --------------------------------------------------------------------------------------------------------
   }
 
-  void _drawGroundPlane(void)
+  void _addParticleEffects(CpuParticleSystem* fog, CpuParticleSystem* sparkles)
   {
-	  // Fill Here ----------------------------------------------------------------------------------------------
+	  SceneNode* nightNode = mRegistry->get(mScene.night);
+
+	  // slow puffs sinking from the spots onto the floor
+	  ParticlePool::Emitter puff;
+	  puff.rate = 800.0f;
+	  puff.lifeMin = 4.0f;
+	  puff.lifeMax = 6.0f;
+	  puff.speedMin = 5.0f;
+	  puff.speedMax = 20.0f;
+	  puff.angle = 1.5f;
+	  puff.sizeStart = 20.0f;
+	  puff.sizeEnd = 60.0f;
+	  puff.box[0] = puff.box[2] = 250.0f;
+	  puff.position[1] = -40.0f;
+	  const float fogStart[4] = { 0.6f, 0.6f, 0.7f, 0.25f }, fogEnd[4] = { 0.3f, 0.3f, 0.4f, 0.0f };
+	  memcpy(puff.colourStart, fogStart, sizeof(fogStart));
+	  memcpy(puff.colourEnd, fogEnd, sizeof(fogEnd));
+	  fog->addEmitter(nightNode, puff);
+	  fog->getPool().setDrag(0.5f);
+
+	  // one jet along each spot, the node turns them
+	  const Vector3 directions[3] = { Vector3(-1, 0.3f, -0.5f), Vector3(1, 0.3f, -0.5f), Vector3(0, 0.3f, 1) };
+	  const ColourValue colours[3] = { ColourValue::Red, ColourValue::Green, ColourValue::Blue };
+	  for (int i = 0; i < 3; i++)
+	  {
+		  ParticlePool::Emitter jet;
+		  jet.rate = 1500.0f;
+		  jet.lifeMin = 0.5f;
+		  jet.lifeMax = 1.5f;
+		  jet.speedMin = 100.0f;
+		  jet.speedMax = 300.0f;
+		  jet.angle = 0.3f;
+		  jet.sizeStart = 2.0f;
+		  jet.sizeEnd = 0.5f;
+		  memcpy(jet.direction, directions[i].normalisedCopy().ptr(), sizeof(jet.direction));
+		  const ColourValue start = colours[i] + ColourValue(0.5f, 0.5f, 0.5f, 0.0f);
+		  memcpy(jet.colourStart, start.ptr(), sizeof(jet.colourStart));
+		  memcpy(jet.colourEnd, colours[i].ptr(), sizeof(jet.colourEnd));
+		  jet.colourEnd[3] = 0.0f;
+		  sparkles->addEmitter(nightNode, jet);
+	  }
+	  sparkles->getPool().setGravity(0.0f, -98.0f, 0.0f);
+	  sparkles->getPool().setDrag(0.2f);
 
-	  Plane plane(Vector3::UNIT_Y, 0);
-	  MeshManager::getSingleton().createPlane(
-		  "Ground",
-		  ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME,
-		  plane,
-		  500, 500,
-		  1, 1,
-		  true, 1, 10, 10,
-		  Vector3::NEGATIVE_UNIT_Z
-		  );
-
-	  Entity* groundEntity = mSceneMgr->createEntity("GroundPlane", "Ground");
-	  mSceneMgr->getRootSceneNode()->createChildSceneNode()->attachObject(groundEntity);
-	  groundEntity->setMaterialName("KPU_LOGO");
-	  groundEntity->setCastShadows(false);
-	  // --------------------------------------------------------------------------------------------------------
+	  // particles are in world space
+	  mSceneMgr->getRootSceneNode()->attachObject(fog);
+	  mSceneMgr->getRootSceneNode()->attachObject(sparkles);
   }
 
-  void _drawGridPlane(void)
+  void _drawGroundPlane(void)
   {
-    // ǥ ǥ
-    Ogre::Entity* mAxesEntity = mSceneMgr->createEntity("Axes", "axes.mesh");
-    mSceneMgr->getRootSceneNode()->createChildSceneNode("AxesNode",Ogre::Vector3(0,0,0))->attachObject(mAxesEntity);
-    mSceneMgr->getSceneNode("AxesNode")->setScale(5, 5, 5);
-
-    Ogre::ManualObject* gridPlane =  mSceneMgr->createManualObject("GridPlane"); 
-    Ogre::SceneNode* gridPlaneNode = mSceneMgr->getRootSceneNode()->createChildSceneNode("GridPlaneNode"); 
-
-    Ogre::MaterialPtr gridPlaneMaterial = Ogre::MaterialManager::getSingleton().create("GridPlanMaterial","General"); 
-    gridPlaneMaterial->setReceiveShadows(false); 
-    gridPlaneMaterial->getTechnique(0)->setLightingEnabled(true); 
-    gridPlaneMaterial->getTechnique(0)->getPass(0)->setDiffuse(1,1,1,0); 
-    gridPlaneMaterial->getTechnique(0)->getPass(0)->setAmbient(1,1,1); 
-    gridPlaneMaterial->getTechnique(0)->getPass(0)->setSelfIllumination(1,1,1); 
-
-    gridPlane->begin("GridPlaneMaterial", Ogre::RenderOperation::OT_LINE_LIST); 
-    for(int i=0; i<21; i++)
-    {
-      gridPlane->position(-500.0f, 0.0f, 500.0f-i*50);
-      gridPlane->position(500.0f, 0.0f, 500.0f-i*50);
-
-      gridPlane->position(-500.f+i*50, 0.f, 500.0f);
-      gridPlane->position(-500.f+i*50, 0.f, -500.f);
-    }
-
-    gridPlane->end(); 
+	  // Fill Here ----------------------------------------------------------------------------------------------
 
-    gridPlaneNode->attachObject(gridPlane);
+	  // the texture once per tile, so the tiles share the material and bake into one batch
+	  StaticSceneBaker::createTiledGround(mSceneMgr, "Ground", "KPU_LOGO", 500.0f, 10);
+	  // --------------------------------------------------------------------------------------------------------
   }
 
 
@@ -420,6 +561,10 @@ private:
 
   Ogre::Light *mLightP, *mLightD, *mLightS;
 
+  SceneRegistry* mRegistry;
+  ClubScene mScene;
+  MeshLodBuilder* mLodBuilder;
+
   OIS::Keyboard* mKeyboard;
   OIS::Mouse* mMouse;
   OIS::InputManager *mInputManager;
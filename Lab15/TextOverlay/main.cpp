@@ -14,6 +14,10 @@
 #include <Overlay/OgreTextAreaOverlayElement.h>
 #include <Overlay/OgreFontManager.h>
 
+#include "StaticSceneBaker.h"
+#include "DebugGeometry.h"
+#include "SceneManagerSelector.h"
+
 using namespace Ogre;
 
 class InputController : public FrameListener,
@@ -167,7 +171,7 @@ public:
 
 		mWindow = mRoot->initialise(true, CLIENT_DESCRIPTION " : Copyleft by Dae-Hyun Lee");
 
-		mSceneMgr = mRoot->createSceneManager(ST_GENERIC, "main");
+		mSceneMgr = SceneManagerSelector::create(mRoot, "main");
 
 		mOverlaySystem = new Ogre::OverlaySystem();
 		mSceneMgr->addRenderQueueListener(mOverlaySystem);
@@ -185,7 +189,8 @@ public:
 		ResourceGroupManager::getSingleton().initialiseAllResourceGroups();
 
 
-		_drawGridPlane();
+		StaticSceneBaker::markStatic(DebugGeometry::createAxes(mSceneMgr));
+		DebugGeometry::createGrid(mSceneMgr);
 
 		_setLights();
 
@@ -229,6 +234,11 @@ public:
 		InputController* inputController = new InputController(mRoot, mKeyboard, mMouse);
 		mRoot->addFrameListener(inputController);
 
+		// bake everything marked static into 1000 unit regions: the 25 ground
+		// tiles become one batch, the axes stay one of their own
+		StaticSceneBaker* staticBaker = new StaticSceneBaker(mSceneMgr, "StaticScene", Vector3(1000.0f, 1000.0f, 1000.0f));
+		staticBaker->bake();
+
 		mRoot->startRendering();
 
 		mInputManager->destroyInputObject(mKeyboard);
@@ -237,6 +247,7 @@ public:
 
 		delete inputController;
 
+		delete staticBaker;
 		delete mRoot;
 	}
 
@@ -283,53 +294,8 @@ private:
 
 	void _drawGroundPlane(void)
 	{
-		Plane plane(Vector3::UNIT_Y, 0);
-		MeshManager::getSingleton().createPlane(
-			"Ground",
-			ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME,
-			plane,
-			500, 500,
-			1, 1,
-			true, 1, 5, 5,
-			Vector3::NEGATIVE_UNIT_Z
-			);
-
-		Entity* groundEntity = mSceneMgr->createEntity("GroundPlane", "Ground");
-		mSceneMgr->getRootSceneNode()->createChildSceneNode()->attachObject(groundEntity);
-		groundEntity->setMaterialName("KPU_LOGO");
-		groundEntity->setCastShadows(false);
-	}
-
-	void _drawGridPlane(void)
-	{
-		// ǥ ǥ
-		Ogre::Entity* mAxesEntity = mSceneMgr->createEntity("Axes", "axes.mesh");
-		mSceneMgr->getRootSceneNode()->createChildSceneNode("AxesNode", Ogre::Vector3(0, 0, 0))->attachObject(mAxesEntity);
-		mSceneMgr->getSceneNode("AxesNode")->setScale(5, 5, 5);
-
-		Ogre::ManualObject* gridPlane = mSceneMgr->createManualObject("GridPlane");
-		Ogre::SceneNode* gridPlaneNode = mSceneMgr->getRootSceneNode()->createChildSceneNode("GridPlaneNode");
-
-		Ogre::MaterialPtr gridPlaneMaterial = Ogre::MaterialManager::getSingleton().create("GridPlanMaterial", "General");
-		gridPlaneMaterial->setReceiveShadows(false);
-		gridPlaneMaterial->getTechnique(0)->setLightingEnabled(true);
-		gridPlaneMaterial->getTechnique(0)->getPass(0)->setDiffuse(1, 1, 1, 0);
-		gridPlaneMaterial->getTechnique(0)->getPass(0)->setAmbient(1, 1, 1);
-		gridPlaneMaterial->getTechnique(0)->getPass(0)->setSelfIllumination(1, 1, 1);
-
-		gridPlane->begin("GridPlaneMaterial", Ogre::RenderOperation::OT_LINE_LIST);
-		for (int i = 0; i < 21; i++)
-		{
-			gridPlane->position(-500.0f, 0.0f, 500.0f - i * 50);
-			gridPlane->position(500.0f, 0.0f, 500.0f - i * 50);
-
-			gridPlane->position(-500.f + i * 50, 0.f, 500.0f);
-			gridPlane->position(-500.f + i * 50, 0.f, -500.f);
-		}
-
-		gridPlane->end();
-
-		gridPlaneNode->attachObject(gridPlane);
+		// the texture once per tile, so the tiles share the material and bake into one batch
+		StaticSceneBaker::createTiledGround(mSceneMgr, "Ground", "KPU_LOGO", 500.0f, 5);
 	}
 
 